@@ -41,6 +41,8 @@ struct cpifaceSessionPrivate_t
 	uint64_t              mcpPauseTarget;
 
 	uint64_t              SongStart;
+
+	uint32_t              dirdb_ref; /* used by cpitime.c to update the media database */
 };
 
 extern OCP_INTERNAL struct cpifaceSessionPrivate_t cpifaceSessionAPI;
@@ -60,6 +62,11 @@ OCP_INTERNAL void cpiLinksDone (void);
 OCP_INTERNAL void cpiMVolInit (void);
 OCP_INTERNAL void cpiMVolDone (void);
 OCP_INTERNAL void cpiPhaseInit (void);
+OCP_INTERNAL void cpiProfInit (void);
+OCP_INTERNAL void cpiProfDone (void);
+OCP_INTERNAL void cpiSongTimeSetup (struct cpifaceSessionAPI_t *cpifaceSession);
+OCP_INTERNAL void cpiSongTimeIdle (struct cpifaceSessionAPI_t *cpifaceSession);
+OCP_INTERNAL void cpiSongTimeClose (void);
 OCP_INTERNAL void cpiPhaseDone (void);
 OCP_INTERNAL void cpiScopeInit (void);
 OCP_INTERNAL void cpiScopeDone (void);
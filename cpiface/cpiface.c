@@ -74,6 +74,7 @@
 #include "stuff/err.h"
 #include "stuff/imsrtns.h"
 #include "stuff/framelock.h"
+#include "stuff/profile.h"
 #include "stuff/latin1.h"
 #include "stuff/piperun.h"
 #include "stuff/poll.h"
@@ -2197,6 +2198,7 @@ static int plmpInit (const struct configAPI_t *configAPI)
 	cpiLinksInit ();
 	cpiMVolInit ();
 	cpiPhaseInit ();
+	cpiProfInit ();
 	cpiScopeInit ();
 	cpiTrackInit ();
 	cpiVolCtrlInit ();
@@ -2212,6 +2214,7 @@ static void plmpClose (void)
 	cpiLinksDone ();
 	cpiMVolDone ();
 	cpiPhaseDone ();
+	cpiProfDone ();
 	cpiScopeDone ();
 	cpiVolCtrlDone ();
 	plOpenCPPicDone ();
@@ -2272,8 +2275,11 @@ static void cpifaceIdle (void)
 	}
 	if (cpifaceSessionAPI.Public.IsEnd)
 	{
+		uint64_t start = profile_now ();
 		cpifaceSessionAPI.Public.IsEnd (&cpifaceSessionAPI.Public, fsLoopMods);
+		profile_add (profileStagePlayerIdle, start);
 	}
+	cpiSongTimeIdle (&cpifaceSessionAPI.Public);
 }
 
 static char NoteStr[134][4]=
@@ -2333,6 +2339,7 @@ static int plmpOpenFile(struct moduleinfostruct *info, struct ocpfilehandle_t *f
 	cpifaceSessionAPI.Public.console = &Console;
 	cpifaceSessionAPI.Public.dirdb = &dirdbAPI;
 	cpifaceSessionAPI.Public.PipeProcess = &PipeProcess;
+	cpifaceSessionAPI.Public.profileAPI = &profileAPI;
 #ifndef _WIN32
 	cpifaceSessionAPI.Public.dmFile = dmFile;
 #endif
@@ -2394,6 +2401,8 @@ static int plmpOpenFile(struct moduleinfostruct *info, struct ocpfilehandle_t *f
 	cpifaceSessionAPI.Public.cpiTextRecalc = cpiTextRecalc;
 	cpifaceSessionAPI.Public.latin1_f_to_utf8_z = latin1_f_to_utf8_z;
 	cpifaceSessionAPI.Public.cpiDebug = cpiDebug;
+	cpiSongTimeSetup (&cpifaceSessionAPI.Public);
+	cpifaceSessionAPI.dirdb_ref = fi->dirdb_ref;
 #ifdef _WIN32
 	cpifaceSessionAPI.Public.utf8_to_utf16_LFN = utf8_to_utf16_LFN;
 	cpifaceSessionAPI.Public.utf16_to_utf8 = utf16_to_utf8;
@@ -2401,6 +2410,8 @@ static int plmpOpenFile(struct moduleinfostruct *info, struct ocpfilehandle_t *f
 
 	curplayer=cp;
 
+	profile_reset ();
+
 	cpifaceSessionAPI.openStatus = curplayer->OpenFile (&cpifaceSessionAPI.Public, info, fi);
 	if (cpifaceSessionAPI.openStatus)
 	{
@@ -2409,6 +2420,7 @@ static int plmpOpenFile(struct moduleinfostruct *info, struct ocpfilehandle_t *f
 		{
 			cpifaceSessionAPI.Public.cpiDebug (&cpifaceSessionAPI.Public, "Configuration of playback device driver is accessible in the setup: drive.\n");
 		}
+		cpiSongTimeClose ();
 		curplayer->CloseFile (&cpifaceSessionAPI.Public);
 		curplayer = 0;
 		return 1;
@@ -2436,6 +2448,7 @@ static void plmpCloseFile (void)
 	if (curplayer)
 	{
 		cpiGetMode (curmodehandle);
+		cpiSongTimeClose ();
 		curplayer->CloseFile (&cpifaceSessionAPI.Public);
 		while (cpiModes)
 		{
@@ -2605,7 +2618,10 @@ static interfaceReturnEnum plmpDrawScreen(void)
 
 	if (cpifaceSessionAPI.Public.IsEnd)
 	{
-		if (cpifaceSessionAPI.Public.IsEnd(&cpifaceSessionAPI.Public, fsLoopMods))
+		uint64_t start = profile_now ();
+		int isend = cpifaceSessionAPI.Public.IsEnd(&cpifaceSessionAPI.Public, fsLoopMods);
+		profile_add (profileStagePlayerIdle, start);
+		if (isend)
 		{
 			plInKeyboardHelp = 0;
 			return interfaceReturnNextAuto;
@@ -2791,7 +2807,9 @@ static interfaceReturnEnum plmpDrawScreen(void)
 superbreak:
 	if (curmode)
 	{
+		uint64_t start = profile_now ();
 		curmode->Draw(&cpifaceSessionAPI.Public);
+		profile_add (profileStageDraw, start);
 	}
 	framelock();
 
@@ -33,6 +33,7 @@ struct notedotsdata;
 struct insdisplaystruct;
 struct cpitrakdisplaystruct;
 struct PipeProcessAPI_t;
+struct profileAPI_t;
 
 struct cpifaceplayerstruct
 {
@@ -253,6 +254,7 @@ struct cpifaceSessionAPI_t
 	const struct console_t          *console;
 	const struct dirdbAPI_t         *dirdb;
 	const struct PipeProcessAPI_t   *PipeProcess;
+	const struct profileAPI_t       *profileAPI;
 	      struct dmDrive            *dmFile;
 
 	int plrActive; /* currently used to detect if plrAPI->ProcessKey should be processed, later it will replaced by a handle instead */
@@ -321,6 +323,12 @@ struct cpifaceSessionAPI_t
 
 	void (*cpiDebug) (struct cpifaceSessionAPI_t *, const char *fmt, ...);
 
+	/* Optional background calculation of order/row to song-time table for tracked formats, cached in adbMeta. Times are given in 1/65536 seconds */
+	uint32_t (*SongTimeHash) (uint32_t hash, const void *data, size_t len); /* start with hash=0, used to key the cache on the song data */
+	void (*SongTimeRegister) (struct cpifaceSessionAPI_t *cpifaceSession, const char *sig, uint32_t hash, uint_fast16_t orders, int (*Step)(struct cpifaceSessionAPI_t *cpifaceSession, int ticks, uint32_t *length)); /* Step() simulates the given amount of ticks and returns non-zero with length filled in when the song loops */
+	void (*SongTimeRow) (struct cpifaceSessionAPI_t *cpifaceSession, uint_fast16_t ord, uint_fast8_t row, uint32_t time); /* called by Step() when a row is reached */
+	void (*SongTimeSeek) (struct cpifaceSessionAPI_t *cpifaceSession, uint_fast16_t ord, uint_fast8_t row); /* called after a seek, sets the timer in the top-right corner to the time of ord/row if it is known (yet) */
+
 #ifdef _WIN32
 	uint16_t *(*utf8_to_utf16_LFN) (const char *src, const int slashstar);
 	char *(*utf16_to_utf8) (const uint16_t *src);
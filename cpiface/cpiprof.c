@@ -0,0 +1,168 @@
+/* OpenCP Module Player
+ * copyright (c) 2026 Stian Skjelstad <stian.skjelstad@gmail.com>
+ *
+ * CPIface text mode profiler, shows time spent in the audio and video hot paths
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "config.h"
+#include "types.h"
+#include "boot/psetting.h"
+#include "cpiface.h"
+#include "cpiface-private.h"
+#include "stuff/framelock.h"
+#include "stuff/poutput.h"
+#include "stuff/profile.h"
+
+#define COLTITLE 0x01
+#define COLTITLEH 0x09
+
+static int ProfActive;
+static int ProfFirstLine;
+static int ProfFirstCol;
+static int ProfHeight;
+static int ProfWidth;
+
+static void ProfDraw (struct cpifaceSessionAPI_t *cpifaceSession, int focus)
+{
+	struct profileStats_t stats;
+	int i;
+	int y = ProfFirstLine;
+	int barwidth = ProfWidth - 54;
+	uint32_t frame_us = fsFPS ? 1000000 / fsFPS : 1000000;
+
+	display_nprintf (y++, ProfFirstCol, focus ? COLTITLEH : COLTITLE, ProfWidth, "   profiler %.7o(time spent per frame in \xe6s, %u frames average)", PROFILE_FRAMES - 1);
+	display_nprintf (y++, ProfFirstCol, 0x08, ProfWidth, "   stage              last      avg      max");
+
+	for (i=0; (i < profileStageCount) && (y < (ProfFirstLine + ProfHeight)); i++)
+	{
+		int bar = 0;
+
+		profile_get_stats (i, &stats);
+		if (barwidth > 0)
+		{
+			bar = (uint64_t)stats.avg * barwidth / frame_us;
+			if (bar > barwidth)
+			{
+				bar = barwidth;
+			}
+		}
+		display_nprintf (y++, ProfFirstCol, 0x07, ProfWidth, "   %-16s %8u %8u %8u  %.9o%*C\xfe%.8o%*C\xfa",
+			profile_stage_name (i),
+			stats.last, stats.avg, stats.max,
+			bar,
+			(barwidth > 0) ? (barwidth - bar) : 0);
+	}
+
+	if (y < (ProfFirstLine + ProfHeight))
+	{
+		profile_get_buffer (&stats);
+		display_nprintf (y++, ProfFirstCol, 0x07, ProfWidth, "   %-16s %8u %8u %8u  ms (min %u ms)   %.*oxruns: %u",
+			"buffer fill",
+			stats.last, stats.avg, stats.max, stats.min,
+			profile_get_xruns () ? 0x0c : 0x07,
+			profile_get_xruns ());
+	}
+
+	for (; y < (ProfFirstLine + ProfHeight); y++)
+	{
+		displayvoid (y, ProfFirstCol, ProfWidth);
+	}
+}
+
+static void ProfSetWin (struct cpifaceSessionAPI_t *cpifaceSession, int xpos, int wid, int ypos, int hgt)
+{
+	ProfFirstCol = xpos;
+	ProfFirstLine = ypos;
+	ProfWidth = wid;
+	ProfHeight = hgt;
+}
+
+static int ProfGetWin (struct cpifaceSessionAPI_t *cpifaceSession, struct cpitextmodequerystruct *q)
+{
+	if (!ProfActive)
+	{
+		return 0;
+	}
+
+	q->hgtmin = 3;
+	q->hgtmax = profileStageCount + 3;
+	q->xmode = 1;
+	q->size = 1;
+	q->top = 0;
+	q->killprio = 112;
+	q->viewprio = 100;
+	return 1;
+}
+
+static int ProfIProcessKey (struct cpifaceSessionAPI_t *cpifaceSession, uint16_t key)
+{
+	switch (key)
+	{
+		case KEY_ALT_K:
+			cpiKeyHelp(KEY_ALT_P, "Enable profiler");
+			break;
+		case KEY_ALT_P:
+			ProfActive = 1;
+			cpiTextSetMode (cpifaceSession, "prof");
+			return 1;
+	}
+	return 0;
+}
+
+static int ProfAProcessKey (struct cpifaceSessionAPI_t *cpifaceSession, uint16_t key)
+{
+	switch (key)
+	{
+		case KEY_ALT_K:
+			cpiKeyHelp(KEY_ALT_P, "Toggle profiler off");
+			cpiKeyHelp(KEY_HOME, "Reset profiler counters");
+			return 0;
+		case KEY_ALT_P:
+			ProfActive = !ProfActive;
+			cpiTextRecalc (cpifaceSession);
+			break;
+		case KEY_HOME:
+			profile_reset ();
+			break;
+		default:
+			return 0;
+	}
+	return 1;
+}
+
+static int ProfEvent (struct cpifaceSessionAPI_t *cpifaceSession, int ev)
+{
+	switch (ev)
+	{
+		case cpievInitAll:
+			ProfActive = cfGetProfileBool2 (cfScreenSec, "screen", "profiler", 0, 0);
+			return 1;
+	}
+	return 1;
+}
+
+static struct cpitextmoderegstruct cpiTModeProf = {"prof", ProfGetWin, ProfSetWin, ProfDraw, ProfIProcessKey, ProfAProcessKey, ProfEvent CPITEXTMODEREGSTRUCT_TAIL};
+
+OCP_INTERNAL void cpiProfInit (void)
+{
+	cpiTextRegisterDefMode (&cpiTModeProf);
+}
+
+OCP_INTERNAL void cpiProfDone (void)
+{
+	cpiTextUnregisterDefMode (&cpiTModeProf);
+}
@@ -0,0 +1,302 @@
+/* OpenCP Module Player
+ * copyright (c) 2026 Stian Skjelstad <stian.skjelstad@gmail.com>
+ *
+ * CPIface background calculation of order/row to song-time tables for
+ * tracked formats. Results are cached in adbMeta and the resulting song
+ * length is written into the media database.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "config.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "types.h"
+#include "cpiface.h"
+#include "cpiface-private.h"
+#include "dev/player.h"
+#include "filesel/adbmeta.h"
+#include "filesel/mdb.h"
+#include "stuff/compat.h"
+
+#define SONGTIME_SLICE_TICKS 256                 /* ticks simulated per call to Step() */
+#define SONGTIME_SLICE_MS    2                   /* time budget per cpifaceIdle() */
+#define SONGTIME_LIMIT       (8 * 60 * 60 * 65536) /* give up if the song has not looped after 8 hours */
+
+/* adbMeta blob:
+ *   uint32_t length  (1/65536 seconds, 0 = song never looped)
+ *   n * { uint16_t order, uint8_t row, uint8_t reserved, uint32_t time }
+ * all values are little-endian
+ */
+#define SONGTIME_HEADER 4
+#define SONGTIME_RECORD 8
+
+static int (*SongTimeStep) (struct cpifaceSessionAPI_t *cpifaceSession, int ticks, uint32_t *length);
+static char SongTimeSIG[16];
+static char SongTimeKey[9];
+static int32_t **SongTimeTable; /* [order][256] */
+static uint_fast16_t SongTimeOrders;
+static uint32_t SongTimeRows;
+static uint32_t SongTimeLast;
+static uint32_t SongTimeLength;
+
+static uint32_t cpiSongTimeHash (uint32_t hash, const void *data, size_t len)
+{ /* FNV-1a */
+	const uint8_t *src = data;
+
+	if (!hash)
+	{
+		hash = 0x811c9dc5;
+	}
+	while (len--)
+	{
+		hash ^= *src++;
+		hash *= 0x01000193;
+	}
+	return hash;
+}
+
+static void cpiSongTimeRow (struct cpifaceSessionAPI_t *cpifaceSession, uint_fast16_t ord, uint_fast8_t row, uint32_t time)
+{
+	SongTimeLast = time;
+
+	if (ord >= SongTimeOrders)
+	{
+		return;
+	}
+	if (!SongTimeTable[ord])
+	{
+		int i;
+		if (!(SongTimeTable[ord] = malloc (sizeof (int32_t) * 256)))
+		{
+			return;
+		}
+		for (i=0; i < 256; i++)
+		{
+			SongTimeTable[ord][i] = -1;
+		}
+	}
+	if (SongTimeTable[ord][row] < 0)
+	{
+		SongTimeTable[ord][row] = time;
+		SongTimeRows++;
+	}
+}
+
+static int32_t cpiSongTimeGet (struct cpifaceSessionAPI_t *cpifaceSession, uint_fast16_t ord, uint_fast8_t row)
+{
+	if ((ord >= SongTimeOrders) || (!SongTimeTable[ord]))
+	{
+		return -1;
+	}
+	return SongTimeTable[ord][row];
+}
+
+static void cpiSongTimeSeek (struct cpifaceSessionAPI_t *cpifaceSession, uint_fast16_t ord, uint_fast8_t row)
+{
+	struct cpifaceSessionPrivate_t *f = (struct cpifaceSessionPrivate_t *)cpifaceSession;
+	int32_t time = cpiSongTimeGet (cpifaceSession, ord, row);
+	uint64_t tail;
+
+	if (time < 0)
+	{ /* not simulated yet, the timer keeps counting from where it was */
+		return;
+	}
+	cpifaceSession->plrDevAPI->GetStats (0, &tail);
+	f->SongStart = tail - (((uint64_t)time * cpifaceSession->plrDevAPI->GetRate ()) >> 16);
+}
+
+static void cpiSongTimeSetLength (struct cpifaceSessionAPI_t *cpifaceSession, uint32_t length, int store)
+{
+	uint32_t seconds = (length + 32768) >> 16;
+	uint32_t mdb_ref;
+	struct moduleinfostruct mi;
+
+	SongTimeLength = length;
+	if (!length)
+	{
+		return;
+	}
+	if (seconds > 0xffff)
+	{
+		seconds = 0xffff;
+	}
+	cpifaceSession->mdbdata.playtime = seconds;
+
+	if (!store)
+	{
+		return;
+	}
+
+	mdb_ref = mdbGetModuleReference2 (cpifaceSessionAPI.dirdb_ref, cpifaceSession->mdbdata.size);
+	if (mdb_ref == UINT32_MAX)
+	{
+		return;
+	}
+	if (mdbGetModuleInfo (&mi, mdb_ref) && (mi.playtime != seconds))
+	{
+		mi.playtime = seconds;
+		mdbWriteModuleInfo (mdb_ref, &mi);
+	}
+}
+
+static void cpiSongTimeStore (void)
+{
+	uint8_t *data, *dst;
+	uint32_t datasize = SONGTIME_HEADER + SongTimeRows * SONGTIME_RECORD;
+	uint_fast16_t ord;
+	int row;
+
+	if (!(data = malloc (datasize)))
+	{
+		return;
+	}
+
+	data[0] = SongTimeLength;
+	data[1] = SongTimeLength >> 8;
+	data[2] = SongTimeLength >> 16;
+	data[3] = SongTimeLength >> 24;
+	dst = data + SONGTIME_HEADER;
+
+	for (ord = 0; ord < SongTimeOrders; ord++)
+	{
+		if (!SongTimeTable[ord])
+		{
+			continue;
+		}
+		for (row = 0; row < 256; row++)
+		{
+			uint32_t time = SongTimeTable[ord][row];
+			if (SongTimeTable[ord][row] < 0)
+			{
+				continue;
+			}
+			dst[0] = ord;
+			dst[1] = ord >> 8;
+			dst[2] = row;
+			dst[3] = 0;
+			dst[4] = time;
+			dst[5] = time >> 8;
+			dst[6] = time >> 16;
+			dst[7] = time >> 24;
+			dst += SONGTIME_RECORD;
+		}
+	}
+
+	adbMetaAdd (SongTimeKey, cpifaceSessionAPI.Public.mdbdata.size, SongTimeSIG, data, datasize);
+	free (data);
+}
+
+static int cpiSongTimeLoad (struct cpifaceSessionAPI_t *cpifaceSession)
+{
+	const unsigned char *data = 0;
+	uint32_t datasize = 0;
+	uint32_t i;
+
+	if (adbMetaGetRef (SongTimeKey, cpifaceSession->mdbdata.size, SongTimeSIG, &data, &datasize))
+	{
+		return 0;
+	}
+	if ((datasize < SONGTIME_HEADER) || ((datasize - SONGTIME_HEADER) % SONGTIME_RECORD))
+	{
+		return 0;
+	}
+
+	for (i = SONGTIME_HEADER; i < datasize; i += SONGTIME_RECORD)
+	{
+		cpiSongTimeRow (cpifaceSession,
+			data[i + 0] | (data[i + 1] << 8),
+			data[i + 2],
+			data[i + 4] | (data[i + 5] << 8) | (data[i + 6] << 16) | ((uint32_t)data[i + 7] << 24));
+	}
+	cpiSongTimeSetLength (cpifaceSession, data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24), 0);
+
+	return 1;
+}
+
+static void cpiSongTimeRegister (struct cpifaceSessionAPI_t *cpifaceSession, const char *sig, uint32_t hash, uint_fast16_t orders, int (*Step)(struct cpifaceSessionAPI_t *cpifaceSession, int ticks, uint32_t *length))
+{
+	cpiSongTimeClose ();
+
+	if (!(SongTimeTable = calloc (orders, sizeof (SongTimeTable[0]))))
+	{
+		return;
+	}
+	SongTimeOrders = orders;
+	snprintf (SongTimeSIG, sizeof (SongTimeSIG), "%s", sig);
+	snprintf (SongTimeKey, sizeof (SongTimeKey), "%08"PRIx32, hash);
+
+	if (cpiSongTimeLoad (cpifaceSession))
+	{
+		cpifaceSession->cpiDebug (cpifaceSession, "[CPI] song time table for %s loaded from cache\n", SongTimeKey);
+		return;
+	}
+
+	SongTimeStep = Step;
+}
+
+OCP_INTERNAL void cpiSongTimeIdle (struct cpifaceSessionAPI_t *cpifaceSession)
+{
+	uint64_t start;
+
+	if (!SongTimeStep)
+	{
+		return;
+	}
+
+	start = clock_ms ();
+	do
+	{
+		uint32_t length = 0;
+
+		if (SongTimeStep (cpifaceSession, SONGTIME_SLICE_TICKS, &length) || (SongTimeLast > SONGTIME_LIMIT))
+		{
+			SongTimeStep = 0;
+			cpiSongTimeSetLength (cpifaceSession, length, 1);
+			cpiSongTimeStore ();
+			return;
+		}
+	} while ((clock_ms () - start) < SONGTIME_SLICE_MS);
+}
+
+OCP_INTERNAL void cpiSongTimeClose (void)
+{
+	uint_fast16_t i;
+
+	if (SongTimeTable)
+	{
+		for (i = 0; i < SongTimeOrders; i++)
+		{
+			free (SongTimeTable[i]);
+		}
+		free (SongTimeTable);
+	}
+	SongTimeTable = 0;
+	SongTimeOrders = 0;
+	SongTimeRows = 0;
+	SongTimeLast = 0;
+	SongTimeLength = 0;
+	SongTimeStep = 0;
+}
+
+OCP_INTERNAL void cpiSongTimeSetup (struct cpifaceSessionAPI_t *cpifaceSession)
+{
+	cpifaceSession->SongTimeHash     = cpiSongTimeHash;
+	cpifaceSession->SongTimeRegister = cpiSongTimeRegister;
+	cpifaceSession->SongTimeRow      = cpiSongTimeRow;
+	cpifaceSession->SongTimeSeek     = cpiSongTimeSeek;
+}
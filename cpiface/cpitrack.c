@@ -263,6 +263,151 @@ struct patviewtype
 	void (*putcmd)(struct cpifaceSessionAPI_t *cpifaceSession, uint16_t *bp);
 };
 
+/* Rendered rows of the most recently used patterns. Pattern data does not
+ * change during playback, so when the view moves to the next order only the
+ * patterns that were not visible before needs to be fetched from the player.
+ * All entries are dropped when the layout, the visible channels or their
+ * mute/select state changes.
+ */
+#define PATCACHE_ENTRIES 32
+static struct patcache_t
+{
+	int pat; /* -1 if unused */
+	int rows;
+	unsigned int lastuse;
+	uint16_t *buf; /* rows * patcachekey.width cells */
+} patcache[PATCACHE_ENTRIES];
+static unsigned int patcacheclock;
+
+struct patcachekey_t
+{
+	const struct patviewtype *pt;
+	int width; /* patwidth */
+	int patpad;
+	int firstchan;
+	int chnn;
+	int inpause;
+	int selected;
+	uint8_t mute[MAXLCHAN];
+};
+static struct patcachekey_t patcachekey;
+
+static void patcache_flush (void)
+{
+	int i;
+	for (i=0; i<PATCACHE_ENTRIES; i++)
+	{
+		free (patcache[i].buf);
+		patcache[i].buf = 0;
+		patcache[i].pat = -1;
+	}
+}
+
+static void patcache_setkey (struct cpifaceSessionAPI_t *cpifaceSession, const struct patviewtype *pt, int firstchan, int chnn)
+{
+	struct patcachekey_t key;
+
+	memset (&key, 0, sizeof (key));
+	key.pt = pt;
+	key.width = (patwidth > CONSOLE_MAX_X) ? CONSOLE_MAX_X : patwidth;
+	key.patpad = patpad;
+	key.firstchan = firstchan;
+	key.chnn = chnn;
+	key.inpause = cpifaceSession->InPause;
+	key.selected = cpifaceSession->SelectedChannel;
+	if ((firstchan + chnn) <= MAXLCHAN)
+	{
+		memcpy (key.mute, cpifaceSession->MuteChannel + firstchan, chnn);
+	}
+
+	if (memcmp (&key, &patcachekey, sizeof (key)))
+	{
+		patcache_flush ();
+		patcachekey = key;
+	}
+}
+
+/* returns the rows of pattern pat, rendering them if needed. Returns NULL on error */
+static const uint16_t *patcache_get (struct cpifaceSessionAPI_t *cpifaceSession, int pat, int rows, const uint16_t *patmask, int p0)
+{
+	const struct patviewtype *pt = patcachekey.pt;
+	const int width = patcachekey.width;
+	struct patcache_t *e = 0;
+	uint16_t *buf;
+	int i;
+
+	for (i=0; i<PATCACHE_ENTRIES; i++)
+	{
+		if ((patcache[i].pat == pat) && (patcache[i].rows == rows))
+		{
+			patcache[i].lastuse = ++patcacheclock;
+			return patcache[i].buf;
+		}
+		if ((!e) || (patcache[i].pat == -1) || ((e->pat != -1) && (patcache[i].lastuse < e->lastuse)))
+		{
+			e = &patcache[i];
+		}
+	}
+
+	free (e->buf);
+	e->pat = -1;
+	if (!(e->buf = malloc (sizeof (uint16_t) * rows * width)))
+	{
+		return 0;
+	}
+	buf = e->buf;
+
+	for (i=0; i<rows; i++)
+	{
+		memcpy (buf + i*width, patmask, sizeof (uint16_t) * width);
+		writenum(buf + i*width, 0, i?COLLNUM:COLHLNUM, i, 16, 2, 0);
+		if (patpad)
+			writenum(buf + i*width, patwidth-3, i?COLLNUM:COLHLNUM, i, 16, 2, 0);
+	}
+
+	if (pt->gcmd)
+	{
+		seektrack (cpifaceSession, pat, -1);
+		while (1)
+		{
+			int currow = startrow (cpifaceSession);
+			if (currow==-1)
+				break;
+			if ((currow>=0)&&(currow<rows))
+			{
+				uint16_t *bp=buf+currow*width+4;
+				getgcmd (cpifaceSession, bp, pt->gcmd);
+				if (cpifaceSession->InPause)
+					setattrgrey(bp, pt->gcmd*4);
+			}
+		}
+	}
+
+	for (i=0; i<patcachekey.chnn; i++)
+	{
+		int chpaus = cpifaceSession->MuteChannel[i+patcachekey.firstchan];
+		seektrack (cpifaceSession, pat, i+patcachekey.firstchan);
+		while (1)
+		{
+			int currow = startrow (cpifaceSession);
+			if (currow==-1)
+				break;
+			if ((currow>=0)&&(currow<rows))
+			{
+				uint16_t *bp=buf+currow*width+p0+i*pt->width;
+				pt->putcmd (cpifaceSession, bp);
+				if (chpaus)
+					setattrgrey(bp, pt->width);
+			}
+		}
+	}
+
+	e->pat = pat;
+	e->rows = rows;
+	e->lastuse = ++patcacheclock;
+	return buf;
+}
+
 static void preparepatgen (struct cpifaceSessionAPI_t *cpifaceSession, int pat, const struct patviewtype *pt)
 {
 	int i;
@@ -332,6 +477,8 @@ static void preparepatgen (struct cpifaceSessionAPI_t *cpifaceSession, int pat,
 		writestring(patmask, p0+pt->width*i, COLBACK, chpaus?pt->paused:sel?pt->selected:pt->normal, pt->width);
 	}
 
+	patcache_setkey (cpifaceSession, pt, firstchan, chnn);
+
 	firstpat=pat;
 
 	/* attempt to rewind 20 (default firsrow value) places back */
@@ -360,6 +507,7 @@ static void preparepatgen (struct cpifaceSessionAPI_t *cpifaceSession, int pat,
 	{
 		int curlen;
 		int lastprow;
+		const uint16_t *rows;
 
 		if (!(curlen = getpatlen (cpifaceSession, firstpat)))
 		{
@@ -373,49 +521,13 @@ static void preparepatgen (struct cpifaceSessionAPI_t *cpifaceSession, int pat,
 			lastprow=plPatBufH-firstrow-firstprow-1;
 		}
 
+		rows = patcache_get (cpifaceSession, firstpat, curlen, patmask, p0);
 		for (i=firstprow; i<lastprow; i++)
 		{
 			writestringattr(plPatBuf[i+firstrow-firstprow], 0, patmask, CONSOLE_MAX_X);
-			writenum(plPatBuf[i+firstrow-firstprow], 0, i?COLLNUM:COLHLNUM, i, 16, 2, 0);
-			if (patpad)
-				writenum(plPatBuf[i+firstrow-firstprow], patwidth-3, i?COLLNUM:COLHLNUM, i, 16, 2, 0);
-		}
-
-		if (pt->gcmd)
-		{
-			seektrack (cpifaceSession, firstpat, -1);
-			while (1)
-			{
-				int currow = startrow (cpifaceSession);
-				if (currow==-1)
-					break;
-				if ((currow>=firstprow)&&(currow<lastprow))
-				{
-					uint16_t *bp=plPatBuf[currow+firstrow-firstprow]+4;
-					getgcmd (cpifaceSession, bp, pt->gcmd);
-					if (cpifaceSession->InPause)
-						setattrgrey(bp, pt->gcmd*4);
-				}
-			}
-		}
-
-		for (i=0; i<chnn; i++)
-		{
-			int chpaus;
-			seektrack (cpifaceSession, firstpat, i+firstchan);
-			chpaus = cpifaceSession->MuteChannel[i+firstchan];
-			while (1)
+			if (rows)
 			{
-				int currow = startrow (cpifaceSession);
-				if (currow==-1)
-					break;
-				if ((currow>=firstprow)&&(currow<lastprow))
-				{
-					uint16_t *bp=plPatBuf[currow+firstrow-firstprow]+p0+i*pt->width;
-					pt->putcmd (cpifaceSession, bp);
-					if (chpaus)
-						setattrgrey(bp, pt->width);
-				}
+				memcpy (plPatBuf[i+firstrow-firstprow], rows + i*patcachekey.width, sizeof (uint16_t) * patcachekey.width);
 			}
 		}
 
@@ -848,6 +960,7 @@ static int trkEvent (struct cpifaceSessionAPI_t *cpifaceSession, int ev)
 		case cpievDone:
 			free(plPatBuf);
 			plPatBuf=0;
+			patcache_flush ();
 			break;
 	}
 	return 1;
@@ -862,6 +975,7 @@ void cpiTrkSetup (struct cpifaceSessionAPI_t *cpifaceSession, const struct cpitr
 	plPatManualPat   = -1;
 	plPrepdPat       = -1;
 	plPatType        = -1;
+	patcache_flush ();
 	getcurpos        = c->getcurpos;
 	getpatlen        = c->getpatlen;
 	getpatname       = c->getpatname;
@@ -883,6 +997,7 @@ void cpiTrkSetup2 (struct cpifaceSessionAPI_t *cpifaceSession, const struct cpit
 	plPatManualPat   = -1;
 	plPrepdPat       = -1;
 	plPatType        = -1;
+	patcache_flush ();
 	getcurpos        = c->getcurpos;
 	getpatlen        = c->getpatlen;
 	getpatname       = c->getpatname;
@@ -47,6 +47,7 @@
 #include "stuff/compat.h"
 #include "stuff/err.h"
 #include "stuff/poutput.h"
+#include "stuff/profile.h"
 
 struct plrDriverListEntry_t
 {
@@ -61,16 +62,40 @@ static struct plrDriverListEntry_t *plrDriverList;
 static int                          plrDriverListEntries;
 static int                          plrDriverListNone;
 
-const struct plrDevAPI_t *plrDevAPI; /* handle from the selected driver */
+const struct plrDevAPI_t *plrDevAPI; /* handle from the selected driver, Idle() is wrapped by plrProfiledIdle() */
+static const struct plrDevAPI_t *plrDevAPIDriver; /* the unmodified handle from the selected driver */
+static struct plrDevAPI_t plrDevAPIProfiled;
 static const struct plrDriver_t *plrDriver; /* current selected driver */
 static const struct plrDriverAPI_t plrDriverAPI = /* API provided from OCP to the driver */
 {
 	&ringbufferAPI,
 	plrGetRealMasterVolume,
 	plrGetMasterSample,
-	plrConvertBufferFromStereo16BitSigned
+	plrConvertBufferFromStereo16BitSigned,
+	&profileAPI
 };
 
+static unsigned int plrProfiledIdle (void)
+{
+	uint64_t start = profile_now ();
+	unsigned int retval = plrDevAPIDriver->Idle ();
+	profile_add (profileStageDeviceIdle, start);
+	profile_buffer_fill (retval, plrDevAPIDriver->GetRate ());
+	return retval;
+}
+
+static const struct plrDevAPI_t *plrOpenDriver (const struct plrDriver_t *driver)
+{
+	plrDevAPIDriver = driver->Open (driver, &plrDriverAPI);
+	if (!plrDevAPIDriver)
+	{
+		return 0;
+	}
+	plrDevAPIProfiled = *plrDevAPIDriver;
+	plrDevAPIProfiled.Idle = plrProfiledIdle;
+	return &plrDevAPIProfiled;
+}
+
 static int deviplayDriverListInsert (int insertat, const char *name, int length)
 {
 	int i;
@@ -251,7 +276,7 @@ static int deviplayLateInit (struct PluginInitAPI_t *API)
 					plrDriverList[i].probed = 1;
 					if (plrDriverList[i].detected)
 					{
-						plrDevAPI = plrDriverList[i].driver->Open (plrDriverList[i].driver, &plrDriverAPI);
+						plrDevAPI = plrOpenDriver (plrDriverList[i].driver);
 						if (plrDevAPI)
 						{
 							fprintf (stderr, " %-8s: %s (selected due to -sp commandline)\n", plrDriverList[i].name, dots(""));
@@ -284,7 +309,7 @@ static int deviplayLateInit (struct PluginInitAPI_t *API)
 		plrDriverList[i].probed = 1;
 		if (plrDriverList[i].detected)
 		{
-			plrDevAPI = plrDriverList[i].driver->Open (plrDriverList[i].driver, &plrDriverAPI);
+			plrDevAPI = plrOpenDriver (plrDriverList[i].driver);
 			if (plrDevAPI)
 			{
 				fprintf (stderr, " %-8s: %s (detected)\n", plrDriverList[i].name, dots(plrDriverList[i].driver->description));
@@ -590,7 +615,7 @@ static void setup_devp_run (void **token, const struct DevInterfaceAPI_t *API)
 						}
 						if (plrDriverList[dsel].detected)
 						{
-							plrDevAPI = plrDriverList[dsel].driver->Open (plrDriverList[dsel].driver, &plrDriverAPI);
+							plrDevAPI = plrOpenDriver (plrDriverList[dsel].driver);
 							if (plrDevAPI)
 							{
 								plrDriver = plrDriverList[dsel].driver;
@@ -2,6 +2,7 @@
 #define _DEV_DEVIPLAY_H 1
 
 struct plrDevAPI_t;
+struct profileAPI_t;
 struct ringbufferAPI_t;
 
 struct plrDriverAPI_t
@@ -10,6 +11,7 @@ struct plrDriverAPI_t
 	void (*GetRealMasterVolume) (int *l, int *r); /* default functions that can be used */
 	void (*GetMasterSample) (int16_t *s, uint32_t len, uint32_t rate, int opt); /* default functions that can be used */
 	void (*ConvertBufferFromStereo16BitSigned) (void *dstbuf, int16_t *srcbuf, int samples, int to16bit, int tosigned, int tostereo, int revstereo);
+	const struct profileAPI_t *profileAPI; /* drivers should report time spent writing to the device and buffer under-runs */
 };
 
 struct plrDriver_t
@@ -30,6 +30,9 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#ifndef _WIN32
+# include <sys/mman.h>
+#endif
 #include "types.h"
 #include "boot/plinkman.h"
 #include "boot/psetting.h"
@@ -77,6 +80,7 @@ static struct mcpAPI_t _mcpAPI =
 	mcpGetNote6848,
 	mcpGetNote8363,
 	mcpReduceSamples,
+	mcpFreeSamples,
 };
 
 const struct mcpAPI_t *mcpAPI = &_mcpAPI;
@@ -144,10 +148,14 @@ static int deviwaveDriverListInsert (int insertat, const char *name, int length)
 static int deviwavePreInit (const struct configAPI_t *configAPI)
 {
 	const char *str, *next;
+	int samplecache;
 	/* this is ran before plugins are initialized */
 
 	mcpDriverListNone = -1;
 
+	samplecache = configAPI->GetProfileInt2 (configAPI->SoundSec, "sound", "samplecache", 64, 10);
+	smpCacheLimit = (samplecache > 0) ? (size_t)samplecache * 1024 * 1024 : 0;
+
 	str = configAPI->GetProfileString2 (configAPI->SoundSec, "sound", "wavetabledevices", "devwNone");
 	if (!strlen(str))
 	{
@@ -390,6 +398,8 @@ static void deviwaveLateClose (void)
 	mcpDriverList = 0;
 	mcpDriverListEntries = 0;
 	mcpDriverListNone = -1;
+
+	smpCacheFlush ();
 }
 
 static void setup_devw_draw (const struct DevInterfaceAPI_t *API, const char *title, int dsel)
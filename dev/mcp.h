@@ -89,7 +89,8 @@ struct mcpAPI_t
 	int (*GetFreq8363) (int note);
 	int (*GetNote6848) (unsigned int freq);
 	int (*GetNote8363) (unsigned int freq);
-	int (*ReduceSamples) (struct sampleinfo *s, int n, long m, enum mcpRed);
+	int (*ReduceSamples) (struct sampleinfo *s, int n, long m, enum mcpRed); /* converted sample data is owned by smpman.c after this call */
+	void (*FreeSamples) (struct sampleinfo *s, int n); /* releases sample data, both before and after ReduceSamples() has been used */
 };
 extern const struct mcpAPI_t *mcpAPI;
 
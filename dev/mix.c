@@ -40,6 +40,7 @@
 #define MIXBUFLEN 2048
 
 static void (*mixGetMixChannel)(unsigned int ch, struct mixchannel *chn, uint32_t rate);
+static int (*mixGetTap)(unsigned int ch, void *buf, unsigned int len, uint32_t rate);
 
 static struct mixchannel *channels;
 
@@ -48,6 +49,7 @@ static uint32_t (*voltabs)[2][256];
 static int16_t (*amptab)[256];
 static int32_t clipmax;
 static int32_t *mixbuf;
+static void *tapbuf; /* stereo frames from mixGetTap, int16_t or float */
 static uint32_t amplify;
 
 
@@ -105,14 +107,86 @@ static void mixgetmixch(int ch, struct mixchannel *chn, int rate)
 	chn->replen=(chn->status&MIX_LOOPED)?(chn->loopend-chn->loopstart):0;
 }
 
-static void putchn(struct mixchannel *chn, unsigned int len, int opt)
+static void puttap(int32_t *dst, unsigned int len, struct mixchannel *chn, const int16_t *tap, int opt)
+	/* Same math as the non-interpolating routes in mixasm.c, but the samples
+	 * are already resampled. Only the high byte is used, unless HQ is asked for,
+	 * then all 16 bits are. If the mixer interpolated the channel, the tap holds
+	 * its interpolation, not the one mixPlayChannel() would have done.
+	 */
+{
+	const uint32_t *voll=chn->voltabs[0];
+	const uint32_t *volr=chn->voltabs[1];
+	const int hq=opt&mcpGetSampleHQ;
+	unsigned int i;
+
+	for (i=0; i<len; i++)
+	{
+		uint16_t l=tap[i<<1]; /* Remove sign */
+		uint16_t r=tap[(i<<1)+1];
+		int32_t vl=voll[l>>8];
+		int32_t vr=volr[r>>8];
+		if (hq)
+		{
+			vl+=voll[(l&255)+256];
+			vr+=volr[(r&255)+256];
+		}
+		if (opt&mcpGetSampleStereo)
+		{
+			*(dst++)+=vl;
+			*(dst++)+=vr;
+		} else
+			*(dst++)+=vl+vr;
+	}
+}
+
+static void puttapf(int32_t *dst, unsigned int len, struct mixchannel *chn, const float *tap, int opt)
+	/* Same math as the float routes in mixasm.c. Those never interpolate, so
+	 * if the mixer interpolated or filtered the channel, the tap holds what
+	 * it played instead. For mono samples both halves of a frame are the same.
+	 */
+{
+	unsigned int i;
+
+	if (opt&mcpGetSampleStereo)
+	{
+		float scale0=chn->vol.volfs[0]*64.0;
+		float scale1=chn->vol.volfs[1]*64.0;
+		for (i=0; i<len; i++)
+		{
+			*(dst++)+=(int32_t)(tap[i<<1]*scale0);
+			*(dst++)+=(int32_t)(tap[(i<<1)+1]*scale1);
+		}
+	} else if (chn->status&MIX_PLAYSTEREO)
+	{
+		float scale0=chn->vol.volfs[0]*32.0;
+		float scale1=chn->vol.volfs[1]*32.0;
+		for (i=0; i<len; i++)
+		{
+			*dst+=(int32_t)(tap[i<<1]*scale0);
+			*(dst++)+=(int32_t)(tap[(i<<1)+1]*scale1);
+		}
+	} else {
+		float scale=chn->vol.volfs[0]*32.0+
+		            chn->vol.volfs[1]*32.0;
+		for (i=0; i<len; i++)
+			*(dst++)+=(int32_t)(tap[i<<1]*scale);
+	}
+}
+
+static void putchn(struct mixchannel *chn, unsigned int len, int opt, const void *tap)
 {
 	if (!(chn->status&MIX_PLAYING)||(chn->status&MIX_MUTE))
 		return;
 	if (opt&mcpGetSampleHQ)
 		chn->status|=MIX_MAX|MIX_INTERPOLATE;
-	if (!(chn->status&MIX_PLAYFLOAT))
+	if (chn->status&MIX_PLAYFLOAT)
 	{
+		if (tap)
+		{
+			puttapf(mixbuf, len, chn, tap, opt);
+			return;
+		}
+	} else {
 		int voll=chn->vol.vols[0];
 		int volr=chn->vol.vols[1];
 		if (voll<0)
@@ -127,6 +201,11 @@ static void putchn(struct mixchannel *chn, unsigned int len, int opt)
 			return;
 		chn->voltabs[0]=(uint32_t *)voltabs[voll];
 		chn->voltabs[1]=(uint32_t *)voltabs[volr];
+		if (tap)
+		{
+			puttap(mixbuf, len, chn, tap, opt);
+			return;
+		}
 	}
 	mixPlayChannel(mixbuf, len, chn, opt&mcpGetSampleStereo);
 }
@@ -145,7 +224,7 @@ static void mixGetMasterSample(int16_t *s, unsigned int len, uint32_t rate, int
 	}
 	memset (mixbuf, 0, (len<<stereo)<<2);
 	for (i=0; i<channum; i++)
-		putchn(&channels[i], len, opt);
+		putchn(&channels[i], len, opt, 0);
 	mixClip(s, mixbuf, len<<stereo, amptab, clipmax);
 }
 
@@ -179,7 +258,11 @@ static int mixMixChanSamples (struct cpifaceSessionAPI_t *cpifaceSession, unsign
 			ret=0;
 		channels[i].status&=~MIX_MUTE;
 
-		putchn(&channels[i], len, opt);
+		/* use what the mixer already rendered if possible, instead of resampling again */
+		if (mixGetTap&&mixGetTap(ch[i], tapbuf, len, rate))
+			putchn(&channels[i], len, opt, tapbuf);
+		else
+			putchn(&channels[i], len, opt, 0);
 	}
 	len<<=stereo;
 
@@ -251,12 +334,14 @@ static int mixInit (struct cpifaceSessionAPI_t *cpifaceSession, void (*getchan)(
 	int i,j;
 
 	mixGetMixChannel=getchan;
+	mixGetTap=0;
 	mixbuf=malloc(MIXBUFLEN*sizeof(int32_t));
+	tapbuf=malloc(MIXBUFLEN*sizeof(float)*2);
 	mixIntrpolTab=malloc(16*sizeof(*mixIntrpolTab));/*new signed char [16][256][2];*/
 	mixIntrpolTab2=malloc(32*sizeof(*mixIntrpolTab2));/*new short [32][256][2];*/
 	voltabs=malloc (65*sizeof(*voltabs));/*new long [65][2][256];*/
 	channels=malloc(sizeof(struct mixchannel)*(16+chn)); /*   new mixchannel[chn+16]; */
-	if (!mixbuf||!voltabs||!mixIntrpolTab2||!mixIntrpolTab||!channels)
+	if (!mixbuf||!tapbuf||!voltabs||!mixIntrpolTab2||!mixIntrpolTab||!channels)
 		return 0;
 	amptab=0;
 
@@ -294,16 +379,24 @@ static void mixClose (struct cpifaceSessionAPI_t *cpifaceSession)
 {
 	free(channels);
 	free(mixbuf);
+	free(tapbuf);
 	free(voltabs);
 	free(amptab);
 	free(mixIntrpolTab);
 	free(mixIntrpolTab2);
 	channels = 0;
 	mixbuf = 0;
+	tapbuf = 0;
 	voltabs = 0;
 	amptab = 0;
 	mixIntrpolTab = 0;
 	mixIntrpolTab2 = 0;
+	mixGetTap = 0;
+}
+
+static void mixSetTap (struct cpifaceSessionAPI_t *cpifaceSession, int (*gettap)(unsigned int ch, void *buf, unsigned int len, uint32_t rate))
+{
+	mixGetTap=gettap;
 }
 
 static const struct mixAPI_t _mixAPI =
@@ -312,6 +405,7 @@ static const struct mixAPI_t _mixAPI =
 	mixClose,
 	mixSetAmplify,
 	mcpFindPostProcFP,
-	mcpFindPostProcInteger
+	mcpFindPostProcInteger,
+	mixSetTap
 };
 const struct mixAPI_t *mixAPI = &_mixAPI;
@@ -37,6 +37,8 @@ struct mixAPI_t
 	void (*mixSetAmplify)(struct cpifaceSessionAPI_t *cpifaceSession, int amp);
 	const struct PostProcFPRegStruct *(*mcpFindPostProcFP) (const char *name);
 	const struct PostProcIntegerRegStruct *(*mcpFindPostProcInteger) (const char *name);
+	/* optional, gettap copies the last len stereo frames the wavetable mixer rendered for a channel (before volume and panning) and returns non-zero, or returns zero if it can not. Frames are two int16_t, or two float for MIX_PLAYFLOAT channels */
+	void (*mixSetTap)    (struct cpifaceSessionAPI_t *cpifaceSession, int (*gettap)(unsigned int ch, void *buf, unsigned int len, uint32_t rate));
 };
 extern const struct mixAPI_t *mixAPI;
 
@@ -635,6 +635,195 @@ void ringbuffer_get_stats (struct ringbuffer_t *self, uint64_t *total_head, uint
 	}
 }
 
+struct ringbuffer_snapshot_record_t
+{
+	unsigned int seq; /* 2*(record number+1) when valid, odd while the producer is writing it */
+	uint64_t timestamp;
+	uint64_t datapos; /* absolute position of the data, offset in data is datapos % datasize */
+	int size;
+};
+
+struct ringbuffer_snapshots_t
+{
+	struct ringbuffer_snapshot_record_t *records;
+	unsigned int recordmask; /* number of records - 1 */
+
+	uint8_t *data;
+	int datasize;
+
+	/* written by the producer */
+	unsigned int first; /* first record number that is valid after a reset */
+	unsigned int head; /* next record number to be committed */
+	uint64_t datahead; /* absolute data position for the next record */
+	uint64_t datareserved; /* data below datareserved - datasize can no longer be trusted */
+
+	/* written by the reader */
+	unsigned int cursor; /* record number returned by the last lookup */
+};
+
+struct ringbuffer_snapshots_t *ringbuffer_snapshots_new (int records, int datasize)
+{
+	struct ringbuffer_snapshots_t *self;
+	unsigned int count = 1;
+
+	while (count < (unsigned int)records)
+	{
+		count <<= 1;
+	}
+
+	self = calloc (sizeof (*self), 1);
+	if (!self)
+	{
+		return 0;
+	}
+	self->records = calloc (sizeof (self->records[0]), count);
+	self->data = malloc (datasize);
+	if ((!self->records) || (!self->data))
+	{
+		free (self->records);
+		free (self->data);
+		free (self);
+		return 0;
+	}
+	self->recordmask = count - 1;
+	self->datasize = datasize;
+	return self;
+}
+
+void ringbuffer_snapshots_free (struct ringbuffer_snapshots_t *self)
+{
+	if (!self)
+	{
+		return;
+	}
+	free (self->records);
+	free (self->data);
+	free (self);
+}
+
+void ringbuffer_snapshots_reset (struct ringbuffer_snapshots_t *self)
+{
+	__atomic_store_n (&self->first, __atomic_load_n (&self->head, __ATOMIC_RELAXED), __ATOMIC_RELEASE);
+}
+
+void *ringbuffer_snapshots_write (struct ringbuffer_snapshots_t *self, uint64_t timestamp, int size)
+{
+	struct ringbuffer_snapshot_record_t *r = self->records + (self->head & self->recordmask);
+	uint64_t pos = self->datahead;
+
+	if ((size < 0) || (size > self->datasize))
+	{
+		return 0;
+	}
+
+	/* records are stored in one piece, skip the end of the buffer if needed */
+	if (((pos % self->datasize) + size) > (uint64_t)self->datasize)
+	{
+		pos += self->datasize - (pos % self->datasize);
+	}
+
+	/* readers check datareserved after copying, so they notice if the producer has started to overwrite their data */
+	__atomic_store_n (&r->seq, 2 * self->head + 1, __ATOMIC_RELAXED);
+	__atomic_store_n (&self->datareserved, pos + size, __ATOMIC_RELAXED);
+	__atomic_thread_fence (__ATOMIC_RELEASE);
+
+	r->timestamp = timestamp;
+	r->datapos = pos;
+	r->size = size;
+	self->datahead = pos + size;
+
+	return self->data + (pos % self->datasize);
+}
+
+void ringbuffer_snapshots_commit (struct ringbuffer_snapshots_t *self)
+{
+	struct ringbuffer_snapshot_record_t *r = self->records + (self->head & self->recordmask);
+
+	__atomic_store_n (&r->seq, 2 * self->head + 2, __ATOMIC_RELEASE);
+	__atomic_store_n (&self->head, self->head + 1, __ATOMIC_RELEASE);
+}
+
+/* copies the header of record n, returns non-zero if it has been overwritten */
+static int ringbuffer_snapshots_peek (struct ringbuffer_snapshots_t *self, unsigned int n, struct ringbuffer_snapshot_record_t *dst)
+{
+	const struct ringbuffer_snapshot_record_t *r = self->records + (n & self->recordmask);
+	unsigned int seq = __atomic_load_n (&r->seq, __ATOMIC_ACQUIRE);
+
+	if (seq != (2 * n + 2))
+	{
+		return -1;
+	}
+	dst->timestamp = r->timestamp;
+	dst->datapos = r->datapos;
+	dst->size = r->size;
+	__atomic_thread_fence (__ATOMIC_ACQUIRE);
+	return __atomic_load_n (&r->seq, __ATOMIC_RELAXED) != seq;
+}
+
+int ringbuffer_snapshots_get (struct ringbuffer_snapshots_t *self, uint64_t timestamp, void *dst, int dstsize, uint64_t *record_timestamp)
+{
+	struct ringbuffer_snapshot_record_t r, next;
+	unsigned int head = __atomic_load_n (&self->head, __ATOMIC_ACQUIRE);
+	unsigned int first = __atomic_load_n (&self->first, __ATOMIC_ACQUIRE);
+	unsigned int n = self->cursor;
+	int size;
+
+	/* records older than recordmask+1 have been reused */
+	if ((head - first) > (self->recordmask + 1))
+	{
+		first = head - (self->recordmask + 1);
+	}
+	if (head == first)
+	{
+		return -1;
+	}
+	if (((n - first) >= (head - first)) || ringbuffer_snapshots_peek (self, n, &r) || (r.timestamp > timestamp))
+	{ /* cursor is not usable, binary search for the last record with a timestamp not newer than timestamp */
+		unsigned int lo = first, len = head - first;
+		while (len)
+		{
+			unsigned int half = len / 2;
+			if ((!ringbuffer_snapshots_peek (self, lo + half, &r)) && (r.timestamp > timestamp))
+			{
+				len = half;
+			} else { /* not newer than timestamp, or already overwritten (which only happens to the oldest records) */
+				lo += half + 1;
+				len -= half + 1;
+			}
+		}
+		if (lo == first)
+		{
+			return -1;
+		}
+		n = lo - 1;
+		if (ringbuffer_snapshots_peek (self, n, &r))
+		{
+			return -1;
+		}
+	}
+
+	/* advance the cursor, this is the common case while playing */
+	while (((n + 1 - first) < (head - first)) && (!ringbuffer_snapshots_peek (self, n + 1, &next)) && (next.timestamp <= timestamp))
+	{
+		n++;
+		r = next;
+	}
+	self->cursor = n;
+
+	size = (r.size < dstsize) ? r.size : dstsize;
+	memcpy (dst, self->data + (r.datapos % self->datasize), size);
+	__atomic_thread_fence (__ATOMIC_ACQUIRE);
+	if (__atomic_load_n (&self->datareserved, __ATOMIC_RELAXED) > (r.datapos + self->datasize))
+	{ /* the producer has started to overwrite the data while we copied it */
+		return -1;
+	}
+	if (record_timestamp)
+	{
+		*record_timestamp = r.timestamp;
+	}
+	return r.size;
+}
+
 const struct ringbufferAPI_t ringbufferAPI =
 {
 	ringbuffer_reset,
@@ -663,7 +852,13 @@ const struct ringbufferAPI_t ringbufferAPI =
 	ringbuffer_free,
 	ringbuffer_add_tail_callback_samples,
 	ringbuffer_add_processing_callback_samples,
-	ringbuffer_get_stats
+	ringbuffer_get_stats,
+	ringbuffer_snapshots_new,
+	ringbuffer_snapshots_free,
+	ringbuffer_snapshots_reset,
+	ringbuffer_snapshots_write,
+	ringbuffer_snapshots_commit,
+	ringbuffer_snapshots_get
 };
 
 
@@ -972,6 +1167,158 @@ const int int_13 = 13;
 const int int_14 = 14;
 const int int_15 = 15;
 
+static void snapshots_put (struct ringbuffer_snapshots_t *s, uint64_t timestamp, int size, int value)
+{
+	uint8_t *data = ringbuffer_snapshots_write (s, timestamp, size);
+	memset (data, value, size);
+	ringbuffer_snapshots_commit (s);
+}
+
+static int snapshots_expect (struct ringbuffer_snapshots_t *s, uint64_t timestamp, int expected_size, int expected_value, uint64_t expected_timestamp)
+{
+	uint8_t data[256];
+	uint64_t record_timestamp = 0;
+	int size, i;
+
+	printf (" lookup %d => ", (int)timestamp);
+	size = ringbuffer_snapshots_get (s, timestamp, data, sizeof (data), &record_timestamp);
+	if (size < 0)
+	{
+		printf ("none");
+	} else {
+		printf ("timestamp %d, size %d", (int)record_timestamp, size);
+	}
+	if (size != expected_size)
+	{
+		printf (" - expected size %d\n", expected_size);
+		return 1;
+	}
+	if (size < 0)
+	{
+		printf (" ok\n");
+		return 0;
+	}
+	if (record_timestamp != expected_timestamp)
+	{
+		printf (" - expected timestamp %d\n", (int)expected_timestamp);
+		return 1;
+	}
+	for (i=0; i < size; i++)
+	{
+		if (data[i] != expected_value)
+		{
+			printf (" - data[%d] is %d, expected %d\n", i, data[i], expected_value);
+			return 1;
+		}
+	}
+	printf (" ok\n");
+	return 0;
+}
+
+static int snapshots_test_lookup (void)
+{
+	struct ringbuffer_snapshots_t *s = ringbuffer_snapshots_new (16, 1024);
+	int retval = 0;
+	int i;
+
+	printf ("SNAPSHOTS, LATENCY LOOKUP\n");
+	retval += snapshots_expect (s, 1000, -1, 0, 0);
+	for (i=0; i < 10; i++)
+	{
+		snapshots_put (s, 100 + i * 100, 10 + i, i);
+	}
+	retval += snapshots_expect (s, 99, -1, 0, 0); /* before the first record */
+	retval += snapshots_expect (s, 100, 10, 0, 100);
+	retval += snapshots_expect (s, 150, 10, 0, 100);
+	retval += snapshots_expect (s, 250, 11, 1, 200);
+	retval += snapshots_expect (s, 260, 11, 1, 200); /* same record again */
+	retval += snapshots_expect (s, 700, 16, 6, 700);
+	retval += snapshots_expect (s, 350, 12, 2, 300); /* backwards, needs a search */
+	retval += snapshots_expect (s, 5000, 19, 9, 1000); /* past the newest record */
+	snapshots_put (s, 1100, 20, 10);
+	retval += snapshots_expect (s, 1100, 20, 10, 1100);
+
+	ringbuffer_snapshots_free (s);
+	return retval;
+}
+
+static int snapshots_test_record_wrap (void)
+{
+	struct ringbuffer_snapshots_t *s = ringbuffer_snapshots_new (10, 4096); /* rounded up to 16 records */
+	int retval = 0;
+	int i;
+
+	printf ("SNAPSHOTS, RECORD WRAP\n");
+	for (i=0; i < 40; i++)
+	{
+		snapshots_put (s, i * 10, 8, i);
+	}
+	/* 24..39 are still available */
+	retval += snapshots_expect (s, 235, -1, 0, 0);
+	retval += snapshots_expect (s, 240, 8, 24, 240);
+	retval += snapshots_expect (s, 305, 8, 30, 300);
+	retval += snapshots_expect (s, 390, 8, 39, 390);
+	for (i=40; i < 45; i++)
+	{
+		snapshots_put (s, i * 10, 8, i);
+	}
+	retval += snapshots_expect (s, 275, -1, 0, 0);
+	retval += snapshots_expect (s, 445, 8, 44, 440);
+
+	ringbuffer_snapshots_free (s);
+	return retval;
+}
+
+static int snapshots_test_data_wrap (void)
+{
+	struct ringbuffer_snapshots_t *s = ringbuffer_snapshots_new (16, 100);
+	int retval = 0;
+	int i;
+
+	printf ("SNAPSHOTS, DATA WRAP\n");
+	snapshots_put (s, 0, 60, 1);
+	snapshots_put (s, 10, 60, 2); /* does not fit behind the first, so it overwrites it */
+	retval += snapshots_expect (s, 5, -1, 0, 0);
+	retval += snapshots_expect (s, 15, 60, 2, 10);
+
+	for (i=0; i < 20; i++)
+	{
+		snapshots_put (s, 20 + i * 10, 20 + (i % 3) * 10, 3 + i);
+	}
+	/* sizes 20,30,40 repeating; only the records within the last 100 bytes are still intact */
+	retval += snapshots_expect (s, 215, 30, 22, 210);
+	retval += snapshots_expect (s, 205, 20, 21, 200);
+	retval += snapshots_expect (s, 195, 40, 20, 190);
+	retval += snapshots_expect (s, 185, -1, 0, 0); /* data overwritten, even if the record itself is still present */
+
+	if (ringbuffer_snapshots_write (s, 1000, 101))
+	{
+		printf (" record larger than the ring was accepted\n");
+		retval++;
+	}
+
+	ringbuffer_snapshots_free (s);
+	return retval;
+}
+
+static int snapshots_test_reset (void)
+{
+	struct ringbuffer_snapshots_t *s = ringbuffer_snapshots_new (16, 1024);
+	int retval = 0;
+
+	printf ("SNAPSHOTS, RESET\n");
+	snapshots_put (s, 100, 4, 1);
+	snapshots_put (s, 200, 4, 2);
+	retval += snapshots_expect (s, 250, 4, 2, 200);
+	ringbuffer_snapshots_reset (s);
+	retval += snapshots_expect (s, 250, -1, 0, 0);
+	snapshots_put (s, 0, 4, 3); /* timestamps may restart after a reset */
+	retval += snapshots_expect (s, 250, 4, 3, 0);
+
+	ringbuffer_snapshots_free (s);
+	return retval;
+}
+
 int main(int argc, char *argv[])
 {
 	int retval = 0;
@@ -1264,6 +1611,11 @@ int main(int argc, char *argv[])
 	retval += callback_processing_errors;
 	retval += callback_tail_errors;
 
+	retval += snapshots_test_lookup ();
+	retval += snapshots_test_record_wrap ();
+	retval += snapshots_test_data_wrap ();
+	retval += snapshots_test_reset ();
+
 	printf ("\nFinal result: %d errors\n", retval);
 	return retval;
 }
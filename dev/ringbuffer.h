@@ -64,6 +64,37 @@ void ringbuffer_add_processing_callback_samples (struct ringbuffer_t *self, int
 /* returns number of non-pause samples */
 void ringbuffer_get_stats (struct ringbuffer_t *self, uint64_t *total_head, uint64_t *total_tail);
 
+/* Timestamped state snapshots, e.g. chip registers, for viewers that want to
+ * show the state that matches the audio currently being played.
+ *
+ * The producer (the player) stores a record each time it renders a block,
+ * tagged with a non-decreasing timestamp in a unit of its own choosing
+ * (usually the position of the block in its own sample stream). A viewer
+ * asks for the newest record that is not newer than the timestamp that is
+ * being played right now, and gets a copy of it.
+ *
+ * Records can have any size up to the data size given at creation. All
+ * memory is allocated up front, old records are silently overwritten. One
+ * producer and one reader may use the ring at the same time without locks.
+ */
+struct ringbuffer_snapshots_t;
+
+struct ringbuffer_snapshots_t *ringbuffer_snapshots_new (int records, int datasize); /* returns NULL on error */
+void ringbuffer_snapshots_free (struct ringbuffer_snapshots_t *self);
+
+/* producer: forget all records, used when the stream is restarted or seeked */
+void ringbuffer_snapshots_reset (struct ringbuffer_snapshots_t *self);
+
+/* producer: reserves a record of size bytes, returns NULL if size is larger than the ring.
+ * The record is not visible until ringbuffer_snapshots_commit() is called */
+void *ringbuffer_snapshots_write (struct ringbuffer_snapshots_t *self, uint64_t timestamp, int size);
+void ringbuffer_snapshots_commit (struct ringbuffer_snapshots_t *self);
+
+/* reader: copies the newest record with a timestamp not newer than timestamp into dst.
+ * Returns the size of the record (dst receives at most dstsize bytes), or -1 if there
+ * is no such record. Calls with increasing timestamps are O(1) */
+int ringbuffer_snapshots_get (struct ringbuffer_snapshots_t *self, uint64_t timestamp, void *dst, int dstsize, uint64_t *record_timestamp);
+
 struct ringbufferAPI_t
 {
 	void (*reset) (struct ringbuffer_t *self);
@@ -93,6 +124,12 @@ struct ringbufferAPI_t
 	void (*add_tail_callback_samples) (struct ringbuffer_t *self, int samples, void (*callback)(void *arg, int samples_ago), const void *arg);
 	void (*add_processing_callback_samples) (struct ringbuffer_t *self, int samples, void (*callback)(void *arg, int samples_ago), const void *arg);
 	void (*get_stats) (struct ringbuffer_t *self, uint64_t *total_head, uint64_t *total_tail); /* given in non-pause samples */
+	struct ringbuffer_snapshots_t * (*snapshots_new) (int records, int datasize);
+	void (*snapshots_free) (struct ringbuffer_snapshots_t *self);
+	void (*snapshots_reset) (struct ringbuffer_snapshots_t *self);
+	void *(*snapshots_write) (struct ringbuffer_snapshots_t *self, uint64_t timestamp, int size);
+	void (*snapshots_commit) (struct ringbuffer_snapshots_t *self);
+	int (*snapshots_get) (struct ringbuffer_snapshots_t *self, uint64_t timestamp, void *dst, int dstsize, uint64_t *record_timestamp);
 };
 
 extern const struct ringbufferAPI_t ringbufferAPI;
@@ -37,6 +37,41 @@
 
 static uint16_t abstab[0x200];
 
+/* Converted sample data is stored in arenas, one arena per call to
+ * mcpReduceSamples(). Every converted sample is also registered in a cache,
+ * keyed by a hash of the unconverted sample data. Arenas that are no longer
+ * referenced are kept until smpCacheLimit is exceeded, so reopening a recently
+ * played module can reuse the converted data directly.
+ */
+#define SMP_ARENA_ALIGN     64
+#define SMP_ARENA_HUGEPAGE  (2*1024*1024) /* use mmap() + MADV_HUGEPAGE for arenas of at least this size */
+
+struct smpArena_t
+{
+	struct smpArena_t *next;
+	uint8_t *data;
+	size_t size;
+	size_t fill;
+	int mmaped;
+	int refs;              /* number of struct sampleinfo that point into this arena */
+	uint32_t released;     /* smpGeneration when refs reached zero, used to evict the oldest arena first */
+};
+
+struct smpCacheEntry_t
+{
+	struct smpCacheEntry_t *next;
+	struct smpArena_t *arena;
+	uint64_t hash;
+	enum mcpRed opt;
+	struct sampleinfo before; /* ptr is not valid */
+	struct sampleinfo after;  /* ptr points into arena */
+};
+
+static struct smpArena_t *smpArenas;
+static struct smpCacheEntry_t *smpCache;
+static size_t smpCacheLimit = 64*1024*1024; /* bytes of unreferenced arenas to keep, 0 disables the cache */
+static uint32_t smpGeneration;
+
 static int sampsizefac(int type)
 {
 	return ((type&mcpSampFloat)?2:((type&mcpSamp16Bit)?1:0))+((type&(mcpSampInterleavedStereo|mcpSampStereo))?1:0);
@@ -816,7 +851,263 @@ static int convertsample(struct sampleinfo *s)
 	return 1;
 }
 
-static int mcpReduceSamples(struct sampleinfo *si, int n, long mem, enum mcpRed opt)
+static size_t smpArenaSampleSize(const struct sampleinfo *s)
+{
+	return ((((size_t)s->length+SAMPEND)<<sampsizefac(s->type)) + (SMP_ARENA_ALIGN-1)) & ~(size_t)(SMP_ARENA_ALIGN-1);
+}
+
+static struct smpArena_t *smpArenaNew(size_t size)
+{
+	struct smpArena_t *a=calloc(1, sizeof(*a));
+	if (!a)
+		return 0;
+	a->size=size;
+#if !defined(_WIN32) && defined(MADV_HUGEPAGE)
+	if (size>=SMP_ARENA_HUGEPAGE)
+	{
+		a->size=(size+SMP_ARENA_HUGEPAGE-1)&~(size_t)(SMP_ARENA_HUGEPAGE-1);
+		a->data=mmap(0, a->size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+		if (a->data==MAP_FAILED)
+		{
+			a->data=0;
+			a->size=size;
+		} else {
+			madvise(a->data, a->size, MADV_HUGEPAGE);
+			a->mmaped=1;
+		}
+	}
+#endif
+	if (!a->data)
+	{
+#ifdef _WIN32
+		a->data=_aligned_malloc(size, SMP_ARENA_ALIGN);
+#else
+		if (posix_memalign((void **)&a->data, SMP_ARENA_ALIGN, size))
+			a->data=0;
+#endif
+	}
+	if (!a->data)
+	{
+		free(a);
+		return 0;
+	}
+	a->next=smpArenas;
+	smpArenas=a;
+	return a;
+}
+
+static void smpArenaFree(struct smpArena_t *a)
+{
+	struct smpArena_t **prev;
+	struct smpCacheEntry_t **e;
+
+	for (e=&smpCache; *e;)
+	{
+		if ((*e)->arena==a)
+		{
+			struct smpCacheEntry_t *next=(*e)->next;
+			free(*e);
+			*e=next;
+		} else
+			e=&(*e)->next;
+	}
+
+	for (prev=&smpArenas; *prev; prev=&(*prev)->next)
+		if (*prev==a)
+		{
+			*prev=a->next;
+			break;
+		}
+
+#if !defined(_WIN32) && defined(MADV_HUGEPAGE)
+	if (a->mmaped)
+		munmap(a->data, a->size);
+	else
+#endif
+#ifdef _WIN32
+		_aligned_free(a->data);
+#else
+		free(a->data);
+#endif
+	free(a);
+}
+
+static void *smpArenaAlloc(struct smpArena_t *a, const struct sampleinfo *s)
+{
+	size_t size=smpArenaSampleSize(s);
+	void *retval;
+	if ((a->fill+size)>a->size)
+		return 0;
+	retval=a->data+a->fill;
+	a->fill+=size;
+	a->refs++;
+	return retval;
+}
+
+static struct smpArena_t *smpArenaFind(const void *ptr)
+{
+	struct smpArena_t *a;
+	for (a=smpArenas; a; a=a->next)
+		if (((const uint8_t *)ptr>=a->data)&&((const uint8_t *)ptr<(a->data+a->fill)))
+			return a;
+	return 0;
+}
+
+/* evict the oldest unreferenced arenas until the cache is within its limit */
+static void smpCacheTrim(void)
+{
+	while (1)
+	{
+		struct smpArena_t *a, *oldest=0;
+		size_t unused=0;
+		for (a=smpArenas; a; a=a->next)
+		{
+			if (a->refs)
+				continue;
+			unused+=a->size;
+			if ((!oldest)||((int32_t)(a->released-oldest->released)<0))
+				oldest=a;
+		}
+		if ((!oldest)||(unused<=smpCacheLimit))
+			return;
+		smpArenaFree(oldest);
+	}
+}
+
+static uint64_t smpCacheHash(const struct sampleinfo *s)
+{ /* FNV-1a, 64bit */
+	uint64_t hash=0xcbf29ce484222325ull;
+	const uint8_t *src=s->ptr;
+	size_t len=s->ptr?((size_t)s->length<<sampsizefac(s->type)):0;
+	while (len--)
+	{
+		hash^=*src++;
+		hash*=0x100000001b3ull;
+	}
+	return hash;
+}
+
+static struct smpCacheEntry_t *smpCacheLookup(const struct sampleinfo *s, uint64_t hash, enum mcpRed opt)
+{
+	struct smpCacheEntry_t *e;
+	for (e=smpCache; e; e=e->next)
+		if ((e->hash==hash)&&
+		    (e->opt==opt)&&
+		    (e->before.type==s->type)&&
+		    (e->before.length==s->length)&&
+		    (e->before.samprate==s->samprate)&&
+		    (e->before.loopstart==s->loopstart)&&
+		    (e->before.loopend==s->loopend)&&
+		    (e->before.sloopstart==s->sloopstart)&&
+		    (e->before.sloopend==s->sloopend))
+			return e;
+	return 0;
+}
+
+static void smpArenaRelease(struct smpArena_t *a)
+{
+	if (--a->refs)
+		return;
+	a->released=++smpGeneration;
+	if (!smpCacheLimit)
+		smpArenaFree(a);
+	else
+		smpCacheTrim();
+}
+
+/* Moves the converted samples that are not already arena backed into a new arena.
+ * If before/hashes are given, the samples are also registered in the cache */
+static int smpArenaCommit(struct sampleinfo *samples, int samplenum, const struct sampleinfo *before, const uint64_t *hashes, enum mcpRed opt)
+{
+	struct smpArena_t *a;
+	size_t size=0;
+	int i;
+
+	for (i=0; i<samplenum; i++)
+		if (!smpArenaFind(samples[i].ptr))
+			size+=smpArenaSampleSize(&samples[i]);
+	if (!size)
+		return 1;
+
+	if (!(a=smpArenaNew(size)))
+	{
+		fprintf(stderr, __FILE__ " smpArenaCommit(): warning, failed to allocate arena, samples are left on the heap\n");
+		return 1; /* mcpFreeSamples() handles heap samples too */
+	}
+
+	for (i=0; i<samplenum; i++)
+	{
+		void *dst;
+		if (smpArenaFind(samples[i].ptr))
+			continue;
+		dst=smpArenaAlloc(a, &samples[i]);
+		memcpy(dst, samples[i].ptr, ((size_t)samples[i].length+SAMPEND)<<sampsizefac(samples[i].type));
+		free(samples[i].ptr);
+		samples[i].ptr=dst;
+
+		if (before&&smpCacheLimit)
+		{
+			struct smpCacheEntry_t *e=malloc(sizeof(*e));
+			if (!e)
+				continue;
+			e->arena=a;
+			e->hash=hashes[i];
+			e->opt=opt;
+			e->before=before[i];
+			e->after=samples[i];
+			e->next=smpCache;
+			smpCache=e;
+		}
+	}
+	return 1;
+}
+
+static void mcpFreeSamples(struct sampleinfo *samples, int samplenum)
+{
+	int i;
+	for (i=0; i<samplenum; i++)
+	{
+		struct smpArena_t *a;
+		if (!samples[i].ptr)
+			continue;
+		if ((a=smpArenaFind(samples[i].ptr)))
+			smpArenaRelease(a);
+		else
+			free(samples[i].ptr);
+		samples[i].ptr=0;
+	}
+}
+
+static void smpCacheFlush(void)
+{
+	while (smpArenas)
+	{
+		if (smpArenas->refs)
+			fprintf(stderr, __FILE__ " smpCacheFlush(): warning, arena still referenced\n");
+		smpArenaFree(smpArenas);
+	}
+}
+
+/* first pass of the conversion, done per sample before the sample bank size is checked */
+static int smpPrepareSample(struct sampleinfo *s, enum mcpRed opt)
+{
+	if (!convertsample(s))
+		return 0;
+	repairloop(s);
+	if (!expandsmp(s, opt&mcpRedNoPingPong))
+		return 0;
+
+	if ((opt&mcpRedToMono)&&(s->type&mcpSampInterleavedStereo))
+		samptomono(s);
+
+	if ((opt&(mcpRedGUS|mcpRedTo8Bit))&&(s->type&mcpSamp16Bit)&&((opt&mcpRedTo8Bit)||((s->length+SAMPEND)>(128*1024))))
+		sampto8(s);
+
+	return 1;
+}
+
+/* cached[i] is set for samples that were found in the cache, before[i] holds their unconverted data */
+static int smpConvertSamples(struct sampleinfo *si, int n, long mem, enum mcpRed opt, const struct sampleinfo *before, char *cached, int *reduced)
 {
 	struct sampleinfo *samples=si;
 	int32_t memmax=mem;
@@ -878,34 +1169,17 @@ static int mcpReduceSamples(struct sampleinfo *si, int n, long mem, enum mcpRed
 #ifdef MCP_DEBUG
 		fprintf(stderr, __FILE__ ": [%d]\n", i);
 #endif
-		if (!convertsample(&samples[i]))
-		{
-#ifdef MCP_DEBUG
-			fprintf(stderr, __FILE__ ": mcpReduceSamples FAILED\n");
-#endif
-			return 0;
-		}
-		repairloop(&samples[i]);
-		if (!expandsmp(&samples[i], opt&mcpRedNoPingPong))
+		if (cached&&cached[i])
+			continue;
+		if (!smpPrepareSample(&samples[i], opt))
 		{
 #ifdef MCP_DEBUG
 			fprintf(stderr, __FILE__ ": mcpReduceSamples FAILED\n");
 #endif
 			return 0;
 		}
-
 	}
 
-	if (opt&mcpRedToMono)
-		for (i=0; i<samplenum; i++)
-			if (samples[i].type&mcpSampInterleavedStereo)
-				samptomono(&samples[i]);
-
-	if (opt&(mcpRedGUS|mcpRedTo8Bit))
-		for (i=0; i<samplenum; i++)
-			if ((samples[i].type&mcpSamp16Bit)&&((opt&mcpRedTo8Bit)||((samples[i].length+SAMPEND)>(128*1024))))
-				sampto8(&samples[i]);
-
 	if (totalsmpsize(samples, samplenum, opt&mcpRedAlways16Bit)>memmax)
 	{
 		uint32_t *redpars=malloc(sizeof(uint32_t)*samplenum);
@@ -914,6 +1188,21 @@ static int mcpReduceSamples(struct sampleinfo *si, int n, long mem, enum mcpRed
 
 		if (!redpars)
 			return 0;
+
+		/* the reduction is done across the whole sample bank, so cached samples can not be used */
+		*reduced=1;
+		for (i=0; i<samplenum; i++)
+			if (cached&&cached[i])
+			{
+				smpArenaRelease(smpArenaFind(samples[i].ptr));
+				samples[i]=before[i];
+				cached[i]=0;
+				if (!smpPrepareSample(&samples[i], opt))
+				{
+					free(redpars);
+					return 0;
+				}
+			}
 		if ((opt&mcpRedAlways16Bit)||!reduce16(samples, samplenum, redpars, memmax))
 			if (!reducestereo(samples, samplenum, redpars, memmax))
 				if (!reducefrq(samples, samplenum, redpars, memmax))
@@ -928,7 +1217,7 @@ static int mcpReduceSamples(struct sampleinfo *si, int n, long mem, enum mcpRed
 	}
 
 	for (i=0; i<samplenum; i++)
-		if (!repairsmp(&samples[i]))
+		if (!(cached&&cached[i])&&!repairsmp(&samples[i]))
 		{
 #ifdef MCP_DEBUG
 			fprintf(stderr, __FILE__ ": mcpReduceSamples FAILED\n");
@@ -938,7 +1227,7 @@ static int mcpReduceSamples(struct sampleinfo *si, int n, long mem, enum mcpRed
 
 	if (opt&mcpRedToFloat)
 		for (i=0; i<samplenum; i++)
-			if (!samptofloat(&samples[i]))
+			if (!(cached&&cached[i])&&!samptofloat(&samples[i]))
 			{
 #ifdef MCP_DEBUG
 				fprintf(stderr, __FILE__ ": mcpReduceSamples FAILED\n");
@@ -953,3 +1242,56 @@ static int mcpReduceSamples(struct sampleinfo *si, int n, long mem, enum mcpRed
 
 	return 1;
 }
+
+static int mcpReduceSamples(struct sampleinfo *si, int n, long mem, enum mcpRed opt)
+{
+	struct sampleinfo *before=0;
+	uint64_t *hashes=0;
+	char *cached=0;
+	int reduced=0;
+	int retval;
+	int i;
+
+	if (smpCacheLimit&&(n>0))
+	{
+		before=malloc(sizeof(before[0])*n);
+		hashes=malloc(sizeof(hashes[0])*n);
+		cached=calloc(n, sizeof(cached[0]));
+		if ((!before)||(!hashes)||(!cached))
+		{
+			free(before); before=0;
+			free(hashes); hashes=0;
+			free(cached); cached=0;
+		}
+	}
+
+	if (cached)
+		for (i=0; i<n; i++)
+		{
+			struct smpCacheEntry_t *e;
+
+			before[i]=si[i];
+			hashes[i]=smpCacheHash(&si[i]);
+			if ((e=smpCacheLookup(&si[i], hashes[i], opt)))
+			{
+				si[i]=e->after;
+				e->arena->refs++;
+				cached[i]=1;
+			}
+		}
+
+	retval=smpConvertSamples(si, n, mem, opt, before, cached, &reduced);
+	if (retval)
+		smpArenaCommit(si, n, reduced?0:before, hashes, opt);
+
+	if (cached)
+		for (i=0; i<n; i++)
+			if (cached[i])
+				free(before[i].ptr); /* unconverted data is no longer needed */
+
+	free(before);
+	free(hashes);
+	free(cached);
+
+	return retval;
+}
@@ -47,6 +47,7 @@
 #include "stuff/err.h"
 #include "stuff/imsrtns.h"
 #include "stuff/poutput.h"
+#include "stuff/profile.h"
 #include "stuff/utf-8.h"
 
 //#define ALSA_DEBUG_OUTPUT 1
@@ -603,6 +604,7 @@ static unsigned int devpALSAIdle(void)
 	int err;
 	int kernlen;
 	unsigned int RetVal;
+	uint64_t start;
 
 	if (busy++)
 	{
@@ -640,6 +642,7 @@ static unsigned int devpALSAIdle(void)
 	if (snd_pcm_status_get_state (alsa_pcm_status) == SND_PCM_STATE_XRUN)
 	{
 		fprintf (stderr, "ALSA: Buffer underrun detected, restarting PCM stream\n");
+		plrDriverAPI->profileAPI->xrun ();
 		snd_pcm_prepare (alsa_pcm);
 		goto error_out;
 	} else {
@@ -717,6 +720,7 @@ static unsigned int devpALSAIdle(void)
 	}
 
 	result=0; // remove warning in the if further down
+	start = plrDriverAPI->profileAPI->now ();
 	if (length1)
 	{
 		if (devpALSAShadowBuffer)
@@ -749,11 +753,14 @@ static unsigned int devpALSAIdle(void)
 		}
 	}
 
+	plrDriverAPI->profileAPI->add (profileStageDeviceWrite, start);
+
 	if (result<0)
 	{
 		if (result==-EPIPE)
 		{
 			fprintf (stderr, "ALSA: Machine is too slow, calling snd_pcm_prepare()\n");
+			plrDriverAPI->profileAPI->xrun ();
 			snd_pcm_prepare(alsa_pcm); /* TODO, can this fail? */
 			debug_printf ("      snd_pcm_prepare()\n");
 		} else {
@@ -51,6 +51,7 @@
 #include "dev/ringbuffer.h"
 #include "stuff/err.h"
 #include "stuff/imsrtns.h"
+#include "stuff/profile.h"
 
 #ifdef OSS_DEBUG
 #define debug_printf(...) fprintf (stderr, __VA_ARGS__)
@@ -90,6 +91,7 @@ static unsigned int devpOSSIdle(void)
 	int result, odelay, tmp;
 	int kernlen;
 	unsigned int RetVal;
+	uint64_t start;
 
 	struct audio_buf_info info;
 
@@ -194,6 +196,7 @@ static unsigned int devpOSSIdle(void)
 		length2 = tmp - length1;
 	}
 
+	start = plrDriverAPI->profileAPI->now ();
 	while (length1)
 	{
 		if (devpOSSShadowBuffer)
@@ -229,6 +232,7 @@ static unsigned int devpOSSIdle(void)
 		pos1 = pos2;
 		pos2 = 0;
 	}
+	plrDriverAPI->profileAPI->add (profileStageDeviceWrite, start);
 /* Move data from ringbuffer-head into processing/kernel STOP */
 
 	debug_printf ("devpOSSIdle POST: tail:%d processing:%d head:%d\n", plrDriverAPI->ringbufferAPI->get_tail_available_samples (devpOSSRingBuffer), plrDriverAPI->ringbufferAPI->get_processing_available_samples(devpOSSRingBuffer), plrDriverAPI->ringbufferAPI->get_head_available_samples(devpOSSRingBuffer));
@@ -116,6 +116,10 @@ static void theRenderProc(void *userdata, Uint8 *stream, int len)
 	{
 		memset (stream, 0, len);
 		PRINT("%s: buffer overrun - %d left\n", __FUNCTION__, len);
+		if (!devpSDLPauseSamples)
+		{
+			plrDriverAPI->profileAPI->xrun ();
+		}
 	}
 }
 
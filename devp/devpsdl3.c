@@ -42,6 +42,7 @@
 #include "dev/ringbuffer.h"
 #include "stuff/err.h"
 #include "stuff/imsrtns.h"
+#include "stuff/profile.h"
 
 #ifdef SDL3_DEBUG
  #define PRINT(...) fprintf(stderr, __VA_ARGS__)
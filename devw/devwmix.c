@@ -50,11 +50,17 @@
 #include "dev/postproc.h"
 #include "stuff/err.h"
 #include "stuff/imsrtns.h"
+#include "stuff/profile.h"
+#include "dwcmdq.h"
 #include "dwmix.h"
 #include "dwmixa.h"
 #include "dwmixqa.h"
+#include "dwtap.h"
 
 #define MIXBUFLEN 4096
+#if MIXBUFLEN > DWTAP_MAXBLOCK
+#error MIXBUFLEN must not be larger than DWTAP_MAXBLOCK
+#endif
 #define MAXCHAN 255
 
 static const struct mcpDriver_t mcpMixer;
@@ -97,14 +103,8 @@ static int channelnum;
 static struct channel *channels;
 static int32_t fadedown[2];
 
-static int32_t (*voltabsr)[256];
-static int16_t (*voltabsq)[2][256];
-
-static uint8_t (*interpoltabr)[256][2];
-static int16_t (*interpoltabq)[32][256][2];
-static int16_t (*interpoltabq2)[16][256][4];
-
 static int16_t *scalebuf=0;
+static struct dwtap taps; /* what playchannelq() rendered, for the channel scopes */
 static int32_t *buf32;
 
 static void (*playerproc)(struct cpifaceSessionAPI_t *cpifaceSession);
@@ -124,68 +124,28 @@ static int masterchr;
 
 static uint32_t IdleCache; /* To prevent devpDisk lockup */
 
-static int devwMixProcKey (uint16_t key);
-
-static void calcinterpoltabr(void)
-	/* used by OpenPlayer */
-{
-	int i,j;
-	for (i=0; i<16; i++)
-		for (j=0; j<256; j++)
-		{
-			interpoltabr[i][j][1]=(i*(signed char)j)>>4;
-			interpoltabr[i][j][0]=(signed char)j-interpoltabr[i][j][1];
-		}
-}
-
-static void calcinterpoltabq(void)
-	/* used by OpenPlayer */
-{
-	int i,j;
-	for (i=0; i<32; i++)
-		for (j=0; j<256; j++)
-		{
-			interpoltabq[0][i][j][1]=(i*(signed char)j)<<3;
-			interpoltabq[0][i][j][0]=(((signed char)j)<<8)-interpoltabq[0][i][j][1];
-			interpoltabq[1][i][j][1]=(i*j)>>5;
-			interpoltabq[1][i][j][0]=j-interpoltabq[1][i][j][1];
-		}
-	for (i=0; i<16; i++)
-		for (j=0; j<256; j++)
-		{
-			interpoltabq2[0][i][j][0]=((16-i)*(16-i)*(signed char)j)>>1;
-			interpoltabq2[0][i][j][2]=(i*i*(signed char)j)>>1;
-			interpoltabq2[0][i][j][1]=(((signed char)j)<<8)-interpoltabq2[0][i][j][0]-interpoltabq2[0][i][j][2];
-			interpoltabq2[1][i][j][0]=((16-i)*(16-i)*j)>>9;
-			interpoltabq2[1][i][j][2]=(i*i*j)>>9;
-			interpoltabq2[1][i][j][1]=j-interpoltabq2[1][i][j][0]-interpoltabq2[1][i][j][2];
-		}
-}
+static struct dwcmdq cmdqueue; /* mcpSet() commands from outside the mixer */
+static dwmix_tls int inmixer; /* set while devwMixIdle() runs on this thread, playerproc() commands are applied directly */
 
-static void calcvoltabsr(void)
-	/* used by OpenPlayer */
+static struct
 {
-	int i,j;
-	for (i=0; i<=512; i++)
-		for (j=0; j<256; j++)
-			voltabsr[i][j]=(i-256)*(signed char)j;
-}
+	unsigned int seq;
+	int timer;
+	int cmdtimer;
+	int masterrvb;
+	int masterchr;
+	unsigned int popped; /* cmdqueue position the snapshot includes */
+	struct mixchannel *chan; /* step is given for samprate */
+} snapshot;
+
+static struct
+{ /* Used by SET and GET outside the mixer */
+	struct dwcmdpending mute[MAXCHAN];
+	struct dwcmdpending masterrvb;
+	struct dwcmdpending masterchr;
+} pending;
 
-static void calcvoltabsq(void)
-	/* used by OpenPlayer */
-{
-	int i,j;
-	for (j=0; j<=512; j++)
-	{
-		long amp=j-256;
-		for (i=0; i<256; i++)
-		{
-			int v=amp*(signed char)i;
-			voltabsq[j][0][i]=(v==0x8000)?0x7FFF:v;
-			voltabsq[j][1][i]=(amp*i)>>8;
-		}
-	}
-}
+static int devwMixProcKey (uint16_t key);
 
 static void calcamptab(signed long amp)
 	/* Used by SET
@@ -440,7 +400,11 @@ static void playchannelq(int ch, uint32_t len)
 
 		mixqPlayChannel(scalebuf, len, c, quiet);
 		if (quiet)
+		{
+			dwtap_skip (&taps, ch, len);
 			return;
+		}
+		dwtap_write (&taps, ch, scalebuf, len);
 
 		amplifyfadeq(0, 0, len, &c->curvols[0][0], c->dstvols[0][0]);
 		amplifyfadeq(0, 1, len, &c->curvols[0][1], c->dstvols[0][1]);
@@ -449,7 +413,44 @@ static void playchannelq(int ch, uint32_t len)
 
 		if (!(c->status&MIXRQ_PLAYING))
 			fadechanq(fadedown, c);
+	} else {
+		dwtap_skip (&taps, ch, len);
+	}
+}
+
+static void devwMixApply (struct cpifaceSessionAPI_t *cpifaceSession, int ch, int opt, int val);
+static void GetMixChannelDirect (unsigned int ch, struct mixchannel *chn, uint32_t rate);
+
+static void devwMixDrain (struct cpifaceSessionAPI_t *cpifaceSession)
+	/* Used by mixer
+	 */
+{
+	struct dwcmd cmd;
+
+	while (dwcmdq_pop (&cmdqueue, &cmd))
+	{
+		devwMixApply (cpifaceSession, cmd.ch, cmd.opt, cmd.val);
+	}
+}
+
+static void devwMixPublish (void)
+	/* Used by mixer
+	 *         OpenPlayer
+	 */
+{
+	int i;
+
+	dwsnap_write_begin (&snapshot.seq);
+	snapshot.timer = imuldiv(playsamps - IdleCache, 65536, samprate);
+	snapshot.cmdtimer = umuldiv(cmdtimerpos, 256, samprate);
+	snapshot.masterrvb = masterrvb;
+	snapshot.masterchr = masterchr;
+	snapshot.popped = dwcmdq_popped (&cmdqueue);
+	for (i=0; i<channelnum; i++)
+	{
+		GetMixChannelDirect (i, &snapshot.chan[i], samprate);
 	}
+	dwsnap_write_end (&snapshot.seq);
 }
 
 static void devwMixIdle  (struct cpifaceSessionAPI_t *cpifaceSession)
@@ -470,6 +471,9 @@ static void devwMixIdle  (struct cpifaceSessionAPI_t *cpifaceSession)
 
 	BARRIER
 
+	inmixer = 1;
+	devwMixDrain (cpifaceSession);
+
 	if (_pause)
 	{
 		cpifaceSession->plrDevAPI->Pause (1);
@@ -477,6 +481,7 @@ static void devwMixIdle  (struct cpifaceSessionAPI_t *cpifaceSession)
 	} else {
 		void *targetbuf;
 		unsigned int targetlength; /* in samples */
+		uint64_t start;
 
 		cpifaceSession->plrDevAPI->Pause (0);
 
@@ -484,6 +489,8 @@ static void devwMixIdle  (struct cpifaceSessionAPI_t *cpifaceSession)
 
 		while (targetlength)
 		{
+			devwMixDrain (cpifaceSession);
+
 			if (targetlength > MIXBUFLEN)
 			{
 				targetlength = MIXBUFLEN;
@@ -493,6 +500,8 @@ static void devwMixIdle  (struct cpifaceSessionAPI_t *cpifaceSession)
 				targetlength=(tickwidth-tickplayed)>>8;
 			}
 
+			start = cpifaceSession->profileAPI->now ();
+
 			mixrFade(buf32, fadedown, targetlength);
 			if (!quality)
 			{
@@ -501,15 +510,24 @@ static void devwMixIdle  (struct cpifaceSessionAPI_t *cpifaceSession)
 			} else {
 				for (i=0; i<channelnum; i++)
 					playchannelq(i, targetlength);
+				dwtap_commit (&taps, targetlength);
 			}
 
+			cpifaceSession->profileAPI->add (profileStageMix, start);
+			start = cpifaceSession->profileAPI->now ();
+
 			for (i=0; i < postprocs; i++)
 			{
 				postproc[i]->Process (cpifaceSession, buf32, targetlength, samprate);
 			}
 
+			cpifaceSession->profileAPI->add (profileStagePostProc, start);
+			start = cpifaceSession->profileAPI->now ();
+
 			mixrClip((char*)targetbuf, buf32, targetlength << 1 /* stereo */, amptab, clipmax);
 
+			cpifaceSession->profileAPI->add (profileStageClip, start);
+
 			tickplayed+=targetlength<<8;
 			if (!((tickwidth-tickplayed)>>8))
 			{
@@ -535,14 +553,18 @@ static void devwMixIdle  (struct cpifaceSessionAPI_t *cpifaceSession)
 
 	cpifaceSession->plrDevAPI->Idle();
 
+	devwMixPublish ();
+	inmixer = 0;
+
 	BARRIER
 
 	clipbusy--;
 }
 
-static void devwMixSET (struct cpifaceSessionAPI_t *cpifaceSession, int ch, int opt, int val)
+static void devwMixApply (struct cpifaceSessionAPI_t *cpifaceSession, int ch, int opt, int val)
 {
-	/* Refered by OpenPlayer
+	/* Used by mixer
+	 *         SET
 	 */
 	struct channel *chn;
 
@@ -764,16 +786,100 @@ static void devwMixSET (struct cpifaceSessionAPI_t *cpifaceSession, int ch, int
 	}
 }
 
+static void devwMixSET (struct cpifaceSessionAPI_t *cpifaceSession, int ch, int opt, int val)
+{
+	/* Refered by OpenPlayer
+	 */
+	if (inmixer)
+	{
+		devwMixApply (cpifaceSession, ch, opt, val);
+		return;
+	}
+	/* If the queue is full, the mixer has not run for a long time (player setup
+	 * before the first Idle), or is running right now. Commands must never be
+	 * dropped, so wait until the mixer is not busy, and then do its work from
+	 * here: flush the queue to keep the commands in order, and apply this one.
+	 */
+	while (!dwcmdq_push (&cmdqueue, ch, opt, val))
+	{
+		if (clipbusy++)
+		{
+			clipbusy--;
+			continue;
+		}
+
+		BARRIER
+
+		inmixer = 1;
+		devwMixDrain (cpifaceSession);
+		devwMixApply (cpifaceSession, ch, opt, val);
+		devwMixPublish ();
+		inmixer = 0;
+
+		BARRIER
+
+		clipbusy--;
+		return;
+	}
+
+	if (ch>=channelnum)
+		ch=channelnum-1;
+	if (ch<0)
+		ch=0;
+	switch (opt)
+	{
+		case mcpCMute:
+			dwcmdpending_set (&pending.mute[ch], &cmdqueue, !!val);
+			break;
+		case mcpMasterReverb:
+			dwcmdpending_set (&pending.masterrvb, &cmdqueue, (val>=64)?64:(val<0)?0:val);
+			break;
+		case mcpMasterChorus:
+			dwcmdpending_set (&pending.masterchr, &cmdqueue, (val>=64)?64:(val<0)?0:val);
+			break;
+	}
+}
+
 static int devwMixGET (struct cpifaceSessionAPI_t *cpifaceSession, int ch, int opt)
 {
 	/* Refered by OpenPlayer
 	 */
 	struct channel *chn;
+	unsigned int seq, popped;
+	int retval;
 
 	if (ch>=channelnum)
 		ch=channelnum-1;
 	if (ch<0)
 		ch=0;
+
+	if (!inmixer)
+	{
+		do
+		{
+			seq = dwsnap_read_begin (&snapshot.seq);
+			switch (opt)
+			{
+				case mcpCStatus:      retval = !!(snapshot.chan[ch].status&MIX_PLAYING); break;
+				case mcpCMute:        retval = !!(snapshot.chan[ch].status&MIX_MUTE);    break;
+				case mcpGTimer:       retval = snapshot.timer;                           break;
+				case mcpGCmdTimer:    retval = snapshot.cmdtimer;                        break;
+				case mcpMasterReverb: retval = snapshot.masterrvb;                       break;
+				case mcpMasterChorus: retval = snapshot.masterchr;                       break;
+				default:              retval = 0;                                        break;
+			}
+			popped = snapshot.popped;
+		} while (dwsnap_read_retry (&snapshot.seq, seq));
+		/* commands still in the queue are newer than the snapshot */
+		switch (opt)
+		{
+			case mcpCMute:        dwcmdpending_get (&pending.mute[ch], popped, &retval);    break;
+			case mcpMasterReverb: dwcmdpending_get (&pending.masterrvb, popped, &retval);  break;
+			case mcpMasterChorus: dwcmdpending_get (&pending.masterchr, popped, &retval);  break;
+		}
+		return retval;
+	}
+
 	chn=&channels[ch];
 	switch (opt)
 	{
@@ -805,8 +911,10 @@ static void devwMixGetVolRegs (struct cpifaceSessionAPI_t *cpifaceSession, void
 	}
 }
 
-static void GetMixChannel(unsigned int ch, struct mixchannel *chn, uint32_t rate)
-	/* Refered to by OpenPlayer to mixInit */
+static void GetMixChannelDirect (unsigned int ch, struct mixchannel *chn, uint32_t rate)
+	/* Used by GetMixChannel
+	 *         mixer
+	 */
 {
 #warning GetMixChannel assumes volume data is for mono-sample
 	struct channel *c=&channels[ch];
@@ -837,6 +945,32 @@ static void GetMixChannel(unsigned int ch, struct mixchannel *chn, uint32_t rate
 		chn->status|=MIX_PLAYSTEREO;
 }
 
+static void GetMixChannel(unsigned int ch, struct mixchannel *chn, uint32_t rate)
+	/* Refered to by OpenPlayer to mixInit */
+{
+	unsigned int seq;
+
+	if (inmixer)
+	{
+		GetMixChannelDirect (ch, chn, rate);
+		return;
+	}
+	do
+	{
+		seq = dwsnap_read_begin (&snapshot.seq);
+		*chn = snapshot.chan[ch];
+	} while (dwsnap_read_retry (&snapshot.seq, seq));
+	chn->step=imuldiv(chn->step, samprate, (signed)rate);
+}
+
+static int GetMixTap(unsigned int ch, void *buf, unsigned int len, uint32_t rate)
+	/* Refered to by OpenPlayer to mixSetTap */
+{
+	if (rate!=samprate)
+		return 0;
+	return dwtap_read (&taps, ch, buf, len);
+}
+
 static int devwMixLoadSamples (struct cpifaceSessionAPI_t *cpifaceSession, struct sampleinfo *sil, int n)
 {
 #if 0
@@ -889,34 +1023,12 @@ static int devwMixOpenPlayer(int chan, void (*proc)(struct cpifaceSessionAPI_t *
 	if (!quality)
 	{
 		scalebuf=0;
-		voltabsq=0;
-		interpoltabq=0;
-		interpoltabq2=0;
-		if (!(voltabsr=malloc(sizeof(uint32_t)*513*256))) /*new long [513][256];*/
-		{
-			goto error_out;
-		}
-		if (!(interpoltabr=malloc(sizeof(uint8_t)*16*256*2))) /*new unsigned char [16][256][2];*/
-		{
-			goto error_out;
-		}
 	} else {
-		voltabsr=0;
-		interpoltabr=0;
 		if (!(scalebuf=malloc (MIXBUFLEN * sizeof(int16_t) * 2 /* stereo */)))
 		{
 			goto error_out;
 		}
-
-		if (!(voltabsq=malloc(sizeof(uint16_t)*513*2*256))) /*new short [513][2][256];*/
-		{
-			goto error_out;
-		}
-		if (!(interpoltabq=malloc(sizeof(uint16_t)*2*32*256*2))) /*new unsigned short [2][32][256][2];*/
-		{
-			goto error_out;
-		}
-		if (!(interpoltabq2=malloc(sizeof(uint16_t)*2*16*256*4))) /*new unsigned short [2][16][256][4];*/
+		if (!dwtap_init (&taps, chan, sizeof (int16_t) * 2 /* stereo */))
 		{
 			goto error_out;
 		}
@@ -934,6 +1046,12 @@ static int devwMixOpenPlayer(int chan, void (*proc)(struct cpifaceSessionAPI_t *
 	{
 		goto error_out;
 	}
+	if (!(snapshot.chan=calloc(sizeof(struct mixchannel), chan)))
+	{
+		goto error_out;
+	}
+	dwcmdq_reset (&cmdqueue);
+	memset (&pending, 0, sizeof (pending));
 
 	currentrate = cpifaceSession->mcpAPI->MixProcRate / chan;
 	samprate = (currentrate > cpifaceSession->mcpAPI->MixMaxRate) ? cpifaceSession->mcpAPI->MixMaxRate : currentrate;
@@ -947,20 +1065,13 @@ static int devwMixOpenPlayer(int chan, void (*proc)(struct cpifaceSessionAPI_t *
 	{
 		goto error_out_plrDevAPI_Play;
 	}
-
-	calcvols();
-
-	if (!quality)
+	if (quality)
 	{
-		mixrSetupAddresses(&voltabsr[256], interpoltabr);
-		calcinterpoltabr();
-		calcvoltabsr();
-	} else {
-		mixqSetupAddresses(&voltabsq[256], interpoltabq, interpoltabq2);
-		calcinterpoltabq();
-		calcvoltabsq();
+		mix->mixSetTap (cpifaceSession, GetMixTap);
 	}
 
+	calcvols();
+
 	_pause=0;
 	orgspeed=12800;
 
@@ -983,6 +1094,8 @@ static int devwMixOpenPlayer(int chan, void (*proc)(struct cpifaceSessionAPI_t *
 		postproc[i]->Init(samprate);
 	}
 
+	devwMixPublish ();
+
 	cpifaceSession->mcpActive = 1;
 
 	return 1;
@@ -992,14 +1105,11 @@ error_out_plrDevAPI_Play:
 	cpifaceSession->plrDevAPI->Stop (cpifaceSession);
 error_out:
 	free (amptab);        amptab = 0;
-	free (voltabsr);      voltabsr = 0;
-	free (interpoltabr);  interpoltabr = 0;
 	free (scalebuf);      scalebuf = 0;
-	free (voltabsq);      voltabsq = 0;
-	free (interpoltabq);  interpoltabq = 0;
-	free (interpoltabq2); interpoltabq2 = 0;
+	dwtap_done (&taps);
 	free (buf32);         buf32 = 0;
 	free (channels);      channels = 0;
+	free (snapshot.chan); snapshot.chan = 0;
 
 	return 0;
 }
@@ -1022,23 +1132,17 @@ static void devwMixClosePlayer (struct cpifaceSessionAPI_t *cpifaceSession)
 		postproc[i]->Close();
 	}
 
-	if (voltabsr) free(voltabsr);
-	if (interpoltabr) free(interpoltabr);
 	if (scalebuf) free(scalebuf);
-	if (voltabsq) free(voltabsq);
-	if (interpoltabq) free(interpoltabq);
-	if (interpoltabq2) free(interpoltabq2);
+	dwtap_done (&taps);
 
 	free(channels);
 	free(amptab);
 	free(buf32);
+	free(snapshot.chan);
 
-	voltabsr=NULL;
-	interpoltabr=NULL;
 	scalebuf=NULL;
-	voltabsq=NULL;
-	interpoltabq=NULL;
-	interpoltabq2=NULL;
+	snapshot.chan=NULL;
+	dwcmdq_reset (&cmdqueue);
 
 	cpifaceSession->mcpActive = 0;
 }
@@ -62,7 +62,13 @@
 #include "dev/postproc.h"
 #include "stuff/err.h"
 #include "stuff/imsrtns.h"
+#include "dwcmdq.h"
 #include "dwmixfa.h"
+#include "dwtap.h"
+
+#if MIXF_MIXBUFLEN > DWTAP_MAXBLOCK
+#error MIXF_MIXBUFLEN must not be larger than DWTAP_MAXBLOCK
+#endif
 
 static const struct mcpDriver_t mcpFMixer;
 
@@ -137,6 +143,30 @@ static uint32_t relspeed;
 static uint32_t newtickwidth;
 static uint32_t cmdtimerpos;
 
+static struct dwcmdq cmdqueue; /* mcpSet() commands from outside the mixer */
+static struct dwtap taps; /* what mixer() played for each voice, for the channel scopes */
+static dwmix_tls int inmixer; /* set while devwMixFIdle() runs on this thread, playerproc() commands are applied directly */
+
+static struct
+{
+	unsigned int seq;
+	int timer;
+	int cmdtimer;
+	int masterrvb;
+	int masterchr;
+	int nsamples;
+	unsigned int popped; /* cmdqueue position the snapshot includes */
+	struct mixchannel *chan; /* step is given for samprate */
+	dwmixfa_channel_t *voice; /* for getrealvol() */
+} snapshot;
+
+static struct
+{ /* Used by SET and GET outside the mixer */
+	struct dwcmdpending mute[MIXF_MAXCHAN];
+	struct dwcmdpending masterrvb;
+	struct dwcmdpending masterchr;
+} pending;
+
 static float mastervol;
 static float masterbal;
 static float masterpan;
@@ -302,6 +332,38 @@ static void stopchan(struct channel *c)
 	dwmixfa_state.ch[n].voiceflags &= ~MIXF_PLAYING;
 }
 
+static void devwMixFApply (struct cpifaceSessionAPI_t *cpifaceSession, int ch, int opt, int val);
+static void GetMixChannelDirect (unsigned int ch, struct mixchannel *chn, uint32_t rate);
+
+static void devwMixFDrain (struct cpifaceSessionAPI_t *cpifaceSession)
+{
+	struct dwcmd cmd;
+
+	while (dwcmdq_pop (&cmdqueue, &cmd))
+	{
+		devwMixFApply (cpifaceSession, cmd.ch, cmd.opt, cmd.val);
+	}
+}
+
+static void devwMixFPublish (void)
+{
+	int i;
+
+	dwsnap_write_begin (&snapshot.seq);
+	snapshot.timer = imuldiv(playsamps - IdleCache, 65536, dwmixfa_state.samprate);
+	snapshot.cmdtimer = umuldiv(cmdtimerpos, 256, dwmixfa_state.samprate);
+	snapshot.masterrvb = masterrvb;
+	snapshot.masterchr = masterchr;
+	snapshot.nsamples = dwmixfa_state.nsamples;
+	snapshot.popped = dwcmdq_popped (&cmdqueue);
+	for (i=0; i<channelnum; i++)
+	{
+		GetMixChannelDirect (i, &snapshot.chan[i], dwmixfa_state.samprate);
+		snapshot.voice[i] = dwmixfa_state.ch[i];
+	}
+	dwsnap_write_end (&snapshot.seq);
+}
+
 static void devwMixFIdle (struct cpifaceSessionAPI_t *cpifaceSession)
 {
 	/* mixmain */
@@ -316,6 +378,9 @@ static void devwMixFIdle (struct cpifaceSessionAPI_t *cpifaceSession)
 		return;
 	}
 
+	inmixer = 1;
+	devwMixFDrain (cpifaceSession);
+
 	if (dopause)
 	{
 		cpifaceSession->plrDevAPI->Pause (1);
@@ -331,6 +396,8 @@ static void devwMixFIdle (struct cpifaceSessionAPI_t *cpifaceSession)
 		{
 			uint32_t ticks2go;
 
+			devwMixFDrain (cpifaceSession);
+
 			if (targetlength > MIXF_MIXBUFLEN)
 			{
 				targetlength = MIXF_MIXBUFLEN;
@@ -532,10 +599,13 @@ static void devwMixFIdle (struct cpifaceSessionAPI_t *cpifaceSession)
 
 	IdleCache = cpifaceSession->plrDevAPI->Idle();
 
+	devwMixFPublish ();
+	inmixer = 0;
+
 	clipbusy--;
 }
 
-static void devwMixFSET (struct cpifaceSessionAPI_t *cpifaceSession, int ch, int opt, int val)
+static void devwMixFApply (struct cpifaceSessionAPI_t *cpifaceSession, int ch, int opt, int val)
 {
 	struct channel *chn;
 	if (ch>=channelnum)
@@ -785,14 +855,90 @@ static void devwMixFSET (struct cpifaceSessionAPI_t *cpifaceSession, int ch, int
 	}
 }
 
+static void devwMixFSET (struct cpifaceSessionAPI_t *cpifaceSession, int ch, int opt, int val)
+{
+	if (inmixer)
+	{
+		devwMixFApply (cpifaceSession, ch, opt, val);
+		return;
+	}
+	/* If the queue is full, the mixer has not run for a long time (player setup
+	 * before the first Idle), or is running right now. Commands must never be
+	 * dropped, so wait until the mixer is not busy, and then do its work from
+	 * here: flush the queue to keep the commands in order, and apply this one.
+	 */
+	while (!dwcmdq_push (&cmdqueue, ch, opt, val))
+	{
+		if (clipbusy++)
+		{
+			clipbusy--;
+			continue;
+		}
+		inmixer = 1;
+		devwMixFDrain (cpifaceSession);
+		devwMixFApply (cpifaceSession, ch, opt, val);
+		devwMixFPublish ();
+		inmixer = 0;
+		clipbusy--;
+		return;
+	}
+
+	if (ch>=channelnum)
+		ch=channelnum-1;
+	if (ch<0)
+		ch=0;
+	switch (opt)
+	{
+		case mcpCMute:
+			dwcmdpending_set (&pending.mute[ch], &cmdqueue, !!val);
+			break;
+		case mcpMasterReverb:
+			dwcmdpending_set (&pending.masterrvb, &cmdqueue, (val>=64)?64:(val<0)?0:val);
+			break;
+		case mcpMasterChorus:
+			dwcmdpending_set (&pending.masterchr, &cmdqueue, (val>=64)?64:(val<0)?0:val);
+			break;
+	}
+}
+
 static int devwMixFGET (struct cpifaceSessionAPI_t *cpifaceSession, int ch, int opt)
 {
 /*
 	struct channel *chn;*/
+	unsigned int seq, popped;
+	int retval;
+
 	if (ch>=channelnum)
 		ch=channelnum-1;
 	if (ch<0)
 		ch=0;
+
+	if (!inmixer)
+	{
+		do
+		{
+			seq = dwsnap_read_begin (&snapshot.seq);
+			switch (opt)
+			{
+				case mcpCStatus:      retval = !!(snapshot.chan[ch].status&MIX_PLAYING); break;
+				case mcpCMute:        retval = !!(snapshot.chan[ch].status&MIX_MUTE);    break;
+				case mcpGTimer:       retval = snapshot.timer;                           break;
+				case mcpGCmdTimer:    retval = snapshot.cmdtimer;                        break;
+				case mcpMasterReverb: retval = snapshot.masterrvb;                       break;
+				case mcpMasterChorus: retval = snapshot.masterchr;                       break;
+				default:              retval = 0;                                        break;
+			}
+			popped = snapshot.popped;
+		} while (dwsnap_read_retry (&snapshot.seq, seq));
+		/* commands still in the queue are newer than the snapshot */
+		switch (opt)
+		{
+			case mcpCMute:        dwcmdpending_get (&pending.mute[ch], popped, &retval);    break;
+			case mcpMasterReverb: dwcmdpending_get (&pending.masterrvb, popped, &retval);  break;
+			case mcpMasterChorus: dwcmdpending_get (&pending.masterchr, popped, &retval);  break;
+		}
+		return retval;
+	}
 /*
 	chn=&channels[ch];*/   /* No commands currently use the channel itself */
 	switch (opt)
@@ -832,7 +978,7 @@ static void devwMixFGetVolRegs (struct cpifaceSessionAPI_t *cpifaceSession, void
  * bla, toller hack: es funktioniert. (fd)
  */
 
-static void GetMixChannel(unsigned int ch, struct mixchannel *chn, uint32_t rate)
+static void GetMixChannelDirect (unsigned int ch, struct mixchannel *chn, uint32_t rate)
 {
 	struct channel *c=&channels[ch];
 
@@ -859,11 +1005,46 @@ static void GetMixChannel(unsigned int ch, struct mixchannel *chn, uint32_t rate
 		chn->status|=MIX_PLAYSTEREO;
 }
 
+static void GetMixChannel(unsigned int ch, struct mixchannel *chn, uint32_t rate)
+{
+	unsigned int seq;
+
+	if (inmixer)
+	{
+		GetMixChannelDirect (ch, chn, rate);
+		return;
+	}
+	do
+	{
+		seq = dwsnap_read_begin (&snapshot.seq);
+		*chn = snapshot.chan[ch];
+	} while (dwsnap_read_retry (&snapshot.seq, seq));
+	chn->step=imuldiv(chn->step, dwmixfa_state.samprate, (signed)rate);
+}
+
+static int GetMixTap(unsigned int ch, void *buf, unsigned int len, uint32_t rate)
+	/* Refered to by OpenPlayer to mixSetTap */
+{
+	if (rate!=dwmixfa_state.samprate)
+		return 0;
+	return dwtap_read (&taps, ch, buf, len);
+}
 
 static void getrealvol(int ch, int *l, int *r)
 {
 	float voll, volr;
-	getchanvol(ch, 256, &voll, &volr);
+	dwmixfa_channel_t voice;
+	unsigned int seq;
+	int nsamples;
+
+	do
+	{
+		seq = dwsnap_read_begin (&snapshot.seq);
+		voice = snapshot.voice[ch];
+		nsamples = snapshot.nsamples;
+	} while (dwsnap_read_retry (&snapshot.seq, seq));
+
+	getchanvol(&voice, nsamples, &voll, &volr);
 	if (voll<0)
 		voll=-voll;
 	*l=(voll>16319)?255:(voll/64.0);
@@ -913,10 +1094,28 @@ static int devwMixFOpenPlayer(int chan, void (*proc)(struct cpifaceSessionAPI_t
 	{
 		goto error_out;
 	}
+	if (!(dwmixfa_state.tapbuf=malloc(sizeof(float)*(MIXF_MIXBUFLEN<<1))))
+	{
+		goto error_out;
+	}
+	if (!dwtap_init (&taps, chan, sizeof (float) * 2 /* stereo */))
+	{
+		goto error_out;
+	}
 	if (!(channels=calloc(sizeof(struct channel), chan)))
 	{
 		goto error_out;
 	}
+	if (!(snapshot.chan=calloc(sizeof(struct mixchannel), chan)))
+	{
+		goto error_out;
+	}
+	if (!(snapshot.voice=calloc(sizeof(dwmixfa_channel_t), chan)))
+	{
+		goto error_out;
+	}
+	dwcmdq_reset (&cmdqueue);
+	memset (&pending, 0, sizeof (pending));
 
 	currentrate = cpifaceSession->mcpAPI->MixProcRate / chan;
 	dwmixfa_state.samprate = ( currentrate > cpifaceSession->mcpAPI->MixMaxRate) ? cpifaceSession->mcpAPI->MixMaxRate : currentrate;
@@ -931,6 +1130,7 @@ static int devwMixFOpenPlayer(int chan, void (*proc)(struct cpifaceSessionAPI_t
 		goto error_out_plrDevAPI_Play;
 	}
 	cpifaceSession->mcpGetRealVolume = getrealvol; /* override mixInit */
+	mix->mixSetTap (cpifaceSession, GetMixTap);
 
 	calcvols();
 
@@ -950,6 +1150,7 @@ static int devwMixFOpenPlayer(int chan, void (*proc)(struct cpifaceSessionAPI_t
 	cpifaceSession->mcpGetVolRegs = devwMixFGetVolRegs;
 
 	dwmixfa_state.nvoices=channelnum;
+	dwmixfa_state.tap=&taps;
 	prepare_mixer();
 
 	calcspeed();
@@ -962,6 +1163,8 @@ static int devwMixFOpenPlayer(int chan, void (*proc)(struct cpifaceSessionAPI_t
 		dwmixfa_state.postproc[i]->Init (dwmixfa_state.samprate);
 	}
 
+	devwMixFPublish ();
+
 	cpifaceSession->mcpActive = 1;
 
 	return 1;
@@ -971,7 +1174,11 @@ error_out_plrDevAPI_Play:
 	cpifaceSession->plrDevAPI->Stop (cpifaceSession);
 error_out:
 	free (dwmixfa_state.tempbuf); dwmixfa_state.tempbuf = 0;
+	free (dwmixfa_state.tapbuf);  dwmixfa_state.tapbuf = 0;
+	dwtap_done (&taps);
 	free (channels);              channels = 0;
+	free (snapshot.chan);         snapshot.chan = 0;
+	free (snapshot.voice);        snapshot.voice = 0;
 	return 0;
 }
 
@@ -995,8 +1202,17 @@ static void devwMixFClosePlayer (struct cpifaceSessionAPI_t *cpifaceSession)
 
 	free(channels);
 	free(dwmixfa_state.tempbuf);
+	free(dwmixfa_state.tapbuf);
+	free(snapshot.chan);
+	free(snapshot.voice);
+	dwmixfa_state.tap = 0;
+	dwtap_done (&taps);
 	channels = 0;
 	dwmixfa_state.tempbuf = 0;
+	dwmixfa_state.tapbuf = 0;
+	snapshot.chan = 0;
+	snapshot.voice = 0;
+	dwcmdq_reset (&cmdqueue);
 
 	cpifaceSession->mcpActive = 0;
 }
@@ -0,0 +1,155 @@
+#ifndef _DEVW_DWCMDQ_H
+#define _DEVW_DWCMDQ_H 1
+
+/* Hand-over of mcpSet() commands and mcpGet() state between the user-interface
+ * and the mixer.
+ *
+ * Commands are pushed by the user-interface into a single-producer/single-
+ * consumer ring, and the mixer applies them at the start of each mix block.
+ * Commands issued by the playerproc (which runs inside the mixer) are applied
+ * directly. The mixer publishes a snapshot of the state the user-interface
+ * wants to see at the end of each Idle call, protected by a sequence counter.
+ * Values the user-interface has queued, but the snapshot does not show yet, are
+ * remembered on the user-interface side, so mcpGet() returns what mcpSet() was
+ * just given.
+ *
+ * Neither side ever blocks, so mixing can be moved into a dedicated thread.
+ * Only a full queue makes the user-interface wait for the mixer to be idle.
+ */
+
+#if defined(_MSC_VER)
+#define dwmix_tls __declspec(thread)
+#elif defined(__clang__) || defined(__GNUC__)
+#define dwmix_tls __thread
+#else
+#error Non clang, non gcc, non MSVC compiler found!
+#endif
+
+#define DWCMDQ_SIZE 1024 /* must be power of two */
+
+struct dwcmd
+{
+	int ch;
+	int opt;
+	int val;
+};
+
+struct dwcmdq
+{
+	struct dwcmd cmd[DWCMDQ_SIZE];
+	unsigned int head; /* only written by the producer */
+	unsigned int tail; /* only written by the consumer */
+};
+
+static inline void dwcmdq_reset (struct dwcmdq *q)
+{
+	__atomic_store_n (&q->head, 0, __ATOMIC_RELAXED);
+	__atomic_store_n (&q->tail, 0, __ATOMIC_RELAXED);
+}
+
+/* returns zero if the queue is full */
+static inline int dwcmdq_push (struct dwcmdq *q, int ch, int opt, int val)
+{
+	unsigned int head = __atomic_load_n (&q->head, __ATOMIC_RELAXED);
+	unsigned int tail = __atomic_load_n (&q->tail, __ATOMIC_ACQUIRE);
+	struct dwcmd *cmd;
+
+	if ((head - tail) >= DWCMDQ_SIZE)
+	{
+		return 0;
+	}
+
+	cmd = &q->cmd[head & (DWCMDQ_SIZE - 1)];
+	cmd->ch = ch;
+	cmd->opt = opt;
+	cmd->val = val;
+
+	__atomic_store_n (&q->head, head + 1, __ATOMIC_RELEASE);
+	return 1;
+}
+
+/* returns zero if the queue is empty */
+static inline int dwcmdq_pop (struct dwcmdq *q, struct dwcmd *cmd)
+{
+	unsigned int tail = __atomic_load_n (&q->tail, __ATOMIC_RELAXED);
+	unsigned int head = __atomic_load_n (&q->head, __ATOMIC_ACQUIRE);
+
+	if (head == tail)
+	{
+		return 0;
+	}
+
+	*cmd = q->cmd[tail & (DWCMDQ_SIZE - 1)];
+
+	__atomic_store_n (&q->tail, tail + 1, __ATOMIC_RELEASE);
+	return 1;
+}
+
+/* queue position after the last command pushed, only used by the producer */
+static inline unsigned int dwcmdq_pushed (const struct dwcmdq *q)
+{
+	return __atomic_load_n (&q->head, __ATOMIC_RELAXED);
+}
+
+/* queue position after the last command popped, only used by the consumer */
+static inline unsigned int dwcmdq_popped (const struct dwcmdq *q)
+{
+	return __atomic_load_n (&q->tail, __ATOMIC_RELAXED);
+}
+
+/* A value queued by the producer, kept until a snapshot taken after the
+ * command was popped is published. Clear with memset() on reset.
+ */
+struct dwcmdpending
+{
+	unsigned int mark; /* queue position after the command */
+	int val;
+};
+
+static inline void dwcmdpending_set (struct dwcmdpending *p, const struct dwcmdq *q, int val)
+{
+	p->val = val;
+	p->mark = dwcmdq_pushed (q);
+}
+
+/* popped is the queue position stored in the snapshot, returns zero if the snapshot already has the value */
+static inline int dwcmdpending_get (const struct dwcmdpending *p, unsigned int popped, int *val)
+{
+	if ((int)(p->mark - popped) <= 0)
+	{
+		return 0;
+	}
+	*val = p->val;
+	return 1;
+}
+
+/* Sequence counter for the snapshots: odd while the mixer is writing. Readers
+ * copy the data they need and retry if the counter changed underneath them.
+ */
+static inline void dwsnap_write_begin (unsigned int *seq)
+{
+	__atomic_store_n (seq, *seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence (__ATOMIC_RELEASE);
+}
+
+static inline void dwsnap_write_end (unsigned int *seq)
+{
+	__atomic_store_n (seq, *seq + 1, __ATOMIC_RELEASE);
+}
+
+static inline unsigned int dwsnap_read_begin (const unsigned int *seq)
+{
+	unsigned int s;
+	while ((s = __atomic_load_n (seq, __ATOMIC_ACQUIRE)) & 1)
+	{
+	}
+	return s;
+}
+
+static inline int dwsnap_read_retry (const unsigned int *seq, unsigned int s)
+{
+	__atomic_thread_fence (__ATOMIC_ACQUIRE);
+	return __atomic_load_n (seq, __ATOMIC_RELAXED) != s;
+}
+
+#endif
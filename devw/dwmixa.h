@@ -5,6 +5,5 @@ extern void mixrPlayChannel(int32_t *buf, int32_t *fade, uint32_t len, struct ch
 extern void mixrFadeChannel(int32_t *fade, struct channel *ch);
 extern void mixrFade(int32_t *buf, int32_t *fade, int len);
 extern void mixrClip(void *dst, int32_t *src, int len, void *, int32_t max);
-extern void mixrSetupAddresses(int32_t (*vol)[256], uint8_t (*intr)[256][2]);
 
 #endif
@@ -19,46 +19,49 @@
  * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
 
-/*static uint32_t (*mixrFadeChannelvoltab)[256];*/
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+
+/* Samples are mixed in blocks of MIXR_BLOCK. For each block the source samples
+ * are gathered first, then interpolation and volume are applied in straight
+ * loops without any table lookups, so the compiler (or the SSE2 code below) can process several
+ * samples in parallel.
+ *
+ * The math is the same as the old interpoltabr[16][256][2] and
+ * voltabsr[513][256] tables produced, so the output is bit-exact:
+ *
+ *   f      = fpos >> 12
+ *   interp = (int8_t)(s0 - ((f * s0) >> 4) + ((f * s1) >> 4))
+ *   output = volume * interp
+ *
+ * where s0 and s1 are the signed upper 8 bits of the two neighbour samples.
+ */
+#define MIXR_BLOCK 64
+
 static int32_t ramping[2][2];
-static int32_t (*mixrFadeChannelvoltab)[256];
-static uint8_t (*mixrFadeChannelintrtab)[256][2];
 
-void mixrSetupAddresses(int32_t (*vol)[256], uint8_t (*intr)[256][2])
+static inline int32_t mixrSample8(const struct channel *chan, const uint32_t index)
 {
-	mixrFadeChannelvoltab=vol;
-	mixrFadeChannelintrtab=intr;
+	if (chan->status&MIXRQ_PLAY16BIT)
+	{
+		return chan->realsamp.bit16[index]>>8;
+	}
+	return chan->realsamp.bit8[index];
 }
 
 void mixrFadeChannel(int32_t *fade, struct channel *chan)
 {
 	if (chan->status&MIXRQ_PLAYSTEREO)
 	{
-		if (chan->status&MIXRQ_PLAY16BIT)
-		{
-			fade[0]+=mixrFadeChannelvoltab[chan->curvols[0][0]][((uint16_t)chan->realsamp.bit16[(chan->pos<<1)    ])>>8];
-			fade[0]+=mixrFadeChannelvoltab[chan->curvols[0][1]][((uint16_t)chan->realsamp.bit16[(chan->pos<<1) + 1])>>8];
-			fade[1]+=mixrFadeChannelvoltab[chan->curvols[1][0]][((uint16_t)chan->realsamp.bit16[(chan->pos<<1)    ])>>8];
-			fade[1]+=mixrFadeChannelvoltab[chan->curvols[1][1]][((uint16_t)chan->realsamp.bit16[(chan->pos<<1) + 1])>>8];
-		} else {
-			fade[0]+=mixrFadeChannelvoltab[chan->curvols[0][0]][(uint8_t)chan->realsamp.bit8[(chan->pos<<1)    ]];
-			fade[0]+=mixrFadeChannelvoltab[chan->curvols[0][1]][(uint8_t)chan->realsamp.bit8[(chan->pos<<1) + 1]];
-			fade[1]+=mixrFadeChannelvoltab[chan->curvols[1][0]][(uint8_t)chan->realsamp.bit8[(chan->pos<<1)    ]];
-			fade[1]+=mixrFadeChannelvoltab[chan->curvols[1][1]][(uint8_t)chan->realsamp.bit8[(chan->pos<<1) + 1]];
-		}
+		int32_t l = mixrSample8(chan, (chan->pos<<1)    );
+		int32_t r = mixrSample8(chan, (chan->pos<<1) + 1);
+		fade[0]+=chan->curvols[0][0]*l + chan->curvols[0][1]*r;
+		fade[1]+=chan->curvols[1][0]*l + chan->curvols[1][1]*r;
 	} else {
-		if (chan->status&MIXRQ_PLAY16BIT)
-		{
-			fade[0]+=mixrFadeChannelvoltab[chan->curvols[0][0]][((uint16_t)chan->realsamp.bit16[chan->pos])>>8];
-			fade[0]+=mixrFadeChannelvoltab[chan->curvols[0][1]][((uint16_t)chan->realsamp.bit16[chan->pos])>>8];
-			fade[1]+=mixrFadeChannelvoltab[chan->curvols[1][0]][((uint16_t)chan->realsamp.bit16[chan->pos])>>8];
-			fade[1]+=mixrFadeChannelvoltab[chan->curvols[1][1]][((uint16_t)chan->realsamp.bit16[chan->pos])>>8];
-		} else {
-			fade[0]+=mixrFadeChannelvoltab[chan->curvols[0][0]][(uint8_t)chan->realsamp.bit8[chan->pos]];
-			fade[0]+=mixrFadeChannelvoltab[chan->curvols[0][1]][(uint8_t)chan->realsamp.bit8[chan->pos]];
-			fade[1]+=mixrFadeChannelvoltab[chan->curvols[1][0]][(uint8_t)chan->realsamp.bit8[chan->pos]];
-			fade[1]+=mixrFadeChannelvoltab[chan->curvols[1][1]][(uint8_t)chan->realsamp.bit8[chan->pos]];
-		}
+		int32_t s = mixrSample8(chan, chan->pos);
+		fade[0]+=chan->curvols[0][0]*s + chan->curvols[0][1]*s;
+		fade[1]+=chan->curvols[1][0]*s + chan->curvols[1][1]*s;
 	}
 	chan->curvols[0][0]=0;
 	chan->curvols[0][1]=0;
@@ -66,163 +69,197 @@ void mixrFadeChannel(int32_t *fade, struct channel *chan)
 	chan->curvols[1][1]=0;
 }
 
-static inline int32_t interp_none8(const struct channel *chan, const int volindex, const uint32_t pos, uint32_t fpos)
-{
-	return mixrFadeChannelvoltab[volindex][(uint8_t)(chan->realsamp.bit8[pos])];
-}
-
-static inline int32_t interp_none16(const struct channel *chan, const int volindex, const uint32_t pos, uint32_t fpos)
-{
-	return mixrFadeChannelvoltab[volindex][((uint16_t)(chan->realsamp.bit16[pos]))>>8];
-}
-
-static inline int32_t interp_i8(const struct channel *chan, const int volindex, const uint32_t pos, uint32_t fpos)
-{
-	uint8_t cache =
-		mixrFadeChannelintrtab[fpos>>12][((uint8_t)(chan->realsamp.bit8[pos  ]))][0]+
-		mixrFadeChannelintrtab[fpos>>12][((uint8_t)(chan->realsamp.bit8[pos+1]))][1];
-	return mixrFadeChannelvoltab[volindex][cache];
-}
-
-static inline int32_t interp_i16(const struct channel *chan, const int volindex, const uint32_t pos, uint32_t fpos)
+/* resolve the sample positions of the block and fetch the signed upper 8 bits
+ * of the samples: mono/left into l0, right into r0, and the right neighbours
+ * into l1 and r1 if interpolating.
+ */
+static inline void mixrBlockGather(const struct channel *chan, uint32_t n, uint32_t *_pos, uint32_t *_fpos, const int bit16, const int stereo, const int interpolate, int16_t *f, int16_t *l0, int16_t *l1, int16_t *r0, int16_t *r1)
 {
-	uint8_t cache =
-		mixrFadeChannelintrtab[fpos>>12][((uint16_t)(chan->realsamp.bit16[pos  ]))>>8][0]+
-		mixrFadeChannelintrtab[fpos>>12][((uint16_t)(chan->realsamp.bit16[pos+1]))>>8][1];
-	return mixrFadeChannelvoltab[volindex][cache];
-}
+	uint32_t pos=*_pos;
+	uint32_t fpos=*_fpos;
+	uint32_t fadd=chan->step&0x0000ffff;
+	uint32_t posadd=chan->step>>16;
+	const int next=stereo?2:1;
+	uint32_t i;
+
+	for (i=0; i<n; i++)
+	{
+		uint32_t index=stereo?(pos<<1):pos;
 
-#define MIX_TEMPLATE_M(NAME, INTERP)                                    \
-static void                                                             \
-NAME(int32_t *buf,                                                      \
-     uint32_t len,                                                      \
-     struct channel *chan)                                              \
-{                                                                       \
-    int32_t vol00    = chan->curvols[0][0];                             \
-    int32_t vol00add = ramping[0][0];                                   \
-    int32_t vol01    = chan->curvols[0][1];                             \
-    int32_t vol01add = ramping[0][1];                                   \
-    int32_t vol10    = chan->curvols[1][0];                             \
-    int32_t vol10add = ramping[1][0];                                   \
-    int32_t vol11    = chan->curvols[1][1];                             \
-    int32_t vol11add = ramping[1][1];                                   \
-    uint32_t pos=chan->pos;                                             \
-    uint32_t fpos=chan->fpos;                                           \
-                                                                        \
-    while (len)                                                         \
-        {                                                               \
-            *(buf++)+=interp_##INTERP(chan, vol00, pos, fpos) +         \
-                      interp_##INTERP(chan, vol01, pos, fpos);          \
-            *(buf++)+=interp_##INTERP(chan, vol10, pos, fpos) +         \
-                      interp_##INTERP(chan, vol11, pos, fpos);          \
-            fpos+=chan->step&0x0000ffff;                                \
-            if (fpos&0xffff0000)                                        \
-            {                                                           \
-                pos++;                                                  \
-                fpos&=0xffff;                                           \
-            }                                                           \
-            pos   += chan->step>>16;                                    \
-            vol00 += vol00add;                                          \
-            vol01 += vol01add;                                          \
-            vol10 += vol10add;                                          \
-            vol11 += vol11add;                                          \
-            len--;                                                      \
-        }                                                               \
+		f[i]=fpos>>12;
+		if (bit16)
+		{
+			const int16_t *s=chan->realsamp.bit16+index;
+			l0[i]=s[0]>>8;
+			if (interpolate)
+			{
+				l1[i]=s[next]>>8;
+			}
+			if (stereo)
+			{
+				r0[i]=s[1]>>8;
+				if (interpolate)
+				{
+					r1[i]=s[next+1]>>8;
+				}
+			}
+		} else {
+			const int8_t *s=chan->realsamp.bit8+index;
+			l0[i]=s[0];
+			if (interpolate)
+			{
+				l1[i]=s[next];
+			}
+			if (stereo)
+			{
+				r0[i]=s[1];
+				if (interpolate)
+				{
+					r1[i]=s[next+1];
+				}
+			}
+		}
+		fpos+=fadd;
+		if (fpos&0xffff0000)
+		{
+			pos++;
+			fpos&=0xffff;
+		}
+		pos+=posadd;
+	}
+	*_pos=pos;
+	*_fpos=fpos;
 }
 
-MIX_TEMPLATE_M(playstereo,    none8)
-MIX_TEMPLATE_M(playstereoi,   i8)
-MIX_TEMPLATE_M(playstereo16,  none16)
-MIX_TEMPLATE_M(playstereoi16, i16)
-
-static inline void interp_none8_s(const struct channel *chan, const int volindexLL, const int volindexLR, const int volindexRL, const int volindexRR, const uint32_t pos, uint32_t fpos, int32_t * const outL, int32_t * const outR)
+/* s0 = interpolation of s0 and s1, using the fraction in f */
+static inline void mixrBlockInterpolate(uint32_t n, int16_t *s0, const int16_t *s1, const int16_t *f)
 {
-	*outL = mixrFadeChannelvoltab[volindexLL][(uint8_t)(chan->realsamp.bit8[(pos<<1)  ])]
-	      + mixrFadeChannelvoltab[volindexLR][(uint8_t)(chan->realsamp.bit8[(pos<<1)+1])];
-	*outR = mixrFadeChannelvoltab[volindexRL][(uint8_t)(chan->realsamp.bit8[(pos<<1)  ])]
-	      + mixrFadeChannelvoltab[volindexRR][(uint8_t)(chan->realsamp.bit8[(pos<<1)+1])];
-}
+	uint32_t i=0;
 
-static inline void interp_none16_s(const struct channel *chan, const int volindexLL, const int volindexLR, const int volindexRL, const int volindexRR, const uint32_t pos, uint32_t fpos, int32_t * const outL, int32_t * const outR)
-{
-	*outL = mixrFadeChannelvoltab[ volindexLL ][ ((uint16_t)(chan->realsamp.bit16[(pos<<1)  ]))>>8 ]
-	      + mixrFadeChannelvoltab[ volindexLR ][ ((uint16_t)(chan->realsamp.bit16[(pos<<1)+1]))>>8 ];
-	*outR = mixrFadeChannelvoltab[ volindexRL ][ ((uint16_t)(chan->realsamp.bit16[(pos<<1)  ]))>>8 ]
-	      + mixrFadeChannelvoltab[ volindexRR ][ ((uint16_t)(chan->realsamp.bit16[(pos<<1)+1]))>>8 ];
+#ifdef __SSE2__
+	for (; (i+8)<=n; i+=8)
+	{
+		__m128i a  = _mm_loadu_si128((const __m128i *)(s0+i));
+		__m128i b  = _mm_loadu_si128((const __m128i *)(s1+i));
+		__m128i fr = _mm_loadu_si128((const __m128i *)(f+i));
+		__m128i r;
+
+		r = _mm_sub_epi16(a, _mm_srai_epi16(_mm_mullo_epi16(fr, a), 4));
+		r = _mm_add_epi16(r, _mm_srai_epi16(_mm_mullo_epi16(fr, b), 4));
+		r = _mm_srai_epi16(_mm_slli_epi16(r, 8), 8); /* wrap into 8 bit, like the uint8_t table did */
+		_mm_storeu_si128((__m128i *)(s0+i), r);
+	}
+#endif
+	for (; i<n; i++)
+	{
+		s0[i]=(int8_t)(s0[i] - ((f[i]*s0[i])>>4) + ((f[i]*s1[i])>>4));
+	}
 }
 
-static inline void interp_i8_s(const struct channel *chan, const int volindexLL, const int volindexLR, const int volindexRL, const int volindexRR, const uint32_t pos, uint32_t fpos, int32_t * const outL, int32_t * const outR)
+/* buf[L] += vol00 * l + vol01 * r
+ * buf[R] += vol10 * l + vol11 * r
+ * volumes ramp with the values in ramping[][] for each sample. Mono input is
+ * given with l == r
+ */
+static inline void mixrBlockAccumulate(int32_t *buf, uint32_t n, const int16_t *l, const int16_t *r, int32_t vol00, int32_t vol01, int32_t vol10, int32_t vol11)
 {
-	uint8_t cacheL =
-		mixrFadeChannelintrtab[ fpos>>12 ][ ((uint8_t)(chan->realsamp.bit8[(pos<<1)  ])) ][ 0 ]+
-		mixrFadeChannelintrtab[ fpos>>12 ][ ((uint8_t)(chan->realsamp.bit8[(pos<<1)+2])) ][ 1 ];
-	uint8_t cacheR =
-		mixrFadeChannelintrtab[ fpos>>12 ][ ((uint8_t)(chan->realsamp.bit8[(pos<<1)+1])) ][ 0 ]+
-		mixrFadeChannelintrtab[ fpos>>12 ][ ((uint8_t)(chan->realsamp.bit8[(pos<<1)+3])) ][ 1 ];
-
-	*outL = mixrFadeChannelvoltab[volindexLL][cacheL]
-	      + mixrFadeChannelvoltab[volindexLR][cacheR];
-	*outR = mixrFadeChannelvoltab[volindexRL][cacheL]
-	      + mixrFadeChannelvoltab[volindexRR][cacheR];
-}
+	uint32_t i=0;
 
-static inline void interp_i16_s(const struct channel *chan, const int volindexLL, const int volindexLR, const int volindexRL, const int volindexRR, const uint32_t pos, uint32_t fpos, int32_t * const outL, int32_t * const outR)
-{
-	uint8_t cacheL =
-		mixrFadeChannelintrtab[ fpos>>12 ][ ((uint16_t)(chan->realsamp.bit16[(pos<<1)  ]))>>8 ][ 0 ]+
-		mixrFadeChannelintrtab[ fpos>>12 ][ ((uint16_t)(chan->realsamp.bit16[(pos<<1)+2]))>>8 ][ 1 ];
-	uint8_t cacheR =
-		mixrFadeChannelintrtab[ fpos>>12 ][ ((uint16_t)(chan->realsamp.bit16[(pos<<1)+1]))>>8 ][ 0 ]+
-		mixrFadeChannelintrtab[ fpos>>12 ][ ((uint16_t)(chan->realsamp.bit16[(pos<<1)+3]))>>8 ][ 1 ];
-
-	*outL = mixrFadeChannelvoltab[volindexLL][cacheL]
-	      + mixrFadeChannelvoltab[volindexLR][cacheR];
-	*outR = mixrFadeChannelvoltab[volindexRL][cacheL]
-	      + mixrFadeChannelvoltab[volindexRR][cacheR];
+#ifdef __SSE2__
+	if (n>=4)
+	{
+		/* volumes are in the -256..256 range, so both volume and sample fit in 16 bit, and each pair can be multiplied and summed in one go */
+		__m128i vl    = _mm_setr_epi16(vol00,                   vol01,
+		                               vol00 +   ramping[0][0], vol01 +   ramping[0][1],
+		                               vol00 + 2*ramping[0][0], vol01 + 2*ramping[0][1],
+		                               vol00 + 3*ramping[0][0], vol01 + 3*ramping[0][1]);
+		__m128i vr    = _mm_setr_epi16(vol10,                   vol11,
+		                               vol10 +   ramping[1][0], vol11 +   ramping[1][1],
+		                               vol10 + 2*ramping[1][0], vol11 + 2*ramping[1][1],
+		                               vol10 + 3*ramping[1][0], vol11 + 3*ramping[1][1]);
+		__m128i vladd = _mm_setr_epi16(4*ramping[0][0], 4*ramping[0][1], 4*ramping[0][0], 4*ramping[0][1],
+		                               4*ramping[0][0], 4*ramping[0][1], 4*ramping[0][0], 4*ramping[0][1]);
+		__m128i vradd = _mm_setr_epi16(4*ramping[1][0], 4*ramping[1][1], 4*ramping[1][0], 4*ramping[1][1],
+		                               4*ramping[1][0], 4*ramping[1][1], 4*ramping[1][0], 4*ramping[1][1]);
+
+		for (; (i+4)<=n; i+=4)
+		{
+			__m128i lr = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *)(l+i)),
+			                                _mm_loadl_epi64((const __m128i *)(r+i)));
+			__m128i accl = _mm_madd_epi16(lr, vl);
+			__m128i accr = _mm_madd_epi16(lr, vr);
+			__m128i b0 = _mm_loadu_si128((const __m128i *)(buf+(i<<1)  ));
+			__m128i b1 = _mm_loadu_si128((const __m128i *)(buf+(i<<1)+4));
+
+			_mm_storeu_si128((__m128i *)(buf+(i<<1)  ), _mm_add_epi32(b0, _mm_unpacklo_epi32(accl, accr)));
+			_mm_storeu_si128((__m128i *)(buf+(i<<1)+4), _mm_add_epi32(b1, _mm_unpackhi_epi32(accl, accr)));
+			vl = _mm_add_epi16(vl, vladd);
+			vr = _mm_add_epi16(vr, vradd);
+		}
+		vol00 += i*ramping[0][0];
+		vol01 += i*ramping[0][1];
+		vol10 += i*ramping[1][0];
+		vol11 += i*ramping[1][1];
+	}
+#endif
+	for (; i<n; i++)
+	{
+		buf[(i<<1)  ]+=vol00*l[i] + vol01*r[i];
+		buf[(i<<1)+1]+=vol10*l[i] + vol11*r[i];
+		vol00 += ramping[0][0];
+		vol01 += ramping[0][1];
+		vol10 += ramping[1][0];
+		vol11 += ramping[1][1];
+	}
 }
 
-#define MIX_TEMPLATE_S(NAME, INTERP)                                    \
-static void                                                             \
-NAME(int32_t *buf,                                                      \
-     uint32_t len,                                                      \
-     struct channel *chan)                                              \
-{                                                                       \
-    int32_t vol00    = chan->curvols[0][0];                             \
-    int32_t vol00add = ramping[0][0];                                   \
-    int32_t vol01    = chan->curvols[0][1];                             \
-    int32_t vol01add = ramping[0][1];                                   \
-    int32_t vol10    = chan->curvols[1][0];                             \
-    int32_t vol10add = ramping[1][0];                                   \
-    int32_t vol11    = chan->curvols[1][1];                             \
-    int32_t vol11add = ramping[1][1];                                   \
-    uint32_t pos=chan->pos;                                             \
-    uint32_t fpos=chan->fpos;                                           \
-                                                                        \
-    while (len)                                                         \
-        {                                                               \
-            int32_t l, r;                                               \
-            interp_##INTERP##_s(chan, vol00, vol01, vol10, vol11, pos, fpos, &l, &r); \
-            *(buf++)+=l;                                                \
-            *(buf++)+=r;                                                \
-            fpos+=chan->step&0x0000ffff;                                \
-            if (fpos&0xffff0000)                                        \
-            {                                                           \
-                pos++;                                                  \
-                fpos&=0xffff;                                           \
-            }                                                           \
-            pos+=(chan->step>>16);                                      \
-            vol00 += vol00add;                                          \
-            vol01 += vol01add;                                          \
-            vol10 += vol10add;                                          \
-            vol11 += vol11add;                                          \
-            len--;                                                      \
-        }                                                               \
+#define MIXR_ROUTE(NAME, BIT16, STEREO, INTERPOLATE)                            \
+static void                                                                     \
+NAME(int32_t *buf,                                                              \
+     uint32_t len,                                                              \
+     struct channel *chan)                                                      \
+{                                                                               \
+    int32_t vol00 = chan->curvols[0][0];                                        \
+    int32_t vol01 = chan->curvols[0][1];                                        \
+    int32_t vol10 = chan->curvols[1][0];                                        \
+    int32_t vol11 = chan->curvols[1][1];                                        \
+    uint32_t pos=chan->pos;                                                     \
+    uint32_t fpos=chan->fpos;                                                   \
+    int16_t f[MIXR_BLOCK];                                                      \
+    int16_t l0[MIXR_BLOCK], l1[MIXR_BLOCK], r0[MIXR_BLOCK], r1[MIXR_BLOCK];     \
+                                                                                \
+    while (len)                                                                 \
+    {                                                                           \
+        uint32_t n = (len > MIXR_BLOCK) ? MIXR_BLOCK : len;                     \
+                                                                                \
+        mixrBlockGather (chan, n, &pos, &fpos, BIT16, STEREO, INTERPOLATE, f, l0, l1, r0, r1); \
+        if (INTERPOLATE)                                                        \
+        {                                                                       \
+            mixrBlockInterpolate (n, l0, l1, f);                                \
+            if (STEREO)                                                         \
+            {                                                                   \
+                mixrBlockInterpolate (n, r0, r1, f);                            \
+            }                                                                   \
+        }                                                                       \
+        mixrBlockAccumulate (buf, n, l0, STEREO?r0:l0, vol00, vol01, vol10, vol11); \
+                                                                                \
+        buf   += n<<1;                                                          \
+        len   -= n;                                                             \
+        vol00 += n*ramping[0][0];                                               \
+        vol01 += n*ramping[0][1];                                               \
+        vol10 += n*ramping[1][0];                                               \
+        vol11 += n*ramping[1][1];                                               \
+    }                                                                           \
 }
 
-MIX_TEMPLATE_S(playstereo_s,    none8)
-MIX_TEMPLATE_S(playstereoi_s,   i8)
-MIX_TEMPLATE_S(playstereo16_s,  none16)
-MIX_TEMPLATE_S(playstereoi16_s, i16)
+MIXR_ROUTE(playstereo,      0, 0, 0)
+MIXR_ROUTE(playstereoi,     0, 0, 1)
+MIXR_ROUTE(playstereo16,    1, 0, 0)
+MIXR_ROUTE(playstereoi16,   1, 0, 1)
+MIXR_ROUTE(playstereo_s,    0, 1, 0)
+MIXR_ROUTE(playstereoi_s,   0, 1, 1)
+MIXR_ROUTE(playstereo16_s,  1, 1, 0)
+MIXR_ROUTE(playstereoi16_s, 1, 1, 1)
 
 static void routequiet(int32_t *buf, uint32_t len, struct channel *chan)
 {
@@ -482,40 +519,21 @@ mixrPlayChannelbigloop:
 
 	if (fillen)
 	{
-		uint32_t curvols[2][2];
+		int32_t sl, sr, outl, outr;
 		chan->pos=chan->length;
 		if (chan->status&MIXRQ_PLAYSTEREO)
 		{
-			if (chan->status&MIXRQ_PLAY16BIT)
-			{
-				curvols[0][0]=mixrFadeChannelvoltab[chan->curvols[0][0]][((uint16_t)(chan->realsamp.bit16[(chan->pos<<1)    ]))>>8];
-				curvols[0][1]=mixrFadeChannelvoltab[chan->curvols[0][1]][((uint16_t)(chan->realsamp.bit16[(chan->pos<<1) + 1]))>>8];
-				curvols[1][0]=mixrFadeChannelvoltab[chan->curvols[1][0]][((uint16_t)(chan->realsamp.bit16[(chan->pos<<1)    ]))>>8];
-				curvols[1][1]=mixrFadeChannelvoltab[chan->curvols[1][1]][((uint16_t)(chan->realsamp.bit16[(chan->pos<<1) + 1]))>>8];
-			} else {
-				curvols[0][0]=mixrFadeChannelvoltab[chan->curvols[0][0]][(uint8_t)(chan->realsamp.bit8[(chan->pos<<1)    ])];
-				curvols[0][1]=mixrFadeChannelvoltab[chan->curvols[0][1]][(uint8_t)(chan->realsamp.bit8[(chan->pos<<1) + 1])];
-				curvols[1][0]=mixrFadeChannelvoltab[chan->curvols[1][0]][(uint8_t)(chan->realsamp.bit8[(chan->pos<<1)    ])];
-				curvols[1][1]=mixrFadeChannelvoltab[chan->curvols[1][1]][(uint8_t)(chan->realsamp.bit8[(chan->pos<<1) + 1])];
-			}
+			sl=mixrSample8(chan, (chan->pos<<1)    );
+			sr=mixrSample8(chan, (chan->pos<<1) + 1);
 		} else {
-			if (chan->status&MIXRQ_PLAY16BIT)
-			{
-				curvols[0][0]=mixrFadeChannelvoltab[chan->curvols[0][0]][((uint16_t)(chan->realsamp.bit16[chan->pos]))>>8];
-				curvols[0][1]=mixrFadeChannelvoltab[chan->curvols[0][1]][((uint16_t)(chan->realsamp.bit16[chan->pos]))>>8];
-				curvols[1][0]=mixrFadeChannelvoltab[chan->curvols[1][0]][((uint16_t)(chan->realsamp.bit16[chan->pos]))>>8];
-				curvols[1][1]=mixrFadeChannelvoltab[chan->curvols[1][1]][((uint16_t)(chan->realsamp.bit16[chan->pos]))>>8];
-			} else {
-				curvols[0][0]=mixrFadeChannelvoltab[chan->curvols[0][0]][(uint8_t)(chan->realsamp.bit8[chan->pos])];
-				curvols[0][1]=mixrFadeChannelvoltab[chan->curvols[0][1]][(uint8_t)(chan->realsamp.bit8[chan->pos])];
-				curvols[1][0]=mixrFadeChannelvoltab[chan->curvols[1][0]][(uint8_t)(chan->realsamp.bit8[chan->pos])];
-				curvols[1][1]=mixrFadeChannelvoltab[chan->curvols[1][1]][(uint8_t)(chan->realsamp.bit8[chan->pos])];
-			}
+			sl=sr=mixrSample8(chan, chan->pos);
 		}
+		outl=chan->curvols[0][0]*sl + chan->curvols[0][1]*sr;
+		outr=chan->curvols[1][0]*sl + chan->curvols[1][1]*sr;
 		while (fillen)
 		{
-			*(buf++) += curvols[0][0] + curvols[0][1];
-			*(buf++) += curvols[1][0] + curvols[1][1];
+			*(buf++) += outl;
+			*(buf++) += outr;
 			fillen--;
 		}
 	} else {
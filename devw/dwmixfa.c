@@ -41,9 +41,14 @@
  */
 
 #include "config.h"
+#include <stdlib.h>
+#include <string.h>
 #include "types.h"
+#include "cpiface/cpiface.h"
 #include "dev/mcp.h"
 #include "dev/postproc.h"
+#include "stuff/profile.h"
 #include "dwmixfa.h"
+#include "dwtap.h"
 
 #include "dwmixfa_c.c"
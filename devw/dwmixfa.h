@@ -12,9 +12,9 @@
 #define MIXF_MUTE 512
 
 struct cpifaceSessionAPI_t;
+struct dwtap;
 extern void mixer (struct cpifaceSessionAPI_t *);
 extern void prepare_mixer (void);
-extern void getchanvol (int n, int len, float * const voll, float * const volr);
 
 #define MAXVOICES MIXF_MAXCHAN
 
@@ -51,6 +51,9 @@ typedef struct
 	float   fb2;         /* filter bp buffer, right channel in stereo samples */
 } dwmixfa_channel_t;
 
+/* average output level of a channel over the next len samples, without touching the channel */
+extern void getchanvol (const dwmixfa_channel_t *ch, int len, float * const voll, float * const volr);
+
 
 typedef struct
 {
@@ -73,6 +76,9 @@ typedef struct
 #define MIXF_MAX_POSTPROC 10
 	const struct PostProcFPRegStruct *postproc[MIXF_MAX_POSTPROC];
 	int                               postprocs;
+
+	struct dwtap *tap;         /* optional, gets what each voice played before volume and panning, for the channel scopes */
+	float        *tapbuf;      /* MIXF_MIXBUFLEN stereo frames, needed if tap is set */
 } dwmixfa_state_t;
 
 extern dwmixfa_state_t dwmixfa_state;
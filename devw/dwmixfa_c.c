@@ -42,7 +42,7 @@ static const clippercall clippers[4] = {clip_8s, clip_8u, clip_16s, clip_16u};
 static const clippercall clippers[1] = {clip_16s};
 #endif
 
-typedef void(*mixercall)(float *destptr, dwmixfa_channel_t * const c);
+typedef void(*mixercall)(float *destptr, float *tapptr, dwmixfa_channel_t * const c);
 
 void
 prepare_mixer (void)
@@ -80,6 +80,7 @@ void clearbufs(float *samples, int count)
 
 static void
 mix_0(float *destptr,
+      float *tapptr,
       dwmixfa_channel_t * const c)
 {
 	int i;
@@ -145,6 +146,7 @@ interp_cub(const float* samples, const uint_fast16_t sample_pos_fract)
 #define MIX_TEMPLATE_M(NAME, INTERP, FILTER, PROTECT)                   \
 static void                                                             \
 mix##NAME(float *destptr,                                               \
+       float *tapptr,                                                   \
        dwmixfa_channel_t * const c)                                     \
 {                                                                       \
     int i = 0;                                                          \
@@ -169,6 +171,11 @@ mix##NAME(float *destptr,                                               \
     for (i = 0; i < dwmixfa_state.nsamples; i++)                        \
       {                                                                 \
         sample = filter_##FILTER(interp_##INTERP(c->smpposw, c->smpposf), c); \
+        if (tapptr)                                                     \
+          {                                                             \
+            *tapptr++ = sample;                                         \
+            *tapptr++ = sample;                                         \
+          }                                                             \
         *destptr++       += c->mono_volleft * sample;                   \
         c->mono_volleft  += c->mono_rampleft;                           \
         *destptr++       += c->mono_volright * sample;                  \
@@ -191,9 +198,14 @@ mix##NAME(float *destptr,                                               \
     goto out;                                                           \
                                                                         \
 fade:                                                                   \
-                                                                        \
-    for (; i < dwmixfa_state.nsamples; i++)                             \
+    /* frame i was mixed above, it is not mixed again */                \
+    for (i++; i < dwmixfa_state.nsamples; i++)                          \
       {                                                                 \
+        if (tapptr)                                                     \
+          {                                                             \
+            *tapptr++ = sample;                                         \
+            *tapptr++ = sample;                                         \
+          }                                                             \
         *destptr++       += c->mono_volleft  * sample;                  \
         c->mono_volleft  += c->mono_rampleft;                           \
         *destptr++       += c->mono_volright * sample;                  \
@@ -265,6 +277,7 @@ interp_cub_S(const float* samples, const uint_fast16_t sample_pos_fract, float *
 #define MIX_TEMPLATE_S(NAME, INTERP, FILTER, PROTECT)                   \
 static void                                                             \
 mix##NAME(float *destptr,                                               \
+       float *tapptr,                                                   \
        dwmixfa_channel_t * const c)                                     \
 {                                                                       \
     int i = 0;                                                          \
@@ -291,6 +304,11 @@ mix##NAME(float *destptr,                                               \
         float iL, iR;                                                   \
         interp_##INTERP##_S(c->smpposw, c->smpposf, &iL, &iR);          \
         filter_##FILTER##_S(iL, iR, &sampleL, &sampleR, c);             \
+        if (tapptr)                                                     \
+          {                                                             \
+            *tapptr++ = sampleL;                                        \
+            *tapptr++ = sampleR;                                        \
+          }                                                             \
         *destptr++  += c->stereo_volleft[0]  * sampleL + c->stereo_volleft[1]  * sampleR; \
         *destptr++  += c->stereo_volright[0] * sampleL + c->stereo_volright[1] * sampleR; \
         c->stereo_volleft[0]  += c->stereo_rampleft[0];                 \
@@ -314,9 +332,14 @@ mix##NAME(float *destptr,                                               \
     goto out;                                                           \
                                                                         \
 fade:                                                                   \
-                                                                        \
-    for (; i < dwmixfa_state.nsamples; i++)                             \
+    /* frame i was mixed above, it is not mixed again */                \
+    for (i++; i < dwmixfa_state.nsamples; i++)                          \
       {                                                                 \
+        if (tapptr)                                                     \
+          {                                                             \
+            *tapptr++ = sampleL;                                        \
+            *tapptr++ = sampleR;                                        \
+          }                                                             \
         *destptr++  += c->stereo_volleft[0]  * sampleL + c->stereo_volleft[1]  * sampleR; \
         *destptr++  += c->stereo_volright[0] * sampleR + c->stereo_volright[1] * sampleR; \
         c->stereo_volleft[0]  += c->stereo_rampleft[0];                 \
@@ -367,6 +390,8 @@ mixer (struct cpifaceSessionAPI_t *cpifaceSession)
 {
 	int i;
 	int voice;
+	const struct profileAPI_t *profileAPI = cpifaceSession ? cpifaceSession->profileAPI : 0; /* test-dwmixfa runs without a session */
+	uint64_t start;
 
 	if (fabsf(dwmixfa_state.fadeleft) < minampl)
 		dwmixfa_state.fadeleft = 0.0;
@@ -377,6 +402,8 @@ mixer (struct cpifaceSessionAPI_t *cpifaceSession)
 	if (dwmixfa_state.nsamples == 0)
 		return;
 
+	start = profileAPI ? profileAPI->now () : 0;
+
 	clearbufs(dwmixfa_state.tempbuf, dwmixfa_state.nsamples);
 
 	for (voice = dwmixfa_state.nvoices - 1; voice >= 0; voice--)
@@ -384,10 +411,32 @@ mixer (struct cpifaceSessionAPI_t *cpifaceSession)
 		mixercall mixer;
 
 		if (!(dwmixfa_state.ch[voice].voiceflags & MIXF_PLAYING))
+		{
+			if (dwmixfa_state.tap)
+				dwtap_skip (dwmixfa_state.tap, voice, dwmixfa_state.nsamples);
 			continue;
+		}
 
 		mixer = mixers[dwmixfa_state.ch[voice].voiceflags & (MIXF_INTERPOLATE | MIXF_INTERPOLATEQ | MIXF_FILTER | MIXF_PLAYSTEREO)];
-		mixer(dwmixfa_state.tempbuf, &dwmixfa_state.ch[voice]);
+		if (!dwmixfa_state.tap)
+		{
+			mixer(dwmixfa_state.tempbuf, 0, &dwmixfa_state.ch[voice]);
+		} else if (mixer == mix_0)
+		{
+			mixer(dwmixfa_state.tempbuf, 0, &dwmixfa_state.ch[voice]);
+			dwtap_skip (dwmixfa_state.tap, voice, dwmixfa_state.nsamples);
+		} else {
+			mixer(dwmixfa_state.tempbuf, dwmixfa_state.tapbuf, &dwmixfa_state.ch[voice]);
+			dwtap_write (dwmixfa_state.tap, voice, dwmixfa_state.tapbuf, dwmixfa_state.nsamples);
+		}
+	}
+	if (dwmixfa_state.tap)
+		dwtap_commit (dwmixfa_state.tap, dwmixfa_state.nsamples);
+
+	if (profileAPI)
+	{
+		profileAPI->add (profileStageMix, start);
+		start = profileAPI->now ();
 	}
 
 	for (i=0; i < dwmixfa_state.postprocs; i++)
@@ -395,7 +444,18 @@ mixer (struct cpifaceSessionAPI_t *cpifaceSession)
 		dwmixfa_state.postproc[i]->Process(cpifaceSession, dwmixfa_state.tempbuf, dwmixfa_state.nsamples, dwmixfa_state.samprate);
 	}
 
+	if (profileAPI)
+	{
+		profileAPI->add (profileStagePostProc, start);
+		start = profileAPI->now ();
+	}
+
 	clippers[0](dwmixfa_state.tempbuf, dwmixfa_state.outbuf, 2 /* stereo */ * dwmixfa_state.nsamples);
+
+	if (profileAPI)
+	{
+		profileAPI->add (profileStageClip, start);
+	}
 }
 
 static void
@@ -470,72 +530,70 @@ static void clip_8u(float *input, void *output, uint_fast32_t count)
 #endif
 
 void
-getchanvol(int n, int len, float * const voll, float * const volr)
+getchanvol(const dwmixfa_channel_t *ch, int len, float * const voll, float * const volr)
 {
-	float *sample_pos = dwmixfa_state.ch[n].smpposw;
-	int sample_pos_fract = dwmixfa_state.ch[n].smpposf;
+	float *sample_pos = ch->smpposw;
+	int sample_pos_fract = ch->smpposf;
 	int i;
 
-	if (!(dwmixfa_state.ch[n].voiceflags & MIXF_PLAYING))
+	if ((!(ch->voiceflags & MIXF_PLAYING)) || (len <= 0))
 	{
 		*voll = 0;
 		*volr = 0;
 		return;
 	}
 
-	if (dwmixfa_state.ch[n].voiceflags & MIXF_PLAYSTEREO)
+	if (ch->voiceflags & MIXF_PLAYSTEREO)
 	{
 		float sumL = 0.0;
 		float sumR = 0.0;
 
-		for (i = 0; i < dwmixfa_state.nsamples; i++)
+		for (i = 0; i < len; i++)
 		{
 			sumL += fabsf(sample_pos[0]);
 			sumR += fabsf(sample_pos[1]);
 
-			sample_pos_fract += dwmixfa_state.ch[n].freqf;
-			sample_pos += (dwmixfa_state.ch[n].freqw + (sample_pos_fract >> 16))<<1;
+			sample_pos_fract += ch->freqf;
+			sample_pos += (ch->freqw + (sample_pos_fract >> 16))<<1;
 			sample_pos_fract &= 0xffff;
-			while (sample_pos >= dwmixfa_state.ch[n].loopend)
+			while (sample_pos >= ch->loopend)
 			{
-				if (!(dwmixfa_state.ch[n].voiceflags & MIXF_LOOPED))
+				if (!(ch->voiceflags & MIXF_LOOPED))
 				{
-					dwmixfa_state.ch[n].voiceflags &= ~MIXF_PLAYING;
 					goto outs;
 				}
-				assert(dwmixfa_state.ch[n].looplen > 0);
-				sample_pos -= dwmixfa_state.ch[n].looplen;
+				assert(ch->looplen > 0);
+				sample_pos -= ch->looplen;
 			}
 		}
 outs:
-		sumL /= dwmixfa_state.nsamples;
-		sumR /= dwmixfa_state.nsamples;
-		*voll = sumL * dwmixfa_state.ch[n].stereo_volleft[0]  + sumR * dwmixfa_state.ch[n].stereo_volleft[1];
-		*volr = sumL * dwmixfa_state.ch[n].stereo_volright[0] + sumR * dwmixfa_state.ch[n].stereo_volright[1];
+		sumL /= len;
+		sumR /= len;
+		*voll = sumL * ch->stereo_volleft[0]  + sumR * ch->stereo_volleft[1];
+		*volr = sumL * ch->stereo_volright[0] + sumR * ch->stereo_volright[1];
 	} else {
 		float sum = 0.0;
 
-		for (i = 0; i < dwmixfa_state.nsamples; i++)
+		for (i = 0; i < len; i++)
 		{
 			sum += fabsf(*sample_pos);
 
-			sample_pos_fract += dwmixfa_state.ch[n].freqf;
-			sample_pos += dwmixfa_state.ch[n].freqw + (sample_pos_fract >> 16);
+			sample_pos_fract += ch->freqf;
+			sample_pos += ch->freqw + (sample_pos_fract >> 16);
 			sample_pos_fract &= 0xffff;
-			while (sample_pos >= dwmixfa_state.ch[n].loopend)
+			while (sample_pos >= ch->loopend)
 			{
-				if (!(dwmixfa_state.ch[n].voiceflags & MIXF_LOOPED))
+				if (!(ch->voiceflags & MIXF_LOOPED))
 				{
-					dwmixfa_state.ch[n].voiceflags &= ~MIXF_PLAYING;
 					goto outm;
 				}
-				assert(dwmixfa_state.ch[n].looplen > 0);
-				sample_pos -= dwmixfa_state.ch[n].looplen;
+				assert(ch->looplen > 0);
+				sample_pos -= ch->looplen;
 			}
 		}
 outm:
-		sum /= dwmixfa_state.nsamples;
-		*voll = sum * dwmixfa_state.ch[n].mono_volleft;
-		*volr = sum * dwmixfa_state.ch[n].mono_volright;
+		sum /= len;
+		*voll = sum * ch->mono_volleft;
+		*volr = sum * ch->mono_volright;
 	}
 }
@@ -19,16 +19,30 @@
  * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
 
-static int16_t (*myvoltab)[2][256];
-static int16_t (*myinterpoltabq)[32][256][2];
-static int16_t (*myinterpoltabq2)[16][256][4];
-
-void mixqSetupAddresses(int16_t (*voltab)[2][256], int16_t (*interpoltabq)[32][256][2], int16_t (*interpoltabq2)[16][256][4])
-{
-	myvoltab=voltab;
-	myinterpoltabq=interpoltabq;
-	myinterpoltabq2=interpoltabq2;
-}
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+
+/* The interpolating routes work on blocks of MIXQ_BLOCK samples. For each block
+ * the sample positions are resolved first, then the source samples are
+ * gathered (split into signed upper and unsigned lower 8 bits) and finally
+ * the interpolation is done in straight loops without any table lookups, so the
+ * compiler (or the SSE2 code below) can process several samples in parallel.
+ *
+ * The math is the same as the old interpoltabq[2][32][256][2] and
+ * interpoltabq2[2][16][256][4] tables produced, so the output is bit-exact.
+ * All intermediate values fit in 16 bit, and the final result is truncated into
+ * 16 bit, like the old code did when storing into the output buffer.
+ *
+ * linear, f = fpos >> 11:
+ *   out = (h0 << 8) - ((f * h0) << 3) + ((f * h1) << 3)
+ *       + l0 - ((f * l0) >> 5) + ((f * l1) >> 5)
+ *
+ * quadratic, f = fpos >> 12, a = (16 - f)^2, b = f^2:
+ *   out = ((a * h0) >> 1) + (h1 << 8) - ((a * h1) >> 1) - ((b * h1) >> 1) + ((b * h2) >> 1)
+ *       + ((a * l0) >> 9) + l1 - ((a * l1) >> 9) - ((b * l1) >> 9) + ((b * l2) >> 9)
+ */
+#define MIXQ_BLOCK 64
 
 static void playquiet(int16_t *buf, uint32_t len, struct channel *chan)
 {
@@ -44,44 +58,6 @@ static inline int32_t interp_none16(const struct channel *chan, const uint32_t p
 	return chan->realsamp.bit16[pos];
 }
 
-static inline int32_t interp_i8(const struct channel *chan, const uint32_t pos, uint32_t fpos)
-{
-	uint8_t cache = fpos>>11;
-	return myinterpoltabq[0][cache][(uint8_t)chan->realsamp.bit8[pos  ]][0] +
-	       myinterpoltabq[0][cache][(uint8_t)chan->realsamp.bit8[pos+1]][1];
-}
-
-static inline int32_t interp_i16(const struct channel *chan, const uint32_t pos, uint32_t fpos)
-{
-	uint8_t cache = fpos>>11;
-
-	return myinterpoltabq[0][cache][(uint8_t)(chan->realsamp.bit16[pos  ]>>8)  ][0] +
-	       myinterpoltabq[0][cache][(uint8_t)(chan->realsamp.bit16[pos+1]>>8)  ][1] +
-	       myinterpoltabq[1][cache][(uint8_t)(chan->realsamp.bit16[pos  ]&0xff)][0] +
-	       myinterpoltabq[1][cache][(uint8_t)(chan->realsamp.bit16[pos+1]&0xff)][1] ;
-}
-
-static inline int32_t interp_i28(const struct channel *chan, const uint32_t pos, uint32_t fpos)
-{
-	uint8_t cache = fpos>>12;
-
-	return myinterpoltabq2[0][cache][(uint8_t)(chan->realsamp.bit8[pos  ])][0] +
-	       myinterpoltabq2[0][cache][(uint8_t)(chan->realsamp.bit8[pos+1])][1] +
-	       myinterpoltabq2[0][cache][(uint8_t)(chan->realsamp.bit8[pos+2])][2] ;
-}
-
-static inline int32_t interp_i216(const struct channel *chan, const uint32_t pos, uint32_t fpos)
-{
-	uint8_t cache = fpos>>12;
-
-	return myinterpoltabq2[0][cache][(uint8_t)(chan->realsamp.bit16[pos  ]>>8)  ][0] +
-	       myinterpoltabq2[0][cache][(uint8_t)(chan->realsamp.bit16[pos+1]>>8)  ][1] +
-	       myinterpoltabq2[0][cache][(uint8_t)(chan->realsamp.bit16[pos+2]>>8)  ][2] +
-	       myinterpoltabq2[1][cache][(uint8_t)(chan->realsamp.bit16[pos  ]&0xff)][0] +
-	       myinterpoltabq2[1][cache][(uint8_t)(chan->realsamp.bit16[pos+1]&0xff)][1] +
-	       myinterpoltabq2[1][cache][(uint8_t)(chan->realsamp.bit16[pos+2]&0xff)][2] ;
-}
-
 #define MIX_TEMPLATE_M(NAME, INTERP)                                    \
 static void                                                             \
 NAME(int16_t *buf,                                                      \
@@ -110,10 +86,6 @@ NAME(int16_t *buf,                                                      \
 
 MIX_TEMPLATE_M(playqmono,     none8)
 MIX_TEMPLATE_M(playqmono16,   none16)
-MIX_TEMPLATE_M(playqmonoi,    i8)
-MIX_TEMPLATE_M(playqmonoi16,  i16)
-MIX_TEMPLATE_M(playqmonoi2,   i28)
-MIX_TEMPLATE_M(playqmonoi216, i216)
 
 static inline void interp_none8_s(const struct channel *chan, const uint32_t pos, const uint32_t fpos, int16_t * const outL, int16_t * const outR)
 {
@@ -127,59 +99,6 @@ static inline void interp_none16_s(const struct channel *chan, const uint32_t po
 	*outR = chan->realsamp.bit16[(pos<<1)+1];
 }
 
-static inline void interp_i8_s(const struct channel *chan, const uint32_t pos, const uint32_t fpos, int16_t * const outL, int16_t * const outR)
-{
-	uint8_t cache = fpos>>11;
-	*outL = myinterpoltabq[0][cache][ (uint8_t)chan->realsamp.bit8[(pos<<1)  ] ][ 0 ] +
-	        myinterpoltabq[0][cache][ (uint8_t)chan->realsamp.bit8[(pos<<1)+2] ][ 1 ];
-	*outR = myinterpoltabq[0][cache][ (uint8_t)chan->realsamp.bit8[(pos<<1)+1] ][ 0 ] +
-	        myinterpoltabq[0][cache][ (uint8_t)chan->realsamp.bit8[(pos<<1)+3] ][ 1 ];
-}
-
-static inline void interp_i16_s(const struct channel *chan, const uint32_t pos, const uint32_t fpos, int16_t * const outL, int16_t * const outR)
-{
-	uint8_t cache = fpos>>11;
-
-	*outL = myinterpoltabq[ 0 ][ cache ][ (uint8_t)(chan->realsamp.bit16[(pos<<1)  ]>>8)   ][ 0 ] +
-	        myinterpoltabq[ 0 ][ cache ][ (uint8_t)(chan->realsamp.bit16[(pos<<1)+2]>>8)   ][ 1 ] +
-	        myinterpoltabq[ 1 ][ cache ][ (uint8_t)(chan->realsamp.bit16[(pos<<1)  ]&0xff) ][ 0 ] +
-	        myinterpoltabq[ 1 ][ cache ][ (uint8_t)(chan->realsamp.bit16[(pos<<1)+2]&0xff) ][ 1 ] ;
-	*outR = myinterpoltabq[ 0 ][ cache ][ (uint8_t)(chan->realsamp.bit16[(pos<<1)+1]>>8)   ][ 0 ] +
-	        myinterpoltabq[ 0 ][ cache ][ (uint8_t)(chan->realsamp.bit16[(pos<<1)+3]>>8)   ][ 1 ] +
-	        myinterpoltabq[ 1 ][ cache ][ (uint8_t)(chan->realsamp.bit16[(pos<<1)+1]&0xff) ][ 0 ] +
-	        myinterpoltabq[ 1 ][ cache ][ (uint8_t)(chan->realsamp.bit16[(pos<<1)+3]&0xff) ][ 1 ] ;
-}
-
-static inline void interp_i28_s(const struct channel *chan, const uint32_t pos, const uint32_t fpos, int16_t * const outL, int16_t * const outR)
-{
-	uint8_t cache = fpos>>12;
-
-	*outL = myinterpoltabq2[ 0 ][ cache ][ (uint8_t)(chan->realsamp.bit8[(pos<<1)  ]) ][ 0 ] +
-	        myinterpoltabq2[ 0 ][ cache ][ (uint8_t)(chan->realsamp.bit8[(pos<<1)+2]) ][ 1 ] +
-	        myinterpoltabq2[ 0 ][ cache ][ (uint8_t)(chan->realsamp.bit8[(pos<<1)+4]) ][ 2 ] ;
-	*outR = myinterpoltabq2[ 0 ][ cache ][ (uint8_t)(chan->realsamp.bit8[(pos<<1)+1]) ][ 0 ] +
-	        myinterpoltabq2[ 0 ][ cache ][ (uint8_t)(chan->realsamp.bit8[(pos<<1)+3]) ][ 1 ] +
-	        myinterpoltabq2[ 0 ][ cache ][ (uint8_t)(chan->realsamp.bit8[(pos<<1)+5]) ][ 2 ] ;
-}
-
-static inline void interp_i216_s(const struct channel *chan, const uint32_t pos, const uint32_t fpos, int16_t * const outL, int16_t * const outR)
-{
-	uint8_t cache = fpos>>12;
-
-	*outL = myinterpoltabq2[ 0 ][ cache ][ (uint8_t)(chan->realsamp.bit16[(pos<<1)  ]>>8)   ][ 0 ] +
-	        myinterpoltabq2[ 0 ][ cache ][ (uint8_t)(chan->realsamp.bit16[(pos<<1)+2]>>8)   ][ 1 ] +
-	        myinterpoltabq2[ 0 ][ cache ][ (uint8_t)(chan->realsamp.bit16[(pos<<1)+4]>>8)   ][ 2 ] +
-	        myinterpoltabq2[ 1 ][ cache ][ (uint8_t)(chan->realsamp.bit16[(pos<<1)  ]&0xff) ][ 0 ] +
-	        myinterpoltabq2[ 1 ][ cache ][ (uint8_t)(chan->realsamp.bit16[(pos<<1)+2]&0xff) ][ 1 ] +
-	        myinterpoltabq2[ 1 ][ cache ][ (uint8_t)(chan->realsamp.bit16[(pos<<1)+4]&0xff) ][ 2 ] ;
-	*outR = myinterpoltabq2[ 0 ][ cache ][ (uint8_t)(chan->realsamp.bit16[(pos<<1)+1]>>8)   ][ 0 ] +
-	        myinterpoltabq2[ 0 ][ cache ][ (uint8_t)(chan->realsamp.bit16[(pos<<1)+3]>>8)   ][ 1 ] +
-	        myinterpoltabq2[ 0 ][ cache ][ (uint8_t)(chan->realsamp.bit16[(pos<<1)+5]>>8)   ][ 2 ] +
-	        myinterpoltabq2[ 1 ][ cache ][ (uint8_t)(chan->realsamp.bit16[(pos<<1)+1]&0xff) ][ 0 ] +
-	        myinterpoltabq2[ 1 ][ cache ][ (uint8_t)(chan->realsamp.bit16[(pos<<1)+3]&0xff) ][ 1 ] +
-	        myinterpoltabq2[ 1 ][ cache ][ (uint8_t)(chan->realsamp.bit16[(pos<<1)+5]&0xff) ][ 2 ] ;
-}
-
 #define MIX_TEMPLATE_S(NAME, INTERP)                                    \
 static void                                                             \
 NAME(int16_t *buf,                                                      \
@@ -208,10 +127,199 @@ NAME(int16_t *buf,                                                      \
 
 MIX_TEMPLATE_S(playqstereo,     none8)
 MIX_TEMPLATE_S(playqstereo16,   none16)
-MIX_TEMPLATE_S(playqstereoi,    i8)
-MIX_TEMPLATE_S(playqstereoi16,  i16)
-MIX_TEMPLATE_S(playqstereoi2,   i28)
-MIX_TEMPLATE_S(playqstereoi216, i216)
+
+static inline void mixqBlockFetch(const struct channel *chan, const int bit16, const uint32_t index, int16_t *h, int16_t *l)
+{
+	if (bit16)
+	{
+		int16_t s=chan->realsamp.bit16[index];
+		*h=s>>8;
+		*l=s&0xff;
+	} else {
+		*h=chan->realsamp.bit8[index];
+	}
+}
+
+/* resolve the sample positions of the block, the fraction (fpos >> fshift),
+ * and fetch the taps needed: h[channel][tap] receives the signed upper 8 bits
+ * and l[channel][tap] the unsigned lower 8 bits (16 bit samples only).
+ */
+static inline void mixqBlockGather(const struct channel *chan, uint32_t n, uint32_t *_pos, uint32_t *_fpos, const int fshift, const int bit16, const int stereo, const int taps, int16_t *f, int16_t (*h)[3][MIXQ_BLOCK], int16_t (*l)[3][MIXQ_BLOCK])
+{
+	uint32_t pos=*_pos;
+	uint32_t fpos=*_fpos;
+	uint32_t fadd=chan->step&0xffff;
+	uint32_t posadd=(int16_t)(chan->step>>16);
+	const int channels=stereo?2:1;
+	uint32_t i;
+
+	for (i=0; i<n; i++)
+	{
+		uint32_t index=stereo?(pos<<1):pos;
+
+		f[i]=fpos>>fshift;
+		mixqBlockFetch (chan, bit16, index,                &h[0][0][i], &l[0][0][i]);
+		mixqBlockFetch (chan, bit16, index + channels,     &h[0][1][i], &l[0][1][i]);
+		if (taps > 2)
+		{
+			mixqBlockFetch (chan, bit16, index + channels * 2, &h[0][2][i], &l[0][2][i]);
+		}
+		if (stereo)
+		{
+			mixqBlockFetch (chan, bit16, index + 1,                &h[1][0][i], &l[1][0][i]);
+			mixqBlockFetch (chan, bit16, index + 1 + channels,     &h[1][1][i], &l[1][1][i]);
+			if (taps > 2)
+			{
+				mixqBlockFetch (chan, bit16, index + 1 + channels * 2, &h[1][2][i], &l[1][2][i]);
+			}
+		}
+		fpos+=fadd;
+		if (fpos&0xffff0000)
+		{
+			pos++;
+			fpos&=0xffff;
+		}
+		pos+=posadd;
+	}
+	*_pos=pos;
+	*_fpos=fpos;
+}
+
+/* linear interpolation, l0 and l1 are NULL for 8 bit samples */
+static inline void mixqBlockInterpolate(uint32_t n, int16_t *out, const int16_t *f, const int16_t *h0, const int16_t *h1, const int16_t *l0, const int16_t *l1)
+{
+	uint32_t i=0;
+
+#ifdef __SSE2__
+	for (; (i+8)<=n; i+=8)
+	{
+		__m128i fr = _mm_loadu_si128((const __m128i *)(f+i));
+		__m128i a  = _mm_loadu_si128((const __m128i *)(h0+i));
+		__m128i b  = _mm_loadu_si128((const __m128i *)(h1+i));
+		__m128i r;
+
+		r = _mm_slli_epi16(a, 8);
+		r = _mm_sub_epi16(r, _mm_slli_epi16(_mm_mullo_epi16(fr, a), 3));
+		r = _mm_add_epi16(r, _mm_slli_epi16(_mm_mullo_epi16(fr, b), 3));
+		if (l0)
+		{
+			a = _mm_loadu_si128((const __m128i *)(l0+i));
+			b = _mm_loadu_si128((const __m128i *)(l1+i));
+			r = _mm_add_epi16(r, a);
+			r = _mm_sub_epi16(r, _mm_srli_epi16(_mm_mullo_epi16(fr, a), 5));
+			r = _mm_add_epi16(r, _mm_srli_epi16(_mm_mullo_epi16(fr, b), 5));
+		}
+		_mm_storeu_si128((__m128i *)(out+i), r);
+	}
+#endif
+	for (; i<n; i++)
+	{
+		int32_t r = h0[i]*256 - f[i]*h0[i]*8 + f[i]*h1[i]*8;
+		if (l0)
+		{
+			r += l0[i] - ((f[i]*l0[i])>>5) + ((f[i]*l1[i])>>5);
+		}
+		out[i] = r;
+	}
+}
+
+/* quadratic interpolation, l0, l1 and l2 are NULL for 8 bit samples */
+static inline void mixqBlockInterpolateMax(uint32_t n, int16_t *out, const int16_t *f, const int16_t *h0, const int16_t *h1, const int16_t *h2, const int16_t *l0, const int16_t *l1, const int16_t *l2)
+{
+	uint32_t i=0;
+
+#ifdef __SSE2__
+	const __m128i sixteen = _mm_set1_epi16(16);
+	for (; (i+8)<=n; i+=8)
+	{
+		__m128i fr = _mm_loadu_si128((const __m128i *)(f+i));
+		__m128i fa = _mm_sub_epi16(sixteen, fr);
+		__m128i wa = _mm_mullo_epi16(fa, fa);
+		__m128i wb = _mm_mullo_epi16(fr, fr);
+		__m128i s0 = _mm_loadu_si128((const __m128i *)(h0+i));
+		__m128i s1 = _mm_loadu_si128((const __m128i *)(h1+i));
+		__m128i s2 = _mm_loadu_si128((const __m128i *)(h2+i));
+		__m128i r;
+
+		r = _mm_srai_epi16(_mm_mullo_epi16(wa, s0), 1);
+		r = _mm_add_epi16(r, _mm_slli_epi16(s1, 8));
+		r = _mm_sub_epi16(r, _mm_srai_epi16(_mm_mullo_epi16(wa, s1), 1));
+		r = _mm_sub_epi16(r, _mm_srai_epi16(_mm_mullo_epi16(wb, s1), 1));
+		r = _mm_add_epi16(r, _mm_srai_epi16(_mm_mullo_epi16(wb, s2), 1));
+		if (l0)
+		{ /* products are up to 256*255, which still fits unsigned 16 bit */
+			s0 = _mm_loadu_si128((const __m128i *)(l0+i));
+			s1 = _mm_loadu_si128((const __m128i *)(l1+i));
+			s2 = _mm_loadu_si128((const __m128i *)(l2+i));
+			r = _mm_add_epi16(r, _mm_srli_epi16(_mm_mullo_epi16(wa, s0), 9));
+			r = _mm_add_epi16(r, s1);
+			r = _mm_sub_epi16(r, _mm_srli_epi16(_mm_mullo_epi16(wa, s1), 9));
+			r = _mm_sub_epi16(r, _mm_srli_epi16(_mm_mullo_epi16(wb, s1), 9));
+			r = _mm_add_epi16(r, _mm_srli_epi16(_mm_mullo_epi16(wb, s2), 9));
+		}
+		_mm_storeu_si128((__m128i *)(out+i), r);
+	}
+#endif
+	for (; i<n; i++)
+	{
+		int32_t wa = (16-f[i])*(16-f[i]);
+		int32_t wb = f[i]*f[i];
+		int32_t r = ((wa*h0[i])>>1) + h1[i]*256 - ((wa*h1[i])>>1) - ((wb*h1[i])>>1) + ((wb*h2[i])>>1);
+		if (l0)
+		{
+			r += ((wa*l0[i])>>9) + l1[i] - ((wa*l1[i])>>9) - ((wb*l1[i])>>9) + ((wb*l2[i])>>9);
+		}
+		out[i] = r;
+	}
+}
+
+#define MIXQ_ROUTE(NAME, STEREO, BIT16, MAX)                                    \
+static void                                                                     \
+NAME(int16_t *buf,                                                              \
+     uint32_t len,                                                              \
+     struct channel *chan)                                                      \
+{                                                                               \
+    uint32_t pos=chan->pos;                                                     \
+    uint32_t fpos=chan->fpos;                                                   \
+    int16_t f[MIXQ_BLOCK];                                                      \
+    int16_t h[2][3][MIXQ_BLOCK];                                                \
+    int16_t l[2][3][MIXQ_BLOCK];                                                \
+    int16_t out[2][MIXQ_BLOCK];                                                 \
+                                                                                \
+    while (len)                                                                 \
+    {                                                                           \
+        uint32_t n = (len > MIXQ_BLOCK) ? MIXQ_BLOCK : len;                     \
+        uint32_t i;                                                             \
+        int c;                                                                  \
+                                                                                \
+        mixqBlockGather (chan, n, &pos, &fpos, MAX?12:11, BIT16, STEREO, MAX?3:2, f, h, l); \
+        for (c=0; c<(STEREO?2:1); c++)                                          \
+        {                                                                       \
+            if (MAX)                                                            \
+            {                                                                   \
+                mixqBlockInterpolateMax (n, out[c], f, h[c][0], h[c][1], h[c][2], BIT16?l[c][0]:0, BIT16?l[c][1]:0, BIT16?l[c][2]:0); \
+            } else {                                                            \
+                mixqBlockInterpolate (n, out[c], f, h[c][0], h[c][1], BIT16?l[c][0]:0, BIT16?l[c][1]:0); \
+            }                                                                   \
+        }                                                                       \
+        for (i=0; i<n; i++)                                                     \
+        {                                                                       \
+            buf[(i<<1)  ] = out[0][i];                                          \
+            buf[(i<<1)+1] = out[STEREO?1:0][i];                                 \
+        }                                                                       \
+        buf += n<<1;                                                            \
+        len -= n;                                                               \
+    }                                                                           \
+}
+
+MIXQ_ROUTE(playqmonoi,      0, 0, 0)
+MIXQ_ROUTE(playqmonoi16,    0, 1, 0)
+MIXQ_ROUTE(playqmonoi2,     0, 0, 1)
+MIXQ_ROUTE(playqmonoi216,   0, 1, 1)
+MIXQ_ROUTE(playqstereoi,    1, 0, 0)
+MIXQ_ROUTE(playqstereoi16,  1, 1, 0)
+MIXQ_ROUTE(playqstereoi2,   1, 0, 1)
+MIXQ_ROUTE(playqstereoi216, 1, 1, 1)
 
 void mixqPlayChannel(int16_t *buf, uint32_t len, struct channel *chan, int quiet)
 {
@@ -421,11 +529,22 @@ mixqPlayChannel_bigloop:
 	}
 }
 
+/* same as the old voltabsq[513][2][256] table, the upper part was stored in 16 bit and 0x8000 clamped to 0x7fff */
+static inline int32_t mixqAmplify(const int16_t s, const int32_t vol)
+{
+	int32_t hi = vol*(s>>8);
+	if (hi == 0x8000)
+	{
+		hi = 0x7fff;
+	}
+	return hi + ((vol*(s&0xff))>>8);
+}
+
 void mixqAmplifyChannel(int32_t *buf, const int16_t *src, uint32_t len, const int32_t vol)
 {
 	while (len)
 	{
-		(*buf) += myvoltab[vol][0][(uint8_t)((*src)>>8)] + myvoltab[vol][1][(uint8_t)((*src)&0xff)];
+		(*buf) += mixqAmplify(*src, vol);
 		src+=2;
 		len--;
 		buf+=2;
@@ -436,7 +555,7 @@ void mixqAmplifyChannelUp(int32_t *buf, const int16_t *src, uint32_t len, int32_
 {
 	while (len)
 	{
-		(*buf) += myvoltab[vol][0][(uint8_t)((*src)>>8)] + myvoltab[vol][1][(uint8_t)((*src)&0xff)];
+		(*buf) += mixqAmplify(*src, vol);
 		src+=2;
 		vol++;
 		len--;
@@ -448,7 +567,7 @@ void mixqAmplifyChannelDown(int32_t *buf, const int16_t *src, uint32_t len, int3
 {
 	while (len)
 	{
-		(*buf) += myvoltab[vol][0][(uint8_t)((*src)>>8)] + myvoltab[vol][1][(uint8_t)((*src)&0xff)];
+		(*buf) += mixqAmplify(*src, vol);
 		src+=2;
 		vol--;
 		len--;
@@ -0,0 +1,123 @@
+#ifndef _DEVW_DWTAP_H
+#define _DEVW_DWTAP_H 1
+
+/* Per-channel taps of the mixer output, so channel scopes do not have to
+ * resample the channels a second time.
+ *
+ * For each mix block the mixer stores the resampled stereo frames of every
+ * channel (before volume and panning are applied) in a ring per channel, and
+ * then advances head. A frame is two int16_t for devwMixQ, and two float for
+ * devwMixF. Channels that did not render anything in a block are
+ * marked, so their old data is never handed out. Readers copy the latest frames
+ * ending at head and check afterwards that the mixer did not overwrite them
+ * while they were copying.
+ *
+ * Neither side ever blocks, the same as dwcmdq.h.
+ */
+
+#define DWTAP_SIZE 8192     /* frames per channel, must be power of two */
+#define DWTAP_MAXBLOCK 4096 /* the mixer never writes more frames than this in one block */
+
+struct dwtap
+{
+	uint8_t *buf;      /* channels * DWTAP_SIZE stereo frames */
+	uint32_t *valid;   /* per channel, the first frame that holds rendered data */
+	unsigned int channels;
+	unsigned int framesize; /* in bytes */
+	uint32_t head;     /* frames written so far, only written by the mixer */
+};
+
+/* returns zero if out of memory */
+static inline int dwtap_init (struct dwtap *tap, unsigned int channels, unsigned int framesize)
+{
+	tap->buf = malloc (framesize * DWTAP_SIZE * channels);
+	tap->valid = calloc (sizeof (uint32_t), channels);
+	tap->channels = channels;
+	tap->framesize = framesize;
+	tap->head = 0;
+	if (!tap->buf || !tap->valid)
+	{
+		free (tap->buf);   tap->buf = 0;
+		free (tap->valid); tap->valid = 0;
+		return 0;
+	}
+	return 1;
+}
+
+static inline void dwtap_done (struct dwtap *tap)
+{
+	free (tap->buf);   tap->buf = 0;
+	free (tap->valid); tap->valid = 0;
+	tap->channels = 0;
+}
+
+/* store the len stereo frames rendered for channel ch in the current block */
+static inline void dwtap_write (struct dwtap *tap, unsigned int ch, const void *buf, uint32_t len)
+{
+	const unsigned int fs = tap->framesize;
+	uint8_t *ring = tap->buf + ch * DWTAP_SIZE * fs;
+	uint32_t pos = tap->head & (DWTAP_SIZE - 1);
+	uint32_t l = DWTAP_SIZE - pos;
+
+	if (l > len)
+	{
+		l = len;
+	}
+	memcpy (ring + pos * fs, buf, l * fs);
+	memcpy (ring, (const uint8_t *)buf + l * fs, (len - l) * fs);
+
+	/* keep valid close to head, so the wrap-around of head does not matter */
+	if ((tap->head - tap->valid[ch]) > DWTAP_SIZE)
+	{
+		__atomic_store_n (&tap->valid[ch], tap->head - DWTAP_SIZE, __ATOMIC_RELAXED);
+	}
+}
+
+/* channel ch did not render anything in the current block of len frames */
+static inline void dwtap_skip (struct dwtap *tap, unsigned int ch, uint32_t len)
+{
+	__atomic_store_n (&tap->valid[ch], tap->head + len, __ATOMIC_RELAXED);
+}
+
+/* all channels have been written or skipped for the current block */
+static inline void dwtap_commit (struct dwtap *tap, uint32_t len)
+{
+	__atomic_store_n (&tap->head, tap->head + len, __ATOMIC_RELEASE);
+}
+
+/* copies the last len stereo frames of channel ch, returns zero if they are not available */
+static inline int dwtap_read (struct dwtap *tap, unsigned int ch, void *buf, uint32_t len)
+{
+	const unsigned int fs = tap->framesize;
+	const uint8_t *ring;
+	uint32_t head, start, pos, l;
+
+	if ((ch >= tap->channels) || (len > (DWTAP_SIZE - DWTAP_MAXBLOCK)))
+	{
+		return 0;
+	}
+	ring = tap->buf + ch * DWTAP_SIZE * fs;
+
+	head = __atomic_load_n (&tap->head, __ATOMIC_ACQUIRE);
+	start = head - len;
+	if ((int32_t)(start - __atomic_load_n (&tap->valid[ch], __ATOMIC_RELAXED)) < 0)
+	{
+		return 0;
+	}
+
+	pos = start & (DWTAP_SIZE - 1);
+	l = DWTAP_SIZE - pos;
+	if (l > len)
+	{
+		l = len;
+	}
+	memcpy (buf, ring + pos * fs, l * fs);
+	memcpy ((uint8_t *)buf + l * fs, ring, (len - l) * fs);
+
+	/* the block the mixer might be writing now must not overlap what we copied */
+	__atomic_thread_fence (__ATOMIC_ACQUIRE);
+	head = __atomic_load_n (&tap->head, __ATOMIC_RELAXED);
+	return (head - start) <= (DWTAP_SIZE - DWTAP_MAXBLOCK);
+}
+
+#endif
@@ -255,29 +255,27 @@ static int test_mixrFadeChannel(void)
 
 	int retval = 0;
 
-	mixrSetupAddresses(&voltabsr[256], interpoltabr);
-	calcinterpoltabr();
-	calcvoltabsr();
+	memset(&dummy, 0, sizeof(dummy));
 
 	fprintf(stderr, "mixrFadeChannel 8 bit 0,0\n");
 
 	fade[0]=0;
 	fade[1]=0;
-	dummy.curvols[0] = 0;
-	dummy.curvols[1] = 0;
+	dummy.curvols[0][0] = 0;
+	dummy.curvols[1][1] = 0;
 	dummy.samp=samples8;
 	dummy.realsamp.bit8=samples8;
 	dummy.pos=1;
 	dummy.status = MIXRQ_PLAYING;
 	mixrFadeChannel(fade, &dummy);
-	if (dummy.curvols[0])
+	if (dummy.curvols[0][0])
 	{
-		fprintf(stderr, "c->curvols[0]!=0 (%d)\n", dummy.curvols[0]);
+		fprintf(stderr, "c->curvols[0][0]!=0 (%d)\n", dummy.curvols[0][0]);
 		retval|=1;
 	}
-	if (dummy.curvols[1])
+	if (dummy.curvols[1][1])
 	{
-		fprintf(stderr, "c->curvols[1]!=0 (%d)\n", dummy.curvols[1]);
+		fprintf(stderr, "c->curvols[1][1]!=0 (%d)\n", dummy.curvols[1][1]);
 		retval|=1;
 	}
 	if (dummy.pos!=1)
@@ -304,21 +302,21 @@ static int test_mixrFadeChannel(void)
 
 	fade[0]=1;
 	fade[1]=1;
-	dummy.curvols[0] = 126;
-	dummy.curvols[1] = 90;
+	dummy.curvols[0][0] = 126;
+	dummy.curvols[1][1] = 90;
 	dummy.samp=samples8;
 	dummy.realsamp.bit8=samples8;
 	dummy.pos=1;
 	dummy.status = MIXRQ_PLAYING;
 	mixrFadeChannel(fade, &dummy);
-	if (dummy.curvols[0])
+	if (dummy.curvols[0][0])
 	{
-		fprintf(stderr, "c->curvols[0]!=0 (%d)\n", dummy.curvols[0]);
+		fprintf(stderr, "c->curvols[0][0]!=0 (%d)\n", dummy.curvols[0][0]);
 		retval|=1;
 	}
-	if (dummy.curvols[1])
+	if (dummy.curvols[1][1])
 	{
-		fprintf(stderr, "c->curvols[1]!=0 (%d)\n", dummy.curvols[1]);
+		fprintf(stderr, "c->curvols[1][1]!=0 (%d)\n", dummy.curvols[1][1]);
 		retval|=1;
 	}
 	if (dummy.pos!=1)
@@ -346,21 +344,21 @@ static int test_mixrFadeChannel(void)
 
 	fade[0]=1;
 	fade[1]=1;
-	dummy.curvols[0] = -54;
-	dummy.curvols[1] = 45;
+	dummy.curvols[0][0] = -54;
+	dummy.curvols[1][1] = 45;
 	dummy.samp=samples8;
 	dummy.realsamp.bit8=samples8;
 	dummy.pos=1;
 	dummy.status = MIXRQ_PLAYING;
 	mixrFadeChannel(fade, &dummy);
-	if (dummy.curvols[0])
+	if (dummy.curvols[0][0])
 	{
-		fprintf(stderr, "c->curvols[0]!=0 (%d)\n", dummy.curvols[0]);
+		fprintf(stderr, "c->curvols[0][0]!=0 (%d)\n", dummy.curvols[0][0]);
 		retval|=1;
 	}
-	if (dummy.curvols[1])
+	if (dummy.curvols[1][1])
 	{
-		fprintf(stderr, "c->curvols[1]!=0 (%d)\n", dummy.curvols[1]);
+		fprintf(stderr, "c->curvols[1][1]!=0 (%d)\n", dummy.curvols[1][1]);
 		retval|=1;
 	}
 	if (dummy.pos!=1)
@@ -388,21 +386,21 @@ static int test_mixrFadeChannel(void)
 
 	fade[0]=0;
 	fade[1]=0;
-	dummy.curvols[0] = 0;
-	dummy.curvols[1] = 0;
+	dummy.curvols[0][0] = 0;
+	dummy.curvols[1][1] = 0;
 	dummy.samp=(void*)((unsigned long)samples16>>1);
 	dummy.realsamp.bit16=samples16;
 	dummy.pos=1;
 	dummy.status = MIXRQ_PLAYING | MIXRQ_PLAY16BIT;
 	mixrFadeChannel(fade, &dummy);
-	if (dummy.curvols[0])
+	if (dummy.curvols[0][0])
 	{
-		fprintf(stderr, "c->curvols[0]!=0 (%d)\n", dummy.curvols[0]);
+		fprintf(stderr, "c->curvols[0][0]!=0 (%d)\n", dummy.curvols[0][0]);
 		retval|=1;
 	}
-	if (dummy.curvols[1])
+	if (dummy.curvols[1][1])
 	{
-		fprintf(stderr, "c->curvols[1]!=0 (%d)\n", dummy.curvols[1]);
+		fprintf(stderr, "c->curvols[1][1]!=0 (%d)\n", dummy.curvols[1][1]);
 		retval|=1;
 	}
 	if (dummy.pos!=1)
@@ -429,21 +427,21 @@ static int test_mixrFadeChannel(void)
 
 	fade[0]=1;
 	fade[1]=1;
-	dummy.curvols[0] = 126;
-	dummy.curvols[1] = 90;
+	dummy.curvols[0][0] = 126;
+	dummy.curvols[1][1] = 90;
 	dummy.samp=(void*)((unsigned long)samples16>>1);
 	dummy.realsamp.bit16=samples16;
 	dummy.pos=1;
 	dummy.status = MIXRQ_PLAYING|MIXRQ_PLAY16BIT;
 	mixrFadeChannel(fade, &dummy);
-	if (dummy.curvols[0])
+	if (dummy.curvols[0][0])
 	{
-		fprintf(stderr, "c->curvols[0]!=0 (%d)\n", dummy.curvols[0]);
+		fprintf(stderr, "c->curvols[0][0]!=0 (%d)\n", dummy.curvols[0][0]);
 		retval|=1;
 	}
-	if (dummy.curvols[1])
+	if (dummy.curvols[1][1])
 	{
-		fprintf(stderr, "c->curvols[1]!=0 (%d)\n", dummy.curvols[1]);
+		fprintf(stderr, "c->curvols[1][1]!=0 (%d)\n", dummy.curvols[1][1]);
 		retval|=1;
 	}
 	if (dummy.pos!=1)
@@ -471,21 +469,21 @@ static int test_mixrFadeChannel(void)
 
 	fade[0]=1;
 	fade[1]=1;
-	dummy.curvols[0] = -54;
-	dummy.curvols[1] = 45;
+	dummy.curvols[0][0] = -54;
+	dummy.curvols[1][1] = 45;
 	dummy.samp=(void*)((unsigned long)samples16>>1);
 	dummy.realsamp.bit16=samples16;
 	dummy.pos=1;
 	dummy.status = MIXRQ_PLAYING|MIXRQ_PLAY16BIT;
 	mixrFadeChannel(fade, &dummy);
-	if (dummy.curvols[0])
+	if (dummy.curvols[0][0])
 	{
-		fprintf(stderr, "c->curvols[0]!=0 (%d)\n", dummy.curvols[0]);
+		fprintf(stderr, "c->curvols[0][0]!=0 (%d)\n", dummy.curvols[0][0]);
 		retval|=1;
 	}
-	if (dummy.curvols[1])
+	if (dummy.curvols[1][1])
 	{
-		fprintf(stderr, "c->curvols[1]!=0 (%d)\n", dummy.curvols[1]);
+		fprintf(stderr, "c->curvols[1][1]!=0 (%d)\n", dummy.curvols[1][1]);
 		retval|=1;
 	}
 	if (dummy.pos!=1)
@@ -641,10 +639,10 @@ static void test_mixrPlayChannel_fill(int bit16, struct channel *c, int status)
 	c->loopend=9;
 	c->replen=7;
 	memset(test_mixrPlayChannel_buf, 1, sizeof(test_mixrPlayChannel_buf));
-	c->curvols[0]=63;
-	c->curvols[1]=63;
-	c->dstvols[0]=55;
-	c->dstvols[1]=55;
+	c->curvols[0][0]=63;
+	c->curvols[1][1]=63;
+	c->dstvols[0][0]=55;
+	c->dstvols[1][1]=55;
 }
 
 static int test_mixrPlayChannel_dump(struct channel *ch, const int32_t *target, int32_t fadebuf0, int32_t fadebuf1, int status, uint32_t pos, uint32_t fpos, int curvols0, int curvols1)
@@ -685,14 +683,14 @@ static int test_mixrPlayChannel_dump(struct channel *ch, const int32_t *target,
 		fprintf(stderr, "ch->pos=0x%08x.%04x (expected 0x%08x.%04x)\n", ch->pos, ch->fpos, pos, fpos);
 		retval |= 1;
 	}
-	if (ch->curvols[0]!=curvols0)
+	if (ch->curvols[0][0]!=curvols0)
 	{
-		fprintf(stderr, "ch->curvols[0]=0x%02x (expected 0x%02x)\n", ch->curvols[0], curvols0);
+		fprintf(stderr, "ch->curvols[0][0]=0x%02x (expected 0x%02x)\n", ch->curvols[0][0], curvols0);
 		retval |= 1;
 	}
-	if (ch->curvols[1]!=curvols1)
+	if (ch->curvols[1][1]!=curvols1)
 	{
-		fprintf(stderr, "ch->curvols[1]=0x%02x (expected 0x%02x)\n", ch->curvols[1], curvols1);
+		fprintf(stderr, "ch->curvols[1][1]=0x%02x (expected 0x%02x)\n", ch->curvols[1][1], curvols1);
 		retval |= 1;
 	}
 	return retval;
@@ -766,6 +764,173 @@ static int test_mixrPlayChannel(void)
 	return retval;
 }
 
+/* The mixer no longer uses voltabsr and interpoltabr, verify that the output is
+ * still bit-exact with what the tables produced, for all routes, with and
+ * without volume ramping, forward and backward, over several block sizes.
+ */
+static uint32_t test_random_state = 0x12345678;
+
+static uint32_t test_random(void)
+{
+	test_random_state = test_random_state * 1103515245 + 12345;
+	return test_random_state >> 8;
+}
+
+#define TEST_REFERENCE_SAMPLES 4096
+
+static uint8_t test_reference_index(const struct channel *c, uint32_t index)
+{
+	if (c->status & MIXRQ_PLAY16BIT)
+	{
+		return ((uint16_t)c->realsamp.bit16[index])>>8;
+	}
+	return (uint8_t)c->realsamp.bit8[index];
+}
+
+static uint8_t test_reference_interpolate(const struct channel *c, uint32_t index, int stride, uint32_t fpos)
+{
+	if (!(c->status & MIXRQ_INTERPOLATE))
+	{
+		return test_reference_index (c, index);
+	}
+	return interpoltabr[fpos>>12][test_reference_index (c, index)][0] +
+	       interpoltabr[fpos>>12][test_reference_index (c, index + stride)][1];
+}
+
+static void test_reference_mix(int32_t *buf, uint32_t len, struct channel *c)
+{
+	int32_t (*voltab)[256] = &voltabsr[256];
+	uint32_t pos = c->pos;
+	uint32_t fpos = c->fpos;
+	int i, j;
+
+	while (len--)
+	{
+		uint8_t l, r;
+		if (c->status & MIXRQ_PLAYSTEREO)
+		{
+			l = test_reference_interpolate (c, (pos<<1),     2, fpos);
+			r = test_reference_interpolate (c, (pos<<1) + 1, 2, fpos);
+		} else {
+			l = r = test_reference_interpolate (c, pos, 1, fpos);
+		}
+		*(buf++) += voltab[c->curvols[0][0]][l] + voltab[c->curvols[0][1]][r];
+		*(buf++) += voltab[c->curvols[1][0]][l] + voltab[c->curvols[1][1]][r];
+
+		for (i=0; i < 2; i++)
+		{
+			for (j=0; j < 2; j++)
+			{
+				if (c->curvols[i][j] < c->dstvols[i][j])
+				{
+					c->curvols[i][j]++;
+				} else if (c->curvols[i][j] > c->dstvols[i][j])
+				{
+					c->curvols[i][j]--;
+				}
+			}
+		}
+
+		fpos += c->step & 0xffff;
+		if (fpos & 0xffff0000)
+		{
+			pos++;
+			fpos &= 0xffff;
+		}
+		pos += c->step >> 16;
+	}
+	c->pos = pos;
+	c->fpos = fpos;
+}
+
+static int test_mixrPlayChannel_reference(void)
+{
+	int8_t *samples;
+	struct channel ch, ref;
+	int32_t buf[2*300], refbuf[2*300];
+	int32_t fade[2];
+	int retval = 0;
+	int route, iteration, i, j;
+
+	fprintf(stderr, "mixrPlayChannel, table-free routes against voltabsr/interpoltabr reference\n");
+
+	samples = malloc (TEST_REFERENCE_SAMPLES * 2 /* stereo */ * sizeof (int16_t));
+	for (i=0; i < TEST_REFERENCE_SAMPLES * 2 * sizeof (int16_t); i++)
+	{
+		samples[i] = test_random();
+	}
+	/* include the extremes */
+	samples[0] = samples[2] = -128;
+	samples[1] = samples[3] = 127;
+
+	for (route=0; route < 8; route++)
+	{
+		for (iteration=0; iteration < 64; iteration++)
+		{
+			uint32_t len = 1 + test_random() % 300;
+
+			memset (&ch, 0, sizeof (ch));
+			ch.samp = samples;
+			ch.realsamp.bit8 = samples;
+			ch.status = MIXRQ_PLAYING |
+			            ((route & 1) ? MIXRQ_PLAY16BIT : 0) |
+			            ((route & 2) ? MIXRQ_INTERPOLATE : 0) |
+			            ((route & 4) ? MIXRQ_PLAYSTEREO : 0);
+			ch.length = TEST_REFERENCE_SAMPLES - 16;
+			ch.step = (int32_t)(test_random() % 0x40000) - 0x20000; /* -2.0 to +2.0 */
+			ch.pos = (iteration == 0) ? 0 : (TEST_REFERENCE_SAMPLES / 2 - 600 + test_random() % 1200);
+			ch.fpos = test_random();
+			if (iteration == 0)
+			{
+				ch.step = 0x10000;
+			}
+			for (i=0; i < 2; i++)
+			{
+				for (j=0; j < 2; j++)
+				{
+					ch.curvols[i][j] = (int32_t)(test_random() % 513) - 256;
+					ch.dstvols[i][j] = (iteration & 1) ? ((int32_t)(test_random() % 513) - 256) : ch.curvols[i][j];
+				}
+			}
+			if (iteration == 1)
+			{
+				ch.curvols[0][0] = ch.curvols[0][1] = ch.curvols[1][0] = ch.curvols[1][1] = -256;
+			}
+			ref = ch;
+
+			for (i=0; i < 2*300; i++)
+			{
+				buf[i] = refbuf[i] = test_random();
+			}
+			fade[0] = fade[1] = 0;
+
+			mixrPlayChannel (buf, fade, len, &ch);
+			test_reference_mix (refbuf, len, &ref);
+
+			if (memcmp (buf, refbuf, sizeof (buf)) ||
+			    (ch.pos != ref.pos) ||
+			    (ch.fpos != ref.fpos) ||
+			    memcmp (ch.curvols, ref.curvols, sizeof (ch.curvols)))
+			{
+				fprintf(stderr, "route %d, iteration %d, len %u, step 0x%08x: output differs from reference\n", route, iteration, len, (unsigned int)ref.step);
+				for (i=0; i < 2*len; i++)
+				{
+					if (buf[i] != refbuf[i])
+					{
+						fprintf(stderr, " buf[%d]=%d (expected %d)\n", i, buf[i], refbuf[i]);
+						break;
+					}
+				}
+				retval |= 1;
+			}
+		}
+	}
+
+	free (samples);
+
+	return retval;
+}
+
 int main(int argc, char *argv[])
 {
 	int retval=0;
@@ -779,6 +944,10 @@ int main(int argc, char *argv[])
 
 	interpoltabr=malloc(sizeof(uint8_t)*16*256*2);
 
+	calcvoltabsr();
+
+	calcinterpoltabr();
+
 	retval |= test_mixrClip();
 
 	retval |= test_mixrFadeChannel();
@@ -787,7 +956,11 @@ int main(int argc, char *argv[])
 
 	retval |= test_mixrPlayChannel();
 
+	retval |= test_mixrPlayChannel_reference();
+
 	free(amptab);
+	free(voltabsr);
+	free(interpoltabr);
 
 	return retval;
 }
@@ -22,6 +22,7 @@
 #include <sys/mman.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include "types.h"
 #include "dev/mix.h"
@@ -76,10 +77,232 @@ static void calcinterpoltabq(void)
 		}
 }
 
+/* The mixer no longer uses voltabsq, interpoltabq and interpoltabq2, verify that
+ * the output is still bit-exact with what the tables produced, for all routes,
+ * forward and backward, over several block sizes.
+ */
+static uint32_t test_random_state = 0x12345678;
+
+static uint32_t test_random(void)
+{
+	test_random_state = test_random_state * 1103515245 + 12345;
+	return test_random_state >> 8;
+}
+
+#define TEST_REFERENCE_SAMPLES 4096
+
+static int16_t test_reference_interpolate(const struct channel *c, uint32_t index, int stride, uint32_t fpos)
+{
+	if (!(c->status & MIXRQ_PLAY16BIT))
+	{
+		const int8_t *s = c->realsamp.bit8 + index;
+		if (!(c->status & MIXRQ_INTERPOLATE))
+		{
+			return s[0]<<8;
+		}
+		if (!(c->status & MIXRQ_INTERPOLATEMAX))
+		{
+			return interpoltabq[0][fpos>>11][(uint8_t)s[0]][0] +
+			       interpoltabq[0][fpos>>11][(uint8_t)s[stride]][1];
+		}
+		return interpoltabq2[0][fpos>>12][(uint8_t)s[0]][0] +
+		       interpoltabq2[0][fpos>>12][(uint8_t)s[stride]][1] +
+		       interpoltabq2[0][fpos>>12][(uint8_t)s[stride*2]][2];
+	} else {
+		const int16_t *s = c->realsamp.bit16 + index;
+		if (!(c->status & MIXRQ_INTERPOLATE))
+		{
+			return s[0];
+		}
+		if (!(c->status & MIXRQ_INTERPOLATEMAX))
+		{
+			return interpoltabq[0][fpos>>11][(uint8_t)(s[0]>>8)][0] +
+			       interpoltabq[0][fpos>>11][(uint8_t)(s[stride]>>8)][1] +
+			       interpoltabq[1][fpos>>11][(uint8_t)(s[0]&0xff)][0] +
+			       interpoltabq[1][fpos>>11][(uint8_t)(s[stride]&0xff)][1];
+		}
+		return interpoltabq2[0][fpos>>12][(uint8_t)(s[0]>>8)][0] +
+		       interpoltabq2[0][fpos>>12][(uint8_t)(s[stride]>>8)][1] +
+		       interpoltabq2[0][fpos>>12][(uint8_t)(s[stride*2]>>8)][2] +
+		       interpoltabq2[1][fpos>>12][(uint8_t)(s[0]&0xff)][0] +
+		       interpoltabq2[1][fpos>>12][(uint8_t)(s[stride]&0xff)][1] +
+		       interpoltabq2[1][fpos>>12][(uint8_t)(s[stride*2]&0xff)][2];
+	}
+}
+
+static void test_reference_mix(int16_t *buf, uint32_t len, struct channel *c)
+{
+	uint32_t pos = c->pos;
+	uint32_t fpos = c->fpos;
+
+	while (len--)
+	{
+		if (c->status & MIXRQ_PLAYSTEREO)
+		{
+			*(buf++) = test_reference_interpolate (c, (pos<<1),     2, fpos);
+			*(buf++) = test_reference_interpolate (c, (pos<<1) + 1, 2, fpos);
+		} else {
+			buf[0] = buf[1] = test_reference_interpolate (c, pos, 1, fpos);
+			buf += 2;
+		}
+
+		fpos += c->step & 0xffff;
+		if (fpos & 0xffff0000)
+		{
+			pos++;
+			fpos &= 0xffff;
+		}
+		pos += c->step >> 16;
+	}
+	c->pos = pos;
+	c->fpos = fpos;
+}
+
+static int test_mixqPlayChannel_reference(void)
+{
+	static const int routes[6] =
+	{
+		0,
+		MIXRQ_PLAY16BIT,
+		MIXRQ_INTERPOLATE,
+		MIXRQ_INTERPOLATE | MIXRQ_PLAY16BIT,
+		MIXRQ_INTERPOLATE | MIXRQ_INTERPOLATEMAX,
+		MIXRQ_INTERPOLATE | MIXRQ_INTERPOLATEMAX | MIXRQ_PLAY16BIT
+	};
+	int8_t *samples;
+	struct channel ch, ref;
+	int16_t buf[2*300], refbuf[2*300];
+	int retval = 0;
+	int route, stereo, iteration, i;
+
+	fprintf(stderr, "mixqPlayChannel, table-free routes against interpoltabq/interpoltabq2 reference\n");
+
+	samples = malloc (TEST_REFERENCE_SAMPLES * 2 /* stereo */ * sizeof (int16_t));
+	for (i=0; i < TEST_REFERENCE_SAMPLES * 2 * sizeof (int16_t); i++)
+	{
+		samples[i] = test_random();
+	}
+	/* include the extremes */
+	samples[0] = samples[2] = samples[4] = -128;
+	samples[1] = samples[3] = samples[5] = 127;
+	samples[6] = samples[8] = samples[10] = 127;
+	samples[7] = samples[9] = samples[11] = -128;
+
+	for (stereo=0; stereo < 2; stereo++)
+	{
+		for (route=0; route < 6; route++)
+		{
+			for (iteration=0; iteration < 64; iteration++)
+			{
+				uint32_t len = 1 + test_random() % 300;
+
+				memset (&ch, 0, sizeof (ch));
+				ch.samp = samples;
+				ch.realsamp.bit8 = samples;
+				ch.status = MIXRQ_PLAYING | routes[route] | (stereo ? MIXRQ_PLAYSTEREO : 0);
+				ch.length = TEST_REFERENCE_SAMPLES - 16;
+				ch.step = (int32_t)(test_random() % 0x40000) - 0x20000; /* -2.0 to +2.0 */
+				ch.pos = TEST_REFERENCE_SAMPLES / 2 - 600 + test_random() % 1200;
+				ch.fpos = test_random();
+				if (iteration < 2)
+				{ /* walk slowly across the extremes */
+					ch.pos = 0;
+					ch.step = 0x1000 + iteration * 0x0800;
+				}
+				ref = ch;
+
+				for (i=0; i < 2*300; i++)
+				{
+					buf[i] = refbuf[i] = test_random();
+				}
+
+				mixqPlayChannel (buf, len, &ch, 0);
+				test_reference_mix (refbuf, len, &ref);
+
+				if (memcmp (buf, refbuf, sizeof (buf)) ||
+				    (ch.pos != ref.pos) ||
+				    (ch.fpos != ref.fpos))
+				{
+					fprintf(stderr, "status 0x%02x, iteration %d, len %u, step 0x%08x: output differs from reference\n", ref.status, iteration, len, (unsigned int)ref.step);
+					for (i=0; i < 2*len; i++)
+					{
+						if (buf[i] != refbuf[i])
+						{
+							fprintf(stderr, " buf[%d]=%d (expected %d)\n", i, buf[i], refbuf[i]);
+							break;
+						}
+					}
+					retval |= 1;
+				}
+			}
+		}
+	}
+
+	free (samples);
+
+	return retval;
+}
+
+static int test_mixqAmplifyChannel_reference(void)
+{
+	int16_t src[2*256];
+	int32_t buf[2*256], refbuf[2*256];
+	int16_t (*voltab)[2][256] = &voltabsq[256];
+	int retval = 0;
+	int vol, i;
+
+	fprintf(stderr, "mixqAmplifyChannel, table-free against voltabsq reference\n");
+
+	for (i=0; i < 2*256; i++)
+	{
+		src[i] = test_random();
+	}
+	src[0] = -32768;
+	src[2] = 32767;
+
+	for (vol=-256; vol <= 256; vol++)
+	{
+		for (i=0; i < 2*256; i++)
+		{
+			buf[i] = refbuf[i] = test_random();
+		}
+		mixqAmplifyChannel (buf, src, 256, vol);
+		for (i=0; i < 256; i++)
+		{
+			refbuf[i<<1] += voltab[vol][0][(uint8_t)(src[i<<1]>>8)] + voltab[vol][1][(uint8_t)(src[i<<1]&0xff)];
+		}
+		if (memcmp (buf, refbuf, sizeof (buf)))
+		{
+			fprintf(stderr, "mixqAmplifyChannel vol %d: output differs from reference\n", vol);
+			retval |= 1;
+		}
+	}
+
+	for (i=0; i < 2*256; i++)
+	{
+		buf[i] = refbuf[i] = test_random();
+	}
+	mixqAmplifyChannelUp (buf, src, 256, -256);
+	mixqAmplifyChannelDown (buf, src, 256, 256);
+	for (i=0; i < 256; i++)
+	{
+		refbuf[i<<1] += voltab[-256 + i][0][(uint8_t)(src[i<<1]>>8)] + voltab[-256 + i][1][(uint8_t)(src[i<<1]&0xff)];
+		refbuf[i<<1] += voltab[ 256 - i][0][(uint8_t)(src[i<<1]>>8)] + voltab[ 256 - i][1][(uint8_t)(src[i<<1]&0xff)];
+	}
+	if (memcmp (buf, refbuf, sizeof (buf)))
+	{
+		fprintf(stderr, "mixqAmplifyChannelUp/Down: output differs from reference\n");
+		retval |= 1;
+	}
+
+	return retval;
+}
+
 int main(int argc, char *argv[])
 {
 	struct channel tc;
 	int c;
+	int retval = 0;
 	int16_t target[128];
 
 	tc.realsamp.bit8 = malloc(1024);
@@ -94,16 +317,18 @@ int main(int argc, char *argv[])
 	tc.pos=0;
 	tc.fpos=0;
 	tc.status=MIXRQ_LOOPED;
-	tc.curvols[0]=32;
-	tc.curvols[1]=32;
-	tc.curvols[2]=32;
-	tc.curvols[3]=32;
-	tc.dstvols[0]=32;
-	tc.dstvols[1]=32;
-	tc.dstvols[2]=32;
-	tc.dstvols[3]=32;
-	tc.vol[0]=32;
-	tc.vol[1]=32;
+	tc.curvols[0][0]=32;
+	tc.curvols[0][1]=32;
+	tc.curvols[1][0]=32;
+	tc.curvols[1][1]=32;
+	tc.dstvols[0][0]=32;
+	tc.dstvols[0][1]=32;
+	tc.dstvols[1][0]=32;
+	tc.dstvols[1][1]=32;
+	tc.vol[0][0]=32;
+	tc.vol[0][1]=0;
+	tc.vol[1][0]=0;
+	tc.vol[1][1]=32;
 	tc.orgvol[0]=32;
 	tc.orgvol[1]=32;
 	tc.orgrate=0x0001000;
@@ -127,8 +352,6 @@ int main(int argc, char *argv[])
 	calcvoltabsq();
 	calcinterpoltabq();
 
-	mixqSetupAddresses(&voltabsq[256], interpoltabq, interpoltabq2);
-
 	mixqPlayChannel(target, 128, &tc, 0);
 
 	for (c=0;c<128;c++)
@@ -144,16 +367,16 @@ int main(int argc, char *argv[])
 	fprintf(stderr, "tc.pos=%d\n", tc.pos);
 	fprintf(stderr, "tc.fpos=%d\n", tc.fpos);
 	fprintf(stderr, "tc.status=%d\n", tc.status);
-	fprintf(stderr, "tc.curvols[0]=%d\n", tc.curvols[0]);
-	fprintf(stderr, "tc.curvols[1]=%d\n", tc.curvols[1]);
-	fprintf(stderr, "tc.curvols[2]=%d\n", tc.curvols[2]);
-	fprintf(stderr, "tc.curvols[3]=%d\n", tc.curvols[3]);
-	fprintf(stderr, "tc.dstvols[0]=%d\n", tc.dstvols[0]);
-	fprintf(stderr, "tc.dstvols[1]=%d\n", tc.dstvols[1]);
-	fprintf(stderr, "tc.dstvols[2]=%d\n", tc.dstvols[2]);
-	fprintf(stderr, "tc.dstvols[3]=%d\n", tc.dstvols[3]);
-	fprintf(stderr, "tc.vol[0]=%d\n", tc.vol[0]);
-	fprintf(stderr, "tc.vol[1]=%d\n", tc.vol[1]);
+	fprintf(stderr, "tc.curvols[0][0]=%d\n", tc.curvols[0][0]);
+	fprintf(stderr, "tc.curvols[0][1]=%d\n", tc.curvols[0][1]);
+	fprintf(stderr, "tc.curvols[1][0]=%d\n", tc.curvols[1][0]);
+	fprintf(stderr, "tc.curvols[1][1]=%d\n", tc.curvols[1][1]);
+	fprintf(stderr, "tc.dstvols[0][0]=%d\n", tc.dstvols[0][0]);
+	fprintf(stderr, "tc.dstvols[0][1]=%d\n", tc.dstvols[0][1]);
+	fprintf(stderr, "tc.dstvols[1][0]=%d\n", tc.dstvols[1][0]);
+	fprintf(stderr, "tc.dstvols[1][1]=%d\n", tc.dstvols[1][1]);
+	fprintf(stderr, "tc.vol[0][0]=%d\n", tc.vol[0][0]);
+	fprintf(stderr, "tc.vol[1][1]=%d\n", tc.vol[1][1]);
 	fprintf(stderr, "tc.orgvol[0]=%d\n", tc.orgvol[0]);
 	fprintf(stderr, "tc.orgvol[1]=%d\n", tc.orgvol[1]);
 	fprintf(stderr, "tc.orgrate=%d\n", tc.orgrate);
@@ -170,5 +393,13 @@ int main(int argc, char *argv[])
 
 	free(tc.realsamp.bit8);
 
-	return 0;
+	retval |= test_mixqPlayChannel_reference();
+
+	retval |= test_mixqAmplifyChannel_reference();
+
+	free(voltabsq);
+	free(interpoltabq);
+	free(interpoltabq2);
+
+	return retval;
 }
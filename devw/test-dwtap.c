@@ -0,0 +1,618 @@
+/* OpenCP Module Player
+ * copyright (c) 2026 Stian Skjelstad <stian.skjelstad@gmail.com>
+ *
+ * Unit-test for "dwtap.h". Channel samples built from the taps of devwMixQ
+ * and devwMixF must be the same as what mixMixChanSamples() produced by
+ * resampling the channel itself, as long as neither side interpolates. When
+ * they do, the taps hold the interpolation the mixer did, and the two may
+ * only differ by a bound that is given for every configuration. The
+ * configurations where the scopes change on purpose are listed as expected
+ * failures, and must keep failing.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "../dev/mix.c"
+#include <math.h>
+#include "dwmix.h"
+#include "dwmixfa.h"
+#include "dwmixqa.h"
+#include "dwtap.h"
+
+#define TEST_CHANNELS 4
+#define TEST_SAMPLES 65536
+#define TEST_RATE 44100
+
+const struct PostProcFPRegStruct *mcpFindPostProcFP (const char *name)
+{
+	return 0;
+}
+
+const struct PostProcIntegerRegStruct *mcpFindPostProcInteger (const char *name)
+{
+	return 0;
+}
+
+static uint32_t test_random_state = 0x12345678;
+
+static uint32_t test_random(void)
+{
+	test_random_state = test_random_state * 1103515245 + 12345;
+	return test_random_state >> 8;
+}
+
+static struct channel test_channels[TEST_CHANNELS];
+static int test_vols[TEST_CHANNELS][2];
+static const float *test_fsamples;
+static float test_fvols[TEST_CHANNELS][2];
+static struct dwtap test_taps;
+static int test_tapped;
+
+/* the same as GetMixChannelDirect() in devwmix.c */
+static void test_getchan (unsigned int ch, struct mixchannel *chn, uint32_t rate)
+{
+	struct channel *c=&test_channels[ch];
+
+	memset (chn, 0, sizeof (*chn));
+	chn->realsamp.fmt=c->samp;
+	chn->length=c->length;
+	chn->fpos=c->fpos;
+	chn->pos=c->pos;
+	chn->vol.vols[0]=test_vols[ch][0];
+	chn->vol.vols[1]=test_vols[ch][1];
+	chn->step=c->step;
+	if (c->status&MIXRQ_PLAY16BIT)
+		chn->status|=MIX_PLAY16BIT;
+	if (c->status&MIXRQ_PLAYING)
+		chn->status|=MIX_PLAYING;
+	if (c->status&MIXRQ_INTERPOLATE)
+		chn->status|=MIX_INTERPOLATE;
+	if (c->status&MIXRQ_PLAYSTEREO)
+		chn->status|=MIX_PLAYSTEREO;
+}
+
+/* the same as GetMixChannelDirect() in devwmixf.c, except that pos is in frames for stereo samples as well, like mixasm.c expects */
+static void test_getchanf (unsigned int ch, struct mixchannel *chn, uint32_t rate)
+{
+	dwmixfa_channel_t *c=&dwmixfa_state.ch[ch];
+	int stereo=!!(c->voiceflags & MIXF_PLAYSTEREO);
+
+	memset (chn, 0, sizeof (*chn));
+	chn->realsamp.fmtfloat=(float *)test_fsamples;
+	chn->length=TEST_SAMPLES;
+	chn->fpos=c->smpposf;
+	chn->pos=(c->smpposw-test_fsamples)>>stereo;
+	chn->vol.volfs[0]=test_fvols[ch][0];
+	chn->vol.volfs[1]=test_fvols[ch][1];
+	chn->step=(c->freqw<<16)|c->freqf;
+	chn->status=MIX_PLAYFLOAT;
+	if (c->voiceflags & MIXF_PLAYING)
+		chn->status|=MIX_PLAYING;
+	if (c->voiceflags & MIXF_INTERPOLATE)
+		chn->status|=MIX_INTERPOLATE;
+	if (stereo)
+		chn->status|=MIX_PLAYSTEREO;
+}
+
+static int test_gettap (unsigned int ch, void *buf, unsigned int len, uint32_t rate)
+{
+	if (!dwtap_read (&test_taps, ch, buf, len))
+	{
+		return 0;
+	}
+	test_tapped++;
+	return 1;
+}
+
+/* what playchannelq() in devwmix.c does for the taps, the channel under test renders, the others are quiet */
+static void test_render (unsigned int ch, uint32_t len)
+{
+	static int16_t scalebuf[DWTAP_MAXBLOCK * 2];
+
+	while (len)
+	{
+		uint32_t l = 1 + test_random() % DWTAP_MAXBLOCK;
+		unsigned int i;
+
+		if (l > len)
+		{
+			l = len;
+		}
+		for (i=0; i < TEST_CHANNELS; i++)
+		{
+			if (i == ch)
+			{
+				mixqPlayChannel (scalebuf, l, &test_channels[i], 0);
+				dwtap_write (&test_taps, i, scalebuf, l);
+			} else {
+				dwtap_skip (&test_taps, i, l);
+			}
+		}
+		dwtap_commit (&test_taps, l);
+		len -= l;
+	}
+}
+
+/* mixer() writes the taps of devwMixF itself, only the channel under test is playing */
+static void test_renderf (uint32_t len)
+{
+	while (len)
+	{
+		uint32_t l = 1 + test_random() % MIXF_MIXBUFLEN;
+
+		if (l > len)
+		{
+			l = len;
+		}
+		dwmixfa_state.nsamples = l;
+		mixer (0);
+		len -= l;
+	}
+}
+
+/* the same as calcinterpoltab() in devwmixf.c */
+static void test_interpoltab (void)
+{
+	int i;
+	for (i=0; i<256; i++)
+	{
+		float x1=i/256.0;
+		float x2=x1*x1;
+		float x3=x1*x1*x1;
+		dwmixfa_state.ct0[i]=-0.5*x3+x2-0.5*x1;
+		dwmixfa_state.ct1[i]=1.5*x3-2.5*x2+1;
+		dwmixfa_state.ct2[i]=-1.5*x3+2*x2+0.5*x1;
+		dwmixfa_state.ct3[i]=0.5*x3-0.5*x2;
+	}
+}
+
+/* the output of mixMixChanSamples() with and without the taps, the largest difference is stored in *maxdiff */
+static int test_compare (const int16_t *ref, const int16_t *out, unsigned int ch, unsigned int len, int exact, int *maxdiff)
+{
+	unsigned int i;
+
+	if (!test_tapped)
+	{
+		fprintf (stderr, " channel %u, %u samples: the tap was not used\n", ch, len);
+		return 1;
+	}
+	for (i=0; i < len; i++)
+	{
+		int diff = abs (ref[i] - out[i]);
+		if (exact && diff)
+		{
+			fprintf (stderr, " channel %u, %u samples: sample %u is %d, expected %d\n", ch, len, i, out[i], ref[i]);
+			return 1;
+		}
+		if (diff > *maxdiff)
+		{
+			*maxdiff = diff;
+		}
+	}
+	return 0;
+}
+
+/* channels that are quiet, or went quiet, must not hand out old data */
+static int test_quiet (unsigned int ch, unsigned int quiet)
+{
+	int16_t buf[4];
+	int retval = 0;
+
+	if (dwtap_read (&test_taps, quiet, buf, 1))
+	{
+		fprintf (stderr, " channel %u was quiet, but the tap has data\n", quiet);
+		retval = 1;
+	}
+	if (dwtap_read (&test_taps, ch, buf, 1))
+	{
+		fprintf (stderr, " channel %u went quiet, but the tap has data\n", ch);
+		retval = 1;
+	}
+	return retval;
+}
+
+static int test_case (int8_t *samples, int status, int opt, int exact, int *maxdiff)
+{
+	struct cpifaceSessionAPI_t session;
+	int16_t ref[MIXBUFLEN], out[MIXBUFLEN], buf[MIXBUFLEN * 2], tapped[MIXBUFLEN * 2];
+	const int stereo = (opt & mcpGetSampleStereo) ? 1 : 0;
+	unsigned int ch = test_random() % TEST_CHANNELS;
+	unsigned int len = 1 + test_random() % (MIXBUFLEN >> stereo);
+	struct channel saved;
+	unsigned int i;
+	int retval = 0;
+
+	memset (&session, 0, sizeof (session));
+	memset (test_channels, 0, sizeof (test_channels));
+	for (i=0; i < TEST_CHANNELS; i++)
+	{
+		test_channels[i].samp = samples;
+		test_channels[i].realsamp.bit8 = samples;
+		test_channels[i].length = TEST_SAMPLES;
+		test_channels[i].status = MIXRQ_PLAYING | status;
+		test_channels[i].pos = 100 + test_random() % 1000;
+		test_channels[i].fpos = test_random();
+		if (exact && (opt & mcpGetSampleHQ))
+		{ /* the main mixer interpolates in HQ mode, it only matches on whole samples */
+			test_channels[i].step = (1 + test_random() % 3) << 16;
+			test_channels[i].fpos = 0;
+		} else {
+			test_channels[i].step = 0x1000 + test_random() % 0x30000;
+		}
+		test_vols[i][0] = test_random() % 80; /* above 64 is clamped */
+		test_vols[i][1] = test_random() % 80;
+	}
+
+	if (!mixAPI->mixInit (&session, test_getchan, 0, TEST_CHANNELS, 256))
+	{
+		fprintf (stderr, "mixInit() failed\n");
+		return 1;
+	}
+	if (!dwtap_init (&test_taps, TEST_CHANNELS, sizeof (int16_t) * 2))
+	{
+		fprintf (stderr, "dwtap_init() failed\n");
+		mixAPI->mixClose (&session);
+		return 1;
+	}
+	/* start close to the wrap-around of head, and with some older data in the ring */
+	test_taps.head = 0xffffe000 + test_random() % 0x1000;
+	for (i=0; i < TEST_CHANNELS; i++)
+	{
+		test_taps.valid[i] = test_taps.head;
+	}
+	test_render (ch, test_random() % 10000);
+
+	saved = test_channels[ch];
+	session.mcpMixChanSamples (&session, &ch, 1, ref, len, TEST_RATE, opt);
+
+	test_render (ch, len);
+
+	/* the taps must hold what the mixer rendered, no matter how the blocks were cut */
+	test_channels[ch] = saved;
+	mixqPlayChannel (buf, len, &test_channels[ch], 0);
+	test_channels[ch] = saved;
+	if (!dwtap_read (&test_taps, ch, tapped, len))
+	{
+		fprintf (stderr, " channel %u, %u samples: the tap has no data\n", ch, len);
+		retval = 1;
+	} else if (memcmp (buf, tapped, len * 2 * sizeof (int16_t)))
+	{
+		fprintf (stderr, " channel %u, %u samples: the tap differs from the rendered samples\n", ch, len);
+		retval = 1;
+	}
+
+	test_tapped = 0;
+	mixAPI->mixSetTap (&session, test_gettap);
+	session.mcpMixChanSamples (&session, &ch, 1, out, len, TEST_RATE, opt);
+	retval |= test_compare (ref, out, ch, len << stereo, exact, maxdiff);
+
+	dwtap_skip (&test_taps, ch, 1);
+	dwtap_skip (&test_taps, (ch + 1) % TEST_CHANNELS, 1);
+	dwtap_commit (&test_taps, 1);
+	retval |= test_quiet (ch, (ch + 1) % TEST_CHANNELS);
+
+	dwtap_done (&test_taps);
+	mixAPI->mixClose (&session);
+
+	return retval;
+}
+
+/* the same for devwMixF, flags are MIXF_PLAYSTEREO, MIXF_INTERPOLATE, MIXF_INTERPOLATEQ and MIXF_FILTER */
+static int test_casef (const float *samples, int flags, int opt, int exact, int *maxdiff)
+{
+	static float tempbuf[MIXF_MIXBUFLEN * 2], tapbuf[MIXF_MIXBUFLEN * 2];
+	static int16_t outbuf[MIXF_MIXBUFLEN * 2];
+	struct cpifaceSessionAPI_t session;
+	int16_t ref[MIXBUFLEN], out[MIXBUFLEN];
+	float buf[MIXBUFLEN * 2], tapped[MIXBUFLEN * 2];
+	const int stereo = (opt & mcpGetSampleStereo) ? 1 : 0;
+	const int sstereo = (flags & MIXF_PLAYSTEREO) ? 1 : 0;
+	unsigned int ch = test_random() % TEST_CHANNELS;
+	unsigned int len = 1 + test_random() % (MIXBUFLEN >> stereo);
+	struct dwtap once;
+	dwmixfa_channel_t saved;
+	unsigned int i;
+	int retval = 0;
+
+	memset (&session, 0, sizeof (session));
+	memset (&dwmixfa_state, 0, sizeof (dwmixfa_state));
+	dwmixfa_state.tempbuf = tempbuf;
+	dwmixfa_state.outbuf = outbuf;
+	dwmixfa_state.tapbuf = tapbuf;
+	dwmixfa_state.tap = &test_taps;
+	dwmixfa_state.nvoices = TEST_CHANNELS;
+	dwmixfa_state.samprate = TEST_RATE;
+	test_interpoltab ();
+	test_fsamples = samples;
+	for (i=0; i < TEST_CHANNELS; i++)
+	{
+		dwmixfa_channel_t *c = &dwmixfa_state.ch[i];
+		uint32_t step = 0x1000 + test_random() % 0x30000;
+
+		c->smpposw = (float *)samples + ((100 + test_random() % 1000) << sstereo);
+		c->smpposf = test_random() & 0xffff;
+		c->freqw = step >> 16;
+		c->freqf = step & 0xffff;
+		c->loopend = (float *)samples + ((TEST_SAMPLES - SAMPEND) << sstereo);
+		c->looplen = TEST_SAMPLES - SAMPEND;
+		c->voiceflags = (i == ch) ? (MIXF_PLAYING | flags) : 0;
+		c->mono_volleft = c->stereo_volleft[0] = c->stereo_volright[1] = (test_random() % 1000) / 1000.0;
+		c->mono_volright = c->stereo_volleft[1] = c->stereo_volright[0] = (test_random() % 1000) / 1000.0;
+		c->ffreq = 1.0;
+		if (flags & MIXF_FILTER)
+		{
+			c->ffreq = 0.05 + (test_random() % 250) / 1000.0;
+			c->freso = (test_random() % 500) / 1000.0;
+		}
+		test_fvols[i][0] = (test_random() % 1000) / 1000.0;
+		test_fvols[i][1] = (test_random() % 1000) / 1000.0;
+	}
+
+	if (!mixAPI->mixInit (&session, test_getchanf, 0, TEST_CHANNELS, 256))
+	{
+		fprintf (stderr, "mixInit() failed\n");
+		return 1;
+	}
+	if (!dwtap_init (&test_taps, TEST_CHANNELS, sizeof (float) * 2))
+	{
+		fprintf (stderr, "dwtap_init() failed\n");
+		mixAPI->mixClose (&session);
+		return 1;
+	}
+	if (!dwtap_init (&once, TEST_CHANNELS, sizeof (float) * 2))
+	{
+		fprintf (stderr, "dwtap_init() failed\n");
+		dwtap_done (&test_taps);
+		mixAPI->mixClose (&session);
+		return 1;
+	}
+	test_taps.head = 0xffffe000 + test_random() % 0x1000;
+	for (i=0; i < TEST_CHANNELS; i++)
+	{
+		test_taps.valid[i] = test_taps.head;
+	}
+	test_renderf (test_random() % 10000);
+
+	saved = dwmixfa_state.ch[ch];
+	session.mcpMixChanSamples (&session, &ch, 1, ref, len, TEST_RATE, opt);
+
+	test_renderf (len);
+
+	/* the taps must hold what mixer() plays in one go, no matter how the blocks were cut */
+	dwmixfa_state.ch[ch] = saved;
+	dwmixfa_state.tap = &once;
+	dwmixfa_state.nsamples = len;
+	mixer (0);
+	dwmixfa_state.tap = &test_taps;
+	if (!dwtap_read (&once, ch, buf, len) || !dwtap_read (&test_taps, ch, tapped, len))
+	{
+		fprintf (stderr, " channel %u, %u samples: the tap has no data\n", ch, len);
+		retval = 1;
+	} else if (memcmp (buf, tapped, len * 2 * sizeof (float)))
+	{
+		fprintf (stderr, " channel %u, %u samples: the tap differs from the rendered samples\n", ch, len);
+		retval = 1;
+	}
+
+	test_tapped = 0;
+	mixAPI->mixSetTap (&session, test_gettap);
+	session.mcpMixChanSamples (&session, &ch, 1, out, len, TEST_RATE, opt);
+	retval |= test_compare (ref, out, ch, len << stereo, exact, maxdiff);
+
+	dwmixfa_state.ch[ch].voiceflags &= ~MIXF_PLAYING;
+	dwmixfa_state.nsamples = 1;
+	mixer (0);
+	retval |= test_quiet (ch, (ch + 1) % TEST_CHANNELS);
+
+	dwtap_done (&once);
+	dwtap_done (&test_taps);
+	mixAPI->mixClose (&session);
+
+	return retval;
+}
+
+/* Slow waves, so that different interpolations of them stay close to each
+ * other, which they do not for random samples. Left and right differ.
+ */
+static double test_wave (int i, int right)
+{
+	return 24000.0 * sin (2 * M_PI * i / (83 + 17 * right)) + 6000.0 * sin (2 * M_PI * i / (29 + 5 * right));
+}
+
+/* for an expected failure, the difference must stay larger than bound, so the list of them is kept up to date */
+static int test_result (const char *name, int errors, int maxdiff, int bound, int xfail)
+{
+	int failed = errors || (xfail ? (maxdiff <= bound) : (maxdiff > bound));
+
+	fprintf (stderr, "%s: differs by up to %d (%s %d): %s\n", name, maxdiff, xfail ? "expected failure, more than" : "bound", bound, failed ? "FAILED" : "ok");
+	return failed;
+}
+
+int main(int argc, char *argv[])
+{
+	static const int statuses[4] =
+	{
+		0,
+		MIXRQ_PLAY16BIT,
+		MIXRQ_PLAYSTEREO,
+		MIXRQ_PLAYSTEREO | MIXRQ_PLAY16BIT
+	};
+	static const int opts[4] =
+	{
+		mcpGetSampleMono,
+		mcpGetSampleStereo,
+		mcpGetSampleHQ,
+		mcpGetSampleHQ | mcpGetSampleStereo
+	};
+	/* The quality mixer interpolates most channels (filter=1 in ocp.ini), and
+	 * the scopes then show the interpolation dwmixqa.c did instead of the one
+	 * in mixasm.c. Random samples are only compared bit-exact, the others use
+	 * the slow waves. Those change by up to about 3100 between two samples,
+	 * which comes out as up to about 1550 in mono requests (both sides are
+	 * added) and half of that in stereo ones. Bounds are for non-HQ and HQ
+	 * requests.
+	 */
+	static const struct
+	{
+		int status;
+		int exact;
+		int bound;
+		int boundhq;
+		const char *name;
+	} interps[4] =
+	{
+		{0,                                         1, 0,    0,    ""},
+		{0,                                         0, 0,    1600, ", fractional steps"}, /* HQ only, non-HQ has them above. mixasm.c interpolates in HQ, the mixer did not */
+		{MIXRQ_INTERPOLATE,                         0, 320,  160,  ", interpolated"}, /* mixasm.c has 16 steps between two samples and only 8 bits in its non-HQ tables */
+		{MIXRQ_INTERPOLATE | MIXRQ_INTERPOLATEMAX, 0, 960,  960,  ", interpolated max"} /* quadratic, while mixasm.c is linear */
+	};
+	/* devwMixF: mixasm.c never interpolates float samples, and knows nothing about the filters */
+	static const struct
+	{
+		int flags;
+		int bound;
+		int xfail;
+		const char *name;
+	} interpsf[6] =
+	{
+		{0,                               0,    0, ""},
+		{MIXF_INTERPOLATE,                800,  0, ", interpolated"},
+		{MIXF_INTERPOLATEQ,               1600, 0, ", cubic"}, /* the cubic spline is one sample ahead of the position */
+		{MIXF_FILTER,                     1600, 1, ", filtered"}, /* the scopes show the filter now */
+		{MIXF_FILTER | MIXF_INTERPOLATE,  1600, 1, ", interpolated, filtered"},
+		{MIXF_FILTER | MIXF_INTERPOLATEQ, 1600, 1, ", cubic, filtered"}
+	};
+	int8_t *samples, *samplesq, *smooth[4];
+	float *fsamples[2], *fsmooth[2];
+	int retval = 0;
+	int s, o, n, iteration, i;
+
+	samples = malloc (TEST_SAMPLES * 2 /* stereo */ * sizeof (int16_t));
+	samplesq = malloc (TEST_SAMPLES * 2 /* stereo */ * sizeof (int16_t));
+	for (i=0; i < TEST_SAMPLES * 2 * sizeof (int16_t); i++)
+	{
+		samples[i] = test_random();
+	}
+	/* the HQ routes in mixasm.c only read the upper 8 bits of 16bit samples, while the taps keep all 16 bits */
+	for (i=0; i < TEST_SAMPLES * 2; i++)
+	{
+		((int16_t *)samplesq)[i] = ((int16_t *)samples)[i] & 0xff00;
+	}
+	for (s=0; s < 4; s++)
+	{
+		int sstereo = (statuses[s] & MIXRQ_PLAYSTEREO) ? 1 : 0;
+
+		smooth[s] = malloc (TEST_SAMPLES * 2 * sizeof (int16_t));
+		for (i=0; i < (TEST_SAMPLES << sstereo); i++)
+		{
+			int v = test_wave (i >> sstereo, i & sstereo);
+			if (statuses[s] & MIXRQ_PLAY16BIT)
+			{
+				((int16_t *)smooth[s])[i] = v;
+			} else {
+				smooth[s][i] = v >> 8;
+			}
+		}
+	}
+	for (s=0; s < 2; s++)
+	{
+		fsamples[s] = malloc (TEST_SAMPLES * 2 * sizeof (float));
+		fsmooth[s] = malloc (TEST_SAMPLES * 2 * sizeof (float));
+		for (i=0; i < (TEST_SAMPLES << s); i++)
+		{ /* samptofloat() in smpman.c keeps the 16bit range */
+			fsamples[s][i] = (int16_t)test_random();
+			fsmooth[s][i] = (int)test_wave (i >> s, i & s);
+		}
+	}
+
+	for (s=0; s < 4; s++)
+	{
+		for (o=0; o < 4; o++)
+		{
+			for (n=0; n < 4; n++)
+			{
+				int errors = 0;
+				int maxdiff = 0;
+				int bound = (opts[o] & mcpGetSampleHQ) ? interps[n].boundhq : interps[n].bound;
+				int8_t *data;
+				char name[128];
+
+				if ((n == 1) && !(opts[o] & mcpGetSampleHQ))
+				{
+					continue;
+				}
+				if (!interps[n].exact)
+				{
+					data = smooth[s];
+				} else if ((opts[o] & mcpGetSampleHQ) && (statuses[s] & MIXRQ_PLAY16BIT))
+				{
+					data = samplesq;
+				} else {
+					data = samples;
+				}
+				for (iteration=0; iteration < 32; iteration++)
+				{
+					errors += test_case (data, statuses[s] | interps[n].status, opts[o], interps[n].exact, &maxdiff);
+				}
+				snprintf (name, sizeof (name), "devwMixQ, %s %s sample, %s%s%s",
+					(statuses[s] & MIXRQ_PLAY16BIT) ? "16bit" : "8bit",
+					(statuses[s] & MIXRQ_PLAYSTEREO) ? "stereo" : "mono",
+					(opts[o] & mcpGetSampleStereo) ? "stereo" : "mono",
+					(opts[o] & mcpGetSampleHQ) ? " HQ" : "",
+					interps[n].name);
+				/* expected failure: playstereoir_s() in mixasm.c reads the wrong left sample, the taps do not have that bug */
+				retval |= test_result (name, errors, maxdiff, bound, !interps[n].exact && (opts[o] & mcpGetSampleHQ) && (opts[o] & mcpGetSampleStereo) && (statuses[s] == MIXRQ_PLAYSTEREO));
+			}
+		}
+	}
+
+	for (s=0; s < 2; s++)
+	{
+		for (o=0; o < 4; o++)
+		{
+			for (n=0; n < 6; n++)
+			{
+				int errors = 0;
+				int maxdiff = 0;
+				char name[128];
+
+				for (iteration=0; iteration < 32; iteration++)
+				{
+					errors += test_casef (n ? fsmooth[s] : fsamples[s], (s ? MIXF_PLAYSTEREO : 0) | interpsf[n].flags, opts[o], !n, &maxdiff);
+				}
+				snprintf (name, sizeof (name), "devwMixF, %s sample, %s%s%s",
+					s ? "stereo" : "mono",
+					(opts[o] & mcpGetSampleStereo) ? "stereo" : "mono",
+					(opts[o] & mcpGetSampleHQ) ? " HQ" : "",
+					interpsf[n].name);
+				retval |= test_result (name, errors, maxdiff, interpsf[n].bound, interpsf[n].xfail);
+			}
+		}
+	}
+
+	for (s=0; s < 4; s++)
+	{
+		free (smooth[s]);
+	}
+	for (s=0; s < 2; s++)
+	{
+		free (fsamples[s]);
+		free (fsmooth[s]);
+	}
+	free (samples);
+	free (samplesq);
+
+	return retval;
+}
@@ -23,6 +23,7 @@ int adbmeta_silene_open_errors = 0;
 #define CFDATAHOMEDIR_OVERRIDE "/tmp/"
 
 #include "adbmeta.c"
+#include "dbjournal.c"
 #include "../stuff/file.c"
 
 #define ANSI_COLOR_RED     "\x1b[31m"
@@ -94,6 +95,7 @@ static int adbmeta_basic_test1 (void)
 		fprintf (stderr, "adbmeta_basic_test1: write(\"/tmp/CPARCMETA.DAT\", block, sizeof (blob)): " ANSI_COLOR_RED "%s" ANSI_COLOR_RESET "\n", strerror (errno));
 		close (f);
 		unlink ("/tmp/CPARCMETA.DAT");
+		unlink ("/tmp/CPARCMETA.JNL");
 		return -1;
 	}
 	close (f);
@@ -158,6 +160,7 @@ static int adbmeta_basic_test1 (void)
 	adbMetaClose ();
 
 	unlink ("/tmp/CPARCMETA.DAT");
+	unlink ("/tmp/CPARCMETA.JNL");
 	return retval;
 }
 
@@ -177,13 +180,17 @@ static int adbmeta_basic_test2 (void)
 		return -1;
 	}
 
-	if (write (f, test_blob, sizeof (test_blob)) != sizeof (test_blob))
+	/* trailing garbage, is only removed if the file is rewritten (it can not be truncated underneath adbMeta, since it is memory-mapped) */
+	if ((write (f, test_blob, sizeof (test_blob)) != sizeof (test_blob)) ||
+	    (write (f, "garbage", 7) != 7))
 	{
 		fprintf (stderr, "adbmeta_basic_test2: write(\"/tmp/CPARCMETA.DAT\", block, sizeof (blob)): " ANSI_COLOR_RED "%s" ANSI_COLOR_RESET "\n", strerror (errno));
 		close (f);
 		unlink ("/tmp/CPARCMETA.DAT");
+		unlink ("/tmp/CPARCMETA.JNL");
 		return -1;
 	}
+	close (f);
 
 	adbmeta_silene_open_errors = 0;
 
@@ -193,9 +200,6 @@ static int adbmeta_basic_test2 (void)
 		fprintf (stderr, "adbmeta_basic_test2: " ANSI_COLOR_RED "adbMetaInit() failed " ANSI_COLOR_RESET "\n");
 	}
 
-	ftruncate (f, 0);
-	close (f);
-
 	adbMetaDirty = 1;
 
 	adbMetaClose ();
@@ -213,11 +217,13 @@ static int adbmeta_basic_test2 (void)
 		fprintf (stderr, "adbmeta_basic_test2: read(\"/tmp/CPARCMETA.DAT\"): " ANSI_COLOR_RED "%s" ANSI_COLOR_RESET "\n", strerror (errno));
 		close (f);
 		unlink ("/tmp/CPARCMETA.DAT");
+		unlink ("/tmp/CPARCMETA.JNL");
 		return -1;
 	}
 	close (f);
 
 	unlink ("/tmp/CPARCMETA.DAT");
+	unlink ("/tmp/CPARCMETA.JNL");
 
 	if (fill != sizeof (test_blob))
 	{
@@ -253,6 +259,7 @@ static int adbmeta_basic_test3 (void)
 	int i;
 
 	unlink ("/tmp/CPARCMETA.DAT");
+	unlink ("/tmp/CPARCMETA.JNL");
 
 	adbmeta_silene_open_errors = 1;
 
@@ -272,24 +279,17 @@ static int adbmeta_basic_test3 (void)
 		fprintf (stderr, "adbmeta_basic_test3: " ANSI_COLOR_RED "adbMetaCount != 4" ANSI_COLOR_RESET "\n");
 	}
 
-	for (i=0; i < adbMetaCount; i++)
+	for (i=0; i < 4; i++)
 	{
-		if (strcmp (adbMetaEntries[i]->filename, test_expect[i].filename))
-		{
-			retval |= 2;
-		}
-	}
+		const unsigned char *data;
+		uint32_t datasize;
 
-	if (retval & 2)
-	{
-		for (i=0; i < adbMetaCount; i++)
+		if (adbMetaGetRef (test_expect[i].filename, test_expect[i].filesize, test_expect[i].SIG, &data, &datasize) ||
+		    (datasize != test_expect[i].datasize) ||
+		    memcmp (data, test_expect[i].data, datasize))
 		{
-			if (strcmp (adbMetaEntries[i]->filename, test_expect[i].filename))
-			{
-				fprintf (stderr, "adbmeta_basic_test3: " ANSI_COLOR_RED "expected file \"%s\" (filesize=%d), but got \"%s\" (filesize=%d)" ANSI_COLOR_RESET "\n", test_expect[i].filename, (int)(test_expect[i].filesize), adbMetaEntries[i]->filename, (int)(adbMetaEntries[i]->filesize));
-			} else {
-				fprintf (stderr, "adbmeta_basic_test3:      got file \"%s\" (filesize=%d)\n", adbMetaEntries[i]->filename, (int)(adbMetaEntries[i]->filesize));
-			}
+			retval |= 2;
+			fprintf (stderr, "adbmeta_basic_test3: " ANSI_COLOR_RED "expected file \"%s\" (filesize=%d) is missing or has wrong content" ANSI_COLOR_RESET "\n", test_expect[i].filename, (int)(test_expect[i].filesize));
 		}
 	}
 
@@ -298,6 +298,7 @@ static int adbmeta_basic_test3 (void)
 	adbMetaClose ();
 
 	unlink ("/tmp/CPARCMETA.DAT");
+	unlink ("/tmp/CPARCMETA.JNL");
 
 	return retval;
 }
@@ -378,6 +379,7 @@ const struct adbMetaEntry_t test_many_expect[32] = {
 	int i;
 
 	unlink ("/tmp/CPARCMETA.DAT");
+	unlink ("/tmp/CPARCMETA.JNL");
 
 	adbmeta_silene_open_errors = 1;
 
@@ -398,24 +400,17 @@ const struct adbMetaEntry_t test_many_expect[32] = {
 		fprintf (stderr, "adbmeta_basic_test4: " ANSI_COLOR_RED "adbMetaCount != 32" ANSI_COLOR_RESET "\n");
 	}
 
-	for (i=0; i < adbMetaCount; i++)
+	for (i=0; i < 32; i++)
 	{
-		if (strcmp (adbMetaEntries[i]->filename, test_many_expect[i].filename))
-		{
-			retval |= 2;
-		}
-	}
+		const unsigned char *data;
+		uint32_t datasize;
 
-	if (retval & 2)
-	{
-		for (i=0; i < adbMetaCount; i++)
+		if (adbMetaGetRef (test_many_expect[i].filename, test_many_expect[i].filesize, test_many_expect[i].SIG, &data, &datasize) ||
+		    (datasize != test_many_expect[i].datasize) ||
+		    memcmp (data, test_many_expect[i].data, datasize))
 		{
-			if (strcmp (adbMetaEntries[i]->filename, test_many_expect[i].filename))
-			{
-				fprintf (stderr, "adbmeta_basic_test4: " ANSI_COLOR_RED "expected file \"%s\" (filesize=%d), but got \"%s\" (filesize=%d)" ANSI_COLOR_RESET "\n", test_many_expect[i].filename, (int)(test_many_expect[i].filesize), adbMetaEntries[i]->filename, (int)(adbMetaEntries[i]->filesize));
-			} else {
-				fprintf (stderr, "adbmeta_basic_test4:      got file \"%s\" (filesize=%d)\n", adbMetaEntries[i]->filename, (int)(adbMetaEntries[i]->filesize));
-			}
+			retval |= 2;
+			fprintf (stderr, "adbmeta_basic_test4: " ANSI_COLOR_RED "expected file \"%s\" (filesize=%d) is missing or has wrong content" ANSI_COLOR_RESET "\n", test_many_expect[i].filename, (int)(test_many_expect[i].filesize));
 		}
 	}
 
@@ -424,6 +419,7 @@ const struct adbMetaEntry_t test_many_expect[32] = {
 	adbMetaClose ();
 
 	unlink ("/tmp/CPARCMETA.DAT");
+	unlink ("/tmp/CPARCMETA.JNL");
 
 	return retval;
 }
@@ -504,6 +500,7 @@ const struct adbMetaEntry_t test_many_expect[32] = {
 	int i;
 
 	unlink ("/tmp/CPARCMETA.DAT");
+	unlink ("/tmp/CPARCMETA.JNL");
 
 	adbmeta_silene_open_errors = 1;
 
@@ -524,24 +521,17 @@ const struct adbMetaEntry_t test_many_expect[32] = {
 		fprintf (stderr, "adbmeta_basic_test5: " ANSI_COLOR_RED "adbMetaCount != 32" ANSI_COLOR_RESET "\n");
 	}
 
-	for (i=0; i < adbMetaCount; i++)
+	for (i=0; i < 32; i++)
 	{
-		if (strcmp (adbMetaEntries[i]->filename, test_many_expect[i].filename))
-		{
-			retval |= 2;
-		}
-	}
+		const unsigned char *data;
+		uint32_t datasize;
 
-	if (retval & 2)
-	{
-		for (i=0; i < adbMetaCount; i++)
+		if (adbMetaGetRef (test_many_expect[i].filename, test_many_expect[i].filesize, test_many_expect[i].SIG, &data, &datasize) ||
+		    (datasize != test_many_expect[i].datasize) ||
+		    memcmp (data, test_many_expect[i].data, datasize))
 		{
-			if (strcmp (adbMetaEntries[i]->filename, test_many_expect[i].filename))
-			{
-				fprintf (stderr, "adbmeta_basic_test5: " ANSI_COLOR_RED "expected file \"%s\" (filesize=%d), but got \"%s\" (filesize=%d)" ANSI_COLOR_RESET "\n", test_many_expect[i].filename, (int)(test_many_expect[i].filesize), adbMetaEntries[i]->filename, (int)(adbMetaEntries[i]->filesize));
-			} else {
-				fprintf (stderr, "adbmeta_basic_test5:      got file \"%s\" (filesize=%d)\n", adbMetaEntries[i]->filename, (int)(adbMetaEntries[i]->filesize));
-			}
+			retval |= 2;
+			fprintf (stderr, "adbmeta_basic_test5: " ANSI_COLOR_RED "expected file \"%s\" (filesize=%d) is missing or has wrong content" ANSI_COLOR_RESET "\n", test_many_expect[i].filename, (int)(test_many_expect[i].filesize));
 		}
 	}
 
@@ -550,6 +540,7 @@ const struct adbMetaEntry_t test_many_expect[32] = {
 	adbMetaClose ();
 
 	unlink ("/tmp/CPARCMETA.DAT");
+	unlink ("/tmp/CPARCMETA.JNL");
 
 	return retval;
 }
@@ -585,6 +576,7 @@ const struct adbMetaEntry_t test_many_insert[14] = {
 	int i;
 
 	unlink ("/tmp/CPARCMETA.DAT");
+	unlink ("/tmp/CPARCMETA.JNL");
 
 	adbmeta_silene_open_errors = 1;
 
@@ -605,24 +597,17 @@ const struct adbMetaEntry_t test_many_insert[14] = {
 		fprintf (stderr, "adbmeta_basic_test6: " ANSI_COLOR_RED "adbMetaCount != 7" ANSI_COLOR_RESET "\n");
 	}
 
-	for (i=0; i < ((adbMetaCount <= 7) ? adbMetaCount : 7); i++)
+	for (i=0; i < 7; i++)
 	{
-		if (strcmp (adbMetaEntries[i]->filename, test_many_expect[i].filename))
-		{
-			retval |= 2;
-		}
-	}
+		const unsigned char *data;
+		uint32_t datasize;
 
-	if (retval & 2)
-	{
-		for (i=0; i < ((adbMetaCount <= 7) ? adbMetaCount : 7); i++)
+		if (adbMetaGetRef (test_many_expect[i].filename, test_many_expect[i].filesize, test_many_expect[i].SIG, &data, &datasize) ||
+		    (datasize != test_many_expect[i].datasize) ||
+		    memcmp (data, test_many_expect[i].data, datasize))
 		{
-			if (strcmp (adbMetaEntries[i]->filename, test_many_expect[i].filename))
-			{
-				fprintf (stderr, "adbmeta_basic_test6: " ANSI_COLOR_RED "expected file \"%s\" (filesize=%d), but got \"%s\" (filesize=%d)" ANSI_COLOR_RESET "\n", test_many_expect[i].filename, (int)(test_many_expect[i].filesize), adbMetaEntries[i]->filename, (int)(adbMetaEntries[i]->filesize));
-			} else {
-				fprintf (stderr, "adbmeta_basic_test6:      got file \"%s\" (filesize=%d)\n", adbMetaEntries[i]->filename, (int)(adbMetaEntries[i]->filesize));
-			}
+			retval |= 2;
+			fprintf (stderr, "adbmeta_basic_test6: " ANSI_COLOR_RED "expected file \"%s\" (filesize=%d) is missing or has wrong content" ANSI_COLOR_RESET "\n", test_many_expect[i].filename, (int)(test_many_expect[i].filesize));
 		}
 	}
 
@@ -631,6 +616,7 @@ const struct adbMetaEntry_t test_many_insert[14] = {
 	adbMetaClose ();
 
 	unlink ("/tmp/CPARCMETA.DAT");
+	unlink ("/tmp/CPARCMETA.JNL");
 
 	return retval;
 }
@@ -662,6 +648,7 @@ const struct adbMetaEntry_t test_many_remove[3] = {
 	int i;
 
 	unlink ("/tmp/CPARCMETA.DAT");
+	unlink ("/tmp/CPARCMETA.JNL");
 
 	adbmeta_silene_open_errors = 1;
 
@@ -689,24 +676,29 @@ const struct adbMetaEntry_t test_many_remove[3] = {
 		fprintf (stderr, "adbmeta_basic_test7: " ANSI_COLOR_RED "adbMetaCount != 4" ANSI_COLOR_RESET "\n");
 	}
 
-	for (i=0; i < ((adbMetaCount <= 4) ? adbMetaCount : 4); i++)
+	for (i=0; i < 4; i++)
 	{
-		if (strcmp (adbMetaEntries[i]->filename, test_many_expect[i].filename))
+		const unsigned char *data;
+		uint32_t datasize;
+
+		if (adbMetaGetRef (test_many_expect[i].filename, test_many_expect[i].filesize, test_many_expect[i].SIG, &data, &datasize) ||
+		    (datasize != test_many_expect[i].datasize) ||
+		    memcmp (data, test_many_expect[i].data, datasize))
 		{
 			retval |= 2;
+			fprintf (stderr, "adbmeta_basic_test7: " ANSI_COLOR_RED "expected file \"%s\" (filesize=%d) is missing or has wrong content" ANSI_COLOR_RESET "\n", test_many_expect[i].filename, (int)(test_many_expect[i].filesize));
 		}
 	}
 
-	if (retval & 2)
+	for (i=0; i < 3; i++)
 	{
-		for (i=0; i < ((adbMetaCount <= 4) ? adbMetaCount : 4); i++)
+		const unsigned char *data;
+		uint32_t datasize;
+
+		if (!adbMetaGetRef (test_many_remove[i].filename, test_many_remove[i].filesize, test_many_remove[i].SIG, &data, &datasize))
 		{
-			if (strcmp (adbMetaEntries[i]->filename, test_many_expect[i].filename))
-			{
-				fprintf (stderr, "adbmeta_basic_test7: " ANSI_COLOR_RED "expected file \"%s\" (filesize=%d), but got \"%s\" (filesize=%d)" ANSI_COLOR_RESET "\n", test_many_expect[i].filename, (int)(test_many_expect[i].filesize), adbMetaEntries[i]->filename, (int)(adbMetaEntries[i]->filesize));
-			} else {
-				fprintf (stderr, "adbmeta_basic_test7:      got file \"%s\" (filesize=%d)\n", adbMetaEntries[i]->filename, (int)(adbMetaEntries[i]->filesize));
-			}
+			retval |= 2;
+			fprintf (stderr, "adbmeta_basic_test7: " ANSI_COLOR_RED "removed file \"%s\" (filesize=%d) is still present" ANSI_COLOR_RESET "\n", test_many_remove[i].filename, (int)(test_many_remove[i].filesize));
 		}
 	}
 
@@ -715,6 +707,7 @@ const struct adbMetaEntry_t test_many_remove[3] = {
 	adbMetaClose ();
 
 	unlink ("/tmp/CPARCMETA.DAT");
+	unlink ("/tmp/CPARCMETA.JNL");
 
 	return retval;
 }
@@ -735,6 +728,7 @@ const struct adbMetaEntry_t test_many_insert[7] = {
 	int i;
 
 	unlink ("/tmp/CPARCMETA.DAT");
+	unlink ("/tmp/CPARCMETA.JNL");
 
 	adbmeta_silene_open_errors = 1;
 
@@ -795,6 +789,209 @@ const struct adbMetaEntry_t test_many_insert[7] = {
 	adbMetaClose ();
 
 	unlink ("/tmp/CPARCMETA.DAT");
+	unlink ("/tmp/CPARCMETA.JNL");
+
+	return retval;
+}
+
+static int adbmeta_basic_test9_verify (const char *name, const struct adbMetaEntry_t *expect, const int count)
+{
+	int retval = 0;
+	int i;
+
+	if (adbMetaCount != count)
+	{
+		retval |= 1;
+		fprintf (stderr, "adbmeta_basic_test9: " ANSI_COLOR_RED "%s: adbMetaCount should be %d, but is %ld" ANSI_COLOR_RESET "\n", name, count, (long)adbMetaCount);
+		return retval;
+	}
+
+	for (i=0; i < count; i++)
+	{
+		unsigned char *data = 0;
+		uint32_t datasize = 0;
+		adbMetaGet (expect[i].filename,
+		            expect[i].filesize,
+		            expect[i].SIG,
+		            &data,
+		            &datasize);
+		if ((!data) || (datasize != expect[i].datasize) || memcmp (data, expect[i].data, datasize))
+		{
+			retval |= 2;
+			fprintf (stderr, "adbmeta_basic_test9: " ANSI_COLOR_RED "%s: entry \"%s\" is missing or has wrong content" ANSI_COLOR_RESET "\n", name, expect[i].filename);
+		}
+		free (data);
+	}
+
+	if (!retval)
+	{
+		fprintf (stderr, "adbmeta_basic_test9: " ANSI_COLOR_GREEN "%s: OK" ANSI_COLOR_RESET "\n", name);
+	}
+
+	return retval;
+}
+
+static int adbmeta_basic_test9 (void)
+{
+const struct adbMetaEntry_t test_journal_insert[4] = {
+	{"foo 11", 11, "test", 6, (unsigned char *)"moomo1"},
+	{"foo 12", 12, "test", 6, (unsigned char *)"moomo2"},
+	{"foo 13", 13, "test", 6, (unsigned char *)"moomo3"},
+	{"foo 12", 12, "test", 6, (unsigned char *)"moomo4"},
+};
+const struct adbMetaEntry_t test_journal_expect[2] = {
+	{"foo 12", 12, "test", 6, (unsigned char *)"moomo4"},
+	{"foo 13", 13, "test", 6, (unsigned char *)"moomo3"},
+};
+	int retval = 0;
+	int i;
+	int f;
+	uint8_t *image;
+	uint32_t imagesize;
+
+	unlink ("/tmp/CPARCMETA.DAT");
+	unlink ("/tmp/CPARCMETA.JNL");
+
+	adbmeta_silene_open_errors = 1;
+
+	adbMetaInit (0);
+
+	for (i=0; i < 3; i++)
+	{
+		adbMetaAdd (test_journal_insert[i].filename,
+		            test_journal_insert[i].filesize,
+		            test_journal_insert[i].SIG,
+		            test_journal_insert[i].data,
+		            test_journal_insert[i].datasize);
+	}
+	adbMetaCommit ();
+	adbMetaRemove ("foo 11", 11, "test");
+	adbMetaAdd (test_journal_insert[3].filename,
+	            test_journal_insert[3].filesize,
+	            test_journal_insert[3].SIG,
+	            test_journal_insert[3].data,
+	            test_journal_insert[3].datasize);
+	adbMetaCommit ();
+
+	if (osfile_getfilesize (adbMetaFile))
+	{
+		retval |= 4;
+		fprintf (stderr, "adbmeta_basic_test9: " ANSI_COLOR_RED "adbMetaCommit() rewrote CPARCMETA.DAT instead of appending to the journal" ANSI_COLOR_RESET "\n");
+	}
+
+	adbMetaClose ();
+
+	/* changes are replayed from the journal */
+	adbMetaInit (0);
+	retval |= adbmeta_basic_test9_verify ("replay", test_journal_expect, 2);
+	adbMetaClose ();
+
+	/* a partially written record at the end of the journal is ignored */
+	f = open ("/tmp/CPARCMETA.JNL", O_WRONLY | O_APPEND);
+	if (f >= 0)
+	{
+		write (f, "\x20\x00\x00\x00\x55\x55\x55\x55\x01garbage", 16);
+		close (f);
+	}
+	adbMetaInit (0);
+	retval |= adbmeta_basic_test9_verify ("torn write", test_journal_expect, 2);
+
+	/* compaction that was interrupted while CPARCMETA.DAT was being written, is completed */
+	image = adbMetaCommit_Image (&imagesize);
+	memcpy (dbJournalReserve (adbMetaJournal, DBJOURNAL_IMAGE, imagesize), image, imagesize);
+	dbJournalFlush (adbMetaJournal);
+	osfile_setpos (adbMetaFile, 0);
+	osfile_write (adbMetaFile, image, imagesize / 2);
+	osfile_purge_writeback_cache (adbMetaFile);
+	free (image);
+	adbMetaClose ();
+
+	adbMetaInit (0);
+	retval |= adbmeta_basic_test9_verify ("interrupted compaction", test_journal_expect, 2);
+
+	/* compaction writes everything into CPARCMETA.DAT and resets the journal */
+	adbMetaDirty = 1;
+	adbMetaCommit ();
+	adbMetaClose ();
+
+	unlink ("/tmp/CPARCMETA.JNL");
+	adbMetaInit (0);
+	retval |= adbmeta_basic_test9_verify ("compaction", test_journal_expect, 2);
+	adbMetaClose ();
+
+	unlink ("/tmp/CPARCMETA.DAT");
+	unlink ("/tmp/CPARCMETA.JNL");
+
+	return retval;
+}
+
+static int adbmeta_basic_test10 (void)
+{
+	int retval = 0;
+	int i, pass;
+	char filename[32];
+	unsigned char data[4];
+
+	unlink ("/tmp/CPARCMETA.DAT");
+	unlink ("/tmp/CPARCMETA.JNL");
+
+	adbmeta_silene_open_errors = 1;
+
+	for (pass = 0; pass < 2; pass++)
+	{
+		adbMetaInit (0);
+
+		if (!pass)
+		{
+			/* many entries that share filesize, so the hash index is grown and has long probe sequences */
+			for (i=0; i < 5000; i++)
+			{
+				snprintf (filename, sizeof (filename), "file %d", i);
+				data[0] = i; data[1] = i >> 8; data[2] = 0x55; data[3] = 0xaa;
+				adbMetaAdd (filename, i & 7, "test", data, 4);
+			}
+			for (i=0; i < 5000; i += 3)
+			{
+				snprintf (filename, sizeof (filename), "file %d", i);
+				adbMetaRemove (filename, i & 7, "test");
+			}
+		}
+
+		for (i=0; i < 5000; i++)
+		{
+			const unsigned char *ref;
+			uint32_t refsize;
+			int result;
+
+			snprintf (filename, sizeof (filename), "file %d", i);
+			result = adbMetaGetRef (filename, i & 7, "test", &ref, &refsize);
+			if (!(i % 3))
+			{
+				if (!result)
+				{
+					retval |= 2;
+					fprintf (stderr, "adbmeta_basic_test10: " ANSI_COLOR_RED "pass %d: removed file \"%s\" is still present" ANSI_COLOR_RESET "\n", pass, filename);
+				}
+			} else if (result || (refsize != 4) || (ref[0] != (uint8_t)i) || (ref[1] != (uint8_t)(i >> 8)) || (ref[2] != 0x55) || (ref[3] != 0xaa))
+			{
+				retval |= 2;
+				fprintf (stderr, "adbmeta_basic_test10: " ANSI_COLOR_RED "pass %d: file \"%s\" is missing or has wrong content" ANSI_COLOR_RESET "\n", pass, filename);
+			}
+		}
+
+		if (adbMetaCount != 3333)
+		{
+			retval |= 1;
+			fprintf (stderr, "adbmeta_basic_test10: " ANSI_COLOR_RED "pass %d: adbMetaCount should be 3333, but is %ld" ANSI_COLOR_RESET "\n", pass, (long)adbMetaCount);
+		}
+
+		/* first pass is written as a full image, second pass loads it back from the file */
+		adbMetaDirty = 1;
+		adbMetaClose ();
+	}
+
+	unlink ("/tmp/CPARCMETA.DAT");
+	unlink ("/tmp/CPARCMETA.JNL");
 
 	return retval;
 }
@@ -827,5 +1024,11 @@ int main(int argc, char *argv[])
 	fprintf (stderr, "\n" ANSI_COLOR_CYAN "Testing adbMetaGet() // fetching back" ANSI_COLOR_RESET "\n");
 	retval |= adbmeta_basic_test8();
 
+	fprintf (stderr, "\n" ANSI_COLOR_CYAN "Testing adbMetaCommit() // journal" ANSI_COLOR_RESET "\n");
+	retval |= adbmeta_basic_test9();
+
+	fprintf (stderr, "\n" ANSI_COLOR_CYAN "Testing adbMetaGetRef() // hash index" ANSI_COLOR_RESET "\n");
+	retval |= adbmeta_basic_test10();
+
 	return retval;
 }
@@ -25,10 +25,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#if !defined(_WIN32)
+# include <sys/mman.h>
+#endif
 #include <unistd.h>
 #include "types.h"
 #include "adbmeta.h"
 #include "boot/psetting.h"
+#include "dbjournal.h"
 #include "stuff/file.h"
 #include "stuff/utf-16.h"
 
@@ -53,7 +58,14 @@ const char adbMetaTag[16] = "OCPArchiveMeta\x1b\x00";
   4 bytes datasize
   X bytes data
 
+ Changes since CPARCMETA.DAT was written are appended to CPARCMETA.JNL as
+ journal records, big-endian as above:
+
+ ADBMETA_JOURNAL_ADD:     8 bytes filesize, 4 bytes datasize, FILENAME\0, SIG\0, data
+ ADBMETA_JOURNAL_REMOVE:  8 bytes filesize, FILENAME\0, SIG\0
  */
+#define ADBMETA_JOURNAL_ADD    1
+#define ADBMETA_JOURNAL_REMOVE 2
 
 struct adbMetaHeader
 {
@@ -68,13 +80,166 @@ struct adbMetaEntry_t
 	char          *SIG;
 	uint32_t       datasize;
 	unsigned char *data;
+	uint32_t       hash;
+	uint8_t        instore; /* filename, SIG and data point into adbMetaStore, and the entry is part of adbMetaStoreEntries */
 };
 
 static osfile                 *adbMetaFile;
-static struct adbMetaEntry_t **adbMetaEntries;
+static struct adbMetaEntry_t **adbMetaEntries; /* unordered, lookups go via adbMetaHash */
 static uint_fast32_t           adbMetaCount;
 static uint_fast32_t           adbMetaSize; /* slots allocated */
-static uint8_t                 adbMetaDirty;
+static uint32_t               *adbMetaHash; /* open addressing with linear probing, holds index+1 into adbMetaEntries, 0 = unused */
+static uint_fast32_t           adbMetaHashSize; /* power of two, never more than half full */
+static uint8_t                *adbMetaStore; /* CPARCMETA.DAT as it was loaded (memory-mapped if possible) or as it was last written */
+static size_t                  adbMetaStoreSize;
+static uint8_t                 adbMetaStoreMapped;
+static struct adbMetaEntry_t  *adbMetaStoreEntries; /* one block of entries that refer to adbMetaStore */
+static uint8_t                 adbMetaDirty; /* the journal is not usable, CPARCMETA.DAT needs to be rewritten */
+static struct dbJournal_t     *adbMetaJournal;
+
+static int adbMetaAdd_Apply (const char *filename, const uint64_t filesize, const char *SIG, const unsigned char *data, const uint32_t datasize);
+static int adbMetaRemove_Apply (const char *filename, const uint64_t filesize, const char *SIG);
+
+static uint32_t adbMetaHashKey (const char *filename, const uint64_t filesize, const char *SIG)
+{ /* FNV-1a */
+	uint32_t hash = 0x811c9dc5;
+	int i;
+
+	for (; *filename; filename++)
+	{
+		hash ^= (uint8_t)*filename;
+		hash *= 0x01000193;
+	}
+	for (i = 0; i < 64; i += 8)
+	{
+		hash ^= (uint8_t)(filesize >> i);
+		hash *= 0x01000193;
+	}
+	for (; *SIG; SIG++)
+	{
+		hash ^= (uint8_t)*SIG;
+		hash *= 0x01000193;
+	}
+	return hash;
+}
+
+/* returns the slot in adbMetaHash that refers to the entry, or the unused slot where it should be inserted */
+static uint_fast32_t adbMetaHashFind (const char *filename, const uint64_t filesize, const char *SIG, const uint32_t hash)
+{
+	uint_fast32_t mask = adbMetaHashSize - 1;
+	uint_fast32_t slot;
+
+	for (slot = hash & mask; adbMetaHash[slot]; slot = (slot + 1) & mask)
+	{
+		struct adbMetaEntry_t *entry = adbMetaEntries[adbMetaHash[slot] - 1];
+
+		if ((entry->hash == hash) &&
+		    (entry->filesize == filesize) &&
+		    (!strcmp (entry->filename, filename)) &&
+		    (!strcmp (entry->SIG, SIG)))
+		{
+			break;
+		}
+	}
+	return slot;
+}
+
+static struct adbMetaEntry_t *adbMetaLookup (const char *filename, const uint64_t filesize, const char *SIG)
+{
+	uint_fast32_t slot;
+
+	if (!adbMetaCount)
+	{
+		return 0;
+	}
+	slot = adbMetaHashFind (filename, filesize, SIG, adbMetaHashKey (filename, filesize, SIG));
+	return adbMetaHash[slot] ? adbMetaEntries[adbMetaHash[slot] - 1] : 0;
+}
+
+static int adbMetaHashResize (const uint_fast32_t size)
+{
+	uint32_t *hash;
+	uint_fast32_t i;
+
+	hash = calloc (size, sizeof (hash[0]));
+	if (!hash)
+	{
+		return -1;
+	}
+	free (adbMetaHash);
+	adbMetaHash = hash;
+	adbMetaHashSize = size;
+
+	for (i = 0; i < adbMetaCount; i++)
+	{
+		uint_fast32_t slot;
+		for (slot = adbMetaEntries[i]->hash & (size - 1); hash[slot]; slot = (slot + 1) & (size - 1));
+		hash[slot] = i + 1;
+	}
+	return 0;
+}
+
+/* makes sure that one more entry fits into adbMetaEntries and adbMetaHash */
+static int adbMetaReserve (void)
+{
+	if (adbMetaCount >= adbMetaSize)
+	{
+		struct adbMetaEntry_t **r;
+		uint_fast32_t size = adbMetaSize ? (adbMetaSize * 2) : 64;
+
+		r = realloc (adbMetaEntries, size * sizeof (adbMetaEntries[0]));
+		if (!r)
+		{
+			return -1;
+		}
+		adbMetaEntries = r;
+		adbMetaSize = size;
+	}
+	if (((adbMetaCount + 1) * 2) > adbMetaHashSize)
+	{
+		return adbMetaHashResize (adbMetaHashSize ? (adbMetaHashSize * 2) : 128);
+	}
+	return 0;
+}
+
+static void adbMetaEntryFree (struct adbMetaEntry_t *entry)
+{
+	if (!entry->instore)
+	{
+		free (entry);
+	}
+}
+
+/* removes the entry referred to by the given slot in adbMetaHash */
+static void adbMetaHashDelete (uint_fast32_t slot)
+{
+	uint_fast32_t mask = adbMetaHashSize - 1;
+	uint_fast32_t index = adbMetaHash[slot] - 1;
+	uint_fast32_t next;
+
+	/* shift the following entries in the same probe sequence backwards, so that no tombstones are needed */
+	for (next = (slot + 1) & mask; adbMetaHash[next]; next = (next + 1) & mask)
+	{
+		uint_fast32_t home = adbMetaEntries[adbMetaHash[next] - 1]->hash & mask;
+		if (((next - home) & mask) >= ((next - slot) & mask))
+		{
+			adbMetaHash[slot] = adbMetaHash[next];
+			slot = next;
+		}
+	}
+	adbMetaHash[slot] = 0;
+
+	adbMetaEntryFree (adbMetaEntries[index]);
+	adbMetaCount--;
+
+	/* move the last entry into the hole, so adbMetaEntries stays dense */
+	if (index != adbMetaCount)
+	{
+		for (slot = adbMetaEntries[adbMetaCount]->hash & mask; adbMetaHash[slot] != (adbMetaCount + 1); slot = (slot + 1) & mask);
+		adbMetaHash[slot] = index + 1;
+		adbMetaEntries[index] = adbMetaEntries[adbMetaCount];
+	}
+}
 
 static struct adbMetaEntry_t *adbMetaInit_CreateBlob (const char          *filename,
                                                       uint64_t             filesize,
@@ -116,176 +281,305 @@ static struct adbMetaEntry_t *adbMetaInit_CreateBlob (const char          *filen
 	strcpy (retval->SIG, signature);
 	memcpy (retval->data, data, datasize);
 
+	retval->hash = adbMetaHashKey (filename, filesize, signature);
+
 	return retval;
 }
 
-static int adbMetaInit_ParseFd (osfile *f)
+/* Fills in entries from a CPARCMETA.DAT image. filename, SIG and data are referenced, not copied. Returns the number of complete entries found */
+static uint_fast32_t adbMetaStore_Parse (uint8_t *store, const size_t storesize, struct adbMetaEntry_t *entries, const uint_fast32_t count)
 {
-	/* record counter */
+	size_t offset = sizeof (struct adbMetaHeader);
 	uint_fast32_t counter;
-	/* read buffer */
-	uint_fast32_t fill;
-	uint_fast32_t size;
-	uint8_t *data;
 
-	fill = 0;
-	size = 65536;
-	data = malloc (size);
-	if (!data)
+	for (counter = 0; counter < count; counter++)
 	{
-		fprintf (stderr, "adbMetaInit: malloc() readbuffer failed\n");
-		return -1;
-	}
-
-	for (counter = 0; counter < adbMetaSize; counter++)
-	{
-		uint_fast32_t offset;
-		uint_fast64_t filesize;
-		uint_fast32_t datasize;
-
-		/* char *filename == data */
-		char *signature;
+		struct adbMetaEntry_t *entry = entries + counter;
+		uint8_t *eos;
 
-#ifdef ADBMETA_DEBUG
-		fprintf (stderr, "adbMeta: attempt to parse entry %d/%d\n", (int)counter + 1, (int)adbMetaSize);
-#endif
-		if (fill < 16)
+		entry->filename = (char *)store + offset;
+		if (!(eos = memchr (store + offset, 0, storesize - offset)))
 		{
-			int result;
-fillmore:
-			if (fill == size)
-			{
-				uint8_t *temp;
-				size += 65536;
-				temp = realloc (data, size);
-				if (!temp)
-				{
-					fprintf (stderr, "realloc() readbuffer failed\n");
-					adbMetaCount = counter;
-					free (data);
-					return 1;
-				}
-#ifdef ADBMETA_DEBUG
-				fprintf (stderr, "adbMeta: increased buffer size up to %d bytes\n", (int)size);
-#endif
-				data = temp;
-			}
-			result = size - fill;
-			if (result > 65536) result = 65536;
-			result = osfile_read (f, data + fill, result);
-			if (result < 0)
-			{
-				adbMetaCount = counter;
-				free (data);
-				return 1;
-			}
-			if (result == 0)
-			{
-				fprintf (stderr, "ran out of data\n");
-				adbMetaCount = counter;
-				free (data);
-				return 1;
-			}
-			fill += result;
-#ifdef ADBMETA_DEBUG
-			fprintf (stderr, "adbMeta: input buffer is filled with %d (of %d possible)\n", (int)fill, (int)size);
-#endif
+			break;
 		}
+		offset = eos - store + 1;
 
-/* filename always start at data + 0 */
-		for (offset = 0; ; offset++)
+		entry->SIG = (char *)store + offset;
+		if (!(eos = memchr (store + offset, 0, storesize - offset)))
 		{
-			if (offset >= fill)
-			{
-				goto fillmore;
-			}
-			if (data[offset])
-			{
-				continue;
-			}
-			//filename_length = offset;
-			offset++;
 			break;
 		}
-		signature = (char *)data + offset;
+		offset = eos - store + 1;
 
-		for (; ; offset++)
+		if ((storesize - offset) < 12)
 		{
-			if (offset >= fill)
-			{
-				goto fillmore;
-			}
-			if (data[offset])
-			{
-				continue;
-			}
-			//signature_length = (data + offset) - signature;
-			offset++;
 			break;
 		}
-
-		if (offset + 12 > fill)
+		entry->filesize = ((uint64_t)store[offset+0] << 56) |
+		                  ((uint64_t)store[offset+1] << 48) |
+		                  ((uint64_t)store[offset+2] << 40) |
+		                  ((uint64_t)store[offset+3] << 32) |
+		                  ((uint64_t)store[offset+4] << 24) |
+		                  ((uint64_t)store[offset+5] << 16) |
+		                  ((uint64_t)store[offset+6] << 8) |
+		                  ((uint64_t)store[offset+7]);
+		entry->datasize = ((uint32_t)store[offset+8] << 24) |
+		                  ((uint32_t)store[offset+9] << 16) |
+		                  ((uint32_t)store[offset+10] << 8) |
+		                  ((uint32_t)store[offset+11]);
+		offset += 12;
+
+		if ((storesize - offset) < entry->datasize)
 		{
-			goto fillmore;
+			break;
 		}
-		filesize = ((uint_fast64_t)data[offset+0] << 56) |
-		           ((uint_fast64_t)data[offset+1] << 48) |
-		           ((uint_fast64_t)data[offset+2] << 40) |
-		           ((uint_fast64_t)data[offset+3] << 32) |
-		           ((uint_fast64_t)data[offset+4] << 24) |
-		           ((uint_fast64_t)data[offset+5] << 16) |
-		           ((uint_fast64_t)data[offset+6] << 8) |
-		           ((uint_fast64_t)data[offset+7]);
-		offset += 8;
-		datasize = ((uint_fast32_t)data[offset+0] << 24) |
-		           ((uint_fast32_t)data[offset+1] << 16) |
-		           ((uint_fast32_t)data[offset+2] << 8) |
-		           ((uint_fast32_t)data[offset+3]);
-		offset += 4;
-
-		if (offset + datasize > fill)
+		entry->data = store + offset;
+		offset += entry->datasize;
+
+		entry->hash = adbMetaHashKey (entry->filename, entry->filesize, entry->SIG);
+		entry->instore = 1;
+	}
+
+	return counter;
+}
+
+static void adbMetaStore_Free (void)
+{
+	free (adbMetaStoreEntries);
+#if !defined(_WIN32)
+	if (adbMetaStoreMapped)
+	{
+		munmap (adbMetaStore, adbMetaStoreSize);
+	} else
+#endif
+	{
+		free (adbMetaStore);
+	}
+	adbMetaStoreEntries = 0;
+	adbMetaStore = 0;
+	adbMetaStoreSize = 0;
+	adbMetaStoreMapped = 0;
+}
+
+/* Makes CPARCMETA.DAT available in adbMetaStore. Returns non-zero on error */
+static int adbMetaStore_Load (const char *path)
+{
+	uint64_t filesize = osfile_getfilesize (adbMetaFile);
+
+	if (filesize < sizeof (struct adbMetaHeader))
+	{
+		return 0;
+	}
+	if (filesize > SIZE_MAX)
+	{
+		fprintf (stderr, "adbMetaInit: file too big\n");
+		return -1;
+	}
+
+#if !defined(_WIN32)
+	{
+		int fd = open (path, O_RDONLY);
+		if (fd >= 0)
 		{
-			goto fillmore;
+			void *map = mmap (0, filesize, PROT_READ, MAP_PRIVATE, fd, 0);
+			close (fd);
+			if (map != MAP_FAILED)
+			{
+				adbMetaStore = map;
+				adbMetaStoreSize = filesize;
+				adbMetaStoreMapped = 1;
+				return 0;
+			}
 		}
+	}
+#endif
+
+	adbMetaStore = malloc (filesize);
+	if (!adbMetaStore)
+	{
+		fprintf (stderr, "adbMetaInit: malloc() failed\n");
+		return -1;
+	}
+	adbMetaStoreSize = filesize;
+	osfile_setpos (adbMetaFile, 0);
+	if (osfile_read (adbMetaFile, adbMetaStore, filesize) != filesize)
+	{
+		fprintf (stderr, "adbMetaInit: read() failed\n");
+		adbMetaStore_Free ();
+		return -1;
+	}
+	osfile_purge_readahead_cache (adbMetaFile);
+	osfile_setpos (adbMetaFile, 0);
+	return 0;
+}
 
-		adbMetaEntries[counter] = adbMetaInit_CreateBlob ((char *)data,
-		                                                  filesize,
-		                                                  signature,
-		                                                  data + offset,
-		                                                  datasize);
-		if (!adbMetaEntries[counter])
+/* Moves all entries into image (a new CPARCMETA.DAT, made by adbMetaCommit_Image), so nothing refers to the mapping of the old file before it is rewritten */
+static int adbMetaStore_Rebase (uint8_t *image, const size_t imagesize)
+{
+	struct adbMetaEntry_t *entries = 0;
+	uint_fast32_t counter;
+
+	if (adbMetaCount)
+	{
+		entries = malloc (sizeof (entries[0]) * adbMetaCount);
+		if (!entries)
 		{
-			fprintf (stderr, "adbMetaInit: failed to allocate memory for entry #%ld\n", (long)counter);
-			adbMetaCount = counter;
-			free (data);
 			return -1;
 		}
+		if (adbMetaStore_Parse (image, imagesize, entries, adbMetaCount) != adbMetaCount)
+		{
+			free (entries);
+			return -1;
+		}
+	}
 
-		offset += datasize;
-
-		memmove (data, data + offset, fill - offset);
-		fill -= offset;
+	/* the image has the entries in the same order as adbMetaEntries, so adbMetaHash stays valid */
+	for (counter = 0; counter < adbMetaCount; counter++)
+	{
+		adbMetaEntryFree (adbMetaEntries[counter]);
+		adbMetaEntries[counter] = entries + counter;
 	}
-	adbMetaCount = counter;
-	free (data);
+
+	adbMetaStore_Free ();
+	adbMetaStore = image;
+	adbMetaStoreSize = imagesize;
+	adbMetaStoreEntries = entries;
 
 	return 0;
 }
 
-static int adbMeta_cmp (const void *_a, const void *_b)
+static int adbMetaInit_Index (uint_fast32_t count)
 {
-	const struct adbMetaEntry_t * const *a = _a;
-	const struct adbMetaEntry_t * const *b = _b;
+	int retval = 0;
+	uint_fast32_t found, counter, hashsize;
 
-	if (a[0]->filesize > b[0]->filesize) return 1;
-	if (a[0]->filesize < b[0]->filesize) return -1;
-	return 0;
+	/* the smallest possible entry is 14 bytes, do not trust the header blindly */
+	if (count > ((adbMetaStoreSize - sizeof (struct adbMetaHeader)) / 14))
+	{
+		count = (adbMetaStoreSize - sizeof (struct adbMetaHeader)) / 14;
+		retval = 1;
+	}
+	if (!count)
+	{
+		fprintf (stderr, "ran out of data\n");
+		return 1;
+	}
+
+	adbMetaStoreEntries = malloc (sizeof (adbMetaStoreEntries[0]) * count);
+	adbMetaEntries = malloc (sizeof (adbMetaEntries[0]) * count);
+	if ((!adbMetaStoreEntries) || (!adbMetaEntries))
+	{
+		fprintf (stderr, "malloc() failed\n");
+		return -1;
+	}
+	adbMetaSize = count;
+
+	found = adbMetaStore_Parse (adbMetaStore, adbMetaStoreSize, adbMetaStoreEntries, count);
+	if (found != count)
+	{
+		fprintf (stderr, "ran out of data\n");
+		retval = 1;
+	}
+
+	for (hashsize = 128; hashsize < (found * 2); hashsize <<= 1);
+	if (adbMetaHashResize (hashsize))
+	{
+		fprintf (stderr, "malloc() failed\n");
+		return -1;
+	}
+
+	for (counter = 0; counter < found; counter++)
+	{
+		struct adbMetaEntry_t *entry = adbMetaStoreEntries + counter;
+		uint_fast32_t slot = adbMetaHashFind (entry->filename, entry->filesize, entry->SIG, entry->hash);
+
+		if (adbMetaHash[slot])
+		{ /* duplicate, the last one wins */
+			adbMetaEntries[adbMetaHash[slot] - 1] = entry;
+			continue;
+		}
+		adbMetaEntries[adbMetaCount] = entry;
+		adbMetaHash[slot] = ++adbMetaCount;
+	}
+
+	return retval;
+}
+
+static void adbMetaInit_Apply (void *token, uint8_t type, const uint8_t *data, uint32_t size)
+{
+	const char *filename, *signature;
+	uint64_t filesize;
+	uint32_t datasize = 0;
+	uint32_t offset;
+
+	if (size < 8)
+	{
+		return;
+	}
+	filesize = ((uint64_t)data[0] << 56) |
+	           ((uint64_t)data[1] << 48) |
+	           ((uint64_t)data[2] << 40) |
+	           ((uint64_t)data[3] << 32) |
+	           ((uint64_t)data[4] << 24) |
+	           ((uint64_t)data[5] << 16) |
+	           ((uint64_t)data[6] << 8) |
+	           ((uint64_t)data[7]);
+	offset = 8;
+	if (type == ADBMETA_JOURNAL_ADD)
+	{
+		if (size < 12)
+		{
+			return;
+		}
+		datasize = ((uint32_t)data[8] << 24) |
+		           ((uint32_t)data[9] << 16) |
+		           ((uint32_t)data[10] << 8) |
+		           ((uint32_t)data[11]);
+		offset = 12;
+	}
+
+	filename = (const char *)data + offset;
+	for (; (offset < size) && data[offset]; offset++);
+	if (offset++ >= size)
+	{
+		return;
+	}
+	signature = (const char *)data + offset;
+	for (; (offset < size) && data[offset]; offset++);
+	if (offset++ >= size)
+	{
+		return;
+	}
+
+	switch (type)
+	{
+		case ADBMETA_JOURNAL_ADD:
+			if ((size - offset) != datasize)
+			{
+				fprintf (stderr, "adbMetaInit: invalid journal record\n");
+				return;
+			}
+			adbMetaAdd_Apply (filename, filesize, signature, data + offset, datasize);
+			break;
+		case ADBMETA_JOURNAL_REMOVE:
+			adbMetaRemove_Apply (filename, filesize, signature);
+			break;
+	}
+}
+
+static void adbMetaInit_Replay (void)
+{
+	if (adbMetaJournal)
+	{
+		dbJournalReplay (adbMetaJournal, adbMetaInit_Apply, 0);
+	}
+	osfile_purge_readahead_cache (adbMetaFile);
 }
 
 int adbMetaInit (const struct configAPI_t *configAPI)
 {
 	int retval;
-	struct adbMetaHeader header;
+	uint_fast32_t entries;
 	char *adbMetaPath;
 
 	if (adbMetaFile)
@@ -311,10 +605,9 @@ int adbMetaInit (const struct configAPI_t *configAPI)
 #endif
 
 	adbMetaFile = osfile_open_readwrite (adbMetaPath, 1, 0);
-	free (adbMetaPath);
-	adbMetaPath = 0;
 	if (!adbMetaFile)
 	{
+		free (adbMetaPath);
 		if (!ADBMETA_SILENCE_OPEN_ERRORS)
 		{
 			fprintf(stderr, "adbMetaInit: open(DataHomeDir/CPARCMETA.DAT) failed\n");
@@ -322,81 +615,173 @@ int adbMetaInit (const struct configAPI_t *configAPI)
 		return 1;
 	}
 
-	if (osfile_read (adbMetaFile, &header, sizeof (header)) != sizeof (header))
+	/* this can restore CPARCMETA.DAT if we crashed during a compaction, so it must be opened before parsing */
+	strcpy (adbMetaPath + strlen (adbMetaPath) - 3, "JNL");
+	adbMetaJournal = dbJournalOpen (adbMetaPath, adbMetaFile);
+	strcpy (adbMetaPath + strlen (adbMetaPath) - 3, "DAT");
+
+	/* entries refer directly into the file content, nothing is copied */
+	retval = adbMetaStore_Load (adbMetaPath);
+	free (adbMetaPath);
+	adbMetaPath = 0;
+	if (retval)
+	{
+		return 1;
+	}
+
+	if (adbMetaStoreSize < sizeof (struct adbMetaHeader))
 	{
 		fprintf (stderr, "No header - empty file\n");
+		adbMetaInit_Replay ();
 		return 1;
 	}
 
-	if (memcmp (header.Signature, adbMetaTag, 16))
+	if (memcmp (adbMetaStore, adbMetaTag, 16))
 	{
 		fprintf (stderr, "Invalid header\n");
+		adbMetaInit_Replay ();
 		return 1;
 	}
 
-	adbMetaSize = uint32_big (header.entries);
-	if (!adbMetaSize)
+	entries = ((uint_fast32_t)adbMetaStore[16] << 24) |
+	          ((uint_fast32_t)adbMetaStore[17] << 16) |
+	          ((uint_fast32_t)adbMetaStore[18] << 8) |
+	          ((uint_fast32_t)adbMetaStore[19]);
+	if (!entries)
 	{
 		fprintf (stderr, "Empty - no entries\n");
+		adbMetaInit_Replay ();
 		return 0;
 	}
-	adbMetaEntries = malloc (sizeof (adbMetaEntries[0]) * adbMetaSize);
-	if (!adbMetaEntries)
-	{
-		fprintf (stderr, "malloc() failed\n");
-		return 1;
-	}
 
-	retval = adbMetaInit_ParseFd (adbMetaFile);
+	retval = adbMetaInit_Index (entries);
+
+	adbMetaInit_Replay ();
+
+	fprintf (stderr, "Done\n");
+
+	return retval;
+}
+
+/* serialize all the entries into the CPARCMETA.DAT format */
+static uint8_t *adbMetaCommit_Image (uint32_t *imagesize)
+{
+	uint_fast32_t counter;
+	uint64_t size = sizeof (struct adbMetaHeader);
+	uint8_t *image, *dst;
 
-	if (adbMetaCount > 1)
+	for (counter = 0; counter < adbMetaCount; counter++)
+	{
+		size += strlen (adbMetaEntries[counter]->filename) + 1 +
+		        strlen (adbMetaEntries[counter]->SIG) + 1 +
+		        12 +
+		        adbMetaEntries[counter]->datasize;
+	}
+	if (size > UINT32_MAX)
+	{
+		fprintf (stderr, "adbMetaCommit: database too big\n");
+		return 0;
+	}
+	image = malloc (size);
+	if (!image)
 	{
-		qsort (adbMetaEntries, adbMetaCount, sizeof (adbMetaEntries[0]), adbMeta_cmp);
+		fprintf (stderr, "adbMetaCommit: malloc() failed\n");
+		return 0;
 	}
 
-	osfile_purge_readahead_cache (adbMetaFile);
+	memcpy (image, adbMetaTag, sizeof (adbMetaTag));
+	image[16] = adbMetaCount >> 24;
+	image[17] = adbMetaCount >> 16;
+	image[18] = adbMetaCount >> 8;
+	image[19] = adbMetaCount;
+	dst = image + sizeof (struct adbMetaHeader);
 
-	fprintf (stderr, "Done\n");
+	for (counter = 0; counter < adbMetaCount; counter++)
+	{
+		size_t len;
+
+		len = strlen (adbMetaEntries[counter]->filename) + 1;
+		memcpy (dst, adbMetaEntries[counter]->filename, len);
+		dst += len;
+		len = strlen (adbMetaEntries[counter]->SIG) + 1;
+		memcpy (dst, adbMetaEntries[counter]->SIG, len);
+		dst += len;
+		dst[ 0] = adbMetaEntries[counter]->filesize >> 56;
+		dst[ 1] = adbMetaEntries[counter]->filesize >> 48;
+		dst[ 2] = adbMetaEntries[counter]->filesize >> 40;
+		dst[ 3] = adbMetaEntries[counter]->filesize >> 32;
+		dst[ 4] = adbMetaEntries[counter]->filesize >> 24;
+		dst[ 5] = adbMetaEntries[counter]->filesize >> 16;
+		dst[ 6] = adbMetaEntries[counter]->filesize >> 8;
+		dst[ 7] = adbMetaEntries[counter]->filesize;
+		dst[ 8] = adbMetaEntries[counter]->datasize >> 24;
+		dst[ 9] = adbMetaEntries[counter]->datasize >> 16;
+		dst[10] = adbMetaEntries[counter]->datasize >> 8;
+		dst[11] = adbMetaEntries[counter]->datasize;
+		dst += 12;
+		memcpy (dst, adbMetaEntries[counter]->data, adbMetaEntries[counter]->datasize);
+		dst += adbMetaEntries[counter]->datasize;
+	}
 
-	return retval;
+	*imagesize = size;
+	return image;
 }
 
 void adbMetaCommit (void)
 {
-	struct adbMetaHeader header;
-	/* record counter */
-	uint_fast32_t counter;
+	uint8_t *image;
+	uint32_t imagesize;
+
+	if (!adbMetaFile)
+	{
+		return;
+	}
 
-	memcpy (header.Signature, adbMetaTag, sizeof (adbMetaTag));
-	header.entries = uint32_big (adbMetaCount);
+	if (adbMetaJournal)
+	{
+		if ((!adbMetaDirty) && (!dbJournalNeedCompact (adbMetaJournal)))
+		{
+			if (!dbJournalFlush (adbMetaJournal))
+			{
+				return;
+			}
+			/* fall back to rewriting everything */
+		}
+	} else if (!adbMetaDirty)
+	{
+		return;
+	}
 
-	if ((!adbMetaDirty) || (!adbMetaFile))
+	image = adbMetaCommit_Image (&imagesize);
+	if (!image)
 	{
 		return;
 	}
 
-	osfile_setpos (adbMetaFile, 0);
-	if (osfile_write (adbMetaFile, &header, sizeof (header)) < 0) { fprintf (stderr, "adbMetaCommit write failed #1\n"); return; };
+	/* CPARCMETA.DAT can not be rewritten while entries refer into the mapping of it, the image takes over as the backing store */
+	if (adbMetaStore_Rebase (image, imagesize))
+	{
+		fprintf (stderr, "adbMetaCommit: malloc() failed\n");
+		free (image);
+		return;
+	}
 
-	for (counter = 0; counter < adbMetaCount; counter++)
+	if (adbMetaJournal)
 	{
-		uint8_t buffer[12];
-		if (osfile_write (adbMetaFile, adbMetaEntries[counter]->filename, strlen (adbMetaEntries[counter]->filename) + 1) < 0) { fprintf (stderr, "adbMetaCommit write failed #2\n"); return; };
-		if (osfile_write (adbMetaFile, adbMetaEntries[counter]->SIG,      strlen (adbMetaEntries[counter]->SIG)      + 1) < 0) { fprintf (stderr, "adbMetaCommit write failed #3\n"); return; };
-		buffer[ 0] = adbMetaEntries[counter]->filesize >> 56;
-		buffer[ 1] = adbMetaEntries[counter]->filesize >> 48;
-		buffer[ 2] = adbMetaEntries[counter]->filesize >> 40;
-		buffer[ 3] = adbMetaEntries[counter]->filesize >> 32;
-		buffer[ 4] = adbMetaEntries[counter]->filesize >> 24;
-		buffer[ 5] = adbMetaEntries[counter]->filesize >> 16;
-		buffer[ 6] = adbMetaEntries[counter]->filesize >> 8;
-		buffer[ 7] = adbMetaEntries[counter]->filesize;
-		buffer[ 8] = adbMetaEntries[counter]->datasize >> 24;
-		buffer[ 9] = adbMetaEntries[counter]->datasize >> 16;
-		buffer[10] = adbMetaEntries[counter]->datasize >> 8;
-		buffer[11] = adbMetaEntries[counter]->datasize;
-		if (osfile_write (adbMetaFile, buffer, 12) < 0) { fprintf (stderr, "adbMetaCommit write failed #4\n"); return; };
-		if (osfile_write (adbMetaFile, adbMetaEntries[counter]->data, adbMetaEntries[counter]->datasize) < 0) { fprintf (stderr, "adbMetaCommit write failed #5\n"); return; };
+		if (dbJournalCompact (adbMetaJournal, adbMetaFile, image, imagesize))
+		{
+			fprintf (stderr, "adbMetaCommit compaction failed\n");
+			adbMetaDirty = 1;
+			return;
+		}
+	} else {
+		osfile_setpos (adbMetaFile, 0);
+		if ((osfile_write (adbMetaFile, image, imagesize) < 0) || (osfile_purge_writeback_cache (adbMetaFile) < 0))
+		{
+			fprintf (stderr, "adbMetaCommit write failed\n");
+			return;
+		}
+		osfile_truncate_at (adbMetaFile, imagesize);
 	}
 
 	adbMetaDirty = 0;
@@ -408,13 +793,22 @@ void adbMetaClose (void)
 	adbMetaCommit();
 	for (i=0; i < adbMetaCount; i++)
 	{
-		free (adbMetaEntries[i]);
+		adbMetaEntryFree (adbMetaEntries[i]);
 		adbMetaEntries[i]=0;
 	}
 	free (adbMetaEntries);
 	adbMetaEntries = 0;
 	adbMetaCount = adbMetaSize = 0;
+	free (adbMetaHash);
+	adbMetaHash = 0;
+	adbMetaHashSize = 0;
+	adbMetaStore_Free ();
 	adbMetaDirty = 0;
+	if (adbMetaJournal)
+	{
+		dbJournalClose (adbMetaJournal);
+		adbMetaJournal = 0;
+	}
 	if (adbMetaFile)
 	{
 		osfile_close (adbMetaFile);
@@ -422,103 +816,30 @@ void adbMetaClose (void)
 	}
 }
 
-static uint32_t adbMetaBinarySearchFilesize (const uint64_t filesize)
-{
-	uint_fast32_t searchbase = 0, searchlen = adbMetaCount;
-//	int i;
-//	fprintf (stderr, "\n SEARCH %"PRIu64"..\n", filesize);
-
-	if (adbMetaCount == 0)
-	{
-		return 0;
-	}
-
-	while (searchlen > 1)
-	{
-		uint_fast32_t halfmark;
-
-		halfmark = searchlen >> 1;
-
-//		for (i=0; i < searchlen; i++)
-//		{
-//			fprintf (stderr, " %"PRIu64"(%d)%s ", adbMetaEntries[searchbase + i]->filesize, (int)(searchbase + i), (i == halfmark)?"*":"");
-//		}
-//		fprintf (stderr, "\n");
-
-		if (filesize > adbMetaEntries[searchbase + halfmark]->filesize)
-		{
-			searchbase += halfmark;
-			searchlen -= halfmark;
-		} else {
-			searchlen = halfmark;
-		}
-	}
-
-//	for (i=0; i < searchlen; i++)
-//	{
-//		fprintf (stderr, " %"PRIu64"(%d) ", adbMetaEntries[searchbase + i]->filesize, (int)(searchbase + i));
-//	}
-//	fprintf (stderr, "\n");
-
-	/* fine-tune the position */
-	if (searchbase < adbMetaCount)
-	{
-/*
-		while (searchbase && (adbMetaEntries[searchbase]->filesize == filesize))
-		{
-			searchbase--;
-		}
-*/
-		if (adbMetaEntries[searchbase]->filesize < filesize)
-		{
-//			fprintf (stderr, "Finetune += 1\n");
-			searchbase++;
-		}
-	}
-//	fprintf (stderr, "\n");
-
-	return searchbase;
-}
-
-int adbMetaAdd (const char *filename, const uint64_t filesize, const char *SIG, const unsigned char *data, const uint32_t datasize)
+/* returns 1 if the database was changed, 0 if unchanged, -1 on error */
+static int adbMetaAdd_Apply (const char *filename, const uint64_t filesize, const char *SIG, const unsigned char *data, const uint32_t datasize)
 {
-	uint_fast32_t searchindex = adbMetaBinarySearchFilesize (filesize);
-	int_fast32_t search;
+	uint_fast32_t slot;
 	struct adbMetaEntry_t *temp;
 
 #ifdef ADBMETA_DEBUG
 	fprintf (stderr, "adbMetaAdd (\"%s\", %"PRIu64", \"%s\", 0x%p, %"PRIu32")\n", filename, filesize, SIG, data, datasize);
 #endif
 
-	if (searchindex == adbMetaCount)
-	{
-		goto DoInsert;
-	}
-
-	assert (adbMetaEntries[searchindex]->filesize >= filesize);
-
 	assert (datasize);
 
-	if (adbMetaEntries[searchindex]->filesize > filesize)
+	if (adbMetaReserve ())
 	{
-		goto DoInsert;
+		fprintf (stderr, "adbMetaAdd: error allocating memory for index\n");
+		return -1;
 	}
 
-	for (search = searchindex; search < adbMetaCount; search++)
+	slot = adbMetaHashFind (filename, filesize, SIG, adbMetaHashKey (filename, filesize, SIG));
+	if (adbMetaHash[slot])
 	{
-		if (adbMetaEntries[search]->filesize != filesize)
-		{
-			break;
-		}
-		if (strcmp (adbMetaEntries[search]->filename, filename))
-		{
-			continue;
-		}
-		if (strcmp (adbMetaEntries[search]->SIG, SIG))
-		{
-			continue;
-		}
-		if ((adbMetaEntries[search]->datasize == datasize) && (!memcmp (adbMetaEntries[search]->data, data, datasize)))
+		uint_fast32_t index = adbMetaHash[slot] - 1;
+
+		if ((adbMetaEntries[index]->datasize == datasize) && (!memcmp (adbMetaEntries[index]->data, data, datasize)))
 		{
 			return 0;
 		}
@@ -530,25 +851,10 @@ int adbMetaAdd (const char *filename, const uint64_t filesize, const char *SIG,
 			fprintf (stderr, "adbMetaAdd: error allocating memory for an entry\n");
 			return -1;
 		}
-		free (adbMetaEntries[search]);
-		adbMetaEntries[search] = temp;
-
-		adbMetaDirty = 1;
-		return 0;
-	}
+		adbMetaEntryFree (adbMetaEntries[index]);
+		adbMetaEntries[index] = temp;
 
-DoInsert:
-	if (adbMetaCount >= adbMetaSize)
-	{
-		struct adbMetaEntry_t **r;
-		r = realloc (adbMetaEntries, (adbMetaSize + 8) * sizeof (adbMetaEntries[0]));
-		if (!r)
-		{
-			fprintf (stderr, "adbMetaAdd: error allocating memory for index\n");
-			return -1;
-		}
-		adbMetaEntries = r;
-		adbMetaSize += 8;
+		return 1;
 	}
 
 	temp = adbMetaInit_CreateBlob (filename, filesize, SIG, data, datasize);
@@ -557,65 +863,109 @@ DoInsert:
 		fprintf (stderr, "adbMetaAdd: error allocating memory for an entry\n");
 		return -1;
 	}
-	memmove (adbMetaEntries + searchindex + 1, adbMetaEntries + searchindex, (adbMetaCount - searchindex) * sizeof (adbMetaEntries[0]));
-	adbMetaEntries[searchindex] = temp;
-	adbMetaCount++;
+	adbMetaEntries[adbMetaCount] = temp;
+	adbMetaHash[slot] = ++adbMetaCount;
+
+	return 1;
+}
+
+int adbMetaAdd (const char *filename, const uint64_t filesize, const char *SIG, const unsigned char *data, const uint32_t datasize)
+{
+	uint32_t filename_length;
+	uint32_t SIG_length;
+	uint8_t *dst;
+	int retval;
+
+	retval = adbMetaAdd_Apply (filename, filesize, SIG, data, datasize);
+	if (retval <= 0)
+	{
+		return retval;
+	}
 
-	adbMetaDirty = 1;
+	filename_length = strlen (filename) + 1;
+	SIG_length = strlen (SIG) + 1;
+	if ((!adbMetaJournal) || (!(dst = dbJournalReserve (adbMetaJournal, ADBMETA_JOURNAL_ADD, 12 + filename_length + SIG_length + datasize))))
+	{
+		adbMetaDirty = 1;
+		return 0;
+	}
+	dst[ 0] = filesize >> 56;
+	dst[ 1] = filesize >> 48;
+	dst[ 2] = filesize >> 40;
+	dst[ 3] = filesize >> 32;
+	dst[ 4] = filesize >> 24;
+	dst[ 5] = filesize >> 16;
+	dst[ 6] = filesize >> 8;
+	dst[ 7] = filesize;
+	dst[ 8] = datasize >> 24;
+	dst[ 9] = datasize >> 16;
+	dst[10] = datasize >> 8;
+	dst[11] = datasize;
+	memcpy (dst + 12, filename, filename_length);
+	memcpy (dst + 12 + filename_length, SIG, SIG_length);
+	memcpy (dst + 12 + filename_length + SIG_length, data, datasize);
 
 	return 0;
 }
 
-int adbMetaRemove (const char *filename, const uint64_t filesize, const char *SIG)
+static int adbMetaRemove_Apply (const char *filename, const uint64_t filesize, const char *SIG)
 {
-	uint_fast32_t searchindex = adbMetaBinarySearchFilesize (filesize);
-	int_fast32_t search;
+	uint_fast32_t slot;
 
 #ifdef ADBMETA_DEBUG
 	fprintf (stderr, "adbMetaRemove (\"%s\", %"PRIu64", \"%s\")\n", filename, filesize, SIG);
 #endif
 
-	if (searchindex == adbMetaCount)
+	if (!adbMetaCount)
 	{
 		return 1; /* not found */
 	}
 
-	assert (adbMetaEntries[searchindex]->filesize >= filesize);
-
-	if (adbMetaEntries[searchindex]->filesize > filesize)
+	slot = adbMetaHashFind (filename, filesize, SIG, adbMetaHashKey (filename, filesize, SIG));
+	if (!adbMetaHash[slot])
 	{
 		return 1; /* not found */
 	}
 
-	for (search = searchindex; search < adbMetaCount; search++)
+	adbMetaHashDelete (slot);
+	return 0;
+}
+
+int adbMetaRemove (const char *filename, const uint64_t filesize, const char *SIG)
+{
+	uint32_t filename_length;
+	uint32_t SIG_length;
+	uint8_t *dst;
+
+	if (adbMetaRemove_Apply (filename, filesize, SIG))
 	{
-		if (adbMetaEntries[search]->filesize != filesize)
-		{
-			return 1; /* not found */
-		}
-		if (strcmp (adbMetaEntries[search]->filename, filename))
-		{
-			continue;
-		}
-		if (strcmp (adbMetaEntries[search]->SIG, SIG))
-		{
-			continue;
-		}
+		return 1; /* not found */
+	}
 
-		free (adbMetaEntries[search]);
-		memmove (adbMetaEntries + search, adbMetaEntries + search + 1, (adbMetaCount - search - 1) * sizeof (adbMetaEntries[0]));
-		adbMetaCount--;
+	filename_length = strlen (filename) + 1;
+	SIG_length = strlen (SIG) + 1;
+	if ((!adbMetaJournal) || (!(dst = dbJournalReserve (adbMetaJournal, ADBMETA_JOURNAL_REMOVE, 8 + filename_length + SIG_length))))
+	{
 		adbMetaDirty = 1;
 		return 0;
 	}
+	dst[0] = filesize >> 56;
+	dst[1] = filesize >> 48;
+	dst[2] = filesize >> 40;
+	dst[3] = filesize >> 32;
+	dst[4] = filesize >> 24;
+	dst[5] = filesize >> 16;
+	dst[6] = filesize >> 8;
+	dst[7] = filesize;
+	memcpy (dst + 8, filename, filename_length);
+	memcpy (dst + 8 + filename_length, SIG, SIG_length);
 
-	return 1; /* not found */
+	return 0;
 }
 
 int adbMetaGet (const char *filename, const uint64_t filesize, const char *SIG, unsigned char **data, uint32_t *datasize)
 {
-	uint_fast32_t searchindex = adbMetaBinarySearchFilesize (filesize);
-	int_fast32_t search;
+	struct adbMetaEntry_t *entry;
 
 #ifdef ADBMETA_DEBUG
 	fprintf (stderr, "adbMetaGet (\"%s\", %"PRIu64", \"%s\") ", filename, filesize, SIG);
@@ -624,60 +974,48 @@ int adbMetaGet (const char *filename, const uint64_t filesize, const char *SIG,
 	*data = 0;
 	*datasize = 0;
 
-	if (searchindex == adbMetaCount)
+	entry = adbMetaLookup (filename, filesize, SIG);
+	if (!entry)
 	{
 #ifdef ADBMETA_DEBUG
-		fprintf (stderr, " => NULL #1\n");
+		fprintf (stderr, " => NULL\n");
 #endif
 		return 1; /* not found */
 	}
 
-	assert (adbMetaEntries[searchindex]->filesize >= filesize);
-
-	if (adbMetaEntries[searchindex]->filesize > filesize)
+	*data = malloc (entry->datasize);
+	if (!*data)
 	{
-#ifdef ADBMETA_DEBUG
-		fprintf (stderr, " => NULL #2\n");
-#endif
-		return 1; /* not found */
+		fprintf (stderr, "adbMetaGet: failed to allocate memory for BLOB\n");
+		return -1;
 	}
+	memcpy (*data, entry->data, entry->datasize);
+	*datasize = entry->datasize;
 
-	for (search = searchindex; search < adbMetaCount; search++)
-	{
-		if (adbMetaEntries[search]->filesize != filesize)
-		{
 #ifdef ADBMETA_DEBUG
-		fprintf (stderr, " => NULL #3\n");
+	fprintf (stderr, " => %p %"PRIu32"\n", *data, *datasize);
 #endif
-			return 1; /* not found */
-		}
-		if (strcmp (adbMetaEntries[search]->filename, filename))
-		{
-			continue;
-		}
-		if (strcmp (adbMetaEntries[search]->SIG, SIG))
-		{
-			continue;
-		}
+	return 0;
+}
 
-		*data = malloc (adbMetaEntries[search]->datasize);
-		if (!*data)
-		{
-			fprintf (stderr, "adbMetaGet: failed to allocate memory for BLOB\n");
-			return -1;
-		}
-		memcpy (*data, adbMetaEntries[search]->data, adbMetaEntries[search]->datasize);
-		*datasize = adbMetaEntries[search]->datasize;
+int adbMetaGetRef (const char *filename, const uint64_t filesize, const char *SIG, const unsigned char **data, uint32_t *datasize)
+{
+	struct adbMetaEntry_t *entry;
 
 #ifdef ADBMETA_DEBUG
-		fprintf (stderr, " => %p %"PRIu32"\n", *data, *datasize);
+	fprintf (stderr, "adbMetaGetRef (\"%s\", %"PRIu64", \"%s\")\n", filename, filesize, SIG);
 #endif
-		return 0;
-	}
 
+	*data = 0;
+	*datasize = 0;
 
-#ifdef ADBMETA_DEBUG
-	fprintf (stderr, " => NULL #4\n");
-#endif
-	return 1; /* not found */
+	entry = adbMetaLookup (filename, filesize, SIG);
+	if (!entry)
+	{
+		return 1; /* not found */
+	}
+
+	*data = entry->data;
+	*datasize = entry->datasize;
+	return 0;
 }
@@ -14,4 +14,7 @@ int adbMetaRemove (const char *filename, const uint64_t filesize, const char *SI
 // when done, use free()
 int adbMetaGet    (const char *filename, const uint64_t filesize, const char *SIG,       unsigned char **data,       uint32_t *datasize);
 
+// zero-copy version of adbMetaGet(), data is only valid until the next call to any of the other adbMeta functions. Do not free()
+int adbMetaGetRef (const char *filename, const uint64_t filesize, const char *SIG, const unsigned char **data,       uint32_t *datasize);
+
 #endif
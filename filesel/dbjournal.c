@@ -0,0 +1,444 @@
+/* OpenCP Module Player
+ * copyright (c) 2026 Stian Skjelstad <stian.skjelstad@gmail.com>
+ *
+ * Append-only change journal with checksums, used by dirdb and adbMeta so
+ * that commits only write the changes
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "types.h"
+#include "dbjournal.h"
+#include "stuff/file.h"
+
+/*
+ 32 bytes header
+   16 bytes signature
+    8 bytes size of the database file the records apply to
+    4 bytes CRC32 of the database file the records apply to
+    4 bytes CRC32 of the first 28 bytes
+
+ N records
+    4 bytes datasize
+    4 bytes CRC32 of type + data
+    1 byte  type
+    X bytes data
+
+ all values are little-endian
+ */
+
+#define DBJOURNAL_HEADER 32
+#define DBJOURNAL_RECORD 9
+#define DBJOURNAL_COMPACT_MIN (256*1024) /* never compact smaller journals than this */
+
+static const char dbJournalSig[16] = "OCPJournal\x1b\x00\x00\x00\x00\x00";
+
+struct dbJournal_t
+{
+	osfile   *file;
+	uint64_t  size;            /* bytes written into the journal file */
+	uint64_t  checkpointsize;  /* the database file the records apply to */
+	uint32_t  checkpointcrc;
+
+	uint8_t  *loaded;          /* records found by dbJournalOpen(), waiting for dbJournalReplay() */
+	uint32_t  loaded_fill;
+
+	uint8_t  *pending;         /* records waiting for dbJournalFlush() */
+	uint32_t  pending_fill;
+	uint32_t  pending_size;
+};
+
+static uint32_t dbJournalCRCTable[256];
+
+static uint32_t dbJournalCRC (uint32_t crc, const uint8_t *data, uint64_t len)
+{ /* CRC-32, same polynom as ZIP and PNG */
+	if (!dbJournalCRCTable[1])
+	{
+		uint32_t i, j;
+		for (i = 0; i < 256; i++)
+		{
+			uint32_t c = i;
+			for (j = 0; j < 8; j++)
+			{
+				c = (c & 1) ? (0xedb88320 ^ (c >> 1)) : (c >> 1);
+			}
+			dbJournalCRCTable[i] = c;
+		}
+	}
+
+	crc = ~crc;
+	while (len--)
+	{
+		crc = dbJournalCRCTable[(crc ^ *data++) & 0xff] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+static uint32_t dbJournalGet32 (const uint8_t *src)
+{
+	return src[0] | (src[1] << 8) | (src[2] << 16) | ((uint32_t)src[3] << 24);
+}
+
+static void dbJournalPut32 (uint8_t *dst, uint32_t value)
+{
+	dst[0] = value;
+	dst[1] = value >> 8;
+	dst[2] = value >> 16;
+	dst[3] = value >> 24;
+}
+
+static int dbJournalDatabaseCRC (osfile *database, uint64_t *size, uint32_t *crc)
+{
+	uint8_t *buffer;
+	int64_t result;
+
+	*size = 0;
+	*crc = 0;
+
+	buffer = malloc (65536);
+	if (!buffer)
+	{
+		fprintf (stderr, "dbJournalDatabaseCRC: malloc() failed\n");
+		return -1;
+	}
+	osfile_setpos (database, 0);
+	while ((result = osfile_read (database, buffer, 65536)) > 0)
+	{
+		*crc = dbJournalCRC (*crc, buffer, result);
+		*size += result;
+	}
+	free (buffer);
+	osfile_setpos (database, 0);
+	osfile_purge_readahead_cache (database);
+
+	return (result < 0) ? -1 : 0;
+}
+
+/* write header + records, and cut off any old data that follows */
+static int dbJournalRewrite (struct dbJournal_t *j, const uint8_t *records, uint32_t len)
+{
+	uint8_t header[DBJOURNAL_HEADER];
+
+	memcpy (header, dbJournalSig, 16);
+	dbJournalPut32 (header + 16, j->checkpointsize);
+	dbJournalPut32 (header + 20, (uint64_t)j->checkpointsize >> 32);
+	dbJournalPut32 (header + 24, j->checkpointcrc);
+	dbJournalPut32 (header + 28, dbJournalCRC (0, header, 28));
+
+	osfile_setpos (j->file, 0);
+	if (osfile_write (j->file, header, DBJOURNAL_HEADER) < 0)
+	{
+		return -1;
+	}
+	if (len && (osfile_write (j->file, records, len) < 0))
+	{
+		return -1;
+	}
+	if (osfile_purge_writeback_cache (j->file) < 0)
+	{
+		return -1;
+	}
+	osfile_truncate_at (j->file, DBJOURNAL_HEADER + len);
+	j->size = DBJOURNAL_HEADER + len;
+	return 0;
+}
+
+struct dbJournal_t *dbJournalOpen (const char *path, osfile *database)
+{
+	struct dbJournal_t *j;
+	uint8_t *buffer = 0;
+	uint64_t filesize;
+	uint64_t offset, valid, image = 0;
+	uint32_t imagesize = 0;
+
+	j = calloc (sizeof (*j), 1);
+	if (!j)
+	{
+		fprintf (stderr, "dbJournalOpen: calloc() failed\n");
+		return 0;
+	}
+	j->file = osfile_open_readwrite (path, 1, 0);
+	if (!j->file)
+	{
+		free (j);
+		return 0;
+	}
+
+	filesize = osfile_getfilesize (j->file);
+	if ((filesize < DBJOURNAL_HEADER) || (filesize > 0x7fffffff))
+	{
+		goto reset;
+	}
+	buffer = malloc (filesize);
+	if (!buffer)
+	{
+		fprintf (stderr, "dbJournalOpen: malloc() failed\n");
+		goto reset;
+	}
+	if (osfile_read (j->file, buffer, filesize) != filesize)
+	{
+		goto reset;
+	}
+	osfile_purge_readahead_cache (j->file);
+
+	if (memcmp (buffer, dbJournalSig, 16) || (dbJournalGet32 (buffer + 28) != dbJournalCRC (0, buffer, 28)))
+	{
+		fprintf (stderr, "(journal header invalid) ");
+		goto reset;
+	}
+	j->checkpointsize = dbJournalGet32 (buffer + 16) | ((uint64_t)dbJournalGet32 (buffer + 20) << 32);
+	j->checkpointcrc = dbJournalGet32 (buffer + 24);
+
+	/* find the end of the valid records, and the last compaction image */
+	for (valid = offset = DBJOURNAL_HEADER; (offset + DBJOURNAL_RECORD) <= filesize; offset = valid)
+	{
+		uint32_t datasize = dbJournalGet32 (buffer + offset);
+		if (datasize > (filesize - offset - DBJOURNAL_RECORD))
+		{
+			break;
+		}
+		if (dbJournalGet32 (buffer + offset + 4) != dbJournalCRC (0, buffer + offset + 8, datasize + 1))
+		{
+			break;
+		}
+		if (buffer[offset + 8] == DBJOURNAL_IMAGE)
+		{
+			image = offset;
+			imagesize = datasize;
+		}
+		valid = offset + DBJOURNAL_RECORD + datasize;
+	}
+	if (valid != filesize)
+	{
+		fprintf (stderr, "(journal truncated at %"PRIu64" of %"PRIu64" bytes) ", valid, filesize);
+	}
+
+	if (image)
+	{ /* compaction was interrupted, complete it */
+		const uint8_t *data = buffer + image + DBJOURNAL_RECORD;
+
+		fprintf (stderr, "(restoring from journal) ");
+		osfile_setpos (database, 0);
+		if ((osfile_write (database, data, imagesize) < 0) || (osfile_purge_writeback_cache (database) < 0))
+		{
+			fprintf (stderr, "dbJournalOpen: failed to restore database from journal\n");
+			osfile_close (j->file);
+			free (buffer);
+			free (j);
+			return 0;
+		}
+		osfile_truncate_at (database, imagesize);
+		osfile_setpos (database, 0);
+		osfile_purge_readahead_cache (database);
+
+		j->checkpointsize = imagesize;
+		j->checkpointcrc = dbJournalCRC (0, data, imagesize);
+
+		offset = image + DBJOURNAL_RECORD + imagesize;
+		j->loaded_fill = valid - offset;
+		memmove (buffer, buffer + offset, j->loaded_fill);
+		j->loaded = buffer;
+		buffer = 0;
+
+		if (dbJournalRewrite (j, j->loaded, j->loaded_fill))
+		{
+			fprintf (stderr, "dbJournalOpen: failed to rewrite journal\n");
+		}
+		return j;
+	}
+
+	if (valid > DBJOURNAL_HEADER)
+	{ /* records are only valid for the database they were written against */
+		uint64_t size;
+		uint32_t crc;
+		if (dbJournalDatabaseCRC (database, &size, &crc) || (size != j->checkpointsize) || (crc != j->checkpointcrc))
+		{
+			fprintf (stderr, "(journal does not match database, discarded) ");
+			goto reset;
+		}
+		j->loaded_fill = valid - DBJOURNAL_HEADER;
+		memmove (buffer, buffer + DBJOURNAL_HEADER, j->loaded_fill);
+		j->loaded = buffer;
+		buffer = 0;
+	}
+
+	if (valid != filesize)
+	{
+		osfile_truncate_at (j->file, valid);
+	}
+	j->size = valid;
+	return j;
+
+reset:
+	free (buffer);
+	if (dbJournalDatabaseCRC (database, &j->checkpointsize, &j->checkpointcrc) ||
+	    dbJournalRewrite (j, 0, 0))
+	{
+		fprintf (stderr, "dbJournalOpen: failed to initialize journal\n");
+		osfile_close (j->file);
+		free (j);
+		return 0;
+	}
+	return j;
+}
+
+void dbJournalReplay (struct dbJournal_t *j, void (*apply)(void *token, uint8_t type, const uint8_t *data, uint32_t size), void *token)
+{
+	uint32_t offset;
+
+	for (offset = 0; offset < j->loaded_fill;)
+	{
+		uint32_t datasize = dbJournalGet32 (j->loaded + offset);
+		uint8_t type = j->loaded[offset + 8];
+
+		if (type != DBJOURNAL_IMAGE)
+		{
+			apply (token, type, j->loaded + offset + DBJOURNAL_RECORD, datasize);
+		}
+		offset += DBJOURNAL_RECORD + datasize;
+	}
+
+	free (j->loaded);
+	j->loaded = 0;
+	j->loaded_fill = 0;
+}
+
+uint8_t *dbJournalReserve (struct dbJournal_t *j, uint8_t type, uint32_t size)
+{
+	uint8_t *retval;
+
+	if ((j->pending_size - j->pending_fill) < (DBJOURNAL_RECORD + size))
+	{
+		uint32_t newsize = j->pending_size + DBJOURNAL_RECORD + size + 65536;
+		uint8_t *temp = realloc (j->pending, newsize);
+		if (!temp)
+		{
+			fprintf (stderr, "dbJournalReserve: realloc() failed\n");
+			return 0;
+		}
+		j->pending = temp;
+		j->pending_size = newsize;
+	}
+
+	retval = j->pending + j->pending_fill;
+	dbJournalPut32 (retval, size);
+	dbJournalPut32 (retval + 4, 0); /* CRC is calculated by dbJournalFlush() */
+	retval[8] = type;
+	j->pending_fill += DBJOURNAL_RECORD + size;
+
+	return retval + DBJOURNAL_RECORD;
+}
+
+int dbJournalPending (struct dbJournal_t *j)
+{
+	return j->pending_fill != 0;
+}
+
+int dbJournalFlush (struct dbJournal_t *j)
+{
+	uint32_t offset;
+
+	if (!j->pending_fill)
+	{
+		return 0;
+	}
+
+	for (offset = 0; offset < j->pending_fill;)
+	{
+		uint32_t datasize = dbJournalGet32 (j->pending + offset);
+		dbJournalPut32 (j->pending + offset + 4, dbJournalCRC (0, j->pending + offset + 8, datasize + 1));
+		offset += DBJOURNAL_RECORD + datasize;
+	}
+
+	osfile_setpos (j->file, j->size);
+	if ((osfile_write (j->file, j->pending, j->pending_fill) < 0) || (osfile_purge_writeback_cache (j->file) < 0))
+	{
+		fprintf (stderr, "dbJournalFlush: write failed\n");
+		return -1;
+	}
+	j->size += j->pending_fill;
+	j->pending_fill = 0;
+
+	return 0;
+}
+
+int dbJournalNeedCompact (struct dbJournal_t *j)
+{
+	uint64_t size = j->size + j->pending_fill;
+
+	return (size > DBJOURNAL_COMPACT_MIN) && (size > (j->checkpointsize / 4));
+}
+
+int dbJournalCompact (struct dbJournal_t *j, osfile *database, const uint8_t *image, uint32_t imagesize)
+{
+	uint8_t record[DBJOURNAL_RECORD];
+	uint32_t crc;
+
+	/* step 1, store the image in the journal */
+	record[8] = DBJOURNAL_IMAGE;
+	crc = dbJournalCRC (0, record + 8, 1);
+	crc = dbJournalCRC (crc, image, imagesize);
+	dbJournalPut32 (record, imagesize);
+	dbJournalPut32 (record + 4, crc);
+
+	osfile_setpos (j->file, j->size);
+	if ((osfile_write (j->file, record, DBJOURNAL_RECORD) < 0) ||
+	    (osfile_write (j->file, image, imagesize) < 0) ||
+	    (osfile_purge_writeback_cache (j->file) < 0))
+	{
+		fprintf (stderr, "dbJournalCompact: failed to write image into journal\n");
+		osfile_truncate_at (j->file, j->size);
+		return -1;
+	}
+	j->size += DBJOURNAL_RECORD + imagesize;
+
+	/* step 2, replace the database. If we crash now, dbJournalOpen() will redo this step */
+	osfile_setpos (database, 0);
+	if ((osfile_write (database, image, imagesize) < 0) ||
+	    (osfile_purge_writeback_cache (database) < 0))
+	{
+		fprintf (stderr, "dbJournalCompact: failed to write database\n");
+		return -1;
+	}
+	osfile_truncate_at (database, imagesize);
+
+	/* step 3, reset the journal */
+	j->checkpointsize = imagesize;
+	j->checkpointcrc = dbJournalCRC (0, image, imagesize);
+	j->pending_fill = 0;
+	if (dbJournalRewrite (j, 0, 0))
+	{
+		fprintf (stderr, "dbJournalCompact: failed to reset journal\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+void dbJournalClose (struct dbJournal_t *j)
+{
+	if (!j)
+	{
+		return;
+	}
+	osfile_close (j->file);
+	free (j->loaded);
+	free (j->pending);
+	free (j);
+}
@@ -0,0 +1,41 @@
+#ifndef _DBJOURNAL_H
+#define _DBJOURNAL_H 1
+
+/* Append-only change journal that lives next to a database file (the
+ * checkpoint). Commits append checksummed records that describe the changes
+ * since the checkpoint, and when the journal has grown large, the owner
+ * rewrites the checkpoint and the journal is reset (compaction).
+ *
+ * Compaction first stores the new checkpoint as a DBJOURNAL_IMAGE record in
+ * the journal, so if the rewrite of the database file is interrupted, it is
+ * completed the next time the journal is opened.
+ *
+ * Records must describe absolute state (replaying them twice is harmless).
+ */
+
+struct osfile_t;
+struct dbJournal_t;
+
+#define DBJOURNAL_IMAGE 0 /* reserved for compaction */
+
+/* If database contains an interrupted compaction, database is restored before returning. Records that do not belong to the current database are discarded. Returns NULL on error */
+struct dbJournal_t *dbJournalOpen (const char *path, struct osfile_t *database);
+
+/* Calls apply() for all records loaded by dbJournalOpen(), in the order they were written */
+void dbJournalReplay (struct dbJournal_t *j, void (*apply)(void *token, uint8_t type, const uint8_t *data, uint32_t size), void *token);
+
+/* Reserves space for a record in the pending buffer, caller must fill in all size bytes. Returns NULL on error */
+uint8_t *dbJournalReserve (struct dbJournal_t *j, uint8_t type, uint32_t size);
+
+int dbJournalPending (struct dbJournal_t *j); /* returns non-zero if there are records not written yet */
+
+int dbJournalFlush (struct dbJournal_t *j); /* appends all pending records with one write, returns non-zero on error */
+
+int dbJournalNeedCompact (struct dbJournal_t *j); /* returns non-zero if the journal has grown large compared to the checkpoint */
+
+/* Replaces the content of database with image and resets the journal, pending records are dropped since image is expected to contain them. Returns non-zero on error */
+int dbJournalCompact (struct dbJournal_t *j, struct osfile_t *database, const uint8_t *image, uint32_t imagesize);
+
+void dbJournalClose (struct dbJournal_t *j);
+
+#endif
@@ -24,6 +24,7 @@
 #define MEASURESTR_UTF8_OVERRIDE
 
 #include "dirdb.c"
+#include "dbjournal.c"
 #include "../stuff/compat.c"
 #include "../stuff/file.c"
 
@@ -68,12 +69,23 @@ static void clear_dirdb()
 	dirdbFreeChildren_size = FREE_MINSIZE;
 	dirdbFreeChildren = malloc (sizeof (dirdbFreeChildren[0]) * dirdbFreeChildren_size);
 
+	free (dirdbDirtyMap);
+	dirdbDirtyMap = 0;
+	dirdbDirtyMapSize = 0;
+	dirdbDirtyMapAny = 0;
+
+	if (dirdbJournal)
+	{
+		dbJournalClose (dirdbJournal);
+		dirdbJournal = 0;
+	}
 	if (dirdbFile)
 	{
 		osfile_close(dirdbFile);
 		dirdbFile = 0;
 	}
 	unlink (CFDATAHOMEDIR_OVERRIDE "CPDIRDB.DAT");
+	unlink (CFDATAHOMEDIR_OVERRIDE "CPDIRDB.JNL");
 }
 
 uint8_t mdbCleanSlate = 0;
@@ -984,6 +996,43 @@ static int dirdb_basic_test7(void)
 	}
 
 
+	fprintf (stderr, ANSI_COLOR_CYAN "Testing partial rescan with dirdbTagPreserveTree(), dirdbTagCancelTree(), dirdbTagRemoveUntaggedAndSubmit() and dirdbGetMdb()\n" ANSI_COLOR_RESET);
+
+	dirdbTagSetParent (node1);
+	dirdbTagPreserveTree (node1); /* everything is kept... */
+	dirdbTagCancelTree (node5); /* ...except /tmp/bar, which is scanned again */
+	dirdbMakeMdbRef (node6, 3);
+
+	dirdbTagRemoveUntaggedAndSubmit ();
+
+	first=1;
+	iter = 0xa1234;
+	mdb = 0xa5678;
+	found_node3=0;
+	found_node6=0;
+	while (!dirdbGetMdb(&iter, &mdb, &first))
+	{
+		     if ((iter==node3) && (mdb==1)) found_node3++;
+		else if ((iter==node6) && (mdb==3)) found_node6++;
+		else {
+			fprintf (stderr, "dirdbGetMdb() gave an unknown node " ANSI_COLOR_RED "iter=%d mdb=%d" ANSI_COLOR_RESET "\n", iter, mdb);
+			retval++;
+		}
+	}
+	if (found_node3 != 1) {
+		fprintf (stderr, "dirdbGetMdb() did not reveal " ANSI_COLOR_RED "iter=%d mdb=1" ANSI_COLOR_RESET "\n", node3);
+		retval++;
+	} else {
+		fprintf (stderr, "dirdbGetMdb() gave us " ANSI_COLOR_GREEN "iter=%d mdb=1" ANSI_COLOR_RESET "\n", node3);
+	}
+	if (found_node6 != 1) {
+		fprintf (stderr, "dirdbGetMdb() did not reveal " ANSI_COLOR_RED "iter=%d mdb=3" ANSI_COLOR_RESET "\n", node6);
+		retval++;
+	} else {
+		fprintf (stderr, "dirdbGetMdb() gave us " ANSI_COLOR_GREEN "iter=%d mdb=3" ANSI_COLOR_RESET "\n", node6);
+	}
+
+
 	fprintf (stderr, ANSI_COLOR_CYAN "Testing clearing with dirdbTagSetParent(), dirdbTagRemoveUntaggedAndSubmit() and dirdbGetMdb()\n" ANSI_COLOR_RESET);
 
 	dirdbTagSetParent (DIRDB_NOPARENT);
@@ -1942,6 +1991,99 @@ static int dirdb_basic_test14(void)
 	return retval;
 }
 
+static int dirdb_basic_test15(void)
+{
+	int retval = 0;
+	uint32_t node1, node2, node3, node4;
+
+	fprintf (stderr, ANSI_COLOR_CYAN "dirdbFlush() journal\n" ANSI_COLOR_RESET);
+	if (!dirdbInit (0))
+	{
+		fprintf (stderr, ANSI_COLOR_RED "dirdbInit() failed, expect errors\n");
+	}
+
+	node1 = dirdbResolvePathAndRef ("file:/tmp", dirdb_use_filehandle);
+	node2 = dirdbResolvePathAndRef ("file:/tmp/01.mod", dirdb_use_filehandle);
+	node3 = dirdbResolvePathAndRef ("file:/tmp/02.mod", dirdb_use_filehandle);
+	dirdbTagSetParent (node1);
+	dirdbMakeMdbRef (node2, 0x00000100);
+	dirdbMakeMdbRef (node3, 0x00000200);
+	dirdbTagRemoveUntaggedAndSubmit ();
+	dirdbUnref (node2, dirdb_use_filehandle);
+	dirdbUnref (node3, dirdb_use_filehandle);
+	dirdbFlush ();
+
+	/* replace 02.mod with 03.mod */
+	node4 = dirdbResolvePathAndRef ("file:/tmp/03.mod", dirdb_use_filehandle);
+	dirdbTagSetParent (node1);
+	dirdbMakeMdbRef (node2, 0x00000100);
+	dirdbMakeMdbRef (node4, 0x00000300);
+	dirdbTagRemoveUntaggedAndSubmit ();
+	dirdbUnref (node4, dirdb_use_filehandle);
+	dirdbUnref (node1, dirdb_use_filehandle);
+	dirdbFlush ();
+
+	if (osfile_getfilesize (dirdbFile))
+	{
+		fprintf (stderr, ANSI_COLOR_RED "dirdbFlush() rewrote CPDIRDB.DAT instead of appending to the journal\n" ANSI_COLOR_RESET);
+		retval++;
+	}
+
+	dirdbClose ();
+	if (!dirdbInit (0))
+	{
+		fprintf (stderr, ANSI_COLOR_RED "dirdbInit() failed to replay the journal\n");
+		retval++;
+	}
+
+	if ((dirdbNum <= node2) || (!dirdbData[node2].name) || strcmp (dirdbData[node2].name, "01.mod") || (dirdbData[node2].parent != node1) || (dirdbData[node2].mdb_ref != 0x00000100))
+	{
+		fprintf (stderr, ANSI_COLOR_RED "node for file:/tmp/01.mod was not restored\n" ANSI_COLOR_RESET);
+		retval++;
+	} else {
+		fprintf (stderr, ANSI_COLOR_GREEN "node for file:/tmp/01.mod was restored\n" ANSI_COLOR_RESET);
+	}
+	if ((dirdbNum <= node4) || (!dirdbData[node4].name) || strcmp (dirdbData[node4].name, "03.mod") || (dirdbData[node4].parent != node1) || (dirdbData[node4].mdb_ref != 0x00000300))
+	{
+		fprintf (stderr, ANSI_COLOR_RED "node for file:/tmp/03.mod was not restored\n" ANSI_COLOR_RESET);
+		retval++;
+	} else {
+		fprintf (stderr, ANSI_COLOR_GREEN "node for file:/tmp/03.mod was restored\n" ANSI_COLOR_RESET);
+	}
+	if ((node3 != node4) && (dirdbNum > node3) && dirdbData[node3].name)
+	{
+		fprintf (stderr, ANSI_COLOR_RED "node for file:/tmp/02.mod was not removed\n" ANSI_COLOR_RESET);
+		retval++;
+	}
+	if ((dirdbNum <= node1) || (dirdbData[node1].refcount != 2))
+	{
+		fprintf (stderr, ANSI_COLOR_RED "node for file:/tmp does not have refcount 2\n" ANSI_COLOR_RESET);
+		retval++;
+	}
+
+	/* compaction */
+	dirdbDirty = 1;
+	dirdbFlush ();
+	dirdbClose ();
+	unlink (CFDATAHOMEDIR_OVERRIDE "CPDIRDB.JNL");
+	if (!dirdbInit (0))
+	{
+		fprintf (stderr, ANSI_COLOR_RED "dirdbInit() failed to parse the compacted database\n");
+		retval++;
+	}
+	if ((dirdbNum <= node4) || (!dirdbData[node4].name) || strcmp (dirdbData[node4].name, "03.mod") || (dirdbData[node4].mdb_ref != 0x00000300))
+	{
+		fprintf (stderr, ANSI_COLOR_RED "node for file:/tmp/03.mod was not compacted into CPDIRDB.DAT\n" ANSI_COLOR_RESET);
+		retval++;
+	} else {
+		fprintf (stderr, ANSI_COLOR_GREEN "node for file:/tmp/03.mod was compacted into CPDIRDB.DAT\n" ANSI_COLOR_RESET);
+	}
+
+	clear_dirdb ();
+
+	return retval;
+}
+
 int main(int argc, char *argv[])
 {
 	int retval = 0;
@@ -1978,5 +2120,7 @@ int main(int argc, char *argv[])
 
 	retval |= dirdb_basic_test14(); /* dirdbFlush(), writing database */
 
+	retval |= dirdb_basic_test15(); /* dirdbFlush(), journal */
+
 	return retval;
 }
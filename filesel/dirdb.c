@@ -35,6 +35,7 @@
 #include <unistd.h>
 #include "types.h"
 #include "boot/console.h"
+#include "dbjournal.h"
 #include "dirdb.h"
 #include "mdb.h"
 #include "boot/psetting.h"
@@ -95,10 +96,21 @@ struct __attribute__((packed)) dirdbheader
 const char dirdbsigv1[60] = "Cubic Player Directory Data Base\x1B\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00";
 const char dirdbsigv2[60] = "Cubic Player Directory Data Base\x1B\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x00\x01\x00";
 
+/* Changes since CPDIRDB.DAT was written are appended to CPDIRDB.JNL as
+ * journal records, little-endian:
+ *
+ * DIRDB_JOURNAL_NODE: 4 bytes node, 4 bytes parent, 4 bytes mdb_ref, X bytes name (no name means that the node is free)
+ */
+#define DIRDB_JOURNAL_NODE 1
+
 static osfile            *dirdbFile;
+static struct dbJournal_t *dirdbJournal;
 static struct dirdbEntry *dirdbData = 0;
 static uint32_t dirdbNum = 0;
-static int dirdbDirty = 0;
+static int dirdbDirty = 0; /* the journal is not usable, CPDIRDB.DAT needs to be rewritten */
+static uint8_t *dirdbDirtyMap; /* nodes that has changed since last dirdbFlush() */
+static uint32_t dirdbDirtyMapSize;
+static int dirdbDirtyMapAny;
 
 static uint32_t *dirdbRootChildren = 0;
 static uint32_t  dirdbRootChildren_fill = 0;
@@ -183,6 +195,26 @@ static void dumpdirdb(void)
 }
 #endif
 
+static void dirdbMarkDirty (uint32_t node)
+{
+	if (node >= dirdbDirtyMapSize)
+	{
+		uint32_t newsize = (dirdbNum + 255) & ~255;
+		uint8_t *temp = realloc (dirdbDirtyMap, newsize / 8);
+		if (!temp)
+		{
+			fprintf (stderr, "dirdbMarkDirty: realloc() failed\n");
+			dirdbDirty = 1;
+			return;
+		}
+		dirdbDirtyMap = temp;
+		memset (dirdbDirtyMap + dirdbDirtyMapSize / 8, 0, (newsize - dirdbDirtyMapSize) / 8);
+		dirdbDirtyMapSize = newsize;
+	}
+	dirdbDirtyMap[node >> 3] |= 1 << (node & 0x07);
+	dirdbDirtyMapAny = 1;
+}
+
 static int dirdbChildren_cmp (const void *a, const void *b)
 {
 	const uint32_t *index1 = (const uint32_t *)a;
@@ -191,6 +223,60 @@ static int dirdbChildren_cmp (const void *a, const void *b)
 	return strcmp (dirdbData[*index1].name, dirdbData[*index2].name);
 }
 
+static void dirdbInit_Apply (void *token, uint8_t type, const uint8_t *data, uint32_t size)
+{
+	uint32_t node, len;
+
+	if ((type != DIRDB_JOURNAL_NODE) || (size < 12) || ((size - 12) > UINT16_MAX))
+	{
+		return;
+	}
+	node = data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+	len = size - 12;
+
+	if (node >= dirdbNum)
+	{
+		uint32_t i, newnum = (node + FREE_MINSIZE) & ~(FREE_MINSIZE - 1);
+		struct dirdbEntry *temp = realloc (dirdbData, newnum * sizeof (dirdbData[0]));
+		if (!temp)
+		{
+			fprintf (stderr, "dirdbInit: realloc() failed\n");
+			return;
+		}
+		dirdbData = temp;
+		memset (dirdbData + dirdbNum, 0, (newnum - dirdbNum) * sizeof (dirdbData[0]));
+		for (i = dirdbNum; i < newnum; i++)
+		{
+			dirdbData[i].parent = DIRDB_NOPARENT;
+			dirdbData[i].mdb_ref = DIRDB_NO_MDBREF;
+			dirdbData[i].newmdb_ref = DIRDB_NO_MDBREF;
+		}
+		dirdbNum = newnum;
+	}
+
+	free (dirdbData[node].name);
+	dirdbData[node].name = 0;
+	dirdbData[node].parent = DIRDB_NOPARENT;
+	dirdbData[node].mdb_ref = DIRDB_NO_MDBREF;
+
+	if (!len)
+	{
+		return;
+	}
+
+	dirdbData[node].name = malloc (len + 1);
+	if (!dirdbData[node].name)
+	{
+		fprintf (stderr, "dirdbInit: malloc() failed\n");
+		return;
+	}
+	memcpy (dirdbData[node].name, data + 12, len);
+	dirdbData[node].name[len] = 0;
+	dirdbData[node].parent = data[4] | (data[5] << 8) | (data[6] << 16) | ((uint32_t)data[7] << 24);
+	/* If mdb has been reset, we need to clear all references */
+	dirdbData[node].mdb_ref = mdbCleanSlate ? DIRDB_NO_MDBREF : (data[8] | (data[9] << 8) | (data[10] << 16) | ((uint32_t)data[11] << 24));
+}
+
 int dirdbInit (const struct configAPI_t *configAPI)
 {
 	struct dirdbheader header;
@@ -223,24 +309,34 @@ int dirdbInit (const struct configAPI_t *configAPI)
 #endif
 
 	dirdbFile = osfile_open_readwrite (dirdbPath, 1, 0);
-	free (dirdbPath);
-	dirdbPath = 0;
 	if (!dirdbFile)
 	{
+		free (dirdbPath);
 		return 1;
 	}
 
+	/* this can restore CPDIRDB.DAT if we crashed during a compaction, so it must be opened before parsing */
+	strcpy (dirdbPath + strlen (dirdbPath) - 3, "JNL");
+	dirdbJournal = dbJournalOpen (dirdbPath, dirdbFile);
+	free (dirdbPath);
+	dirdbPath = 0;
+
+	if (mdbCleanSlate)
+	{ /* all the stored mdb_ref values are invalid */
+		dirdbDirty = 1;
+	}
+
 	if ( osfile_read (dirdbFile, &header, sizeof(header)) != sizeof(header) )
 	{
-		fprintf(stderr, "Empty\n");
-		return 1;
+		fprintf(stderr, "Empty, ");
+		goto replay;
 	}
 	if (memcmp(header.sig, dirdbsigv1, 60))
 	{
 		if (memcmp(header.sig, dirdbsigv2, 60))
 		{
-			fprintf(stderr, "Invalid header\n");
-			return 1;
+			fprintf(stderr, "Invalid header, ");
+			goto replay;
 		} else {
 			version = 2;
 		}
@@ -299,13 +395,6 @@ int dirdbInit (const struct configAPI_t *configAPI)
 				goto endoffile;
 			}
 			dirdbData[i].name[len]=0; /* terminate the string */
-			if (dirdbData[i].mdb_ref!=DIRDB_NO_MDBREF)
-			{
-				dirdbData[i].refcount++;
-#ifdef DIRDB_DEBUG
-				dirdbData[i].refcount_mdb_medialib++;
-#endif
-			}
 		} else {
 			dirdbData[i].parent = DIRDB_NOPARENT;
 			dirdbData[i].mdb_ref = DIRDB_NO_MDBREF;
@@ -326,6 +415,12 @@ endoffile:
 		}
 	}
 
+replay:
+	if (dirdbJournal)
+	{
+		dbJournalReplay (dirdbJournal, dirdbInit_Apply, 0);
+	}
+
 	/* Search for orphaned entries (invalid parent), recursive until database appears healthy */
 	while (1)
 	{
@@ -359,9 +454,17 @@ endoffile:
 		}
 	}
 
-	/* Reference the parents */
+	/* Reference the parents and mdb entries */
 	for (i=0; i<dirdbNum; i++)
 	{
+		if ((dirdbData[i].name) && (dirdbData[i].mdb_ref != DIRDB_NO_MDBREF))
+		{
+			dirdbData[i].refcount++;
+#ifdef DIRDB_DEBUG
+			dirdbData[i].refcount_mdb_medialib++;
+#endif
+		}
+
 		if (dirdbData[i].parent != DIRDB_NOPARENT)
 		{
 			dirdbData[dirdbData[i].parent].refcount++;
@@ -503,6 +606,15 @@ outofmemory:
 void dirdbClose(void)
 {
 	uint32_t i;
+	free (dirdbDirtyMap);
+	dirdbDirtyMap = 0;
+	dirdbDirtyMapSize = 0;
+	dirdbDirtyMapAny = 0;
+	if (dirdbJournal)
+	{
+		dbJournalClose (dirdbJournal);
+		dirdbJournal = 0;
+	}
 	if (dirdbFile)
 	{
 		osfile_close (dirdbFile);
@@ -733,7 +845,7 @@ uint32_t dirdbFindAndRef(uint32_t parent, char const *name, enum dirdb_use use)
 			{
 				dirdbRef(parent, dirdb_use_children);
 			}
-			dirdbDirty=1;
+			dirdbMarkDirty (node);
 		}
 	}
 	dirdbData[node].refcount++;
@@ -1304,7 +1416,7 @@ void dirdbUnref(uint32_t node, enum dirdb_use use)
 		return;
 	}
 	/* fprintf(stderr, "DELETE\n");*/
-	dirdbDirty=1;
+	dirdbMarkDirty (node);
 	parent = dirdbData[node].parent;
 
 	if (parent == DIRDB_NOPARENT)
@@ -1466,18 +1578,128 @@ void dirdbGetFullname_malloc(uint32_t node, char **name, int flags)
 	}
 }
 
-void dirdbFlush(void)
+/* serialize all the nodes into the CPDIRDB.DAT format */
+static uint8_t *dirdbFlush_Image (uint32_t *imagesize)
 {
 	uint32_t i;
 	uint32_t max;
-	uint16_t buf16;
-	uint32_t buf32;
+	uint64_t size;
+	uint8_t *image, *dst;
 	struct dirdbheader header;
 
-	if ((!dirdbDirty) || (!dirdbFile))
-		return;
+	max=0;
+	for (i=0;i<dirdbNum;i++)
+		if (dirdbData[i].name)
+			max=i+1;
 
-	osfile_setpos (dirdbFile, 0);
+	size = sizeof (header);
+	for (i=0;i<max;i++)
+	{
+		size += 2;
+		if (dirdbData[i].name)
+		{
+			size += 12 + strlen (dirdbData[i].name);
+		}
+	}
+	if (size > UINT32_MAX)
+	{
+		fprintf (stderr, "dirdbFlush: database too big\n");
+		return 0;
+	}
+	image = malloc (size);
+	if (!image)
+	{
+		fprintf (stderr, "dirdbFlush: malloc() failed\n");
+		return 0;
+	}
+
+	memcpy(header.sig, dirdbsigv2, sizeof(dirdbsigv2));
+	header.entries=uint32_little(max);
+	memcpy (image, &header, sizeof (header));
+	dst = image + sizeof (header);
+
+	for (i=0;i<max;i++)
+	{
+		int len=(dirdbData[i].name?strlen(dirdbData[i].name):0);
+		dst[0] = len;
+		dst[1] = len >> 8;
+		dst += 2;
+		if (len)
+		{
+			dst[0] = dirdbData[i].parent;
+			dst[1] = dirdbData[i].parent >> 8;
+			dst[2] = dirdbData[i].parent >> 16;
+			dst[3] = dirdbData[i].parent >> 24;
+			dst[4] = dirdbData[i].mdb_ref;
+			dst[5] = dirdbData[i].mdb_ref >> 8;
+			dst[6] = dirdbData[i].mdb_ref >> 16;
+			dst[7] = dirdbData[i].mdb_ref >> 24;
+#warning remove-me this used to be ADB_REF
+			dst[8] = 0xff; //ADB_REF
+			dst[9] = 0xff;
+			dst[10] = 0xff;
+			dst[11] = 0xff;
+			memcpy (dst + 12, dirdbData[i].name, len);
+			dst += 12 + len;
+		}
+	}
+
+	*imagesize = size;
+	return image;
+}
+
+/* append a record to the journal for each node in dirdbDirtyMap, returns non-zero on error */
+static int dirdbFlush_Journal (void)
+{
+	uint32_t i;
+
+	for (i=0; (i<dirdbNum) && (i<dirdbDirtyMapSize); i++)
+	{
+		uint32_t len;
+		uint8_t *dst;
+
+		if (!dirdbDirtyMap[i>>3])
+		{
+			i |= 0x07;
+			continue;
+		}
+		if (!(dirdbDirtyMap[i>>3] & (1 << (i & 0x07))))
+		{
+			continue;
+		}
+
+		len = dirdbData[i].name ? strlen (dirdbData[i].name) : 0;
+		dst = dbJournalReserve (dirdbJournal, DIRDB_JOURNAL_NODE, 12 + len);
+		if (!dst)
+		{
+			return -1;
+		}
+		dst[ 0] = i;
+		dst[ 1] = i >> 8;
+		dst[ 2] = i >> 16;
+		dst[ 3] = i >> 24;
+		dst[ 4] = dirdbData[i].parent;
+		dst[ 5] = dirdbData[i].parent >> 8;
+		dst[ 6] = dirdbData[i].parent >> 16;
+		dst[ 7] = dirdbData[i].parent >> 24;
+		dst[ 8] = dirdbData[i].mdb_ref;
+		dst[ 9] = dirdbData[i].mdb_ref >> 8;
+		dst[10] = dirdbData[i].mdb_ref >> 16;
+		dst[11] = dirdbData[i].mdb_ref >> 24;
+		memcpy (dst + 12, dirdbData[i].name, len);
+	}
+
+	return dbJournalFlush (dirdbJournal);
+}
+
+void dirdbFlush(void)
+{
+	uint32_t i;
+	uint8_t *image;
+	uint32_t imagesize;
+
+	if (((!dirdbDirty) && (!dirdbDirtyMapAny)) || (!dirdbFile))
+		return;
 
 	for (i=0;i<dirdbNum;i++)
 	{
@@ -1495,43 +1717,49 @@ void dirdbFlush(void)
 		}
 	}
 
-	max=0;
-	for (i=0;i<dirdbNum;i++)
-		if (dirdbData[i].name)
-			max=i+1;
-
-	memcpy(header.sig, dirdbsigv2, sizeof(dirdbsigv2));
-	header.entries=uint32_little(max);
+	if (dirdbJournal && (!dirdbDirty) && (!dbJournalNeedCompact (dirdbJournal)))
+	{
+		if (!dirdbFlush_Journal ())
+		{
+			goto done;
+		}
+		/* fall back to rewriting everything */
+	}
 
-	if (osfile_write (dirdbFile, &header, sizeof(header)) != sizeof(header) )
+	image = dirdbFlush_Image (&imagesize);
+	if (!image)
+	{
 		goto writeerror;
-
-	for (i=0;i<max;i++)
+	}
+	if (dirdbJournal)
 	{
-		int len=(dirdbData[i].name?strlen(dirdbData[i].name):0);
-		buf16=uint16_little(len);
-		if ( osfile_write (dirdbFile, &buf16, sizeof(uint16_t)) != sizeof(uint16_t) )
+		if (dbJournalCompact (dirdbJournal, dirdbFile, image, imagesize))
+		{
+			free (image);
 			goto writeerror;
-		if (len)
+		}
+	} else {
+		osfile_setpos (dirdbFile, 0);
+		if ((osfile_write (dirdbFile, image, imagesize) < 0) || (osfile_purge_writeback_cache (dirdbFile) < 0))
 		{
-			buf32=uint32_little(dirdbData[i].parent);
-			if ( osfile_write (dirdbFile, &buf32, sizeof(uint32_t)) != sizeof(uint32_t) )
-				goto writeerror;
-			buf32=uint32_little(dirdbData[i].mdb_ref);
-			if ( osfile_write (dirdbFile, &buf32, sizeof(uint32_t)) != sizeof(uint32_t) )
-				goto writeerror;
-#warning remove-me this used to be ADB_REF
-			buf32=0xffffffff; //ADB_REF
-			if ( osfile_write (dirdbFile, &buf32, sizeof(uint32_t)) != sizeof(uint32_t) )
-				goto writeerror;
-			if ( osfile_write (dirdbFile, dirdbData[i].name, len) != len )
-				goto writeerror;
+			free (image);
+			goto writeerror;
 		}
+		osfile_truncate_at (dirdbFile, imagesize);
 	}
+	free (image);
+
+done:
 	dirdbDirty=0;
+	if (dirdbDirtyMapAny)
+	{
+		memset (dirdbDirtyMap, 0, dirdbDirtyMapSize / 8);
+		dirdbDirtyMapAny = 0;
+	}
 	return;
 writeerror:
-	{}
+	fprintf (stderr, "dirdbFlush: failed to write CPDIRDB.DAT\n");
+	dirdbDirty=1;
 }
 
 uint32_t dirdbGetParentAndRef (uint32_t node, enum dirdb_use use)
@@ -1656,6 +1884,7 @@ static void _dirdbTagRemoveUntaggedAndSubmit(const uint32_t *nodes, const uint32
 				dirdbUnref(node, dirdb_use_mdb_medialib);
 			}
 		} else {
+			dirdbMarkDirty (node);
 			if (dirdbData[node].mdb_ref == DIRDB_NO_MDBREF)
 			{
 				dirdbData[node].mdb_ref = dirdbData[node].newmdb_ref;
@@ -1725,6 +1954,32 @@ void dirdbTagPreserveTree(uint32_t node)
 	}
 }
 
+static void _dirdbTagCancelTree(const uint32_t * const nodes, const uint32_t nodecount)
+{
+	uint32_t i;
+
+	for (i = 0; i < nodecount; i++)
+	{
+		uint32_t node = nodes[i];
+		_dirdbTagCancelTree (dirdbData[node].children, dirdbData[node].children_fill);
+		if (dirdbData[node].newmdb_ref != DIRDB_NO_MDBREF)
+		{
+			dirdbData[node].newmdb_ref = DIRDB_NO_MDBREF;
+			dirdbUnref (node, dirdb_use_mdb_medialib);
+		}
+	}
+}
+
+void dirdbTagCancelTree(uint32_t node)
+{
+	if ((node>=dirdbNum) || (!dirdbData[node].name))
+	{
+		fprintf(stderr, "dirdbTagCancelTree: invalid node\n");
+		return;
+	}
+	_dirdbTagCancelTree (dirdbData[node].children, dirdbData[node].children_fill);
+}
+
 void dirdbTagRemoveUntaggedAndSubmit(void)
 {
 	if (tagparentnode != DIRDB_NOPARENT)
@@ -1738,7 +1993,6 @@ void dirdbTagRemoveUntaggedAndSubmit(void)
 		dirdbUnref (tagparentnode, dirdb_use_mdb_medialib);
 	}
 	tagparentnode=DIRDB_NOPARENT;
-	dirdbDirty=1;
 }
 
 int dirdbGetMdb(uint32_t *dirdbnode, uint32_t *mdb_ref, int *first)
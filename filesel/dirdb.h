@@ -81,6 +81,7 @@ uint32_t dirdbGetParentAndRef(uint32_t node, enum dirdb_use use);
  */
 extern void dirdbTagSetParent(uint32_t node);
 extern void dirdbTagPreserveTree(uint32_t node); /* used if we want delete only a part of a tree, but preserve the rest */
+extern void dirdbTagCancelTree(uint32_t node); /* undo dirdbTagPreserveTree() and dirdbMakeMdbRef() for the given sub-tree, used before it is scanned again */
 extern void dirdbMakeMdbRef(uint32_t node, uint32_t mdbref);
 extern void dirdbTagCancel(void);
 extern void dirdbTagRemoveUntaggedAndSubmit(void);
@@ -22,10 +22,16 @@
 #include "config.h"
 #include <assert.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <iconv.h>
+#if !defined(_WIN32)
+# include <pthread.h>
+#endif
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "types.h"
 #include "adbmeta.h"
 #include "dirdb.h"
@@ -58,6 +64,10 @@ static int do_zip_debug_print=1;
 #define MAX_SIZE_OF_CENTRAL_DIRECTORY (16*1024*1024)
 #define MAX_NUMBER_OF_DISKS 1000
 
+#define ZIP_PREFETCH_SIZE    65536 /* matches the first cache-line of filesystem-filehandle-cache.c, enough for mdbReadInfo() */
+#define ZIP_PREFETCH_MAX     64    /* files per batch */
+#define ZIP_PREFETCH_THREADS 4
+
 struct zip_instance_t;
 
 struct zip_instance_dir_t
@@ -92,6 +102,9 @@ struct zip_instance_file_t
 
 	uint32_t                     LocalHeaderSize;
 
+	uint8_t                     *prefetch; /* the first prefetch_fill bytes of the file, made by zip_prefetch_heads(). The next filehandle takes ownership of it */
+	uint32_t                     prefetch_fill;
+
 /* Not needed - above points to the PK header which contains this information when needed
 	uint16_t                     method;
 	uint16_t                     flags;
@@ -104,6 +117,10 @@ struct zip_instance_filehandle_t
 	struct zip_instance_file_t  *file;
 	struct zip_instance_t       *owner;
 	int                          error;
+	int                          io;       /* zip_filehandle_setup() has been performed */
+
+	uint8_t                     *prefetch; /* served by zip_filehandle_read_prefetch() until a read goes outside of it */
+	uint32_t                     prefetch_fill;
 
 	uint64_t                     filepos; /* user-pos */
 	uint64_t                     curpos;  /* last known position... if missmatch we need to either skip and/or reset */
@@ -749,6 +766,8 @@ static uint32_t zip_instance_add_file (struct zip_instance_t *self,
 	self->files[self->file_fill].compressed_filesize             = CompressedSize;
 	self->files[self->file_fill].compressed_fileoffset_startdisk = OffsetLocalHeader;
 	self->files[self->file_fill].compressed_startdisk            = DiskNumber;
+	self->files[self->file_fill].prefetch      = 0;
+	self->files[self->file_fill].prefetch_fill = 0;
 
 	prev = &self->dirs[dir_parent]->file_child;
 	for (iter = *prev; iter != UINT32_MAX; iter = self->files[iter].file_next)
@@ -1268,6 +1287,7 @@ static void zip_instance_unref (struct zip_instance_t *self)
 	{
 		dirdbUnref (self->files[counter].head.dirdb_ref, dirdb_use_file);
 		free (self->files[counter].orig_full_filepath);
+		free (self->files[counter].prefetch);
 	}
 
 	free (self->dirs);
@@ -1309,6 +1329,313 @@ static void zip_instance_unref (struct zip_instance_t *self)
 	free (self);
 }
 
+#if !defined(_WIN32)
+struct zip_prefetch_job_t
+{
+	struct zip_instance_file_t *file;
+	uint64_t                    offset; /* of the local header */
+	uint64_t                    compressed_filesize;
+	uint64_t                    uncompressed_filesize;
+
+	/* result */
+	uint8_t                    *data;
+	uint32_t                    fill;
+	uint32_t                    LocalHeaderSize;
+};
+
+struct zip_prefetch_t
+{
+	const char                *path;
+	struct zip_prefetch_job_t *jobs;
+	int                        count;
+	int                        next; /* next job to be picked up by a worker */
+};
+
+/* Runs in a worker thread, so it can only use the file-descriptor it is given - no dirdb, no ocpfilehandle_t */
+static void zip_prefetch_job (int fd, struct zip_prefetch_job_t *job, uint8_t *in, const uint32_t insize)
+{
+	uint16_t GeneralPurposeFlags;
+	uint16_t CompressionMethod;
+	uint64_t diskpos;
+	uint64_t compressed_left;
+	uint32_t want;
+	ssize_t  fill;
+	int32_t  header;
+
+	fill = pread (fd, in, insize, job->offset);
+	if (fill <= 0)
+	{
+		return;
+	}
+	if ((header = local_file_header (in, fill, &GeneralPurposeFlags, &CompressionMethod)) < 0)
+	{
+		return;
+	}
+	if (GeneralPurposeFlags & 0x0001)
+	{ /* encrypted */
+		return;
+	}
+
+	want = (job->uncompressed_filesize < ZIP_PREFETCH_SIZE) ? job->uncompressed_filesize : ZIP_PREFETCH_SIZE;
+	if ((!want) || (!(job->data = malloc (want))))
+	{
+		return;
+	}
+	job->LocalHeaderSize = header;
+
+	diskpos = job->offset + fill;
+	fill -= header;
+	compressed_left = job->compressed_filesize;
+	if (fill > compressed_left)
+	{
+		fill = compressed_left;
+	}
+	compressed_left -= fill;
+
+	switch (CompressionMethod)
+	{
+		case 0: /* stored */
+			if (fill > want)
+			{
+				fill = want;
+			}
+			memcpy (job->data, in + header, fill);
+			job->fill = fill;
+			if (job->fill < want)
+			{
+				fill = pread (fd, job->data + job->fill, want - job->fill, diskpos);
+				if (fill > 0)
+				{
+					job->fill += fill;
+				}
+			}
+			break;
+
+		case 8: /* deflate */
+		{
+			z_stream strm;
+			int res;
+
+			memset (&strm, 0, sizeof (strm));
+			if (inflateInit2 (&strm, -15))
+			{
+				break;
+			}
+			strm.next_in = in + header;
+			strm.avail_in = fill;
+			strm.next_out = job->data;
+			strm.avail_out = want;
+			while (strm.avail_out)
+			{
+				if ((!strm.avail_in) && compressed_left)
+				{
+					fill = pread (fd, in, (compressed_left < insize) ? compressed_left : insize, diskpos);
+					if (fill <= 0)
+					{
+						break;
+					}
+					diskpos += fill;
+					compressed_left -= fill;
+					strm.next_in = in;
+					strm.avail_in = fill;
+				}
+				res = inflate (&strm, Z_SYNC_FLUSH);
+				if (res != Z_OK)
+				{ /* Z_STREAM_END, or an error that the real decoder will report again */
+					break;
+				}
+			}
+			job->fill = want - strm.avail_out;
+			inflateEnd (&strm);
+			break;
+		}
+
+		default: /* the rest are rare, and are decoded on demand */
+			break;
+	}
+
+	if (!job->fill)
+	{
+		free (job->data);
+		job->data = 0;
+	}
+}
+
+static void *zip_prefetch_thread (void *token)
+{
+	struct zip_prefetch_t *p = token;
+	uint8_t *in;
+	int fd;
+	int i;
+
+	if ((fd = open (p->path, O_RDONLY)) < 0)
+	{
+		return 0;
+	}
+	if (!(in = malloc (65536)))
+	{
+		close (fd);
+		return 0;
+	}
+	while ((i = __atomic_fetch_add (&p->next, 1, __ATOMIC_RELAXED)) < p->count)
+	{
+		zip_prefetch_job (fd, p->jobs + i, in, 65536);
+	}
+	free (in);
+	close (fd);
+	return 0;
+}
+
+/* Prefetches the start of the given files, they must all belong to the same instance */
+static void zip_instance_prefetch (struct zip_instance_t *self, struct zip_instance_file_t **files, int count)
+{
+	struct zip_prefetch_t p;
+	pthread_t threads[ZIP_PREFETCH_THREADS];
+	int threadcount;
+	char *path = 0;
+	struct stat st;
+	int i, j;
+
+	if ((self->archive_file->compression != COMPRESSION_NONE) || (self->Total_number_of_disks > 1))
+	{ /* workers need a plain file they can open by themselves */
+		return;
+	}
+
+	dirdbGetFullname_malloc (self->archive_file->dirdb_ref, &path, DIRDB_FULLNAME_DRIVE);
+	if ((!path) || strncmp (path, "file:", 5) || stat (path + 5, &st) || (st.st_size != self->archive_file->filesize (self->archive_file)))
+	{
+		free (path);
+		return;
+	}
+
+	/* data from earlier batches that was never used should not pile up */
+	for (i = 0; i < self->file_fill; i++)
+	{
+		if (!self->files[i].prefetch)
+		{
+			continue;
+		}
+		for (j = 0; (j < count) && (files[j] != &self->files[i]); j++);
+		if (j == count)
+		{
+			free (self->files[i].prefetch);
+			self->files[i].prefetch = 0;
+			self->files[i].prefetch_fill = 0;
+		}
+	}
+
+	p.path = path + 5;
+	p.count = 0;
+	p.next = 0;
+	p.jobs = calloc (count, sizeof (p.jobs[0]));
+	if (!p.jobs)
+	{
+		free (path);
+		return;
+	}
+	for (i = 0; i < count; i++)
+	{
+		if (files[i]->prefetch || (!files[i]->uncompressed_filesize))
+		{
+			continue;
+		}
+		p.jobs[p.count].file                  = files[i];
+		p.jobs[p.count].offset                = files[i]->compressed_fileoffset_startdisk;
+		p.jobs[p.count].compressed_filesize   = files[i]->compressed_filesize;
+		p.jobs[p.count].uncompressed_filesize = files[i]->uncompressed_filesize;
+		p.count++;
+	}
+	count = p.count;
+	if (!count)
+	{
+		free (p.jobs);
+		free (path);
+		return;
+	}
+
+	threadcount = sysconf (_SC_NPROCESSORS_ONLN);
+	if (threadcount > ZIP_PREFETCH_THREADS)
+	{
+		threadcount = ZIP_PREFETCH_THREADS;
+	}
+	if (threadcount > count)
+	{
+		threadcount = count;
+	}
+	for (i = 0; i < threadcount; i++)
+	{
+		if (pthread_create (&threads[i], 0, zip_prefetch_thread, &p))
+		{
+			break;
+		}
+	}
+	threadcount = i;
+	if (!threadcount)
+	{ /* no threads available, do the work here instead */
+		zip_prefetch_thread (&p);
+	}
+	for (i = 0; i < threadcount; i++)
+	{
+		pthread_join (threads[i], 0);
+	}
+
+	for (i = 0; i < count; i++)
+	{
+		if (p.jobs[i].data)
+		{
+			p.jobs[i].file->prefetch        = p.jobs[i].data;
+			p.jobs[i].file->prefetch_fill   = p.jobs[i].fill;
+			p.jobs[i].file->LocalHeaderSize = p.jobs[i].LocalHeaderSize;
+		}
+	}
+
+	free (p.jobs);
+	free (path);
+}
+#endif
+
+void zip_prefetch_heads (struct ocpfile_t **files, int count)
+{
+#if !defined(_WIN32)
+	struct zip_instance_file_t *batch[ZIP_PREFETCH_MAX];
+	uint8_t done[ZIP_PREFETCH_MAX];
+	int i, j, n;
+
+	if (count > ZIP_PREFETCH_MAX)
+	{
+		count = ZIP_PREFETCH_MAX;
+	}
+	memset (done, 0, count);
+
+	/* group the files by instance */
+	for (i = 0; i < count; i++)
+	{
+		struct zip_instance_t *owner;
+
+		if (done[i] || (!files[i]) || (files[i]->unref != zip_file_unref))
+		{
+			continue;
+		}
+		owner = ((struct zip_instance_file_t *)files[i])->owner;
+		for (n = 0, j = i; j < count; j++)
+		{
+			struct zip_instance_file_t *file = (struct zip_instance_file_t *)files[j];
+
+			if (done[j] || (!files[j]) || (files[j]->unref != zip_file_unref) || (file->owner != owner))
+			{
+				continue;
+			}
+			done[j] = 1;
+			batch[n++] = file;
+		}
+		if (n > 1)
+		{ /* a single file gains nothing from worker threads */
+			zip_instance_prefetch (owner, batch, n);
+		}
+	}
+#endif
+}
+
 static struct ocpdirdecompressor_t zipdecompressor =
 {
 	"zip",
@@ -2097,10 +2424,10 @@ static int zip_filehandle_read_bzip2 (struct ocpfilehandle_t *_self, void *dst,
 	return retval;
 }
 
-static struct ocpfilehandle_t *zip_file_open (struct ocpfile_t *_self)
+/* reads the local header and prepares the decoder, returns non-zero on error */
+static int zip_filehandle_setup (struct zip_instance_filehandle_t *retval)
 {
-	struct zip_instance_file_t *self = (struct zip_instance_file_t *)_self;
-	struct zip_instance_filehandle_t *retval;
+	struct zip_instance_file_t *self = retval->file;
 	uint8_t *buffer;
 	int bufferfill;
 	int buffersize;
@@ -2112,12 +2439,12 @@ static struct ocpfilehandle_t *zip_file_open (struct ocpfile_t *_self)
 
 	if (zip_ensure_disk (self->owner, self->compressed_startdisk) < 0)
 	{
-		return 0;
+		return -1;
 	}
 
 	if (self->owner->archive_filehandle->seek_set (self->owner->archive_filehandle, self->compressed_fileoffset_startdisk) < 0)
 	{
-		return 0;
+		return -1;
 	}
 
 	buffersize = 65536;
@@ -2126,7 +2453,7 @@ static struct ocpfilehandle_t *zip_file_open (struct ocpfile_t *_self)
 	if (bufferfill <= 0)
 	{
 		free (buffer);
-		return 0;
+		return -1;
 	}
 
 	if ((r = local_file_header (buffer, bufferfill,
@@ -2134,13 +2461,11 @@ static struct ocpfilehandle_t *zip_file_open (struct ocpfile_t *_self)
 	                            &CompressionMethod)) < 0)
 	{
 		free (buffer);
-		return 0;
+		return -1;
 	}
 
 	self->LocalHeaderSize = r;
 
-	retval = calloc (sizeof (*retval), 1);
-
 	switch (CompressionMethod)
 	{
 		case  0: /* stored */
@@ -2177,8 +2502,7 @@ static struct ocpfilehandle_t *zip_file_open (struct ocpfile_t *_self)
 				retval->inflate_io = 0;
 
 				free (buffer);
-				free (retval);
-				return 0;
+				return -1;
 			}
 			break;
 
@@ -2192,15 +2516,13 @@ static struct ocpfilehandle_t *zip_file_open (struct ocpfile_t *_self)
 				retval->bzip2_io = 0;
 
 				free (buffer);
-				free (retval);
-				return 0;
+				return -1;
 			}
 			break;
 
 		default:
 			free (buffer);
-			free (retval);
-			return 0;
+			return -1;
 	}
 
 	if (bufferfill > (self->compressed_filesize + self->LocalHeaderSize))
@@ -2208,6 +2530,89 @@ static struct ocpfilehandle_t *zip_file_open (struct ocpfile_t *_self)
 		bufferfill = self->compressed_filesize + self->LocalHeaderSize;
 	}
 
+	retval->head.read = zip_filehandle_read;
+	retval->io = 1;
+	retval->in_buffer = buffer;
+	retval->in_buffer_diskpos = 0;
+	retval->in_buffer_size = buffersize;
+	retval->in_buffer_fill = bufferfill - self->LocalHeaderSize;
+	retval->in_buffer_readnext = retval->in_buffer + self->LocalHeaderSize;
+	retval->CurrentDisk       = self->compressed_startdisk;
+	retval->CurrentDiskOffset = self->compressed_fileoffset_startdisk + bufferfill;
+
+	return 0;
+}
+
+/* serves reads from the data made by zip_prefetch_heads(), and switches to the real decoder when needed */
+static int zip_filehandle_read_prefetch (struct ocpfilehandle_t *_self, void *dst, int len)
+{
+	struct zip_instance_filehandle_t *self = (struct zip_instance_filehandle_t *)_self;
+
+	if (self->error)
+	{
+		return -1;
+	}
+
+	/* ensure len is within range */
+	if (len < 0)
+	{
+		return -1;
+	}
+	if ((self->filepos + len) >= self->file->uncompressed_filesize)
+	{
+		len = self->file->uncompressed_filesize - self->filepos;
+	}
+	if (len == 0)
+	{
+		return 0;
+	}
+
+	if ((self->filepos + len) <= self->prefetch_fill)
+	{
+		memcpy (dst, self->prefetch + self->filepos, len);
+		self->filepos += len;
+		return len;
+	}
+
+	DEBUG_PRINT ("[ZIP] zip_filehandle_read_prefetch, read outside the prefetched data, setup the decoder\n");
+	if (zip_filehandle_setup (self))
+	{
+		self->error = 1;
+		return -1;
+	}
+	free (self->prefetch);
+	self->prefetch = 0;
+	self->prefetch_fill = 0;
+
+	return self->head.read (&self->head, dst, len);
+}
+
+static struct ocpfilehandle_t *zip_file_open (struct ocpfile_t *_self)
+{
+	struct zip_instance_file_t *self = (struct zip_instance_file_t *)_self;
+	struct zip_instance_filehandle_t *retval;
+
+	retval = calloc (sizeof (*retval), 1);
+	if (!retval)
+	{
+		return 0;
+	}
+	retval->file = self;
+	retval->owner = self->owner;
+
+	if (self->prefetch)
+	{ /* no I/O needed until a read goes beyond the prefetched data */
+		DEBUG_PRINT ("[ZIP] using prefetched data\n");
+		retval->prefetch = self->prefetch;
+		retval->prefetch_fill = self->prefetch_fill;
+		self->prefetch = 0;
+		self->prefetch_fill = 0;
+	} else if (zip_filehandle_setup (retval))
+	{
+		free (retval);
+		return 0;
+	}
+
 	ocpfilehandle_t_fill (&retval->head,
 	                       zip_filehandle_ref,
 	                       zip_filehandle_unref,
@@ -2216,7 +2621,7 @@ static struct ocpfilehandle_t *zip_file_open (struct ocpfile_t *_self)
 	                       zip_filehandle_getpos,
 	                       zip_filehandle_eof,
 	                       zip_filehandle_error,
-	                       zip_filehandle_read,
+	                       retval->io ? retval->head.read : zip_filehandle_read_prefetch,
 	                       0, /* ioctl */
 	                       zip_filehandle_filesize,
 	                       zip_filehandle_filesize_ready,
@@ -2228,16 +2633,6 @@ static struct ocpfilehandle_t *zip_file_open (struct ocpfile_t *_self)
 	zip_io_ref (self->owner);
 	zip_instance_ref (self->owner);
 
-	retval->file = self;
-	retval->owner = self->owner;
-	retval->in_buffer = buffer;
-	retval->in_buffer_diskpos = 0;
-	retval->in_buffer_size = buffersize;
-	retval->in_buffer_fill = bufferfill - self->LocalHeaderSize;
-	retval->in_buffer_readnext = retval->in_buffer + self->LocalHeaderSize;
-	retval->CurrentDisk       = self->compressed_startdisk;
-	retval->CurrentDiskOffset = self->compressed_fileoffset_startdisk + bufferfill;
-
 	DEBUG_PRINT ("We just created a ZIP handle\n");
 
 	return &retval->head;
@@ -2275,6 +2670,9 @@ static void zip_filehandle_unref (struct ocpfilehandle_t *_self)
 		zip_io_unref (self->owner);
 		zip_instance_unref (self->owner);
 
+		free (self->prefetch);
+		self->prefetch = 0;
+
 		free (self->unshrink_io);
 		self->unshrink_io = 0;
 
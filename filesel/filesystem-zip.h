@@ -3,4 +3,8 @@
 
 void filesystem_zip_register (void);
 
+struct ocpfile_t;
+/* Inflates the start of the given files with worker threads, if they are members of a .ZIP file, so the following mdbScan() of each of them does not need to wait for decompression. Other files are ignored */
+void zip_prefetch_heads (struct ocpfile_t **files, int count);
+
 #endif
@@ -92,6 +92,22 @@ void cp437_f_to_utf8_z(const char *src, size_t srclen, char *dst, size_t dstlen)
 	snprintf (dst, dstlen, "%*s", (int)(MIN(dstlen - 1, srclen-1)), src);
 }
 
+uint64_t profile_now (void)
+{
+	return 0;
+}
+
+int utf8_encoded_length (uint32_t codepoint)
+{
+	return 1;
+}
+
+int utf8_encode (char *dst, uint32_t code)
+{
+	*dst = code;
+	return 1;
+}
+
 const struct dirdbAPI_t dirdbAPI;
 
 static ssize_t mdb_test_read (int *fd, void *buf, size_t size)
@@ -646,6 +662,81 @@ int mdb_basic_mdbGetModuleReference (void)
 	return retval;
 }
 
+static int mdb_dispatch_ReadInfo (struct moduleinfostruct *m, struct ocpfilehandle_t *f, const char *buf, size_t len, const struct mdbReadInfoAPI_t *API)
+{
+	return 0;
+}
+
+static const struct mdbReadInfoSignature mdb_dispatch_sigA[] =
+{
+	{0, 4, "ABCD"},
+	{0, 4, "ABXY"},
+	{0, 0, 0}
+};
+
+static const struct mdbReadInfoSignature mdb_dispatch_sigB[] =
+{
+	{8, 2, "QQ"},
+	{0, 2, "AB"},
+	{0, 0, 0}
+};
+
+static const char * const mdb_dispatch_extC[] = {"XYZ", 0};
+
+int mdb_basic_mdbDispatch (void)
+{
+	int retval = 0;
+	struct mdbreadinforegstruct regA = {"A", mdb_dispatch_ReadInfo, mdb_dispatch_sigA, 0 MDBREADINFOREGSTRUCT_TAIL};
+	struct mdbreadinforegstruct regB = {"B", mdb_dispatch_ReadInfo, mdb_dispatch_sigB, 0 MDBREADINFOREGSTRUCT_TAIL};
+	struct mdbreadinforegstruct regC = {"C", mdb_dispatch_ReadInfo, 0, mdb_dispatch_extC MDBREADINFOREGSTRUCT_TAIL};
+	const struct
+	{
+		const char *buf;
+		int len;
+		const char *filename;
+		int A, B, C;
+	} tests[] =
+	{
+		{"ABCDxxxxxxxx", 12, "test.mod", 1, 1, 0},
+		{"ABXYxxxxQQxx", 12, "test.mod", 1, 1, 0},
+		{"xxxxxxxxQQxx", 12, "test.xyz", 0, 1, 1},
+		{"xxxxxxxxQQxx",  9, "test.mod", 0, 0, 0}, /* signature goes beyond the buffer */
+		{"ABCxxxxxxxxx", 12, 0,          0, 1, 0},
+		{"BBCDxxxxxxxx", 12, "test.XYZ", 0, 0, 1},
+	};
+	int i;
+
+	fprintf (stderr, ANSI_COLOR_CYAN "MDB mdbDispatch (signature and extension dispatch for mdbReadInfo)\n" ANSI_COLOR_RESET);
+
+	mdbRegisterReadInfo (&regA);
+	mdbRegisterReadInfo (&regB);
+	mdbRegisterReadInfo (&regC);
+
+	fprintf (stderr, "Compiled %d distinct offsets: %s\n" ANSI_COLOR_RESET, mdbDispatchOffsetCount, (mdbDispatchOffsetCount == 2) ? ANSI_COLOR_GREEN "OK" : ANSI_COLOR_RED "Failed");
+	retval |= mdbDispatchOffsetCount != 2;
+
+	for (i=0; i < sizeof (tests) / sizeof (tests[0]); i++)
+	{
+		uint32_t stamp = mdbDispatch (tests[i].buf, tests[i].len, tests[i].filename);
+		int A = regA.dispatchstamp == stamp;
+		int B = regB.dispatchstamp == stamp;
+		int C = regC.dispatchstamp == stamp;
+		int failed = (A != tests[i].A) || (B != tests[i].B) || (C != tests[i].C);
+
+		fprintf (stderr, "%.*s %-8s => A=%d B=%d C=%d %s\n" ANSI_COLOR_RESET, tests[i].len, tests[i].buf, tests[i].filename ? tests[i].filename : "(null)", A, B, C, failed ? ANSI_COLOR_RED "Failed" : ANSI_COLOR_GREEN "OK");
+		retval |= failed;
+	}
+
+	mdbUnregisterReadInfo (&regA);
+	mdbUnregisterReadInfo (&regB);
+	mdbUnregisterReadInfo (&regC);
+
+	fprintf (stderr, "Table is released when the last detector leaves: %s\n" ANSI_COLOR_RESET, (!mdbDispatchOffsetCount && !mdbDispatchEntries) ? ANSI_COLOR_GREEN "OK" : ANSI_COLOR_RED "Failed");
+	retval |= mdbDispatchOffsetCount || mdbDispatchEntries;
+
+	return retval;
+}
+
 void mdb_basic_mdbWriteString_prepare (void)
 {
 	mdbDataSize = 256;
@@ -1022,6 +1113,7 @@ void mdb_basic_mdbWriteModuleInfo_mdbGetModuleInfo_finalize (void)
 	free (mdbData);
 	free (mdbDirtyMap);
 	free (mdbSearchIndexData);
+	mdbInfoCacheFlush ();
 }
 
 int mdb_basic_mdbWriteModuleInfo_mdbGetModuleInfo (void)
@@ -1193,6 +1285,43 @@ int mdb_basic_mdbWriteModuleInfo_mdbGetModuleInfo (void)
 	retval |= e;
 	fprintf (stderr, "%s\n" ANSI_COLOR_RESET, e ? "" : ANSI_COLOR_GREEN " OK");
 
+	e=0;
+	fprintf (stderr, "mdbGetModuleInfo() cache is used, and invalidated by mdbWriteModuleInfo():");
+	if (!mdbInfoCacheLookup (r))
+	{
+		fprintf (stderr, ANSI_COLOR_RED " [entry not cached]");
+		e++;
+	}
+	src.channels = 4;
+	if (!mdbWriteModuleInfo (r, &src))
+	{
+		fprintf (stderr, ANSI_COLOR_RED " [mdbWriteModuleInfo() failed]");
+		e++;
+	}
+	if (mdbInfoCacheLookup (r))
+	{
+		fprintf (stderr, ANSI_COLOR_RED " [entry not invalidated]");
+		e++;
+	}
+	if (!mdbGetModuleInfo (&dst, r))
+	{
+		fprintf (stderr, ANSI_COLOR_RED " [mdbGetModuleInfo() failed]");
+		e++;
+	}
+	if (memcmp (&src, &dst, sizeof (src)))
+	{
+		fprintf (stderr, ANSI_COLOR_RED " [src and dst data missmatches]");
+		e++;
+	}
+	dst.channels = 0;
+	if ((!mdbGetModuleInfo (&dst, r)) || memcmp (&src, &dst, sizeof (src)))
+	{
+		fprintf (stderr, ANSI_COLOR_RED " [cached copy missmatches]");
+		e++;
+	}
+	retval |= e;
+	fprintf (stderr, "%s\n" ANSI_COLOR_RESET, e ? "" : ANSI_COLOR_GREEN " OK");
+
 	mdb_basic_mdbWriteModuleInfo_mdbGetModuleInfo_finalize ();
 
 	return retval;
@@ -1707,6 +1836,8 @@ int main (int argc, char *argv[])
 
 	retval |= mdb_basic_mdbGetModuleReference ();
 
+	retval |= mdb_basic_mdbDispatch ();
+
 	retval |= mdb_basic_mdbWriteString ();
 
 	retval |= mdb_basic_mdbGetString ();
@@ -46,6 +46,7 @@
 #endif
 #include "stuff/imsrtns.h"
 #include "stuff/latin1.h"
+#include "stuff/profile.h"
 #include "stuff/utf-16.h"
 #include "stuff/utf-8.h"
 
@@ -130,6 +131,103 @@ static uint32_t            *mdbSearchIndexData;  /* lookup sorted index */
 static uint32_t             mdbSearchIndexCount; /* Number of entries in sorted index */
 static uint32_t             mdbSearchIndexSize;  /* Allocated size in sorted index */
 
+/* Fully decoded moduleinfostruct of the most recently used entries, so that
+ * the file selector can redraw without walking the string records again.
+ * Entries are chained per hash-bucket, index+1 is stored so that zero means
+ * empty. The least recently used entry is evicted on a miss.
+ */
+#define MDB_INFOCACHE_SIZE 256
+#define MDB_INFOCACHE_HASH 512 /* must be power of two */
+
+struct mdbInfoCacheEntry
+{
+	uint32_t mdb_ref; /* zero if unused */
+	uint32_t lastuse;
+	uint16_t hashnext;
+	struct moduleinfostruct info;
+};
+
+static struct mdbInfoCacheEntry mdbInfoCache[MDB_INFOCACHE_SIZE];
+static uint16_t                 mdbInfoCacheHash[MDB_INFOCACHE_HASH];
+static uint32_t                 mdbInfoCacheClock;
+
+static void mdbInfoCacheFlush (void)
+{
+	memset (mdbInfoCache, 0, sizeof (mdbInfoCache));
+	memset (mdbInfoCacheHash, 0, sizeof (mdbInfoCacheHash));
+	mdbInfoCacheClock = 0;
+}
+
+static struct mdbInfoCacheEntry *mdbInfoCacheLookup (uint32_t mdb_ref)
+{
+	uint16_t i = mdbInfoCacheHash[mdb_ref & (MDB_INFOCACHE_HASH - 1)];
+
+	while (i)
+	{
+		struct mdbInfoCacheEntry *e = &mdbInfoCache[i - 1];
+		if (e->mdb_ref == mdb_ref)
+		{
+			return e;
+		}
+		i = e->hashnext;
+	}
+	return 0;
+}
+
+static void mdbInfoCacheUnlink (struct mdbInfoCacheEntry *e)
+{
+	uint16_t *iter = &mdbInfoCacheHash[e->mdb_ref & (MDB_INFOCACHE_HASH - 1)];
+	uint16_t self = e - mdbInfoCache + 1;
+
+	while (*iter != self)
+	{
+		iter = &mdbInfoCache[*iter - 1].hashnext;
+	}
+	*iter = e->hashnext;
+	e->hashnext = 0;
+	e->mdb_ref = 0;
+}
+
+static void mdbInfoCacheInvalidate (uint32_t mdb_ref)
+{
+	struct mdbInfoCacheEntry *e = mdbInfoCacheLookup (mdb_ref);
+
+	if (e)
+	{
+		mdbInfoCacheUnlink (e);
+	}
+}
+
+static void mdbInfoCacheInsert (uint32_t mdb_ref, const struct moduleinfostruct *m)
+{
+	struct mdbInfoCacheEntry *e = &mdbInfoCache[0];
+	uint16_t *bucket = &mdbInfoCacheHash[mdb_ref & (MDB_INFOCACHE_HASH - 1)];
+	int i;
+
+	for (i=0; i < MDB_INFOCACHE_SIZE; i++)
+	{
+		if (!mdbInfoCache[i].mdb_ref)
+		{
+			e = &mdbInfoCache[i];
+			break;
+		}
+		if (mdbInfoCache[i].lastuse < e->lastuse)
+		{
+			e = &mdbInfoCache[i];
+		}
+	}
+	if (e->mdb_ref)
+	{
+		mdbInfoCacheUnlink (e);
+	}
+
+	e->mdb_ref = mdb_ref;
+	e->lastuse = ++mdbInfoCacheClock;
+	e->info = *m;
+	e->hashnext = *bucket;
+	*bucket = e - mdbInfoCache + 1;
+}
+
 int mdbGetModuleType (uint32_t mdb_ref, struct moduletype *dst)
 {
 	if (mdb_ref>=mdbDataSize)
@@ -172,12 +270,186 @@ int mdbInfoIsAvailable (uint32_t mdb_ref)
 /* This thing will end up with a register of all valid pre-interprators for modules and friends
  */
 static struct mdbreadinforegstruct *mdbReadInfos=NULL;
+
+/* Signatures of all the registered detectors, compiled into one table sorted by
+ * offset and first byte. For each distinct offset, first[byte] gives the range
+ * of entries to compare against.
+ */
+struct mdbDispatchEntry
+{
+	const struct mdbReadInfoSignature *signature;
+	struct mdbreadinforegstruct *r;
+};
+
+struct mdbDispatchOffset
+{
+	uint16_t offset;
+	uint32_t first[257];
+};
+
+static struct mdbDispatchEntry  *mdbDispatchEntries;
+static struct mdbDispatchOffset *mdbDispatchOffsets;
+static int                       mdbDispatchOffsetCount;
+static uint32_t                  mdbDispatchStamp;
+
+static int mdbDispatchCompare (const void *_a, const void *_b)
+{
+	const struct mdbDispatchEntry *a = _a;
+	const struct mdbDispatchEntry *b = _b;
+
+	if (a->signature->offset != b->signature->offset)
+	{
+		return (int)a->signature->offset - (int)b->signature->offset;
+	}
+	return (int)(uint8_t)a->signature->magic[0] - (int)(uint8_t)b->signature->magic[0];
+}
+
+static void mdbDispatchCompile (void)
+{
+	struct mdbreadinforegstruct *iter;
+	const struct mdbReadInfoSignature *s;
+	uint32_t count = 0, i;
+
+	free (mdbDispatchEntries);
+	free (mdbDispatchOffsets);
+	mdbDispatchEntries = 0;
+	mdbDispatchOffsets = 0;
+	mdbDispatchOffsetCount = 0;
+
+	for (iter=mdbReadInfos; iter; iter=iter->next)
+	{
+		for (s=iter->signatures; s && s->length; s++)
+		{
+			count++;
+		}
+	}
+	if (!count)
+	{
+		return;
+	}
+
+	mdbDispatchEntries = malloc (sizeof (mdbDispatchEntries[0]) * count);
+	mdbDispatchOffsets = malloc (sizeof (mdbDispatchOffsets[0]) * count);
+	if ((!mdbDispatchEntries) || (!mdbDispatchOffsets))
+	{
+		fprintf (stderr, "mdbDispatchCompile: malloc() failed, signature dispatch disabled\n");
+		free (mdbDispatchEntries);
+		free (mdbDispatchOffsets);
+		mdbDispatchEntries = 0;
+		mdbDispatchOffsets = 0;
+		return;
+	}
+
+	count = 0;
+	for (iter=mdbReadInfos; iter; iter=iter->next)
+	{
+		for (s=iter->signatures; s && s->length; s++)
+		{
+			mdbDispatchEntries[count].signature = s;
+			mdbDispatchEntries[count].r = iter;
+			count++;
+		}
+	}
+	qsort (mdbDispatchEntries, count, sizeof (mdbDispatchEntries[0]), mdbDispatchCompare);
+
+	for (i=0; i < count; )
+	{
+		struct mdbDispatchOffset *d = &mdbDispatchOffsets[mdbDispatchOffsetCount++];
+		uint32_t end;
+		int b;
+
+		d->offset = mdbDispatchEntries[i].signature->offset;
+		for (end=i; (end < count) && (mdbDispatchEntries[end].signature->offset == d->offset); end++)
+		{
+		}
+		/* first[b] is the first entry at this offset with magic[0] >= b */
+		for (b=0; b <= 256; b++)
+		{
+			while ((i < end) && ((uint8_t)mdbDispatchEntries[i].signature->magic[0] < b))
+			{
+				i++;
+			}
+			d->first[b] = i;
+		}
+		i = end;
+	}
+
+	DEBUG_PRINT ("mdbDispatchCompile() => %"PRIu32" signatures at %d distinct offsets\n", count, mdbDispatchOffsetCount);
+}
+
+static int mdbExtensionMatch (const char * const *extensions, const char *filename)
+{
+	const char *ext;
+
+	if (!filename)
+	{
+		return 0;
+	}
+	if (!(ext = strrchr (filename, '.')))
+	{
+		return 0;
+	}
+	ext++;
+	for (; *extensions; extensions++)
+	{
+		if (!strcasecmp (ext, *extensions))
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* marks all the detectors that can handle the given buffer/filename with a new dispatchstamp, and returns the stamp */
+static uint32_t mdbDispatch (const char *buf, int len, const char *filename)
+{
+	struct mdbreadinforegstruct *iter;
+	int o;
+
+	mdbDispatchStamp++;
+
+	for (o=0; o < mdbDispatchOffsetCount; o++)
+	{
+		const struct mdbDispatchOffset *d = &mdbDispatchOffsets[o];
+		uint32_t i;
+		uint8_t b;
+
+		if (d->offset >= len)
+		{
+			break;
+		}
+		b = buf[d->offset];
+		for (i=d->first[b]; i < d->first[b + 1]; i++)
+		{
+			const struct mdbReadInfoSignature *s = mdbDispatchEntries[i].signature;
+
+			if (((s->offset + s->length) <= len) &&
+			    (!memcmp (buf + s->offset, s->magic, s->length)))
+			{
+				mdbDispatchEntries[i].r->dispatchstamp = mdbDispatchStamp;
+			}
+		}
+	}
+
+	for (iter=mdbReadInfos; iter; iter=iter->next)
+	{
+		if (iter->extensions && (iter->dispatchstamp != mdbDispatchStamp) && mdbExtensionMatch (iter->extensions, filename))
+		{
+			iter->dispatchstamp = mdbDispatchStamp;
+		}
+	}
+
+	return mdbDispatchStamp;
+}
+
 void mdbRegisterReadInfo (struct mdbreadinforegstruct *r)
 {
 	DEBUG_PRINT ("mdbRegisterReadInfo(%s)\n", r->name);
 
 	r->next=mdbReadInfos;
 	mdbReadInfos=r;
+
+	mdbDispatchCompile ();
 }
 
 void mdbUnregisterReadInfo (struct mdbreadinforegstruct *r)
@@ -191,6 +463,7 @@ void mdbUnregisterReadInfo (struct mdbreadinforegstruct *r)
 			DEBUG_PRINT ("mdbUnregisterReadInfo(%s)\n", r->name);
 
 			*prev = iter->next;
+			mdbDispatchCompile ();
 			return;
 		}
 		prev = &iter->next;
@@ -209,10 +482,37 @@ static const struct mdbReadInfoAPI_t mdbReadInfoAPI =
 	utf8_encode,
 	&dirdbAPI
 };
+static int mdbReadInfoRun (struct mdbreadinforegstruct *rinfos, struct moduleinfostruct *m, struct ocpfilehandle_t *f, const char *buf, int len, uint32_t stamp)
+{
+	uint64_t start;
+	int retval;
+
+	if (!rinfos->ReadInfo)
+	{
+		return 0;
+	}
+	if ((rinfos->signatures || rinfos->extensions) && (rinfos->dispatchstamp != stamp))
+	{
+		return 0;
+	}
+
+	start = profile_now ();
+	retval = rinfos->ReadInfo(m, f, buf, len, &mdbReadInfoAPI);
+	rinfos->time_us += profile_now () - start;
+	rinfos->calls++;
+	if (retval)
+	{
+		rinfos->hits++;
+	}
+	return retval;
+}
+
 int mdbReadInfo (struct moduleinfostruct *m, struct ocpfilehandle_t *f)
 {
 	char mdbScanBuf[4096];
 	struct mdbreadinforegstruct *rinfos;
+	const char *filename = 0;
+	uint32_t stamp;
 	int maxl;
 
 	DEBUG_PRINT ("mdbReadInfo(f=%p)\n", f);
@@ -236,15 +536,15 @@ int mdbReadInfo (struct moduleinfostruct *m, struct ocpfilehandle_t *f)
 
 	m->modtype.integer.i = mtUnRead;
 
+	dirdbGetName_internalstr (f->dirdb_ref, &filename);
+	stamp = mdbDispatch (mdbScanBuf, maxl, filename);
+
 	/* slow version that also allows more I/O */
 	for (rinfos=mdbReadInfos; rinfos; rinfos=rinfos->next)
 	{
-		if (rinfos->ReadInfo)
+		if (mdbReadInfoRun (rinfos, m, f, mdbScanBuf, maxl, stamp))
 		{
-			if (rinfos->ReadInfo(m, f, mdbScanBuf, maxl, &mdbReadInfoAPI))
-			{
-				return 1;
-			}
+			return 1;
 		}
 	}
 
@@ -259,15 +559,16 @@ int mdbReadInfo (struct moduleinfostruct *m, struct ocpfilehandle_t *f)
 			maxl = ancient->read (ancient, mdbScanBuf, sizeof (mdbScanBuf));
 			ancient->seek_set (ancient, 0);
 
+			filename = 0;
+			dirdbGetName_internalstr (ancient->dirdb_ref, &filename);
+			stamp = mdbDispatch (mdbScanBuf, maxl, filename);
+
 			for (rinfos=mdbReadInfos; rinfos; rinfos=rinfos->next)
 			{
-				if (rinfos->ReadInfo)
+				if (mdbReadInfoRun (rinfos, m, ancient, mdbScanBuf, maxl, stamp))
 				{
-					if (rinfos->ReadInfo(m, ancient, mdbScanBuf, maxl, &mdbReadInfoAPI))
-					{
-						ancient->unref (ancient);
-						return 1;
-					}
+					ancient->unref (ancient);
+					return 1;
 				}
 			}
 
@@ -373,6 +674,7 @@ static void mdbFree (uint32_t ref, int size)
 
 	for (j = 0; j < size; j++)
 	{
+		mdbInfoCacheInvalidate (ref + j);
 		memset (mdbData + ref + j, 0, sizeof (mdbData[0]));
 		mdbDirty=1;
 		mdbDirtyMap[(ref + j)>>3] |= 1 << ((ref + j) & 0x07);
@@ -466,6 +768,8 @@ int mdbWriteModuleInfo (uint32_t mdb_ref, struct moduleinfostruct *m)
 	assert (mdb_ref < mdbDataSize);
 	assert (mdbData[mdb_ref].mie.general.record_flags == MDB_USED);
 
+	mdbInfoCacheInvalidate (mdb_ref);
+
 	/* ensure that there is only zeroes after a possible zero-termination */
 	if (!m->modtype.string.c[0]) m->modtype.string.c[1] = 0;
 	if (!m->modtype.string.c[1]) m->modtype.string.c[2] = 0;
@@ -560,6 +864,8 @@ int mdbInit (const struct configAPI_t *configAPI)
 	uint32_t i;
 	int retval = 1;
 
+	mdbInfoCacheFlush ();
+
 	mdbData = 0;
 	mdbDataSize = 0;
 	mdbDataNextFree = 0;
@@ -781,6 +1087,15 @@ void mdbUpdate (void)
 
 void mdbClose (void)
 {
+#ifdef MDB_DEBUG
+	struct mdbreadinforegstruct *rinfos;
+
+	for (rinfos=mdbReadInfos; rinfos; rinfos=rinfos->next)
+	{
+		DEBUG_PRINT ("mdbReadInfo %-12s %s calls=%"PRIu32" hits=%"PRIu32" time=%"PRIu64"us\n", rinfos->name, (rinfos->signatures || rinfos->extensions) ? "dispatched" : "generic   ", rinfos->calls, rinfos->hits, rinfos->time_us);
+	}
+#endif
+
 	mdbUpdate();
 	if (mdbFile)
 	{
@@ -800,6 +1115,8 @@ void mdbClose (void)
 	mdbSearchIndexData = 0;
 	mdbSearchIndexCount = 0;
 	mdbSearchIndexSize = 0;
+
+	mdbInfoCacheFlush ();
 }
 
 /* Unit test available */
@@ -974,6 +1291,8 @@ static void mdbGetString (char *dst, int dstlen, uint32_t mdb_ref)
 /* Partially unit test in mdbInit */
 int mdbGetModuleInfo (struct moduleinfostruct *m, uint32_t mdb_ref)
 {
+	struct mdbInfoCacheEntry *e;
+
 	memset (m, 0, sizeof(*m));
 	assert (mdb_ref > 0);
 	assert (mdb_ref < mdbDataSize);
@@ -983,6 +1302,13 @@ int mdbGetModuleInfo (struct moduleinfostruct *m, uint32_t mdb_ref)
 	{ /* invalid reference */
 		return 0;
 	}
+
+	if ((e = mdbInfoCacheLookup (mdb_ref)))
+	{
+		e->lastuse = ++mdbInfoCacheClock;
+		*m = e->info;
+		return 1;
+	}
 	m->size = mdbData[mdb_ref].mie.general.size;
 	m->modtype = mdbData[mdb_ref].mie.general.modtype;
 	m->flags = mdbData[mdb_ref].mie.general.module_flags;
@@ -995,5 +1321,7 @@ int mdbGetModuleInfo (struct moduleinfostruct *m, uint32_t mdb_ref)
 	mdbGetString (m->style,    sizeof (m->style),    mdbData[mdb_ref].mie.general.style_ref);
 	mdbGetString (m->comment,  sizeof (m->comment),  mdbData[mdb_ref].mie.general.comment_ref);
 	mdbGetString (m->album,    sizeof (m->album),    mdbData[mdb_ref].mie.general.album_ref);
+
+	mdbInfoCacheInsert (mdb_ref, m);
 	return 1;
 }
@@ -64,12 +64,28 @@ struct mdbReadInfoAPI_t
 };
 
 
+struct mdbReadInfoSignature
+{
+	uint16_t offset; /* position in the scan buffer */
+	uint8_t length; /* zero terminates the list */
+	const char *magic;
+};
+
 struct mdbreadinforegstruct /* this is to test a file, and give it a tag..*/
 {
 	const char *name; /* for debugging */
 	// buf includes the first 1084 byte of the file, enought to include signature in .MOD files */
 	int (*ReadInfo)(struct moduleinfostruct *m, struct ocpfilehandle_t *f, const char *buf, size_t len, const struct mdbReadInfoAPI_t *API);
+	/* Optional. If signatures and/or extensions are given, ReadInfo is only called if one of them match, so they must cover every file ReadInfo can detect */
+	const struct mdbReadInfoSignature *signatures;
+	const char * const *extensions; /* upper-case, without the dot, NULL terminated */
 	struct mdbreadinforegstruct *next;
+
+	/* statistics, maintained by mdbReadInfo() */
+	uint32_t calls;
+	uint32_t hits;
+	uint64_t time_us;
+	uint32_t dispatchstamp; /* private */
 };
 
 #define MDBREADINFOREGSTRUCT_TAIL ,0
@@ -85,6 +85,8 @@ struct modlistentry *modlist_get (const struct modlist *modlist, unsigned int in
 	return &modlist->files[modlist->sortindex[index]];
 }
 
+static void mlecmp_key (struct modlistentry *e);
+
 static void _modlist_append (struct modlist *modlist, struct modlistentry *entry) /* steals entry->utf8_casefolded */
 {
 	if (!entry)
@@ -114,6 +116,7 @@ static void _modlist_append (struct modlist *modlist, struct modlistentry *entry
 	}
 	modlist->files[modlist->num] = *entry;
 	modlist->sortindex[modlist->num] = modlist->num;
+	mlecmp_key (&modlist->files[modlist->num]);
 
 	if (entry->file)
 	{
@@ -416,7 +419,6 @@ int modlist_fuzzyfind(struct modlist *modlist, const char *filename)
 	return retval;
 }
 
-static struct modlist *sorting;
 static int mlecmp_score (const struct modlistentry *e1)
 {
 	int i1;
@@ -447,12 +449,49 @@ static int mlecmp_score (const struct modlistentry *e1)
 
 	return i1;
 }
-static int mlecmp (const void *a, const void *b)
+
+/* The sort key packs the score (inverted, so higher scores sort first) and
+ * the first bytes of the name, so that most comparisons are resolved by
+ * comparing two integers. Entries with identical keys are resolved by mlecmp().
+ *
+ * strverscmp() compares digits as numbers, so the name prefix stops at the
+ * first digit. The digit is stored as '0' (no non-digit byte sorts between
+ * '0' and '9'), and the rest of the key is left zero.
+ */
+static void mlecmp_key (struct modlistentry *e)
 {
-	int _1 = *(int *)a;
-	int _2 = *(int *)b;
-	const struct modlistentry *e1 = &sorting->files[_1];
-	const struct modlistentry *e2 = &sorting->files[_2];
+	const unsigned char *src;
+	uint8_t key[MODLIST_SORTKEY_SIZE] = {0};
+	int drive = e->flags & MODLIST_FLAG_DRV;
+	int i, j;
+
+	key[0] = 255 - mlecmp_score (e);
+
+	src = (const unsigned char *)(drive ? e->utf8_16_dot_3 : e->utf8_casefolded);
+	for (i = 1; src && *src && (i < MODLIST_SORTKEY_SIZE); i++, src++)
+	{
+		if ((!drive) && (*src >= '0') && (*src <= '9'))
+		{
+			key[i] = '0';
+			break;
+		}
+		key[i] = *src;
+	}
+
+	for (i = 0; i < 2; i++)
+	{
+		e->sortkey[i] = 0;
+		for (j = 0; j < 8; j++)
+		{
+			e->sortkey[i] = (e->sortkey[i] << 8) | key[i * 8 + j];
+		}
+	}
+}
+
+static int mlecmp (const struct modlist *ml, int _1, int _2)
+{
+	const struct modlistentry *e1 = &ml->files[_1];
+	const struct modlistentry *e2 = &ml->files[_2];
 
 	int i1 = mlecmp_score (e1);
 	int i2 = mlecmp_score (e2);
@@ -485,12 +524,26 @@ static int mlecmp (const void *a, const void *b)
 	return strverscmp(n1, n2);
 }
 
-static int mlecmp_filesonly_groupdir (const void *a, const void *b)
+static int mlecmp_sortkey (const struct modlist *ml, int _1, int _2)
 {
-	int _1 = *(int *)a;
-	int _2 = *(int *)b;
-	const struct modlistentry *e1 = &sorting->files[_1];
-	const struct modlistentry *e2 = &sorting->files[_2];
+	const struct modlistentry *e1 = &ml->files[_1];
+	const struct modlistentry *e2 = &ml->files[_2];
+
+	if (e1->sortkey[0] != e2->sortkey[0])
+	{
+		return (e1->sortkey[0] < e2->sortkey[0]) ? -1 : 1;
+	}
+	if (e1->sortkey[1] != e2->sortkey[1])
+	{
+		return (e1->sortkey[1] < e2->sortkey[1]) ? -1 : 1;
+	}
+	return mlecmp (ml, _1, _2);
+}
+
+static int mlecmp_filesonly_groupdir (const struct modlist *ml, int _1, int _2)
+{
+	const struct modlistentry *e1 = &ml->files[_1];
+	const struct modlistentry *e2 = &ml->files[_2];
 
 	int i1 = mlecmp_score (e1);
 	int i2 = mlecmp_score (e2);
@@ -525,24 +578,230 @@ static int mlecmp_filesonly_groupdir (const void *a, const void *b)
 	return strcasecmp(n1, n2);
 }
 
+/* stable merge sort of index[0..n-1], tmp must hold n entries */
+static void modlist_mergesort (const struct modlist *ml, int *index, int *tmp, unsigned int n, int (*cmp)(const struct modlist *ml, int _1, int _2))
+{
+	unsigned int half, i, j, k;
+
+	if (n <= 16)
+	{
+		for (i = 1; i < n; i++)
+		{
+			int v = index[i];
+			for (j = i; j && (cmp (ml, index[j - 1], v) > 0); j--)
+			{
+				index[j] = index[j - 1];
+			}
+			index[j] = v;
+		}
+		return;
+	}
+
+	half = n / 2;
+	modlist_mergesort (ml, index, tmp, half, cmp);
+	modlist_mergesort (ml, index + half, tmp, n - half, cmp);
+
+	if (cmp (ml, index[half - 1], index[half]) <= 0)
+	{ /* already in order */
+		return;
+	}
+
+	memcpy (tmp, index, half * sizeof (index[0]));
+	for (i = 0, j = half, k = 0; (i < half) && (j < n); k++)
+	{
+		if (cmp (ml, index[j], tmp[i]) < 0)
+		{
+			index[k] = index[j++];
+		} else {
+			index[k] = tmp[i++];
+		}
+	}
+	memcpy (index + k, tmp + i, (half - i) * sizeof (index[0]));
+}
+
+struct modlist_sortpair
+{
+	uint64_t key;
+	int index;
+};
+
+/* Sorts index[0..n-1]: LSD radix sort on the sort keys, followed by mlecmp() on each run of identical keys. Returns non-zero on out of memory */
+static int modlist_keysort (const struct modlist *ml, int *index, unsigned int n)
+{
+	struct modlist_sortpair *a, *b, *t;
+	uint32_t histogram[8][256];
+	unsigned int i, j;
+	int word, pass;
+
+	if (n < 2)
+	{
+		return 0;
+	}
+
+	a = malloc (n * sizeof (a[0]));
+	b = malloc (n * sizeof (b[0]));
+	if ((!a) || (!b))
+	{
+		free (a);
+		free (b);
+		return -1;
+	}
+
+	for (i = 0; i < n; i++)
+	{
+		a[i].index = index[i];
+	}
+
+	/* least significant word first, the passes are stable */
+	for (word = 1; word >= 0; word--)
+	{
+		memset (histogram, 0, sizeof (histogram));
+		for (i = 0; i < n; i++)
+		{
+			uint64_t key = ml->files[a[i].index].sortkey[word];
+			a[i].key = key;
+			for (pass = 0; pass < 8; pass++)
+			{
+				histogram[pass][(key >> (pass * 8)) & 0xff]++;
+			}
+		}
+
+		for (pass = 0; pass < 8; pass++)
+		{
+			uint32_t sum = 0;
+			if (histogram[pass][(a[0].key >> (pass * 8)) & 0xff] == n)
+			{ /* all entries share this byte */
+				continue;
+			}
+			for (j = 0; j < 256; j++)
+			{
+				uint32_t c = histogram[pass][j];
+				histogram[pass][j] = sum;
+				sum += c;
+			}
+			for (i = 0; i < n; i++)
+			{
+				b[histogram[pass][(a[i].key >> (pass * 8)) & 0xff]++] = a[i];
+			}
+			t = a; a = b; b = t;
+		}
+	}
+
+	for (i = 0; i < n; i++)
+	{
+		index[i] = a[i].index;
+	}
+
+	/* resolve runs of identical keys, b is reused as scratch space */
+	for (i = 0; i < n; i = j)
+	{
+		const struct modlistentry *e = &ml->files[index[i]];
+		for (j = i + 1; j < n; j++)
+		{
+			const struct modlistentry *f = &ml->files[index[j]];
+			if ((e->sortkey[0] != f->sortkey[0]) || (e->sortkey[1] != f->sortkey[1]))
+			{
+				break;
+			}
+		}
+		if ((j - i) > 1)
+		{
+			modlist_mergesort (ml, index + i, (int *)b, j - i, mlecmp);
+		}
+	}
+
+	free (a);
+	free (b);
+	return 0;
+}
+
 void modlist_sort (struct modlist *modlist)
 {
-	sorting = modlist; /* dirty HACK that is not thread-safe / reentrant what so ever */
-	qsort(modlist->sortindex, modlist->num, sizeof(modlist->sortindex[0]), mlecmp);
-	sorting = 0;
+	int *tmp;
+
+	if (!modlist_keysort (modlist, modlist->sortindex, modlist->num))
+	{
+		return;
+	}
+
+	/* out of memory, fall back to sorting without the radix pass */
+	if (!(tmp = malloc (modlist->num * sizeof (tmp[0]))))
+	{
+		fprintf (stderr, "modlist_sort: out of memory\n");
+		return;
+	}
+	modlist_mergesort (modlist, modlist->sortindex, tmp, modlist->num, mlecmp_sortkey);
+	free (tmp);
 }
 
 void modlist_subsort_filesonly_groupdir (struct modlist *modlist, unsigned int pos, unsigned int length)
 {
+	int *tmp;
+
 	if ((pos >= modlist->num) ||
 	    (length > modlist->num) ||
 	    ((pos + length) > modlist->num))
 	{
 		return;
 	}
-	sorting = modlist; /* dirty HACK that is not thread-safe / reentrant what so ever */
-	qsort(modlist->sortindex + pos, length, sizeof(modlist->sortindex[0]), mlecmp_filesonly_groupdir);
-	sorting = 0;
+	if (!(tmp = malloc (length * sizeof (tmp[0]))))
+	{
+		fprintf (stderr, "modlist_subsort_filesonly_groupdir: out of memory\n");
+		return;
+	}
+	modlist_mergesort (modlist, modlist->sortindex + pos, tmp, length, mlecmp_filesonly_groupdir);
+	free (tmp);
+}
+
+unsigned int modlist_sort_insert (struct modlist *modlist, unsigned int first)
+{
+	unsigned int count, lowest, i, j, w;
+	int *tail;
+
+	if (first >= modlist->num)
+	{
+		return modlist->num;
+	}
+	count = modlist->num - first;
+	if (!(tail = malloc (count * sizeof (tail[0]))))
+	{ /* out of memory, fall back to a full sort */
+		modlist_sort (modlist);
+		return 0;
+	}
+
+	memcpy (tail, modlist->sortindex + first, count * sizeof (tail[0]));
+	if (modlist_keysort (modlist, tail, count))
+	{
+		free (tail);
+		modlist_sort (modlist);
+		return 0;
+	}
+
+	/* merge from the back, the sorted head only needs to move once */
+	lowest = modlist->num;
+	i = first;
+	j = count;
+	w = modlist->num;
+	while (j)
+	{
+		w--;
+		if (i && (mlecmp_sortkey (modlist, modlist->sortindex[i - 1], tail[j - 1]) > 0))
+		{
+			i--;
+			modlist->sortindex[w] = modlist->sortindex[i];
+			if (modlist->pos == i)
+			{
+				modlist->pos = w;
+			}
+		} else {
+			j--;
+			modlist->sortindex[w] = tail[j];
+			lowest = w;
+		}
+	}
+
+	free (tail);
+	return lowest;
 }
 
 struct modlist *modlist_create (void)
@@ -10,6 +10,9 @@ struct modlistentry
 	char utf8_16_dot_3 [20*4+1]; /* UTF-8 ready */
 	char *utf8_casefolded;
 
+#define MODLIST_SORTKEY_SIZE 16
+	uint64_t sortkey[MODLIST_SORTKEY_SIZE / 8]; /* computed by modlist_append*(), see mlecmp_key() */
+
 #define MODLIST_FLAG_DRV     1
 #define MODLIST_FLAG_DOTDOT  2
 #define MODLIST_FLAG_SCANNED 4
@@ -39,6 +42,7 @@ struct modlist *modlist_create(void);
 void modlist_free(struct modlist *modlist);
 void modlist_sort(struct modlist *modlist);
 void modlist_subsort_filesonly_groupdir (struct modlist *modlist, unsigned int pos, unsigned int length); /* sorts a slice of the list */
+unsigned int modlist_sort_insert (struct modlist *modlist, unsigned int first); /* merges entries appended since first into an already sorted list, pos follows its entry. Returns the lowest position that received a new entry */
 void modlist_append(struct modlist *modlist, struct modlistentry *entry);
 void modlist_append_dir (struct modlist *modlist, struct ocpdir_t *dir);
 void modlist_append_dotdot (struct modlist *modlist, struct ocpdir_t *dir);
@@ -125,6 +125,8 @@ static struct DevInterfaceAPI_t DevInterfaceAPI;
 
 static void fsForceNextRescan(void); /* Next time fsFileSelect() is called, force a rescan */
 
+static void fsReadDir_file (void *_token, struct ocpfile_t *file);
+
 struct fsReadDir_token_t
 {
 #if 0
@@ -139,7 +141,71 @@ struct fsReadDir_token_t
 	char           *parent_displaydir;
 
 	struct ocpfilehandle_t *fileretain; /* hack to keep one file open in archives, to ensure they remain open while scanning their content */
+
+	int             background; /* content of archives is queued for fsScanDirStep() instead of being scanned behind a modal box */
+};
+
+/* The listing of currentdir is done in the background: fsScanDir() starts it,
+ * and fsScanDirStep() advances it from the idle part of fsFileSelect() until
+ * the next frame is due. Arriving entries are merged into the sorted list.
+ * Content of archives (fsPutArcs) is scanned the same way by stacking the
+ * flat directory handle on top of the one currently iterated.
+ */
+#define FSSCANDIR_MAXDEPTH 8
+struct fsScanDirLevel_t
+{
+	struct ocpdir_t         *dir;
+	ocpdirhandle_pt          dh;
+	int                      done;
+	struct fsReadDir_token_t token;
 };
+static struct fsScanDirLevel_t fsScanDirLevel[FSSCANDIR_MAXDEPTH];
+static int fsScanDirLevels; /* zero if no background scan is in progress */
+
+static int fsScanDirPush (struct fsReadDir_token_t *token, struct ocpdir_t *dir)
+{
+	struct fsScanDirLevel_t *l;
+
+	if (fsScanDirLevels >= FSSCANDIR_MAXDEPTH)
+	{
+		return 0;
+	}
+
+	l = &fsScanDirLevel[fsScanDirLevels];
+	l->token = *token;
+	l->token.parent_displaydir = 0;
+	l->token.fileretain = 0;
+	l->done = 0;
+	if (!(l->dh = dir->readflatdir_start (dir, fsReadDir_file, &l->token)))
+	{
+		return 0;
+	}
+	dir->ref (dir);
+	l->dir = dir;
+	fsScanDirLevels++;
+	return 1;
+}
+
+static void fsScanDirPop (void)
+{
+	struct fsScanDirLevel_t *l = &fsScanDirLevel[--fsScanDirLevels];
+
+	l->dir->readdir_cancel (l->dh);
+	l->dh = 0;
+	if (l->token.fileretain)
+	{
+		l->token.fileretain->unref (l->token.fileretain);
+		l->token.fileretain = 0;
+	}
+#ifndef FNM_CASEFOLD
+	if (!fsScanDirLevels)
+	{
+		free (l->token.mask); /* shared by all the levels */
+	}
+#endif
+	l->dir->unref (l->dir);
+	l->dir = 0;
+}
 
 static void fsReadDir_file (void *_token, struct ocpfile_t *file)
 {
@@ -174,7 +240,10 @@ static void fsReadDir_file (void *_token, struct ocpfile_t *file)
 				{
 					fsReadDir (token->ml, dir, token->mask, token->opt);
 				}
-				if ((!dir->is_playlist) && fsPutArcs && dir->readflatdir_start)
+				if ((!dir->is_playlist) && fsPutArcs && dir->readflatdir_start && token->background)
+				{
+					fsScanDirPush (token, dir);
+				} else if ((!dir->is_playlist) && fsPutArcs && dir->readflatdir_start)
 				{
 					unsigned int mlTop=plScrHeight/2-2;
 					unsigned int i;
@@ -356,6 +425,7 @@ int fsReadDir (struct modlist *ml, struct ocpdir_t *dir, const char *mask, unsig
 #endif
 	token.opt = opt & ~(RD_SUBSORT);
 	token.fileretain = 0;
+	token.background = 0;
 
 	if ((opt & RD_PUTRSUBS) && dir->readflatdir_start)
 	{
@@ -908,6 +978,7 @@ static short editfilepos=0;
 static short editdirpos=0;
 static short editmode=0;
 static unsigned int scanposf, scanposp;
+static unsigned int scanprefetchfirst, scanprefetchlast; /* range of currentdir that has been given to zip_prefetch_heads() */
 static int win = 0;
 
 int fsListScramble=1;
@@ -940,13 +1011,152 @@ static void fsForceNextRescan(void) /* Next time fsFileSelect() is called, force
 	fsFileSelect_ForceRescan = 1;
 }
 
+static uint32_t fsScanDirTarget = DIRDB_CLEAR; /* entry to place the cursor on when it arrives, DIRDB_CLEAR for the top of the list */
+static int fsScanDirFallback = -1; /* position to use if fsScanDirTarget never arrives */
+static int fsScanDirHold; /* non-zero while the cursor is still placed by the scan and not by the user */
+static unsigned int fsScanDirPos; /* cursor position as left by the scan, used to detect that the user has moved it */
+
+static void fsScanDirRelease (void)
+{
+	if (fsScanDirTarget != DIRDB_CLEAR)
+	{
+		dirdbUnref (fsScanDirTarget, dirdb_use_pfilesel);
+		fsScanDirTarget = DIRDB_CLEAR;
+	}
+	fsScanDirFallback = -1;
+	fsScanDirHold = 0;
+}
+
+static void fsScanDirCancel (void)
+{
+	if (!fsScanDirLevels)
+	{
+		return;
+	}
+	while (fsScanDirLevels)
+	{
+		fsScanDirPop ();
+	}
+	fsScanDirRelease ();
+	adbMetaCommit ();
+}
+
+/* returns non-zero if poll_framelock() fired, and the frame should not be waited for */
+static int fsScanDirStep (void)
+{
+	unsigned int first = currentdir->num;
+	int polled = 0;
+
+	if (!fsScanDirLevels)
+	{
+		return 0;
+	}
+
+	if (fsScanDirHold && (currentdir->pos != fsScanDirPos))
+	{ /* user has moved the cursor, stop placing it */
+		fsScanDirRelease ();
+	}
+
+	while (fsScanDirLevels)
+	{
+		struct fsScanDirLevel_t *l = &fsScanDirLevel[fsScanDirLevels - 1];
+
+		if (l->done)
+		{
+			fsScanDirPop ();
+			continue;
+		}
+		/* iterate can push a new level, so only flag it as done here */
+		if (!l->dir->readdir_iterate (l->dh))
+		{
+			l->done = 1;
+		}
+		if (poll_framelock ())
+		{
+			polled = 1;
+			break;
+		}
+	}
+
+	if (currentdir->num > first)
+	{
+		unsigned int lowest = modlist_sort_insert (currentdir, first);
+
+		/* entries that arrived in front of the prescan position must be scanned too */
+		if ((scanposf != ~0u) && (lowest < scanposf))
+		{
+			scanposf = lowest;
+		}
+		scanprefetchfirst = scanprefetchlast = 0;
+	}
+
+	if (fsScanDirHold)
+	{
+		if (fsScanDirTarget == DIRDB_CLEAR)
+		{
+			currentdir->pos = 0;
+		} else {
+			int newpos = modlist_find (currentdir, fsScanDirTarget);
+			if (newpos >= 0)
+			{
+				currentdir->pos = newpos;
+				fsScanDirRelease (); /* from now on, the cursor follows the entry */
+			} else if ((!fsScanDirLevels) && (fsScanDirFallback >= 0))
+			{
+				currentdir->pos = fsScanDirFallback;
+				/* if position is out of range, adjust it */
+				if (currentdir->pos >= currentdir->num)
+				{
+					currentdir->pos = currentdir->num ? currentdir->num - 1 : 0;
+				}
+			}
+		}
+	}
+	fsScanDirPos = currentdir->pos;
+
+	if (!fsScanDirLevels)
+	{
+		fsScanDirRelease ();
+		adbMetaCommit ();
+	}
+
+	return polled;
+}
+
+static void fsScanDirSelect (uint32_t dirdb_ref) /* place the cursor on the given entry, now or when it arrives */
+{
+	int pos = modlist_find (currentdir, dirdb_ref);
+
+	if (pos >= 0)
+	{
+		currentdir->pos = pos;
+		fsScanDirPos = pos;
+		fsScanDirRelease ();
+		return;
+	}
+	if (!fsScanDirLevels)
+	{
+		return;
+	}
+	fsScanDirRelease ();
+	dirdbRef (dirdb_ref, dirdb_use_pfilesel);
+	fsScanDirTarget = dirdb_ref;
+	fsScanDirHold = 1;
+	fsScanDirPos = currentdir->pos;
+}
+
 static char fsScanDir (int op)
 {
+	struct fsReadDir_token_t *token;
+	struct ocpdir_t *dir = dmCurDrive->cwd;
+	struct dmDrive *d;
 	uint32_t dirdb_ref = DIRDB_CLEAR;
-	int pos;
+	int pos = 0;
 
 	fsFileSelect_ForceRescan = 0;
 
+	fsScanDirCancel ();
+
 	 /* if we are to maintain the old position, store both the dirdb reference and the position as fall-back */
 	if (op == 1)
 	{
@@ -968,53 +1178,64 @@ static char fsScanDir (int op)
 	}
 
 	modlist_clear (currentdir);
+	currentdir->pos = 0;
 	nextplay=0;
 
+	quickfind[0] = 0;
+	quickfindlen = 0;
+	scanposf=fsScanNames?0:~0;
+	scanprefetchfirst = scanprefetchlast = 0;
+
 #ifdef _WIN32
 	filesystem_windows_refresh_drives();
 #endif
 
-	if (!fsReadDir (currentdir, dmCurDrive->cwd, curmask, RD_PUTDRIVES | RD_PUTSUBS | (fsScanArcs?RD_ARCSCAN:0)))
+	for (d=dmDrives; d; d=d->next)
 	{
-		if (dirdb_ref != DIRDB_CLEAR)
-		{
-			dirdbUnref (dirdb_ref, dirdb_use_pfilesel);
-		}
-		modlist_sort(currentdir);
-		return 0;
+		modlist_append_drive (currentdir, d);
+	}
+	if (dir->parent) /* we only add dotdot, if we add drives */
+	{
+		modlist_append_dotdot (currentdir, dir->parent);
 	}
+	modlist_sort (currentdir);
 
-	modlist_sort(currentdir);
+	token = &fsScanDirLevel[0].token;
+	token->ml = currentdir;
+	token->cancel_recursive = 0;
+	token->parent_displaydir = 0;
+#ifndef FNM_CASEFOLD
+	token->mask = strupr(strdup (curmask));
+#else
+	token->mask = curmask;
+#endif
+	token->opt = RD_PUTSUBS | (fsScanArcs?RD_ARCSCAN:0);
+	token->fileretain = 0;
+	token->background = 1;
+	fsScanDirLevel[0].done = 0;
 
-	/* if we are to maintain position, attempt one is to find the previous dirdb reference */
-	if (op == 1)
+	if (!(fsScanDirLevel[0].dh = dir->readdir_start (dir, fsReadDir_file, fsReadDir_dir, token)))
 	{
-		int newpos = modlist_find (currentdir, dirdb_ref);
-		/* if unable to find, fallback to the same position */
-		if (newpos < 0)
+#ifndef FNM_CASEFOLD
+		free (token->mask);
+#endif
+		if (dirdb_ref != DIRDB_CLEAR)
 		{
-			newpos = pos;
-			/* if position is out of range, adjust it */
-			if (newpos >= currentdir->num)
-			{
-				newpos = currentdir->num ? currentdir->num - 1 : 0;
-			}
+			dirdbUnref (dirdb_ref, dirdb_use_pfilesel);
 		}
-		currentdir->pos = newpos;
-	} else {
-		currentdir->pos = 0;
+		return 0;
 	}
+	dir->ref (dir);
+	fsScanDirLevel[0].dir = dir;
+	fsScanDirLevels = 1;
 
-	quickfind[0] = 0;
-	quickfindlen = 0;
-	scanposf=fsScanNames?0:~0;
-
-	adbMetaCommit ();
+	fsScanDirTarget = dirdb_ref; /* reference is handed over */
+	fsScanDirFallback = (op == 1) ? pos : -1;
+	fsScanDirHold = 1;
+	fsScanDirPos = currentdir->pos;
 
-	if (dirdb_ref != DIRDB_CLEAR)
-	{
-		dirdbUnref (dirdb_ref, dirdb_use_pfilesel);
-	}
+	/* head start, small directories are complete before the first redraw */
+	fsScanDirStep ();
 
 	return 1;
 }
@@ -1403,6 +1624,7 @@ void fsClose(void)
 {
 	if (currentdir)
 	{
+		fsScanDirCancel ();
 		modlist_free(currentdir);
 		currentdir=NULL;
 	}
@@ -2276,6 +2498,10 @@ static void fsShowDir(unsigned int firstv, unsigned int selectv, unsigned int fi
 		displaychr (2, 0,               0x07, 0xc4, plScrWidth - 15);
 		displaychr (2, plScrWidth - 15, 0x07, 0xc2, 1);
 		displaychr (2, plScrWidth - 14, 0x07, 0xc4, 14);
+		if (fsScanDirLevels)
+		{
+			displaystr (2, 2, 0x09, " scanning directory... ", 23);
+		}
 	}
 
 	if (fsEditWin||(selecte>=0)||(selectd>=0))
@@ -3834,6 +4060,31 @@ static void fsDraw(void)
 	/* we do not paint any of the edits from the fsFileSelect() state */
 }
 
+/* give the next files in currentdir that are going to be scanned to the archive decompressors, so they can prepare them in parallel */
+static void fsScanPrefetch (unsigned int pos)
+{
+	struct ocpfile_t *files[32];
+	int count = 0;
+
+	if ((pos >= scanprefetchfirst) && (pos < scanprefetchlast))
+	{
+		return;
+	}
+
+	scanprefetchfirst = pos;
+	for (; (pos < currentdir->num) && (count < 32); pos++)
+	{
+		struct modlistentry *m = modlist_get (currentdir, pos);
+		if (m && m->file && (m->file->compression < COMPRESSION_REMOTE) && (m->flags & MODLIST_FLAG_ISMOD) && (!(m->flags & MODLIST_FLAG_SCANNED)) && (!mdbInfoIsAvailable (m->mdb_ref)))
+		{
+			files[count++] = m->file;
+		}
+	}
+	scanprefetchlast = pos;
+
+	zip_prefetch_heads (files, count);
+}
+
 signed int fsFileSelect(void)
 {
 	int state = 0;
@@ -3964,7 +4215,14 @@ superbreak:
 			state = 0;
 		}
 
-		if (!Console.KeyboardHit() && fsScanNames)
+		if (!Console.KeyboardHit() && fsScanDirLevels)
+		{
+			if (!fsScanDirStep ())
+			{
+				framelock();
+			}
+			continue;
+		} else if (!Console.KeyboardHit() && fsScanNames)
 		{
 			int poll = 1;
 			if ((m->file && (m->file->compression < COMPRESSION_REMOTE) && (m->flags & MODLIST_FLAG_ISMOD)) && (!mdbInfoIsAvailable(m->mdb_ref)) && (!(m->flags&MODLIST_FLAG_SCANNED)))
@@ -3982,6 +4240,7 @@ superbreak:
 					{
 						if (!mdbInfoIsAvailable(scanm->mdb_ref))
 						{
+							fsScanPrefetch (scanposf - 1);
 							mdbScan(scanm->file, scanm->mdb_ref, 0);
 							scanm->flags |= MODLIST_FLAG_SCANNED;
 
@@ -4223,7 +4482,6 @@ superbreak:
 						if (m->dir)
 						{
 							uint32_t olddirpath = dmCurDrive->cwd->dirdb_ref;
-							unsigned int i;
 
 							dirdbRef (olddirpath, dirdb_use_pfilesel);
 
@@ -4240,11 +4498,7 @@ superbreak:
 #endif
 
 							fsScanDir(0);
-							i = modlist_find (currentdir, olddirpath);
-							if (i >= 0)
-							{
-								currentdir->pos = i;
-							}
+							fsScanDirSelect (olddirpath);
 							dirdbUnref(olddirpath, dirdb_use_pfilesel);
 						} else if (m->file && (m->flags & MODLIST_FLAG_ISMOD))
 						{
@@ -402,10 +402,12 @@ static void medialibAddRun (void **token, const struct DevInterfaceAPI_t *API)
 				case KEY_RIGHT:
 				case KEY_INSERT:
 					dirdbTagSetParent (medialibAddCurDir->dirdb_ref);
+					mlFingerprintBegin ();
 
 					if (mlScan (medialibAddCurDir))
 					{
 						dirdbTagCancel ();
+						mlFingerprintEnd (medialibAddCurDir->dirdb_ref, 0);
 					} else {
 						int i;
 						for (i=0; i < medialib_sources_count; i++)
@@ -430,6 +432,7 @@ static void medialibAddRun (void **token, const struct DevInterfaceAPI_t *API)
 							}
 						}
 						dirdbTagRemoveUntaggedAndSubmit ();
+						mlFingerprintEnd (medialibAddCurDir->dirdb_ref, 1);
 						dirdbFlush ();
 						mdbUpdate ();
 						mlFlushBlob ();
@@ -0,0 +1,282 @@
+/* OpenCP Module Player
+ * copyright (c) 2026 Stian Skjelstad <stian.skjelstad@gmail.com>
+ *
+ * unit test for medialib-fingerprint.c
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "config.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h>
+#endif
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include "types.h"
+#include "filesel/adbmeta.h"
+#include "filesel/dirdb.h"
+#include "filesel/filesystem.h"
+
+#include "medialib-fingerprint.c"
+
+#define ANSI_COLOR_RED     "\x1b[31m"
+#define ANSI_COLOR_GREEN   "\x1b[32m"
+#define ANSI_COLOR_RESET   "\x1b[0m"
+
+/* adbMeta stubs, keeps a single blob */
+
+static unsigned char *test_blob;
+static uint32_t       test_blobsize;
+
+int adbMetaAdd (const char *filename, const uint64_t filesize, const char *SIG, const unsigned char *data, const uint32_t datasize)
+{
+	free (test_blob);
+	test_blob = malloc (datasize);
+	memcpy (test_blob, data, datasize);
+	test_blobsize = datasize;
+	return 0;
+}
+
+int adbMetaRemove (const char *filename, const uint64_t filesize, const char *SIG)
+{
+	free (test_blob);
+	test_blob = 0;
+	test_blobsize = 0;
+	return 0;
+}
+
+int adbMetaGetRef (const char *filename, const uint64_t filesize, const char *SIG, const unsigned char **data, uint32_t *datasize)
+{
+	if (!test_blob)
+	{
+		return -1;
+	}
+	*data = test_blob;
+	*datasize = test_blobsize;
+	return 0;
+}
+
+/* dirdb stub, dirdb_ref is an index into test_paths */
+
+enum
+{
+	TEST_ROOT,
+	TEST_SUB,      /* root/sub */
+	TEST_SUBSUB,   /* root/sub/deeper */
+	TEST_ARCHIVE,  /* root/test.zip */
+	TEST_SIBLING,  /* root-2, sorts in front of root/ */
+	TEST_PATHS
+};
+
+static char *test_paths[TEST_PATHS];
+
+void dirdbGetFullname_malloc (uint32_t node, char **name, int flags)
+{
+	*name = 0;
+	if (node < TEST_PATHS)
+	{
+		*name = malloc (strlen (test_paths[node]) + 6);
+		sprintf (*name, "file:%s", test_paths[node]);
+	}
+}
+
+static struct ocpdir_t test_dirs[TEST_PATHS];
+
+static int test_check (int node, int expected)
+{
+	char *path = 0;
+	int retval = mlFingerprintCheck (&test_dirs[node], &path);
+
+	if (retval != expected)
+	{
+		printf (ANSI_COLOR_RED " mlFingerprintCheck(%s) returned %d, expected %d" ANSI_COLOR_RESET "\n", test_paths[node], retval, expected);
+		free (path);
+		return 1;
+	}
+	if ((!retval) && ((!path) || strcmp (path, test_paths[node])))
+	{
+		printf (ANSI_COLOR_RED " mlFingerprintCheck(%s) gave path \"%s\"" ANSI_COLOR_RESET "\n", test_paths[node], path ? path : "(null)");
+		free (path);
+		return 1;
+	}
+	free (path);
+	return 0;
+}
+
+static char test_children[256];
+
+static int test_child (void *token, const char *name)
+{
+	strcat (test_children, name);
+	strcat (test_children, ";");
+	return 0;
+}
+
+static int test_foreachchild (int node, const char *expected)
+{
+	test_children[0] = 0;
+	mlFingerprintForEachChild (test_paths[node], test_child, 0);
+	if (strcmp (test_children, expected))
+	{
+		printf (ANSI_COLOR_RED " mlFingerprintForEachChild(%s) gave \"%s\", expected \"%s\"" ANSI_COLOR_RESET "\n", test_paths[node], test_children, expected);
+		return 1;
+	}
+	return 0;
+}
+
+/* the fingerprints recorded by a scan survive mlFingerprintEnd(), mlFingerprintStore() and mlFingerprintLoad() */
+static int test_reload (int count)
+{
+	mlFingerprintFreeList (&mlFingerprints, &mlFingerprintsCount);
+	mlFingerprintLoad ();
+	if (mlFingerprintsCount != count)
+	{
+		printf (ANSI_COLOR_RED " %d fingerprints were loaded, expected %d" ANSI_COLOR_RESET "\n", mlFingerprintsCount, count);
+		return 1;
+	}
+	return 0;
+}
+
+int main (int argc, char *argv[])
+{
+	char base[] = "/tmp/medialib-fingerprint-test-XXXXXX";
+	static const char *names[TEST_PATHS] = {"/root", "/root/sub", "/root/sub/deeper", "/root/test.zip", "/root-2"};
+	int retval = 0;
+	FILE *f;
+	int i;
+
+	if (!mkdtemp (base))
+	{
+		perror ("mkdtemp()");
+		return 1;
+	}
+	for (i=0; i < TEST_PATHS; i++)
+	{
+		test_paths[i] = malloc (strlen (base) + strlen (names[i]) + 1);
+		sprintf (test_paths[i], "%s%s", base, names[i]);
+		test_dirs[i].dirdb_ref = i;
+		test_dirs[i].is_archive = (i == TEST_ARCHIVE);
+		if (i != TEST_ARCHIVE)
+		{
+			mkdir (test_paths[i], 0700);
+		}
+	}
+	f = fopen (test_paths[TEST_ARCHIVE], "w");
+	fputs ("PK", f);
+	fclose (f);
+
+	printf ("first scan records everything: ");
+	mlFingerprintLoad ();
+	mlFingerprintBegin ();
+	retval |= test_check (TEST_ROOT, 1);
+	retval |= test_check (TEST_SUB, 1);
+	retval |= test_check (TEST_SUBSUB, 1);
+	retval |= test_check (TEST_ARCHIVE, 1);
+	mlFingerprintEnd (TEST_ROOT, 1);
+	retval |= test_reload (4);
+	printf ("%s\n", retval ? ANSI_COLOR_RED "FAILED" ANSI_COLOR_RESET : ANSI_COLOR_GREEN "ok" ANSI_COLOR_RESET);
+
+	printf ("another source next to it: ");
+	mlFingerprintBegin ();
+	retval |= test_check (TEST_SIBLING, 1);
+	mlFingerprintEnd (TEST_SIBLING, 1);
+	retval |= test_reload (5);
+	printf ("%s\n", retval ? ANSI_COLOR_RED "FAILED" ANSI_COLOR_RESET : ANSI_COLOR_GREEN "ok" ANSI_COLOR_RESET);
+
+	printf ("direct children only, archives included, siblings not: ");
+	retval |= test_foreachchild (TEST_ROOT, "sub;test.zip;");
+	retval |= test_foreachchild (TEST_SUB, "deeper;");
+	retval |= test_foreachchild (TEST_ARCHIVE, "");
+	printf ("%s\n", retval ? ANSI_COLOR_RED "FAILED" ANSI_COLOR_RESET : ANSI_COLOR_GREEN "ok" ANSI_COLOR_RESET);
+
+	printf ("unchanged tree matches: ");
+	mlFingerprintBegin ();
+	retval |= test_check (TEST_ROOT, 0);
+	retval |= test_check (TEST_SUB, 0);
+	retval |= test_check (TEST_SUBSUB, 0);
+	retval |= test_check (TEST_ARCHIVE, 0);
+	mlFingerprintEnd (TEST_ROOT, 1);
+	retval |= test_reload (5);
+	printf ("%s\n", retval ? ANSI_COLOR_RED "FAILED" ANSI_COLOR_RESET : ANSI_COLOR_GREEN "ok" ANSI_COLOR_RESET);
+
+	printf ("changes are found: ");
+	f = fopen (test_paths[TEST_ARCHIVE], "a");
+	fputs ("\003\004", f);
+	fclose (f);
+	{ /* the test runs faster than the timestamp resolution of some filesystems */
+		struct timespec ts[2];
+		ts[0].tv_sec = ts[1].tv_sec = 1000000000;
+		ts[0].tv_nsec = ts[1].tv_nsec = 0;
+		utimensat (AT_FDCWD, test_paths[TEST_SUB], ts, 0);
+	}
+#ifdef HAVE_SYS_INOTIFY_H
+	mlDirtyAdd (test_paths[TEST_SUBSUB]); /* as if inotify reported it */
+	if ((mlDirtyCountBelow (test_paths[TEST_ROOT]) != 1) || mlDirtyCountBelow (test_paths[TEST_SIBLING]))
+	{
+		printf (ANSI_COLOR_RED " the dirty set is not counted per source" ANSI_COLOR_RESET "\n");
+		retval |= 1;
+	}
+#endif
+	mlFingerprintBegin ();
+	retval |= test_check (TEST_ROOT, 0);
+	retval |= test_check (TEST_SUB, 1);
+#ifdef HAVE_SYS_INOTIFY_H
+	retval |= test_check (TEST_SUBSUB, 1);
+#else
+	retval |= test_check (TEST_SUBSUB, 0);
+#endif
+	retval |= test_check (TEST_ARCHIVE, 1);
+	mlFingerprintEnd (TEST_ROOT, 1);
+	retval |= test_reload (5);
+	if (mlDirtyCount)
+	{
+		printf (ANSI_COLOR_RED " the dirty set was not cleared" ANSI_COLOR_RESET "\n");
+		retval |= 1;
+	}
+	mlFingerprintBegin ();
+	retval |= test_check (TEST_SUB, 0);
+	retval |= test_check (TEST_SUBSUB, 0);
+	retval |= test_check (TEST_ARCHIVE, 0);
+	mlFingerprintEnd (TEST_ROOT, 0); /* aborted scans keep the old fingerprints */
+	retval |= test_reload (5);
+	printf ("%s\n", retval ? ANSI_COLOR_RED "FAILED" ANSI_COLOR_RESET : ANSI_COLOR_GREEN "ok" ANSI_COLOR_RESET);
+
+	printf ("children that are not visited are forgotten: ");
+	mlFingerprintBegin ();
+	retval |= test_check (TEST_ROOT, 0);
+	retval |= test_check (TEST_SUB, 0);
+	mlFingerprintEnd (TEST_ROOT, 1);
+	retval |= test_reload (3);
+	retval |= test_foreachchild (TEST_ROOT, "sub;");
+	printf ("%s\n", retval ? ANSI_COLOR_RED "FAILED" ANSI_COLOR_RESET : ANSI_COLOR_GREEN "ok" ANSI_COLOR_RESET);
+
+	mlFingerprintClose ();
+	free (test_blob);
+	unlink (test_paths[TEST_ARCHIVE]);
+	for (i=TEST_PATHS - 1; i >= 0; i--)
+	{
+		rmdir (test_paths[i]);
+		free (test_paths[i]);
+	}
+	rmdir (base);
+
+	return retval;
+}
@@ -0,0 +1,636 @@
+/* OpenCP Module Player
+ * copyright (c) 2026 Stian Skjelstad <stian.skjelstad@gmail.com>
+ *
+ * MEDIALIBRARY directory fingerprints and change notification
+ *
+ * Every native directory (and archive file) visited by mlScan() gets a
+ * fingerprint recorded: the modification time, the size and the link count.
+ * The last two are cheap stand-ins for the entry count, since they are
+ * available without reading the directory. A refresh only reads directories
+ * where the fingerprint changed; the rest keep their entries in the database.
+ *
+ * On Linux, all fingerprinted directories are also watched with inotify while
+ * OCP is running. The kernel queues the events, and they are drained when a
+ * refresh is about to happen. This catches changes the fingerprint can not
+ * see, like a file that is rewritten in place.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/* adbMeta blob, repeated for each directory:
+ *   int64_t  mtime (nanoseconds)
+ *   uint64_t size
+ *   uint32_t nlink
+ *   char     path[] (zero-terminated, without the file: prefix)
+ * all values are little-endian
+ */
+#define MLFP_RECORD 20
+
+struct mlFingerprint_t
+{
+	char    *path;
+	int64_t  mtime;
+	uint64_t size;
+	uint32_t nlink;
+};
+
+static struct mlFingerprint_t *mlFingerprints; /* sorted by path, as stored by the last scan */
+static int                     mlFingerprintsCount;
+
+static struct mlFingerprint_t *mlFingerprintsNew; /* recorded by the current scan */
+static int                     mlFingerprintsNewCount;
+static int                     mlFingerprintsNewSize;
+static int                     mlFingerprintSession;
+
+#ifdef HAVE_SYS_INOTIFY_H
+struct mlWatch_t
+{
+	int   wd;
+	char *path;
+};
+static int               mlWatchFd = -1;
+static struct mlWatch_t *mlWatches; /* sorted by wd */
+static int               mlWatchesCount;
+static int               mlWatchesFull; /* the kernel refused more watches */
+#endif
+static char            **mlDirty; /* directories reported changed */
+static int               mlDirtyCount;
+
+static int mlFingerprintCmp (const void *a, const void *b)
+{
+	const struct mlFingerprint_t *A = a;
+	const struct mlFingerprint_t *B = b;
+	return strcmp (A->path, B->path);
+}
+
+/* returns the index of the first entry not less than path */
+static int mlFingerprintLowerBound (const char *path)
+{
+	int lo = 0, hi = mlFingerprintsCount;
+
+	while (lo < hi)
+	{
+		int mid = (lo + hi) / 2;
+		if (strcmp (mlFingerprints[mid].path, path) < 0)
+		{
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+/* non-zero if path is equal to root, or below it */
+static int mlFingerprintIsBelow (const char *path, const char *root)
+{
+	size_t len = strlen (root);
+
+	if (strncmp (path, root, len))
+	{
+		return 0;
+	}
+	return (!path[len]) || (path[len] == '/') || (len && (root[len - 1] == '/'));
+}
+
+static void mlFingerprintFreeList (struct mlFingerprint_t **list, int *count)
+{
+	int i;
+
+	for (i = 0; i < *count; i++)
+	{
+		free ((*list)[i].path);
+	}
+	free (*list);
+	*list = 0;
+	*count = 0;
+}
+
+static int mlFingerprintAppend (struct mlFingerprint_t **list, int *count, int *size, const struct mlFingerprint_t *fp)
+{
+	if (*count >= *size)
+	{
+		struct mlFingerprint_t *temp = realloc (*list, (*size + 256) * sizeof ((*list)[0]));
+		if (!temp)
+		{
+			return -1;
+		}
+		*list = temp;
+		*size += 256;
+	}
+	(*list)[*count] = *fp;
+	(*count)++;
+	return 0;
+}
+
+/* dirty set */
+
+#ifdef HAVE_SYS_INOTIFY_H
+static void mlDirtyAdd (const char *path)
+{
+	char **temp;
+	int i;
+
+	for (i = 0; i < mlDirtyCount; i++)
+	{
+		if (!strcmp (mlDirty[i], path))
+		{
+			return;
+		}
+	}
+	if (!(temp = realloc (mlDirty, (mlDirtyCount + 1) * sizeof (mlDirty[0]))))
+	{
+		return;
+	}
+	mlDirty = temp;
+	if ((mlDirty[mlDirtyCount] = strdup (path)))
+	{
+		mlDirtyCount++;
+	}
+}
+#endif
+
+static int mlDirtyCheck (const char *path)
+{
+	int i;
+
+	for (i = 0; i < mlDirtyCount; i++)
+	{
+		if (!strcmp (mlDirty[i], path))
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static int mlDirtyCountBelow (const char *root)
+{
+	int i, retval = 0;
+
+	for (i = 0; i < mlDirtyCount; i++)
+	{
+		if (mlFingerprintIsBelow (mlDirty[i], root))
+		{
+			retval++;
+		}
+	}
+	return retval;
+}
+
+static void mlDirtyRemoveBelow (const char *root)
+{
+	int i;
+
+	for (i = 0; i < mlDirtyCount;)
+	{
+		if (mlFingerprintIsBelow (mlDirty[i], root))
+		{
+			free (mlDirty[i]);
+			mlDirty[i] = mlDirty[--mlDirtyCount];
+		} else {
+			i++;
+		}
+	}
+}
+
+/* inotify */
+
+#ifdef HAVE_SYS_INOTIFY_H
+static void mlWatchAdd (const char *path)
+{
+	struct mlWatch_t *temp;
+	int wd, i;
+
+	if ((mlWatchFd < 0) || mlWatchesFull)
+	{
+		return;
+	}
+
+	wd = inotify_add_watch (mlWatchFd, path, IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF);
+	if (wd < 0)
+	{
+		if (errno == ENOSPC)
+		{
+			fprintf (stderr, "[medialib] inotify watch limit reached, falling back to directory fingerprints only\n");
+			mlWatchesFull = 1;
+		}
+		return;
+	}
+
+	/* the kernel hands out increasing numbers, but gives the old one back if the inode is already watched */
+	for (i = mlWatchesCount; i && (mlWatches[i - 1].wd >= wd); i--)
+	{
+		if (mlWatches[i - 1].wd == wd)
+		{
+			return;
+		}
+	}
+	if (!(temp = realloc (mlWatches, (mlWatchesCount + 1) * sizeof (mlWatches[0]))))
+	{
+		inotify_rm_watch (mlWatchFd, wd);
+		return;
+	}
+	mlWatches = temp;
+	if (!(path = strdup (path)))
+	{
+		inotify_rm_watch (mlWatchFd, wd);
+		return;
+	}
+	memmove (mlWatches + i + 1, mlWatches + i, (mlWatchesCount - i) * sizeof (mlWatches[0]));
+	mlWatches[i].wd = wd;
+	mlWatches[i].path = (char *)path;
+	mlWatchesCount++;
+}
+
+static struct mlWatch_t *mlWatchFind (int wd)
+{
+	int lo = 0, hi = mlWatchesCount;
+
+	while (lo < hi)
+	{
+		int mid = (lo + hi) / 2;
+		if (mlWatches[mid].wd == wd)
+		{
+			return mlWatches + mid;
+		}
+		if (mlWatches[mid].wd < wd)
+		{
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return 0;
+}
+
+static void mlWatchRemove (struct mlWatch_t *w)
+{
+	int i = w - mlWatches;
+
+	free (w->path);
+	memmove (mlWatches + i, mlWatches + i + 1, (mlWatchesCount - i - 1) * sizeof (mlWatches[0]));
+	mlWatchesCount--;
+}
+#endif
+
+/* moves queued notifications from the kernel into the dirty set */
+static void mlWatchPoll (void)
+{
+#ifdef HAVE_SYS_INOTIFY_H
+	char buffer[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+	ssize_t len;
+
+	if (mlWatchFd < 0)
+	{
+		return;
+	}
+
+	while ((len = read (mlWatchFd, buffer, sizeof (buffer))) > 0)
+	{
+		char *ptr;
+		for (ptr = buffer; ptr < (buffer + len); ptr += sizeof (struct inotify_event) + ((struct inotify_event *)ptr)->len)
+		{
+			const struct inotify_event *event = (const struct inotify_event *)ptr;
+			struct mlWatch_t *w;
+
+			if (event->mask & IN_Q_OVERFLOW)
+			{ /* events were lost, the fingerprints still catches new and removed entries */
+				fprintf (stderr, "[medialib] inotify queue overflow\n");
+				continue;
+			}
+			if (!(w = mlWatchFind (event->wd)))
+			{
+				continue;
+			}
+			if (event->mask & IN_IGNORED)
+			{
+				mlWatchRemove (w);
+				continue;
+			}
+			mlDirtyAdd (w->path);
+		}
+	}
+#endif
+}
+
+/* loading and storing */
+
+static void mlFingerprintLoad (void)
+{
+	const unsigned char *data = 0;
+	uint32_t datasize = 0;
+	uint32_t i;
+	int size = 0;
+
+	if (adbMetaGetRef ("medialib", 1, "MF", &data, &datasize))
+	{
+		return;
+	}
+
+	for (i = 0; (i + MLFP_RECORD) < datasize;)
+	{
+		struct mlFingerprint_t fp;
+		const unsigned char *eos = memchr (data + i + MLFP_RECORD, 0, datasize - i - MLFP_RECORD);
+		int j;
+
+		if (!eos)
+		{
+			break;
+		}
+		fp.mtime = 0;
+		fp.size = 0;
+		for (j = 7; j >= 0; j--)
+		{
+			fp.mtime = (fp.mtime << 8) | data[i + j];
+			fp.size = (fp.size << 8) | data[i + 8 + j];
+		}
+		fp.nlink = data[i + 16] | (data[i + 17] << 8) | (data[i + 18] << 16) | ((uint32_t)data[i + 19] << 24);
+		if (!(fp.path = strdup ((const char *)data + i + MLFP_RECORD)))
+		{
+			break;
+		}
+		if (mlFingerprintAppend (&mlFingerprints, &mlFingerprintsCount, &size, &fp))
+		{
+			free (fp.path);
+			break;
+		}
+		i = eos - data + 1;
+	}
+
+	qsort (mlFingerprints, mlFingerprintsCount, sizeof (mlFingerprints[0]), mlFingerprintCmp);
+}
+
+static void mlFingerprintStore (void)
+{
+	unsigned char *data, *dst;
+	uint32_t datasize = 0;
+	int i, j;
+
+	if (!mlFingerprintsCount)
+	{
+		adbMetaRemove ("medialib", 1, "MF");
+		return;
+	}
+
+	for (i = 0; i < mlFingerprintsCount; i++)
+	{
+		datasize += MLFP_RECORD + strlen (mlFingerprints[i].path) + 1;
+	}
+	if (!(data = malloc (datasize)))
+	{
+		return;
+	}
+	for (dst = data, i = 0; i < mlFingerprintsCount; i++)
+	{
+		for (j = 0; j < 8; j++)
+		{
+			dst[j]     = (uint64_t)mlFingerprints[i].mtime >> (j * 8);
+			dst[8 + j] = mlFingerprints[i].size >> (j * 8);
+		}
+		dst[16] = mlFingerprints[i].nlink;
+		dst[17] = mlFingerprints[i].nlink >> 8;
+		dst[18] = mlFingerprints[i].nlink >> 16;
+		dst[19] = mlFingerprints[i].nlink >> 24;
+		strcpy ((char *)dst + MLFP_RECORD, mlFingerprints[i].path);
+		dst += MLFP_RECORD + strlen (mlFingerprints[i].path) + 1;
+	}
+
+	adbMetaAdd ("medialib", 1, "MF", data, datasize);
+	free (data);
+}
+
+/* scan session */
+
+static void mlFingerprintBegin (void)
+{
+	mlWatchPoll ();
+	mlFingerprintFreeList (&mlFingerprintsNew, &mlFingerprintsNewCount);
+	mlFingerprintsNewSize = 0;
+	mlFingerprintSession = 1;
+}
+
+/* commit: replace everything stored below root with what the scan recorded */
+static void mlFingerprintEnd (uint32_t root, int commit)
+{
+	char *rootpath = 0;
+	int i, j, size;
+
+	mlFingerprintSession = 0;
+
+	if (commit)
+	{
+		dirdbGetFullname_malloc (root, &rootpath, DIRDB_FULLNAME_DRIVE);
+	}
+	if ((!rootpath) || strncmp (rootpath, "file:", 5))
+	{
+		free (rootpath);
+		mlFingerprintFreeList (&mlFingerprintsNew, &mlFingerprintsNewCount);
+		mlFingerprintsNewSize = 0;
+		return;
+	}
+
+	for (i = 0, j = 0; i < mlFingerprintsCount; i++)
+	{
+		if (mlFingerprintIsBelow (mlFingerprints[i].path, rootpath + 5))
+		{
+			free (mlFingerprints[i].path);
+		} else {
+			mlFingerprints[j++] = mlFingerprints[i];
+		}
+	}
+	mlFingerprintsCount = j;
+	size = j;
+	for (i = 0; i < mlFingerprintsNewCount; i++)
+	{
+		if (mlFingerprintAppend (&mlFingerprints, &mlFingerprintsCount, &size, &mlFingerprintsNew[i]))
+		{
+			free (mlFingerprintsNew[i].path);
+			continue;
+		}
+#ifdef HAVE_SYS_INOTIFY_H
+		mlWatchAdd (mlFingerprintsNew[i].path);
+#endif
+	}
+	free (mlFingerprintsNew);
+	mlFingerprintsNew = 0;
+	mlFingerprintsNewCount = 0;
+	mlFingerprintsNewSize = 0;
+
+	qsort (mlFingerprints, mlFingerprintsCount, sizeof (mlFingerprints[0]), mlFingerprintCmp);
+
+	mlDirtyRemoveBelow (rootpath + 5);
+	free (rootpath);
+
+	mlFingerprintStore ();
+}
+
+/* Records the current fingerprint of dir. Returns non-zero if the content must
+ * be read, and gives the native path in *path if the fingerprint matched.
+ */
+static int mlFingerprintCheck (struct ocpdir_t *dir, char **path)
+{
+	struct mlFingerprint_t fp;
+	struct stat st;
+	char *fullpath = 0;
+	int i;
+
+	*path = 0;
+
+	if (!mlFingerprintSession)
+	{
+		return 1;
+	}
+
+	dirdbGetFullname_malloc (dir->dirdb_ref, &fullpath, DIRDB_FULLNAME_DRIVE);
+	if ((!fullpath) || strncmp (fullpath, "file:", 5))
+	{
+		free (fullpath);
+		return 1;
+	}
+	if (stat (fullpath + 5, &st) ||
+	    !(S_ISDIR (st.st_mode) || (dir->is_archive && S_ISREG (st.st_mode))))
+	{ /* directories inside archives and such */
+		free (fullpath);
+		return 1;
+	}
+
+	if (!(fp.path = strdup (fullpath + 5)))
+	{
+		free (fullpath);
+		return 1;
+	}
+	free (fullpath);
+#ifdef __APPLE__
+	fp.mtime = (int64_t)st.st_mtimespec.tv_sec * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+	fp.mtime = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+	fp.size = st.st_size;
+	fp.nlink = st.st_nlink;
+
+	i = mlFingerprintLowerBound (fp.path);
+	if ((i < mlFingerprintsCount) &&
+	    (!strcmp (mlFingerprints[i].path, fp.path)) &&
+	    (mlFingerprints[i].mtime == fp.mtime) &&
+	    (mlFingerprints[i].size == fp.size) &&
+	    (mlFingerprints[i].nlink == fp.nlink) &&
+	    (!mlDirtyCheck (fp.path)))
+	{
+		*path = strdup (fp.path);
+	}
+
+	if (mlFingerprintAppend (&mlFingerprintsNew, &mlFingerprintsNewCount, &mlFingerprintsNewSize, &fp))
+	{
+		free (fp.path);
+		free (*path);
+		*path = 0;
+	}
+
+	return !*path;
+}
+
+/* Calls back for each known direct sub-directory of path, as found by the last scan */
+static int mlFingerprintForEachChild (const char *path, int (*callback)(void *token, const char *name), void *token)
+{
+	size_t len = strlen (path);
+	int slash = !len || (path[len - 1] != '/');
+	int i;
+
+	for (i = mlFingerprintLowerBound (path); i < mlFingerprintsCount; i++)
+	{
+		const char *name = mlFingerprints[i].path;
+
+		if (strncmp (name, path, len))
+		{
+			break;
+		}
+		name += len;
+		if (slash)
+		{
+			if (*name != '/')
+			{
+				if (*name && (*name > '/'))
+				{
+					break;
+				}
+				continue; /* path itself, or a sibling like "path-2" that sorts in front of "path/" */
+			}
+			name++;
+		}
+		if ((!*name) || strchr (name, '/'))
+		{
+			continue;
+		}
+		if (callback (token, name))
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static void mlFingerprintInit (void)
+{
+	mlFingerprintLoad ();
+
+#ifdef HAVE_SYS_INOTIFY_H
+	int i;
+
+	mlWatchFd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+	for (i = 0; (i < mlFingerprintsCount) && (mlWatchFd >= 0) && (!mlWatchesFull); i++)
+	{
+		struct stat st;
+		if ((!stat (mlFingerprints[i].path, &st)) && S_ISDIR (st.st_mode))
+		{
+			mlWatchAdd (mlFingerprints[i].path);
+		}
+	}
+#endif
+}
+
+static void mlFingerprintClose (void)
+{
+	int i;
+
+#ifdef HAVE_SYS_INOTIFY_H
+	if (mlWatchFd >= 0)
+	{
+		close (mlWatchFd);
+		mlWatchFd = -1;
+	}
+	for (i = 0; i < mlWatchesCount; i++)
+	{
+		free (mlWatches[i].path);
+	}
+	free (mlWatches);
+	mlWatches = 0;
+	mlWatchesCount = 0;
+	mlWatchesFull = 0;
+#endif
+
+	for (i = 0; i < mlDirtyCount; i++)
+	{
+		free (mlDirty[i]);
+	}
+	free (mlDirty);
+	mlDirty = 0;
+	mlDirtyCount = 0;
+
+	mlFingerprintFreeList (&mlFingerprints, &mlFingerprintsCount);
+	mlFingerprintFreeList (&mlFingerprintsNew, &mlFingerprintsNewCount);
+	mlFingerprintsNewSize = 0;
+	mlFingerprintSession = 0;
+}
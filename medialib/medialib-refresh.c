@@ -113,7 +113,16 @@ static void mlRefreshDraw(const char *title)
 	{
 		if (i < medialib_sources_count)
 		{
-			displaystr_utf8 (mlTop + 3 + i, mlLeft + 1, (medialibRefreshSelected==(i + skip))?0x8f:0x0f, medialib_sources[i].path, mlWidth - 2);
+			int changes = strncmp (medialib_sources[i].path, "file:", 5) ? 0 : mlDirtyCountBelow (medialib_sources[i].path + 5);
+			if (changes)
+			{
+				char temp[24];
+				snprintf (temp, sizeof (temp), " %d changed", changes);
+				displaystr_utf8 (mlTop + 3 + i, mlLeft + 1, (medialibRefreshSelected==(i + skip))?0x8f:0x0f, medialib_sources[i].path, mlWidth - 2 - strlen (temp));
+				displaystr (mlTop + 3 + i, mlLeft + mlWidth - 1 - strlen (temp), (medialibRefreshSelected==(i + skip))?0x8e:0x0e, temp, strlen (temp));
+			} else {
+				displaystr_utf8 (mlTop + 3 + i, mlLeft + 1, (medialibRefreshSelected==(i + skip))?0x8f:0x0f, medialib_sources[i].path, mlWidth - 2);
+			}
 		} else {
 			displayvoid (mlTop + 3 + i, mlLeft + 1, mlWidth - 2);
 		}
@@ -135,6 +144,7 @@ static void medialibRefreshRun (void **token, const struct DevInterfaceAPI_t *AP
 {
 	while (1)
 	{
+		mlWatchPoll ();
 		API->fsDraw();
 		mlRefreshDraw("Refresh files in medialib");
 		while (API->console->KeyboardHit())
@@ -173,12 +183,15 @@ static void medialibRefreshRun (void **token, const struct DevInterfaceAPI_t *AP
 						}
 
 						dirdbTagSetParent (medialib_sources[medialibRefreshSelected].dirdb_ref);
+						mlFingerprintBegin ();
 
 						if (mlScan (dir))
 						{
 							dirdbTagCancel ();
+							mlFingerprintEnd (medialib_sources[medialibRefreshSelected].dirdb_ref, 0);
 						} else {
 							dirdbTagRemoveUntaggedAndSubmit ();
+							mlFingerprintEnd (medialib_sources[medialibRefreshSelected].dirdb_ref, 1);
 							dirdbFlush ();
 							mdbUpdate ();
 							adbMetaCommit ();
@@ -177,6 +177,11 @@ static void medialibRemoveRun (void **token, const struct DevInterfaceAPI_t *API
 							}
 						}
 						dirdbTagRemoveUntaggedAndSubmit ();
+
+						/* an empty scan session drops the fingerprints below the source */
+						mlFingerprintBegin ();
+						mlFingerprintEnd (medialib_sources[medialibRemoveSelected].dirdb_ref, 1);
+
 						dirdbFlush ();
 						mdbUpdate ();
 						adbMetaCommit ();
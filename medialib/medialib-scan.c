@@ -22,6 +22,8 @@
  *    -first release
  */
 
+#define MLSCAN_BATCH 32
+
 struct scanlist_t
 {
 	char *path;
@@ -30,6 +32,11 @@ struct scanlist_t
 	int size;
 	int abort;
 	struct ocpfilehandle_t *retain; /* hack to keep one file open in archives, to ensure they remain open while scanning their content */
+
+	/* files that needs mdbScan(), they are scanned in batches so archives can decompress them in parallel */
+	struct ocpfile_t *pending[MLSCAN_BATCH];
+	uint32_t pending_mdbref[MLSCAN_BATCH];
+	int pending_count;
 };
 
 static void mlScanDraw(const char *title, struct scanlist_t *token)
@@ -133,6 +140,23 @@ static void mlScanDraw(const char *title, struct scanlist_t *token)
 
 static int mlScan(struct ocpdir_t *dir);
 
+static void mlScan_flush (struct scanlist_t *token)
+{
+	int i;
+
+	zip_prefetch_heads (token->pending, token->pending_count);
+
+	for (i=0; i < token->pending_count; i++)
+	{
+		if (!token->abort)
+		{
+			mdbScan (token->pending[i], token->pending_mdbref[i], token->retain ? 0 : &token->retain);
+		}
+		token->pending[i]->unref (token->pending[i]);
+	}
+	token->pending_count = 0;
+}
+
 static void mlScan_dir (void *_token, struct ocpdir_t *dir)
 {
 	struct scanlist_t *token = _token;
@@ -198,7 +222,13 @@ static void mlScan_file (void *_token, struct ocpfile_t *file)
 	mdbref = mdbGetModuleReference2 (file->dirdb_ref, file->filesize(file));
 	if (!mdbInfoIsAvailable (mdbref))
 	{
-		mdbScan(file, mdbref, token->retain ? 0 : &token->retain);
+		file->ref (file);
+		token->pending[token->pending_count] = file;
+		token->pending_mdbref[token->pending_count] = mdbref;
+		if (++token->pending_count >= MLSCAN_BATCH)
+		{
+			mlScan_flush (token);
+		}
 	}
 	dirdbMakeMdbRef(file->dirdb_ref, mdbref);
 
@@ -217,12 +247,56 @@ static void mlScan_file (void *_token, struct ocpfile_t *file)
 	token->entries++;
 }
 
+static int mlScan_child (void *_dir, const char *name)
+{
+	struct ocpdir_t *dir = _dir;
+	struct ocpdir_t *sub;
+	uint32_t dirdb_ref;
+	int retval = 0;
+
+	dirdb_ref = dirdbFindAndRef (dir->dirdb_ref, name, dirdb_use_medialib);
+	if (dirdb_ref == DIRDB_NOPARENT)
+	{
+		return 0;
+	}
+	sub = dir->readdir_dir (dir, dirdb_ref);
+	if ((!sub) && fsScanArcs)
+	{ /* archives are files, open them the same way mlScan_file() does, or their fingerprints get lost */
+		struct ocpfile_t *file = dir->readdir_file (dir, dirdb_ref);
+		if (file)
+		{
+			char *curext = 0;
+
+			getext_malloc (name, &curext);
+			if (curext)
+			{
+				sub = ocpdirdecompressor_check (file, curext);
+				free (curext);
+			}
+			if (sub && sub->is_playlist)
+			{
+				sub->unref (sub);
+				sub = 0;
+			}
+			file->unref (file);
+		}
+	}
+	dirdbUnref (dirdb_ref, dirdb_use_medialib);
+	if (sub)
+	{
+		retval = mlScan (sub);
+		sub->unref (sub);
+	}
+	return retval;
+}
+
 /* returns non-zero on KEY_ESC */
 static int mlScan(struct ocpdir_t *dir)
 {
 	struct scanlist_t token;
 	int i;
 	ocpdirhandle_pt *handle;
+	char *fppath;
 
 	memset (&token, 0, sizeof (token));
 
@@ -232,6 +306,23 @@ static int mlScan(struct ocpdir_t *dir)
 		return 0;
 	}
 
+	if (!mlFingerprintCheck (dir, &fppath))
+	{ /* unchanged since the last scan, keep the entries and only visit the known sub-directories */
+		dirdbTagPreserveTree (dir->dirdb_ref);
+		if (poll_framelock())
+		{
+			mlScanDraw ("Scanning", &token);
+		}
+		if ((!token.abort) && mlFingerprintForEachChild (fppath, mlScan_child, dir))
+		{
+			token.abort = 1;
+		}
+		free (fppath);
+		free (token.path);
+		return token.abort;
+	}
+	dirdbTagCancelTree (dir->dirdb_ref); /* undo dirdbTagPreserveTree() done by an unchanged parent */
+
 	handle = dir->readdir_start (dir, mlScan_file, mlScan_dir, &token);
 	if (!handle)
 	{
@@ -250,6 +341,7 @@ static int mlScan(struct ocpdir_t *dir)
 			mlScanDraw ("Scanning", &token);
 		}
 	}
+	mlScan_flush (&token);
 	dir->readdir_cancel (handle);
 
 	for (i=0; i < token.entries; i++)
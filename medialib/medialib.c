@@ -25,10 +25,14 @@
 #include "config.h"
 #include <assert.h>
 #include <ctype.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h>
+#endif
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -41,6 +45,7 @@
 #include "filesel/filesystem-dir-mem.h"
 #include "filesel/filesystem-drive.h"
 #include "filesel/filesystem-file-dev.h"
+#include "filesel/filesystem-zip.h"
 #include "filesel/modlist.h"
 #include "filesel/mdb.h"
 #include "filesel/pfilesel.h"
@@ -170,6 +175,8 @@ static void mlFlushBlob (void)
 	free (data);
 }
 
+#include "medialib-fingerprint.c"
+
 #include "medialib-scan.c"
 
 #include "medialib-add.c"
@@ -203,6 +210,8 @@ static int mlint (const struct configAPI_t *configAPI)
 		free (data);
 	}
 
+	mlFingerprintInit ();
+
 	addfiles = dev_file_create (
 		r, /* parent-dir */
 		"add.dev",
@@ -292,6 +301,8 @@ static void mlclose(void)
 
 	mlSearchClear();
 
+	mlFingerprintClose ();
+
 	if (removefiles)
 	{
 		ocpdir_mem_remove_file (medialib_root, removefiles);
@@ -93,6 +93,9 @@ static int fadetime=10;     /* fadeout time *after* that in sec, 0=none */
 static int stopafter=0;     /* TODO */
 static int silent_max=4*50; /* max frames of silence before skipping */
 static int ay_looped;
+static int silent_for=0;
+static uint32_t ay_frame; /* frames since the start of the track */
+static int64_t new_ay_frame=-1; /* pending seek */
 
 /* the memory is a flat all-RAM 64k */
 OCP_INTERNAL unsigned char ay_mem[64*1024];
@@ -101,6 +104,27 @@ OCP_INTERNAL unsigned char ay_mem[64*1024];
 #define FRAME_STATES_128        (3546900/50)
 #define FRAME_STATES_CPC        (4000000/50)
 static int do_cpc=0;
+static int cpc_f4=0;
+
+/* Seeking backwards (or far forward) restores the nearest earlier snapshot of the entire emulator and
+ * emulates the remaining frames silently. A snapshot is taken every AY_SNAPSHOT_INTERVAL frames the first
+ * time that point of the track is reached, the oldest ones are dropped when the pool is full.
+ */
+#define AY_SNAPSHOT_INTERVAL (10*50)
+#define AY_SNAPSHOT_RECORDS 32 /* 66KB each, covers the first 5 minutes and 20 seconds of a track */
+struct ay_snapshot_t
+{
+	struct ay_z80_state_t z80;
+	struct sound_state_t sound;
+	unsigned long tstates, tsmax;
+	int current_reg, do_cpc, cpc_f4;
+	int done_fade, silent_for;
+	struct time_tag tunetime;
+	uint32_t frame;
+	unsigned char mem[64*1024];
+};
+static struct ringbuffer_snapshots_t *ay_snapshots;
+static int64_t ay_snapshot_newest=-1;
 
 static unsigned long voll,volr;
 static int bal;
@@ -191,8 +215,6 @@ OCP_INTERNAL unsigned int ay_in (int h,int l)
 /* from main.c */
 OCP_INTERNAL unsigned int ay_out (int h,int l,int a)
 {
-	static int cpc_f4=0;
-
 	/* unlike a real speccy, it seems we should only emulate exact port
 	 * number matches, rather than using bitmasks.
 	 */
@@ -460,11 +482,11 @@ static int read_ay_file (struct ocpfilehandle_t *in, struct cpifaceSessionAPI_t
 static void tunetime_reset(void)
 {
 	ay_tunetime.min=ay_tunetime.sec=ay_tunetime.subsecframes=0;
+	ay_frame=0;
 	done_fade=0;
 }
 
 /* returns zero if we want to exit the emulation (i.e. exit track) */
-static int silent_for=0;
 OCP_INTERNAL int  ay_do_interrupt (const struct plrDevAPI_t *plrDevAPI)
 {
 	/* check for fade needed */
@@ -475,6 +497,7 @@ OCP_INTERNAL int  ay_do_interrupt (const struct plrDevAPI_t *plrDevAPI)
 	}
 
 	/* incr time */
+	ay_frame++;
 	ay_tunetime.subsecframes++;
 	if(ay_tunetime.subsecframes>=50)
 	{
@@ -592,6 +615,103 @@ static void aydumpbuffer_delay_callback_from_aybuf_to_devp (void *arg, int sampl
 	state->plrDevAPI->OnBufferCallback (-samples_until, aydumpbuffer_delay_callback_from_devp, state);
 }
 
+static void ay_track_init (void)
+{
+	ay_current_reg=0;
+	cpc_f4=0;
+	silent_for=0;
+	sound_ay_reset();
+	mem_init(ay_track);
+	tunetime_reset();
+	ay_tsmax=FRAME_STATES_128;
+	do_cpc=0;
+	ay_z80_init(aydata.tracks[ay_track].data,
+	            aydata.tracks[ay_track].data_stacketc);
+}
+
+static void ay_snapshot_save (struct cpifaceSessionAPI_t *cpifaceSession)
+{
+	struct ay_snapshot_t *s = cpifaceSession->ringbufferAPI->snapshots_write (ay_snapshots, ay_frame, sizeof (*s));
+
+	if (!s)
+	{
+		return;
+	}
+	ay_z80_save_state (&s->z80);
+	sound_save_state (&s->sound);
+	s->tstates = ay_tstates;
+	s->tsmax = ay_tsmax;
+	s->current_reg = ay_current_reg;
+	s->do_cpc = do_cpc;
+	s->cpc_f4 = cpc_f4;
+	s->done_fade = done_fade;
+	s->silent_for = silent_for;
+	s->tunetime = ay_tunetime;
+	s->frame = ay_frame;
+	memcpy (s->mem, ay_mem, sizeof (s->mem));
+	cpifaceSession->ringbufferAPI->snapshots_commit (ay_snapshots);
+
+	ay_snapshot_newest = ay_frame;
+}
+
+static int ay_snapshot_load (struct cpifaceSessionAPI_t *cpifaceSession, uint32_t frame)
+{
+	static struct ay_snapshot_t s; /* too big for the stack */
+
+	if (cpifaceSession->ringbufferAPI->snapshots_get (ay_snapshots, frame, &s, sizeof (s), 0) != sizeof (s))
+	{
+		return -1;
+	}
+	ay_z80_load_state (&s.z80);
+	sound_load_state (&s.sound);
+	ay_tstates = s.tstates;
+	ay_tsmax = s.tsmax;
+	ay_current_reg = s.current_reg;
+	do_cpc = s.do_cpc;
+	cpc_f4 = s.cpc_f4;
+	done_fade = s.done_fade;
+	silent_for = s.silent_for;
+	ay_tunetime = s.tunetime;
+	ay_frame = s.frame;
+	memcpy (ay_mem, s.mem, sizeof (ay_mem));
+	return 0;
+}
+
+/* emulate until ay_frame reaches frame, restoring the nearest snapshot if that is closer than the current position */
+static void ay_seek (struct cpifaceSessionAPI_t *cpifaceSession, uint32_t frame)
+{
+	uint64_t snapshot;
+
+	if (cpifaceSession->ringbufferAPI->snapshots_get (ay_snapshots, frame, &snapshot, 0, &snapshot) < 0)
+	{ /* no snapshot this early (anymore) */
+		if (frame < ay_frame)
+		{
+			ay_track_init ();
+		}
+	} else if ((frame < ay_frame) || (snapshot > ay_frame))
+	{
+		if (ay_snapshot_load (cpifaceSession, frame))
+		{
+			ay_track_init ();
+		}
+	}
+
+	while ((ay_frame < frame) && (new_ay_track == ay_track) && !(donotloop && (ay_looped&1)))
+	{
+		if ((ay_frame % AY_SNAPSHOT_INTERVAL) == 0 && ((int64_t)ay_frame > ay_snapshot_newest))
+		{
+			ay_snapshot_save (cpifaceSession);
+		}
+		ay_z80loop (cpifaceSession->plrDevAPI);
+		aydumpbuffer_delayed_state = 0;
+	}
+	aydumpbuffer_n = 0;
+	if (silent_for < silent_max)
+	{
+		ay_looped &= ~1;
+	}
+}
+
 static void ayIdler (struct cpifaceSessionAPI_t *cpifaceSession)
 {
 	int pos1, pos2;
@@ -611,14 +731,22 @@ static void ayIdler (struct cpifaceSessionAPI_t *cpifaceSession)
 			if (new_ay_track!=ay_track)
 			{
 				ay_track=new_ay_track;
-				ay_current_reg=0;
-				sound_ay_reset();
-				mem_init(ay_track);
-				tunetime_reset();
-				ay_tsmax=FRAME_STATES_128;
-				do_cpc=0;
-				ay_z80_init(aydata.tracks[ay_track].data,
-				            aydata.tracks[ay_track].data_stacketc);
+				ay_track_init ();
+				cpifaceSession->ringbufferAPI->snapshots_reset (ay_snapshots);
+				ay_snapshot_newest=-1;
+				new_ay_frame=-1;
+			}
+
+			if (new_ay_frame >= 0)
+			{
+				ay_seek (cpifaceSession, new_ay_frame);
+				new_ay_frame=-1;
+				continue;
+			}
+
+			if (((ay_frame % AY_SNAPSHOT_INTERVAL) == 0) && ((int64_t)ay_frame > ay_snapshot_newest))
+			{
+				ay_snapshot_save (cpifaceSession);
 			}
 
 			ay_z80loop (cpifaceSession->plrDevAPI);
@@ -928,7 +1056,17 @@ OCP_INTERNAL int ayOpenPlayer(struct ocpfilehandle_t *file, struct cpifaceSessio
 	}
 	aybuffpos=0;
 
+	ay_snapshots = cpifaceSession->ringbufferAPI->snapshots_new (AY_SNAPSHOT_RECORDS, AY_SNAPSHOT_RECORDS * sizeof (struct ay_snapshot_t));
+	if (!ay_snapshots)
+	{
+		retval = errAllocMem;
+		goto errorout_ringbuffer_aybufpos;
+	}
+
+	ay_snapshot_newest=-1;
 	ay_track=0;
+	new_ay_track=0;
+	new_ay_frame=-1;
 /*
 	if(go_to_last)
 	{
@@ -941,7 +1079,7 @@ OCP_INTERNAL int ayOpenPlayer(struct ocpfilehandle_t *file, struct cpifaceSessio
 	if (!sound_init())
 	{
 		retval = errAllocMem;
-		goto errorout_ringbuffer_aybufpos;
+		goto errorout_snapshots;
 	}
 
 	memset (&aydumpbuffer_state_current, 0, sizeof (aydumpbuffer_state_current));
@@ -952,14 +1090,7 @@ OCP_INTERNAL int ayOpenPlayer(struct ocpfilehandle_t *file, struct cpifaceSessio
 	aydumpbuffer_state_current.aydumpbuffer_states.noise_period = 1;
 	aydumpbuffer_state_current.aydumpbuffer_states.envelope_period = 1;
 
-	ay_current_reg=0;
-	sound_ay_reset();
-	mem_init(ay_track);
-	tunetime_reset();
-	ay_tsmax=FRAME_STATES_128;
-	do_cpc=0;
-	ay_z80_init(aydata.tracks[ay_track].data,
-	            aydata.tracks[ay_track].data_stacketc);
+	ay_track_init ();
 
 #ifdef PLAYAY_DEBUG_OUTPUT
 	debug_output = open ("test.raw", O_WRONLY | O_TRUNC | O_CREAT, S_IRUSR | S_IWUSR);
@@ -973,6 +1104,9 @@ OCP_INTERNAL int ayOpenPlayer(struct ocpfilehandle_t *file, struct cpifaceSessio
 	return errOk;
 
 	//sound_end();
+errorout_snapshots:
+	cpifaceSession->ringbufferAPI->snapshots_free (ay_snapshots);
+	ay_snapshots = 0;
 errorout_ringbuffer_aybufpos:
 	cpifaceSession->ringbufferAPI->free (aybufpos);
 	aybufpos = 0;
@@ -1004,6 +1138,12 @@ OCP_INTERNAL void ayClosePlayer (struct cpifaceSessionAPI_t *cpifaceSession)
 		aybufpos = 0;
 	}
 
+	if (ay_snapshots)
+	{
+		cpifaceSession->ringbufferAPI->snapshots_free (ay_snapshots);
+		ay_snapshots = 0;
+	}
+
 	free(aybuf);
 	free(aydata.tracks);
 	free(aydata.filedata);
@@ -1043,3 +1183,18 @@ OCP_INTERNAL void ayStartSong (struct cpifaceSessionAPI_t *cpifaceSession, int s
 	new_ay_track=song-1;
 	cpifaceSession->ringbufferAPI->reset(aybufpos);
 }
+
+OCP_INTERNAL uint32_t ayGetPos (void)
+{
+	return (new_ay_frame >= 0) ? new_ay_frame : ay_frame;
+}
+
+OCP_INTERNAL void aySetPos (struct cpifaceSessionAPI_t *cpifaceSession, int32_t frame)
+{
+	if (frame < 0)
+	{
+		frame = 0;
+	}
+	new_ay_frame=frame;
+	cpifaceSession->ringbufferAPI->reset(aybufpos);
+}
@@ -21,6 +21,8 @@ OCP_INTERNAL void aySetMute (struct cpifaceSessionAPI_t *cpifaceSession, int ch,
 OCP_INTERNAL void ayGetInfo (struct ayinfo *);
 OCP_INTERNAL void ayGetChans (struct ay_driver_frame_state_t *);
 OCP_INTERNAL void ayStartSong (struct cpifaceSessionAPI_t *cpifaceSession, int song);
+OCP_INTERNAL uint32_t ayGetPos (void); /* in frames, 50 per second */
+OCP_INTERNAL void aySetPos (struct cpifaceSessionAPI_t *cpifaceSession, int32_t frame);
 OCP_INTERNAL void ayChanSetup (struct cpifaceSessionAPI_t *cpifaceSession);
 
 #endif
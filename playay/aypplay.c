@@ -85,6 +85,8 @@ static int ayProcessKey (struct cpifaceSessionAPI_t *cpifaceSession, uint16_t ke
 			cpifaceSession->KeyHelp (KEY_CTRL_LEFT, "Jump to previous track");
 			cpifaceSession->KeyHelp ('>', "Jump to next track");
 			cpifaceSession->KeyHelp (KEY_CTRL_RIGHT, "Jump to next track");
+			cpifaceSession->KeyHelp (KEY_CTRL_UP, "Rewind 1 second");
+			cpifaceSession->KeyHelp (KEY_CTRL_DOWN, "Forward 1 second");
 			return 0;
 		case 'p': case 'P':
 			cpifaceSession->TogglePauseFade (cpifaceSession);
@@ -115,6 +117,12 @@ static int ayProcessKey (struct cpifaceSessionAPI_t *cpifaceSession, uint16_t ke
 				cpifaceSession->ResetSongTimer (cpifaceSession);
 			}
 			break;
+		case KEY_CTRL_UP:
+			aySetPos (cpifaceSession, (int32_t)ayGetPos() - 50);
+			break;
+		case KEY_CTRL_DOWN:
+			aySetPos (cpifaceSession, (int32_t)ayGetPos() + 50);
+			break;
 
 		default:
 			return 0;
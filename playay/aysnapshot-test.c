@@ -0,0 +1,262 @@
+/* OpenCP Module Player
+ * copyright (c) 2026 Stian Skjelstad <stian.skjelstad@gmail.com>
+ *
+ * Test for the emulator snapshots used when seeking. A seek (restore an
+ * earlier snapshot and emulate forward) must give exactly the same audio as
+ * playing straight through.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "types.h"
+
+#include "main.h"
+#include "sound.h"
+#include "z80.h"
+
+#define FRAMES 300
+
+OCP_INTERNAL unsigned char ay_mem[64*1024];
+OCP_INTERNAL unsigned long ay_tstates, ay_tsmax;
+
+static int current_reg;
+static int frame;
+static uint32_t frame_hash;
+
+/* everything ayplay.c stores in a snapshot that this test uses */
+struct snapshot_t
+{
+	struct ay_z80_state_t z80;
+	struct sound_state_t sound;
+	unsigned long tstates, tsmax;
+	int current_reg;
+	int frame;
+	unsigned char mem[64*1024];
+};
+
+OCP_INTERNAL unsigned int ay_in (int h, int l)
+{
+	return 255;
+}
+
+/* the ZX Spectrum ports, with the same top-byte masks as ay_out() in ayplay.c */
+OCP_INTERNAL unsigned int ay_out (int h, int l, int a)
+{
+	if (l == 0xfd)
+	{
+		if ((h & 0xc0) == 0xc0)
+		{
+			current_reg = a & 15;
+		} else if ((h & 0xc0) == 0x80)
+		{
+			sound_ay_write (current_reg, a, ay_tstates);
+		}
+	} else if (l == 0xfe)
+	{
+		sound_beeper (a & 0x18, ay_tstates);
+	}
+	return 0;
+}
+
+OCP_INTERNAL int ay_do_interrupt (const struct plrDevAPI_t *plrDevAPI)
+{
+	struct ay_driver_frame_state_t states;
+
+	if (frame == 200)
+	{
+		sound_start_fade (2);
+	}
+	frame++;
+	sound_frame (&states);
+	return 0;
+}
+
+OCP_INTERNAL void ay_driver_frame (int16_t *quad_samples, size_t bytes)
+{
+	uint32_t hash = 2166136261u;
+	size_t j;
+
+	for (j = 0; j < bytes / 2; j++)
+	{
+		hash = (hash ^ (uint16_t)quad_samples[j]) * 16777619;
+	}
+	frame_hash = hash;
+}
+
+static struct sound_state_t sound_initial; /* sound_ay_reset() keeps e.g. the noise generator running */
+static uint32_t random_state;
+
+static uint8_t random_byte (void)
+{
+	random_state = random_state * 1103515245 + 12345;
+	return random_state >> 16;
+}
+
+static void setup_player (int seed)
+{
+	static const uint8_t intnz[]=
+	{
+		0xf3,           /* di */
+		0xcd,0x1b,0x80, /* call init */
+		0xed,0x56,      /* loop: im 1 */
+		0xfb,           /* ei */
+		0x76,           /* halt */
+		0xcd,0x00,0x80, /* call interrupt */
+		0x18,0xf7       /* jr loop */
+	};
+	static const uint8_t interrupt[]=
+	{
+		0x1e,0x04,      /* 8000: ld e,4 */
+		0x01,0xfd,0xff, /* 8002: ld bc,0xfffd */
+		0x3a,0x00,0x90, /* 8005: ld a,(0x9000) */
+		0x3c,           /* 8008: inc a */
+		0x32,0x00,0x90, /* 8009: ld (0x9000),a */
+		0xe6,0x0f,      /* 800c: and 0x0f */
+		0xed,0x79,      /* 800e: out (c),a */
+		0x06,0xbf,      /* 8010: ld b,0xbf */
+		0xed,0x5f,      /* 8012: ld a,r */
+		0xed,0x79,      /* 8014: out (c),a */
+		0xd3,0xfe,      /* 8016: out (0xfe),a */
+		0x1d,           /* 8018: dec e */
+		0x20,0xe7,      /* 8019: jr nz,0x8002 */
+		0xc9            /* 801b: ret (init) */
+	};
+	uint8_t data[10];
+	uint8_t stacketc[2];
+	int j;
+
+	for (j = 0; j < sizeof (ay_mem); j++)
+	{
+		ay_mem[j] = random_byte ();
+	}
+	if (seed & 1)
+	{ /* a register writer called like a tune would be */
+		memcpy (ay_mem, intnz, sizeof (intnz));
+		memcpy (ay_mem + 0x8000, interrupt, sizeof (interrupt));
+		ay_mem[0x38] = 0xfb; /* ei */
+		ay_mem[0x39] = 0xc9; /* ret */
+	} else { /* random code, only occasionally hits the ports */
+		for (j = 0; j < 0x1000; j += 4)
+		{
+			ay_mem[j + 0] = 0xd3; /* out (0xfd),a */
+			ay_mem[j + 1] = 0xfd;
+		}
+	}
+
+	data[8] = random_byte ();
+	data[9] = random_byte ();
+	stacketc[0] = random_byte ();
+	stacketc[1] = random_byte ();
+
+	sound_load_state (&sound_initial);
+	sound_ay_reset ();
+	current_reg = 0;
+	frame = 0;
+	ay_tsmax = 3546900/50;
+	ay_z80_init (data, stacketc);
+}
+
+static void snapshot_save (struct snapshot_t *s)
+{
+	ay_z80_save_state (&s->z80);
+	sound_save_state (&s->sound);
+	s->tstates = ay_tstates;
+	s->tsmax = ay_tsmax;
+	s->current_reg = current_reg;
+	s->frame = frame;
+	memcpy (s->mem, ay_mem, sizeof (ay_mem));
+}
+
+static void snapshot_load (const struct snapshot_t *s)
+{
+	ay_z80_load_state (&s->z80);
+	sound_load_state (&s->sound);
+	ay_tstates = s->tstates;
+	ay_tsmax = s->tsmax;
+	current_reg = s->current_reg;
+	frame = s->frame;
+	memcpy (ay_mem, s->mem, sizeof (ay_mem));
+}
+
+int main (int argc, char *argv[])
+{
+	static uint32_t straight[FRAMES];
+	static struct snapshot_t snapshot;
+	int errors = 0;
+	int seed, i;
+
+	sound_freq = 44100;
+	if (!sound_init ())
+	{
+		fprintf (stderr, "sound_init() failed\n");
+		return 1;
+	}
+	sound_save_state (&sound_initial);
+
+	for (seed = 0; seed < 200; seed++)
+	{
+		int save, played, target;
+
+		random_state = seed;
+		setup_player (seed);
+		for (i = 0; i < FRAMES; i++)
+		{
+			ay_z80loop (0);
+			straight[i] = frame_hash;
+		}
+
+		save = random_byte () % FRAMES;
+		played = save + random_byte () % (FRAMES - save);
+		target = save + random_byte () % (FRAMES - save);
+
+		/* play up to a snapshot, continue playing, then seek back (or forward) to target */
+		random_state = seed;
+		setup_player (seed);
+		while (frame < save)
+		{
+			ay_z80loop (0);
+		}
+		snapshot_save (&snapshot);
+		while (frame < played)
+		{
+			ay_z80loop (0);
+		}
+		snapshot_load (&snapshot);
+		while (frame < target)
+		{
+			ay_z80loop (0);
+		}
+
+		for (i = target; i < FRAMES; i++)
+		{
+			ay_z80loop (0);
+			if (frame_hash != straight[i])
+			{
+				fprintf (stderr, "seed %d: snapshot at frame %d, played to %d, seek to %d: frame %d differs\n", seed, save, played, target, i);
+				errors++;
+				break;
+			}
+		}
+	}
+
+	sound_end ();
+
+	fprintf (stderr, "Final result: %d errors\n", errors);
+	return !!errors;
+}
@@ -103,7 +103,13 @@ static int ayReadInfo(struct moduleinfostruct *m, struct ocpfilehandle_t *f, con
 }
 
 
-static struct mdbreadinforegstruct ayReadInfoReg = {"AY", ayReadInfo MDBREADINFOREGSTRUCT_TAIL};
+static const struct mdbReadInfoSignature aySignatures[] =
+{
+	{0, 8, "ZXAYEMUL"},
+	{0, 0, 0}
+};
+
+static struct mdbreadinforegstruct ayReadInfoReg = {"AY", ayReadInfo, aySignatures, 0 MDBREADINFOREGSTRUCT_TAIL};
 
 static const char *AY_description[] =
 {
@@ -101,7 +101,7 @@ instr(0x4b,16);
    {uint16_t addr=fetch2(pc);
     pc+=2;
     c=fetch(addr);
-    b=fetch(addr+1);
+    b=fetch((addr+1)&0xffff);
    }
 endinstr;
 
@@ -174,7 +174,7 @@ instr(0x5b,16);
    {uint16_t addr=fetch2(pc);
     pc+=2;
     e=fetch(addr);
-    d=fetch(addr+1);
+    d=fetch((addr+1)&0xffff);
    }
 endinstr;
 
@@ -252,7 +252,7 @@ instr(0x6b,16);
    {uint16_t addr=fetch2(pc);
     pc+=2;
     l=fetch(addr);
-    h=fetch(addr+1);
+    h=fetch((addr+1)&0xffff);
    }
 endinstr;
 
@@ -87,6 +87,10 @@ static int ay_change_count;
 static int fading=0,fadetotal;
 static int sfadetime;
 
+static int rng=1;
+static int noise_toggle=0;
+static int env_first=1,env_rev=0,env_counter=15;
+
 static void sound_ay_init(void)
 {
 /* AY output doesn't match the claimed levels; these levels are based
@@ -207,9 +211,6 @@ OCP_INTERNAL void sound_end (void)
 
 static void sound_ay_overlay(struct ay_driver_frame_state_t *states)
 {
-	static int rng=1;
-	static int noise_toggle=0;
-	static int env_first=1,env_rev=0,env_counter=15;
 	int tone_level[3];
 	int mixer,envshape;
 	int f,g,level,count;
@@ -615,6 +616,38 @@ fading=1;
 sfadetime=fadetotal=fadetime_in_sec*sound_freq;
 }
 
+#define SOUND_STATE_VARIABLES \
+	SOUND_STATE(sound_oldval) \
+	SOUND_STATE(ay_noise_tick) SOUND_STATE(ay_tone_subcycles) SOUND_STATE(ay_env_subcycles) \
+	SOUND_STATE(ay_env_internal_tick) SOUND_STATE(ay_env_tick) SOUND_STATE(ay_tick_incr) SOUND_STATE(ay_clock) \
+	SOUND_STATE(ay_noise_period) SOUND_STATE(ay_env_period) \
+	SOUND_STATE(fading) SOUND_STATE(fadetotal) SOUND_STATE(sfadetime) \
+	SOUND_STATE(rng) SOUND_STATE(noise_toggle) SOUND_STATE(env_first) SOUND_STATE(env_rev) SOUND_STATE(env_counter)
+
+/* only valid between two frames, when there are no pending register changes */
+OCP_INTERNAL void sound_save_state (struct sound_state_t *state)
+{
+#define SOUND_STATE(x) state->x = x;
+	SOUND_STATE_VARIABLES
+#undef SOUND_STATE
+	memcpy (state->ay_tone_tick, ay_tone_tick, sizeof (ay_tone_tick));
+	memcpy (state->ay_tone_high, ay_tone_high, sizeof (ay_tone_high));
+	memcpy (state->ay_tone_period, ay_tone_period, sizeof (ay_tone_period));
+	memcpy (state->sound_ay_registers, sound_ay_registers, sizeof (sound_ay_registers));
+}
+
+OCP_INTERNAL void sound_load_state (const struct sound_state_t *state)
+{
+#define SOUND_STATE(x) x = state->x;
+	SOUND_STATE_VARIABLES
+#undef SOUND_STATE
+	memcpy (ay_tone_tick, state->ay_tone_tick, sizeof (ay_tone_tick));
+	memcpy (ay_tone_high, state->ay_tone_high, sizeof (ay_tone_high));
+	memcpy (ay_tone_period, state->ay_tone_period, sizeof (ay_tone_period));
+	memcpy (sound_ay_registers, state->sound_ay_registers, sizeof (sound_ay_registers));
+	ay_change_count=0;
+}
+
 OCP_INTERNAL void sound_beeper (int on, unsigned long tstates)
 {
 	if(ay_change_count<AY_CHANGE_MAX)
@@ -25,6 +25,22 @@ struct ay_driver_frame_state_t
 	uint8_t envelope_shape; /* ___ssss */
 };
 
+/* everything that sound_frame() carries over from one frame to the next */
+struct sound_state_t
+{
+	int sound_oldval;
+	uint32_t ay_tone_tick[3], ay_tone_high[3], ay_noise_tick;
+	uint32_t ay_tone_subcycles, ay_env_subcycles;
+	uint32_t ay_env_internal_tick, ay_env_tick;
+	uint32_t ay_tick_incr;
+	uint32_t ay_clock;
+	uint32_t ay_tone_period[3], ay_noise_period, ay_env_period;
+	uint8_t sound_ay_registers[16];
+	int fading, fadetotal, sfadetime;
+	int rng, noise_toggle;
+	int env_first, env_rev, env_counter;
+};
+
 OCP_INTERNAL int sound_init (void);
 OCP_INTERNAL void sound_end (void);
 OCP_INTERNAL int sound_frame (struct ay_driver_frame_state_t *states);
@@ -34,4 +50,6 @@ OCP_INTERNAL void sound_ay_write (int reg, int val, unsigned long tstates);
 OCP_INTERNAL void sound_ay_reset (void);
 OCP_INTERNAL void sound_ay_reset_cpc (void);
 OCP_INTERNAL void sound_beeper (int on, unsigned long tstates);
+OCP_INTERNAL void sound_save_state (struct sound_state_t *state);
+OCP_INTERNAL void sound_load_state (const struct sound_state_t *state);
 extern OCP_INTERNAL unsigned int sound_freq;
@@ -0,0 +1,147 @@
+/* OpenCP Module Player
+ * copyright (c) 2026 Stian Skjelstad <stian.skjelstad@gmail.com>
+ *
+ * Trace test for z80.c. The test is built twice, with threaded and with
+ * switch dispatch, and the two traces must be identical.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "z80.c"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+OCP_INTERNAL unsigned char ay_mem[64*1024];
+OCP_INTERNAL unsigned long ay_tstates, ay_tsmax;
+
+static uint32_t trace; /* FNV-1a of all port accesses */
+
+static void trace_add (uint32_t v)
+{
+	int j;
+	for (j = 0; j < 4; j++)
+	{
+		trace = (trace ^ ((v >> (j * 8)) & 0xff)) * 16777619;
+	}
+}
+
+OCP_INTERNAL unsigned int ay_in (int h, int l)
+{
+	trace_add (0x10000000 | (h << 8) | l);
+	trace_add (ay_tstates);
+	return (h * 31 + l) & 0xff;
+}
+
+OCP_INTERNAL unsigned int ay_out (int h, int l, int a)
+{
+	trace_add (0x20000000 | (h << 16) | (l << 8) | a);
+	trace_add (ay_tstates);
+	return 0;
+}
+
+OCP_INTERNAL int ay_do_interrupt (const struct plrDevAPI_t *plrDevAPI)
+{
+	return 0;
+}
+
+static uint32_t memory_hash (void)
+{
+	uint32_t hash = 2166136261u;
+	int j;
+	for (j = 0; j < sizeof (ay_mem); j++)
+	{
+		hash = (hash ^ ay_mem[j]) * 16777619;
+	}
+	return hash;
+}
+
+static uint32_t random_state;
+
+static uint8_t random_byte (void)
+{ /* not rand(), so the traces do not depend on the C library */
+	random_state = random_state * 1103515245 + 12345;
+	return random_state >> 16;
+}
+
+/* same layout as mem_init() in ayplay.c uses, an IM 2 or IM 1 player loop at address 0 */
+static void setup_player (int seed)
+{
+	static const uint8_t intnz[]=
+	{
+		0xf3,           /* di */
+		0xcd,0,0,       /* call init */
+		0xed,0x56,      /* loop: im 1 */
+		0xfb,           /* ei */
+		0x76,           /* halt */
+		0xcd,0,0,       /* call interrupt */
+		0x18,0xf7       /* jr loop */
+	};
+	int j;
+
+	for (j = 0; j < sizeof (ay_mem); j++)
+	{
+		ay_mem[j] = random_byte ();
+	}
+	if (seed & 1)
+	{ /* random code, but called like a tune would be */
+		memcpy (ay_mem, intnz, sizeof (intnz));
+		ay_mem[0x38] = 0xfb; /* ei */
+		ay_mem[0x39] = 0xc9; /* ret */
+		ay_mem[2] = random_byte ();
+		ay_mem[3] = random_byte () | 0x40;
+		ay_mem[9] = random_byte ();
+		ay_mem[10] = random_byte () | 0x40;
+	}
+}
+
+int main (int argc, char *argv[])
+{
+	const int seeds = 2000;
+	const int frames = 25;
+	struct timespec t0, t1;
+	int seed, frame;
+
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	for (seed = 0; seed < seeds; seed++)
+	{
+		uint8_t data[10];
+		uint8_t stacketc[2];
+
+		random_state = seed;
+		setup_player (seed);
+		data[8] = random_byte ();
+		data[9] = random_byte ();
+		stacketc[0] = random_byte ();
+		stacketc[1] = random_byte ();
+
+		trace = 2166136261u;
+		ay_tsmax = 69888;
+		ay_z80_init (data, stacketc);
+
+		for (frame = 0; frame < frames; frame++)
+		{
+			ay_z80loop (0);
+		}
+
+		printf ("seed %4d: pc=%04x sp=%04x af=%02x%02x bc=%02x%02x de=%02x%02x hl=%02x%02x ix=%04x iy=%04x af'=%02x%02x bc'=%02x%02x de'=%02x%02x hl'=%02x%02x i=%02x r=%02x iff=%d%d im=%d tstates=%lu ports=%08x memory=%08x\n",
+			seed, pc, sp, a, f, b, c, d, e, h, l, ix, iy, a1, f1, b1, c1, d1, e1, h1, l1, i, (r & 0x80) | (radjust & 0x7f), iff1, iff2, im, ay_tstates, trace, memory_hash ());
+	}
+	clock_gettime (CLOCK_MONOTONIC, &t1);
+
+	fprintf (stderr, "%d x %d frames emulated in %.3f seconds\n", seeds, frames, (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1000000000.0);
+
+	return 0;
+}
@@ -57,6 +57,25 @@ static uint32_t intsample;
 static uint8_t op;
 static int interrupted;
 
+/* With GCC and clang, every instruction ends by dispatching the next one directly (threaded code) instead
+ * of all instructions sharing the single indirect jump of the switch, which the branch predictor handles far
+ * better. The interrupt and HALT handling after each instruction is only entered when it can have an effect.
+ */
+#if defined(__GNUC__) && !defined(Z80_SWITCH_DISPATCH)
+#define Z80_THREADED_DISPATCH 1
+#define Z80_NEXT do { \
+		if ((interrupted && iff1) || (op == 0x76)) goto z80_slowpath; \
+		if (ay_tstates >= ay_tsmax) goto z80_done; \
+		ixoriy=new_ixoriy; \
+		new_ixoriy=0; \
+		intsample=1; \
+		op=fetch(pc); \
+		pc++; \
+		radjust++; \
+		goto *dispatch[op]; \
+	} while (0)
+#endif
+
 OCP_INTERNAL void ay_z80_init (const unsigned char *data, const unsigned char *stacketc)
 {
 a=f=b=c=d=e=h=l=a1=f1=b1=c1=d1=e1=h1=l1=i=r=iff1=iff2=im=0;
@@ -73,8 +92,67 @@ interrupted=0;
 sp=stacketc[0]*256+stacketc[1];
 }
 
+#define Z80_STATE_REGISTERS \
+	Z80_STATE(a) Z80_STATE(f) Z80_STATE(b) Z80_STATE(c) Z80_STATE(d) Z80_STATE(e) Z80_STATE(h) Z80_STATE(l) \
+	Z80_STATE(r) Z80_STATE(a1) Z80_STATE(f1) Z80_STATE(b1) Z80_STATE(c1) Z80_STATE(d1) Z80_STATE(e1) Z80_STATE(h1) Z80_STATE(l1) \
+	Z80_STATE(i) Z80_STATE(iff1) Z80_STATE(iff2) Z80_STATE(im) \
+	Z80_STATE(pc) Z80_STATE(ix) Z80_STATE(iy) Z80_STATE(sp) \
+	Z80_STATE(radjust) Z80_STATE(ixoriy) Z80_STATE(new_ixoriy) Z80_STATE(interrupted)
+
+OCP_INTERNAL void ay_z80_save_state (struct ay_z80_state_t *state)
+{
+#define Z80_STATE(x) state->x = x;
+	Z80_STATE_REGISTERS
+#undef Z80_STATE
+}
+
+OCP_INTERNAL void ay_z80_load_state (const struct ay_z80_state_t *state)
+{
+#define Z80_STATE(x) x = state->x;
+	Z80_STATE_REGISTERS
+#undef Z80_STATE
+}
+
 OCP_INTERNAL void ay_z80loop (const struct plrDevAPI_t *plrDevAPI)
 {
+#ifdef Z80_THREADED_DISPATCH
+  static const void *const dispatch[256] =
+  {
+		&&op_0, &&op_1, &&op_2, &&op_3, &&op_4, &&op_5, &&op_6, &&op_7,
+		&&op_8, &&op_9, &&op_10, &&op_11, &&op_12, &&op_13, &&op_14, &&op_15,
+		&&op_16, &&op_17, &&op_18, &&op_19, &&op_20, &&op_21, &&op_22, &&op_23,
+		&&op_24, &&op_25, &&op_26, &&op_27, &&op_28, &&op_29, &&op_30, &&op_31,
+		&&op_32, &&op_33, &&op_34, &&op_35, &&op_36, &&op_37, &&op_38, &&op_39,
+		&&op_40, &&op_41, &&op_42, &&op_43, &&op_44, &&op_45, &&op_46, &&op_47,
+		&&op_48, &&op_49, &&op_50, &&op_51, &&op_52, &&op_53, &&op_54, &&op_55,
+		&&op_56, &&op_57, &&op_58, &&op_59, &&op_60, &&op_61, &&op_62, &&op_63,
+		&&op_0x40, &&op_0x41, &&op_0x42, &&op_0x43, &&op_0x44, &&op_0x45, &&op_0x46, &&op_0x47,
+		&&op_0x48, &&op_0x49, &&op_0x4a, &&op_0x4b, &&op_0x4c, &&op_0x4d, &&op_0x4e, &&op_0x4f,
+		&&op_0x50, &&op_0x51, &&op_0x52, &&op_0x53, &&op_0x54, &&op_0x55, &&op_0x56, &&op_0x57,
+		&&op_0x58, &&op_0x59, &&op_0x5a, &&op_0x5b, &&op_0x5c, &&op_0x5d, &&op_0x5e, &&op_0x5f,
+		&&op_0x60, &&op_0x61, &&op_0x62, &&op_0x63, &&op_0x64, &&op_0x65, &&op_0x66, &&op_0x67,
+		&&op_0x68, &&op_0x69, &&op_0x6a, &&op_0x6b, &&op_0x6c, &&op_0x6d, &&op_0x6e, &&op_0x6f,
+		&&op_0x70, &&op_0x71, &&op_0x72, &&op_0x73, &&op_0x74, &&op_0x75, &&op_0x76, &&op_0x77,
+		&&op_0x78, &&op_0x79, &&op_0x7a, &&op_0x7b, &&op_0x7c, &&op_0x7d, &&op_0x7e, &&op_0x7f,
+		&&op_0x80, &&op_0x81, &&op_0x82, &&op_0x83, &&op_0x84, &&op_0x85, &&op_0x86, &&op_0x87,
+		&&op_0x88, &&op_0x89, &&op_0x8a, &&op_0x8b, &&op_0x8c, &&op_0x8d, &&op_0x8e, &&op_0x8f,
+		&&op_0x90, &&op_0x91, &&op_0x92, &&op_0x93, &&op_0x94, &&op_0x95, &&op_0x96, &&op_0x97,
+		&&op_0x98, &&op_0x99, &&op_0x9a, &&op_0x9b, &&op_0x9c, &&op_0x9d, &&op_0x9e, &&op_0x9f,
+		&&op_0xa0, &&op_0xa1, &&op_0xa2, &&op_0xa3, &&op_0xa4, &&op_0xa5, &&op_0xa6, &&op_0xa7,
+		&&op_0xa8, &&op_0xa9, &&op_0xaa, &&op_0xab, &&op_0xac, &&op_0xad, &&op_0xae, &&op_0xaf,
+		&&op_0xb0, &&op_0xb1, &&op_0xb2, &&op_0xb3, &&op_0xb4, &&op_0xb5, &&op_0xb6, &&op_0xb7,
+		&&op_0xb8, &&op_0xb9, &&op_0xba, &&op_0xbb, &&op_0xbc, &&op_0xbd, &&op_0xbe, &&op_0xbf,
+		&&op_0xc0, &&op_0xc1, &&op_0xc2, &&op_0xc3, &&op_0xc4, &&op_0xc5, &&op_0xc6, &&op_0xc7,
+		&&op_0xc8, &&op_0xc9, &&op_0xca, &&op_0xcb, &&op_0xcc, &&op_0xcd, &&op_0xce, &&op_0xcf,
+		&&op_0xd0, &&op_0xd1, &&op_0xd2, &&op_0xd3, &&op_0xd4, &&op_0xd5, &&op_0xd6, &&op_0xd7,
+		&&op_0xd8, &&op_0xd9, &&op_0xda, &&op_0xdb, &&op_0xdc, &&op_0xdd, &&op_0xde, &&op_0xdf,
+		&&op_0xe0, &&op_0xe1, &&op_0xe2, &&op_0xe3, &&op_0xe4, &&op_0xe5, &&op_0xe6, &&op_0xe7,
+		&&op_0xe8, &&op_0xe9, &&op_0xea, &&op_0xeb, &&op_0xec, &&op_0xed, &&op_0xee, &&op_0xef,
+		&&op_0xf0, &&op_0xf1, &&op_0xf2, &&op_0xf3, &&op_0xf4, &&op_0xf5, &&op_0xf6, &&op_0xf7,
+		&&op_0xf8, &&op_0xf9, &&op_0xfa, &&op_0xfb, &&op_0xfc, &&op_0xfd, &&op_0xfe, &&op_0xff
+  };
+#endif
+
   while (ay_tstates<ay_tsmax)
   {
   ixoriy=new_ixoriy;
@@ -83,10 +161,16 @@ OCP_INTERNAL void ay_z80loop (const struct plrDevAPI_t *plrDevAPI)
   op=fetch(pc);
   pc++;
   radjust++;
+#ifdef Z80_THREADED_DISPATCH
+  goto *dispatch[op];
+#include "z80ops.c"
+z80_slowpath:
+#else
   switch(op)
     {
 #include "z80ops.c"
     }
+#endif
 
   if(interrupted && intsample && iff1)
     {
@@ -117,6 +201,9 @@ OCP_INTERNAL void ay_z80loop (const struct plrDevAPI_t *plrDevAPI)
       ay_tstates = ay_tsmax;
     }
   }
+#ifdef Z80_THREADED_DISPATCH
+z80_done:
+#endif
   ay_do_interrupt(plrDevAPI);
   ay_tstates-=ay_tsmax;
 #ifndef Z80_DISABLE_INTERRUPT
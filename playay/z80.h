@@ -30,6 +30,21 @@ struct plrDevAPI_t;
 OCP_INTERNAL void ay_z80_init (const unsigned char *data, const unsigned char *stacketc);
 OCP_INTERNAL void ay_z80loop (const struct plrDevAPI_t *plrDevAPI);
 
+/* CPU registers, used for snapshots taken between two calls to ay_z80loop() */
+struct ay_z80_state_t
+{
+	uint8_t a, f, b, c, d, e, h, l;
+	uint8_t r, a1, f1, b1, c1, d1, e1, h1, l1, i, iff1, iff2, im;
+	uint16_t pc;
+	uint16_t ix, iy, sp;
+	uint32_t radjust;
+	uint32_t ixoriy, new_ixoriy;
+	int interrupted;
+};
+
+OCP_INTERNAL void ay_z80_save_state (struct ay_z80_state_t *state);
+OCP_INTERNAL void ay_z80_load_state (const struct ay_z80_state_t *state);
+
 #define fetch(x) (ay_mem[x])
 #define fetch2(x) ((fetch(((x)+1)&0xffff)<<8)|fetch(x))
 
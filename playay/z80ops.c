@@ -16,6 +16,18 @@
  * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
 
+#ifdef Z80_THREADED_DISPATCH
+#define instr(opcode,cycles) op_##opcode: {ay_tstates+=cycles
+#define HLinstr(opcode,cycles,morecycles) \
+                             op_##opcode: {uint16_t addr; \
+                                ay_tstates+=cycles; \
+                                if(ixoriy==0)addr=hl; \
+                                else ay_tstates+=morecycles, \
+                                   addr=(ixoriy==1?ix:iy)+ \
+                                        (int8_t)fetch(pc),\
+                                   pc++
+#define endinstr             }; Z80_NEXT
+#else
 #define instr(opcode,cycles) case opcode: {ay_tstates+=cycles
 #define HLinstr(opcode,cycles,morecycles) \
                              case opcode: {uint16_t addr; \
@@ -26,6 +38,7 @@
                                         (int8_t)fetch(pc),\
                                    pc++
 #define endinstr             }; break
+#endif
 
 #define cy (f&1)
 
@@ -110,7 +123,7 @@
                    } while(0)
 #define pop2(var) /* pop 16-bit register */ (var=fetch2(sp),sp+=2)
 #define pop1(v1,v2) /* pop register pair */ (v2=fetch(sp),\
-                                             v1=fetch(sp+1),sp+=2)
+                                             v1=fetch((sp+1)&0xffff),sp+=2)
 #define push2(val) /* push 16-bit register */ do{sp-=2;store2(sp,(val));}\
                                               while(0)
 #define push1(v1,v2) /* push register pair */ do{sp-=2;\
@@ -345,7 +358,7 @@ instr(42,16);
    pc+=2;
    if(!ixoriy){
       l=fetch(addr);
-      h=fetch(addr+1);
+      h=fetch((addr+1)&0xffff);
    }
    else if(ixoriy==1)ix=fetch2(addr);
    else iy=fetch2(addr);
@@ -1214,7 +1227,20 @@ instr(0xec,10);
 endinstr;
 
 instr(0xed,4);
+#ifdef Z80_THREADED_DISPATCH
+/* edops.c has its own switch */
+#undef instr
+#undef endinstr
+#define instr(opcode,cycles) case opcode: {ay_tstates+=cycles
+#define endinstr             }; break
+#endif
 #include"edops.c"
+#ifdef Z80_THREADED_DISPATCH
+#undef instr
+#undef endinstr
+#define instr(opcode,cycles) op_##opcode: {ay_tstates+=cycles
+#define endinstr             }; Z80_NEXT
+#endif
 endinstr;
 
 instr(0xee,7);
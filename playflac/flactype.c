@@ -202,7 +202,13 @@ static int flacReadInfo(struct moduleinfostruct *m, struct ocpfilehandle_t *fp,
 	return 1;
 }
 
-static struct mdbreadinforegstruct flacReadInfoReg = {"FLAC", flacReadInfo MDBREADINFOREGSTRUCT_TAIL};
+static const struct mdbReadInfoSignature flacSignatures[] =
+{
+	{0, 4, "fLaC"},
+	{0, 0, 0}
+};
+
+static struct mdbreadinforegstruct flacReadInfoReg = {"FLAC", flacReadInfo, flacSignatures, 0 MDBREADINFOREGSTRUCT_TAIL};
 
 static const char *FLAC_description[] =
 {
@@ -592,7 +592,7 @@ safeout:
 	if (msmps)
 		free(msmps);
 
-	mpFree(m);
+	mpFree (cpifaceSession, m);
 
 	return retval;
 }
@@ -905,7 +905,7 @@ safeout:
 	if (msmps)
 		free(msmps);
 
-	mpFree(m);
+	mpFree (cpifaceSession, m);
 
 	return retval;
 }
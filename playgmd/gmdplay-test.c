@@ -0,0 +1,404 @@
+/* OpenCP Module Player
+ * copyright (c) 2026 Stian Skjelstad <stian.skjelstad@gmail.com>
+ *
+ * Test for the order checkpoints used when seeking. After mpSetPosition() the
+ * player must be in the same state as it was when the same row was reached
+ * by playing from the start, and stay so for the ticks that follow. Which
+ * physical channel plays a track is not part of the checkpoints, so it is
+ * not compared. A seek inside the current order must not use the
+ * checkpoints, but keep the notes that are playing. Every other module starts
+ * with a "+++" skip marker in order 0. The seeks are done in random order, so the silent walk that makes the
+ * checkpoints is resumed from where it stopped.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "gmdplay.c"
+
+#define NCHAN 4
+#define NPAT 4
+#define NORD 8
+#define PATLEN 32
+#define TRACKSIZE (PATLEN * 12)
+#define MAXTICKS 20000
+#define COMPARETICKS 96
+
+static void (*player_tick)(struct cpifaceSessionAPI_t *cpifaceSession);
+
+static void test_mcpSet (struct cpifaceSessionAPI_t *cpifaceSession, int ch, int opt, int val)
+{
+}
+
+static int test_mcpGet (struct cpifaceSessionAPI_t *cpifaceSession, int ch, int opt)
+{
+	return opt == mcpCStatus; /* the same as gmdNullGet(), voices never end by themselves */
+}
+
+static int test_GetFreq6848 (int note)
+{
+	return 6848 + note;
+}
+
+static int test_GetNote (unsigned int freq)
+{
+	return freq / 7;
+}
+
+static int test_OpenPlayer (int chan, void (*p)(struct cpifaceSessionAPI_t *cpifaceSession), struct ocpfilehandle_t *source_file, struct cpifaceSessionAPI_t *cpifaceSession)
+{
+	player_tick = p;
+	cpifaceSession->PhysicalChannelCount = chan;
+	return 1;
+}
+
+static void test_ClosePlayer (struct cpifaceSessionAPI_t *cpifaceSession)
+{
+}
+
+static void test_Normalize (struct cpifaceSessionAPI_t *cpifaceSession, enum mcpNormalizeType Type)
+{
+}
+
+static uint32_t state_hash;
+
+static void hash_add (const void *data, size_t len)
+{
+	const uint8_t *d = data;
+	size_t j;
+	for (j = 0; j < len; j++)
+	{
+		state_hash = (state_hash ^ d[j]) * 16777619;
+	}
+}
+
+#define HASH(x) hash_add (&(x), sizeof (x))
+
+/* everything a checkpoint restores, except the physical channels */
+static uint32_t hash_state (void)
+{
+	int i;
+
+	state_hash = 2166136261u;
+	HASH (currenttick);
+	HASH (tempo);
+	HASH (currentrow);
+	HASH (patternlen);
+	HASH (currentpattern);
+	HASH (speed);
+	HASH (brkpat);
+	HASH (brkrow);
+	HASH (patlooprow);
+	HASH (patloopcount);
+	HASH (globchan);
+	HASH (patdelay);
+	HASH (globalvol);
+	HASH (globalvolslide);
+	HASH (globalvolslval);
+	HASH (donotshutup);
+	HASH (gtrack);
+	for (i = 0; i < NCHAN; i++)
+	{
+		struct trackdata t = tdata[i];
+		t.phys = 0;
+		HASH (t);
+	}
+	return state_hash;
+}
+
+static uint32_t random_state;
+
+static int random_int (int n)
+{ /* not rand(), so the module does not depend on the C library */
+	random_state = random_state * 1103515245 + 12345;
+	return (random_state >> 16) % n;
+}
+
+/* appends a row to a track if it has any commands */
+static uint8_t *track_row (uint8_t *p, int row, const uint8_t *cmd, int len)
+{
+	if (len)
+	{
+		*p++ = row;
+		*p++ = len;
+		memcpy (p, cmd, len);
+		p += len;
+	}
+	return p;
+}
+
+/* patterns full of effects that keep state between rows: slides with effect memory, vibrato, tempo and global volume */
+static void random_module (struct gmdmodule *m, int skipfirst, uint8_t (*trackdata)[TRACKSIZE], struct gmdtrack *tracks, struct gmdpattern *patterns, uint16_t *orders, struct gmdsample *modsamples, struct gmdinstrument *instruments, struct sampleinfo *sampleinfos)
+{
+	static const uint8_t commands[] =
+	{
+		cmdVolSlideUp, cmdVolSlideDown, cmdRowVolSlideUp, cmdRowVolSlideDown, cmdPitchSlideUp, cmdPitchSlideDown,
+		cmdPitchSlideToNote, cmdRowPitchSlideUp, cmdRowPitchSlideDown, cmdPanSlide, cmdRowPanSlide, cmdVolVibrato,
+		cmdTremor, cmdPitchVibrato, cmdArpeggio, cmdNoteCut, cmdRetrig, cmdOffset, cmdKeyOff, cmdChannelVol
+	};
+	int i, j, k;
+
+	memset (m, 0, sizeof (*m));
+	m->options = MOD_EXPOFREQ;
+	m->channum = NCHAN;
+	m->instnum = 2;
+	m->modsampnum = 2;
+	m->sampnum = 2;
+	m->patnum = NPAT;
+	m->ordnum = NORD;
+	m->endord = NORD;
+	m->tracknum = NPAT * (NCHAN + 1);
+	m->instruments = instruments;
+	m->tracks = tracks;
+	m->samples = sampleinfos;
+	m->modsamples = modsamples;
+	m->patterns = patterns;
+	m->orders = orders;
+
+	memset (modsamples, 0, sizeof (modsamples[0]) * 2);
+	memset (instruments, 0, sizeof (instruments[0]) * 2);
+	memset (sampleinfos, 0, sizeof (sampleinfos[0]) * 2);
+	for (i = 0; i < 2; i++)
+	{
+		modsamples[i].handle = i;
+		modsamples[i].stdvol = 0xc0 + i * 0x20;
+		modsamples[i].stdpan = i ? -1 : 0x40;
+		modsamples[i].volfade = 0x100;
+		modsamples[i].volenv = modsamples[i].panenv = modsamples[i].pchenv = 0xffff;
+		sampleinfos[i].length = 0x10000;
+		sampleinfos[i].samprate = 44100;
+		for (j = 0; j < 128; j++)
+		{
+			instruments[i].samples[j] = i;
+		}
+	}
+
+	for (i = 0; i < NPAT; i++)
+	{
+		patterns[i].patlen = PATLEN;
+		patterns[i].gtrack = i * (NCHAN + 1);
+		for (k = 0; k <= NCHAN; k++)
+		{
+			uint8_t *p = trackdata[i * (NCHAN + 1) + k];
+
+			if (k)
+			{
+				patterns[i].tracks[k - 1] = i * (NCHAN + 1) + k;
+			}
+			tracks[i * (NCHAN + 1) + k].ptr = p;
+			for (j = 0; j < PATLEN; j++)
+			{
+				uint8_t cmd[8];
+				int len = 0;
+
+				if (!k)
+				{ /* the global track */
+					switch (random_int (12))
+					{
+						case 0: cmd[len++] = cmdTempo;        cmd[len++] = 1 + random_int (6);      break;
+						case 1: cmd[len++] = cmdSpeed;        cmd[len++] = 0x40 + random_int (0xc0); break;
+						case 2: cmd[len++] = cmdGlobVol;      cmd[len++] = random_int (256);        break;
+						case 3: cmd[len++] = cmdGlobVolSlide; cmd[len++] = random_int (16) - 8;     break;
+						case 4: cmd[len++] = cmdPatDelay;     cmd[len++] = random_int (3);          break;
+						case 5: cmd[len++] = cmdFineSpeed;    cmd[len++] = random_int (10);         break;
+						case 6:
+							if (!random_int (4))
+							{
+								cmd[len++] = cmdBreak;
+								cmd[len++] = random_int (PATLEN);
+							}
+							break;
+					}
+				} else {
+					if (!random_int (4))
+					{
+						int opt = cmdPlayNote | cmdPlayIns | cmdPlayNte;
+						if (random_int (2))
+						{
+							opt |= cmdPlayVol;
+						}
+						cmd[len++] = opt;
+						cmd[len++] = random_int (2);
+						cmd[len++] = (random_int (4) ? 0 : 0x80) | (24 + random_int (72)); /* sometimes a portamento to the note */
+						if (opt & cmdPlayVol)
+						{
+							cmd[len++] = random_int (256);
+						}
+					}
+					if (random_int (3))
+					{
+						cmd[len++] = commands[random_int (sizeof (commands))];
+						cmd[len++] = random_int (3) ? 0 : random_int (256);
+					}
+				}
+				p = track_row (p, j, cmd, len);
+			}
+			tracks[i * (NCHAN + 1) + k].end = p;
+		}
+	}
+	for (i = 0; i < NORD; i++)
+	{
+		orders[i] = random_int (NPAT);
+	}
+	if (skipfirst)
+	{
+		orders[0] = 0xFFFF;
+	}
+}
+
+struct position_t
+{
+	int ord, row;
+	int tick; /* the first tick of the row when played from the start */
+};
+
+int main (int argc, char *argv[])
+{
+	static uint8_t trackdata[NPAT * (NCHAN + 1)][TRACKSIZE];
+	static uint32_t linear[MAXTICKS];
+	static struct position_t rows[MAXTICKS];
+	struct gmdtrack tracks[NPAT * (NCHAN + 1)];
+	struct gmdpattern patterns[NPAT];
+	uint16_t orders[NORD];
+	struct gmdsample modsamples[2];
+	struct gmdinstrument instruments[2];
+	struct sampleinfo sampleinfos[2];
+	struct gmdmodule m;
+	struct mcpAPI_t api;
+	struct mcpDevAPI_t devapi;
+	struct cpifaceSessionAPI_t session;
+	int seeds = 20;
+	int errors = 0;
+	int seed;
+
+	memset (&api, 0, sizeof (api));
+	api.GetFreq6848 = test_GetFreq6848;
+	api.GetNote6848 = test_GetNote;
+	api.GetNote8363 = test_GetNote;
+	memset (&devapi, 0, sizeof (devapi));
+	devapi.OpenPlayer = test_OpenPlayer;
+	devapi.ClosePlayer = test_ClosePlayer;
+	memset (&session, 0, sizeof (session));
+	session.mcpAPI = &api;
+	session.mcpDevAPI = &devapi;
+	session.mcpSet = test_mcpSet;
+	session.mcpGet = test_mcpGet;
+	session.Normalize = test_Normalize;
+
+	for (seed = 0; seed < seeds; seed++)
+	{
+		int nrows = 0;
+		int ticks, i, j;
+		int seekerrors = 0;
+
+		random_state = seed;
+		random_module (&m, seed & 1, trackdata, tracks, patterns, orders, modsamples, instruments, sampleinfos);
+
+		if (mpPlayModule (&m, 0, &session))
+		{
+			fprintf (stderr, "seed %d: mpPlayModule() failed\n", seed);
+			errors++;
+			continue;
+		}
+		if (checkpointticks)
+		{
+			fprintf (stderr, "seed %d: mpPlayModule() walked the module, that is only done when seeking\n", seed);
+			errors++;
+		}
+		for (ticks = 0; ticks < MAXTICKS; ticks++)
+		{
+			int nextrow = (currenttick+1)>=tempo;
+
+			linear[ticks] = hash_state ();
+			player_tick (&session);
+			if (nextrow && !looped)
+			{ /* only the first time through the song, checkpoints are not made after it loops */
+				for (i = 0; i < nrows; i++)
+				{
+					if ((rows[i].ord == currentpattern) && (rows[i].row == currentrow))
+					{
+						break;
+					}
+				}
+				if (i == nrows)
+				{
+					rows[nrows].ord = currentpattern;
+					rows[nrows].row = currentrow;
+					rows[nrows].tick = ticks;
+					nrows++;
+				}
+			}
+		}
+		if (!nrows)
+		{
+			fprintf (stderr, "seed %d: no rows were played\n", seed);
+			errors++;
+		}
+
+		for (i = nrows - 1; i > 0; i--)
+		{
+			struct position_t temp = rows[i];
+			j = random_int (i + 1);
+			rows[i] = rows[j];
+			rows[j] = temp;
+		}
+		for (i = 0; i < nrows; i++)
+		{
+			if (currentpattern == rows[i].ord)
+			{
+				int oldpchan[sizeof (pchan) / sizeof (pchan[0])];
+				memcpy (oldpchan, pchan, sizeof (pchan));
+				mpSetPosition (&session, rows[i].ord, rows[i].row);
+				if (memcmp (oldpchan, pchan, sizeof (pchan)))
+				{
+					if (!seekerrors)
+					{
+						fprintf (stderr, "seed %d: seek to row %d inside order %d cut the notes\n", seed, rows[i].row, rows[i].ord);
+					}
+					seekerrors++;
+				}
+				/* the checkpoint is only restored when coming from another order */
+				for (j = 0; (j < nrows) && (rows[j].ord == rows[i].ord); j++)
+				{
+				}
+				if (j == nrows)
+				{
+					continue;
+				}
+				mpSetPosition (&session, rows[j].ord, rows[j].row);
+			}
+			mpSetPosition (&session, rows[i].ord, rows[i].row);
+			for (j = 0; (j < COMPARETICKS) && ((rows[i].tick + j) < MAXTICKS); j++)
+			{
+				if (hash_state () != linear[rows[i].tick + j])
+				{
+					if (!seekerrors)
+					{
+						fprintf (stderr, "seed %d: seek to order %d row %d differs at tick %d\n", seed, rows[i].ord, rows[i].row, j);
+					}
+					seekerrors++;
+					break;
+				}
+				player_tick (&session);
+			}
+		}
+		fprintf (stderr, "seed %d: %d rows%s, %s\n", seed, nrows, (orders[0] == 0xFFFF) ? " (starts with +++)" : "", seekerrors ? "FAILED" : "ok");
+		errors += seekerrors;
+
+		mpStopModule (&session);
+	}
+
+	fprintf (stderr, "Final result: %d errors\n", errors);
+	return !!errors;
+}
@@ -166,6 +166,7 @@ static int lockpattern;
 static uint16_t patternnum;
 static uint16_t looppat;
 static uint16_t endpat;
+static uint16_t startpat; /* the first order that is not "+++" */
 static struct trackdata tdata[GMD_MAXLCHAN];
 static struct trackdata *tdataend;
 static struct gmdtrack gtrack;
@@ -207,6 +208,42 @@ static int querpos;
 static int quewpos;
 static int quelen;
 
+/* Player state just before the tick that starts an order. They are recorded by playing the module silently from the
+ * start, so that a seek gets the effect memory, envelopes, tempo and volumes it would have had when played from the
+ * start. The silent walk is only done as far as a seek needs it, and continues from where it stopped on the next seek.
+ */
+struct gmdcheckpoint
+{
+	uint16_t row; /* the row the order was entered at */
+	uint8_t currenttick;
+	uint8_t tempo;
+	uint16_t currentrow;
+	uint16_t patternlen;
+	uint16_t currentpattern;
+	uint16_t speed;
+	int gspeed; /* the last mcpGSpeed, it can be finer than speed */
+	int16_t brkpat;
+	int16_t brkrow;
+	uint8_t patlooprow[GMD_MAXLCHAN];
+	uint8_t patloopcount[GMD_MAXLCHAN];
+	uint8_t globchan;
+	uint8_t patdelay;
+	uint8_t globalvol;
+	uint8_t globalvolslide[GMD_MAXLCHAN];
+	int8_t globalvolslval[GMD_MAXLCHAN];
+	uint8_t donotshutup;
+	struct gmdtrack gtrack;
+	struct trackdata tdata[]; /* channels entries */
+};
+#define GMD_CHECKPOINT_MAXTICKS 0x100000
+static struct gmdcheckpoint **checkpoints; /* one per order, NULL if the order is not reached (yet) */
+static struct gmdcheckpoint *checkpointscratch;
+static struct gmdcheckpoint *checkpointwalk; /* where the silent walk stopped */
+static struct gmdcheckpoint *checkpointlive; /* the state of the playback, while walking */
+static int checkpointticks; /* ticks walked so far, -1 when the module has looped */
+static struct cpifaceSessionAPI_t *silentsession; /* copy of the session with a mixer that does nothing */
+static int silentgspeed;
+
 #define HPITCHMIN (6848>>6)
 #define HPITCHMAX ((int32_t)6848<<6)
 #define EPITCHMIN -72*256
@@ -1231,9 +1268,8 @@ static void PlayTick (struct cpifaceSessionAPI_t *cpifaceSession)
 				currentpattern=looppat;
 				looped=1;
 			}
-			if (!currentpattern&&!currentrow&&!patdelay&&!donotshutup)
+			if ((currentpattern==startpat)&&!currentrow&&!patdelay&&!donotshutup)
 			{
-				currentpattern=0;
 				currentrow=0;
 				for (i=0; i<channels; i++)
 				{
@@ -1572,6 +1608,224 @@ static void PlayTick (struct cpifaceSessionAPI_t *cpifaceSession)
 	putque(cmdtime, -1, (currentrow<<8)|(currentpattern<<16), 0);
 }
 
+static void gmdNullSet (struct cpifaceSessionAPI_t *cpifaceSession, int ch, int opt, int val)
+{
+	if (opt==mcpGSpeed)
+		silentgspeed=val;
+}
+
+static int gmdNullGet (struct cpifaceSessionAPI_t *cpifaceSession, int ch, int opt)
+{
+	return opt==mcpCStatus; /* voices never end by themselves */
+}
+
+static void gmdSaveState (struct gmdcheckpoint *c)
+{
+	c->currenttick=currenttick;
+	c->tempo=tempo;
+	c->currentrow=currentrow;
+	c->patternlen=patternlen;
+	c->currentpattern=currentpattern;
+	c->speed=speed;
+	c->gspeed=silentgspeed;
+	c->brkpat=brkpat;
+	c->brkrow=brkrow;
+	memcpy (c->patlooprow, patlooprow, sizeof (patlooprow));
+	memcpy (c->patloopcount, patloopcount, sizeof (patloopcount));
+	c->globchan=globchan;
+	c->patdelay=patdelay;
+	c->globalvol=globalvol;
+	memcpy (c->globalvolslide, globalvolslide, sizeof (globalvolslide));
+	memcpy (c->globalvolslval, globalvolslval, sizeof (globalvolslval));
+	c->donotshutup=donotshutup;
+	c->gtrack=gtrack;
+	memcpy (c->tdata, tdata, sizeof (tdata[0]) * channels);
+}
+
+static void gmdLoadState (const struct gmdcheckpoint *c)
+{
+	int i;
+
+	currenttick=c->currenttick;
+	tempo=c->tempo;
+	currentrow=c->currentrow;
+	patternlen=c->patternlen;
+	currentpattern=c->currentpattern;
+	speed=c->speed;
+	silentgspeed=c->gspeed;
+	brkpat=c->brkpat;
+	brkrow=c->brkrow;
+	memcpy (patlooprow, c->patlooprow, sizeof (patlooprow));
+	memcpy (patloopcount, c->patloopcount, sizeof (patloopcount));
+	globchan=c->globchan;
+	patdelay=c->patdelay;
+	globalvol=c->globalvol;
+	memcpy (globalvolslide, c->globalvolslide, sizeof (globalvolslide));
+	memcpy (globalvolslval, c->globalvolslval, sizeof (globalvolslval));
+	donotshutup=c->donotshutup;
+	gtrack=c->gtrack;
+	for (i=0; i<channels; i++)
+	{
+		int mute=tdata[i].mute; /* set by the user, not by the module */
+		tdata[i]=c->tdata[i];
+		tdata[i].mute=mute;
+		tdata[i].phys=-1;
+	}
+	memset(pchan, -1, sizeof(pchan));
+}
+
+static void gmdFreeCheckpoints (void)
+{
+	int i;
+
+	if (checkpoints)
+	{
+		for (i=0; i<patternnum; i++)
+		{
+			free (checkpoints[i]);
+		}
+		free (checkpoints);
+		checkpoints=0;
+	}
+	free (checkpointscratch);
+	checkpointscratch=0;
+	free (checkpointwalk);
+	checkpointwalk=0;
+	free (checkpointlive);
+	checkpointlive=0;
+	free (silentsession);
+	silentsession=0;
+}
+
+/* the silent walk starts from the state the module is loaded with. Without memory, seeks use the old jump */
+static void gmdInitCheckpoints (struct cpifaceSessionAPI_t *cpifaceSession)
+{
+	size_t size = sizeof (struct gmdcheckpoint) + sizeof (tdata[0]) * channels;
+
+	checkpoints=calloc (patternnum, sizeof (checkpoints[0]));
+	checkpointscratch=malloc (size);
+	checkpointwalk=malloc (size);
+	checkpointlive=malloc (size);
+	silentsession=malloc (sizeof (*silentsession));
+	if ((!checkpoints) || (!checkpointscratch) || (!checkpointwalk) || (!checkpointlive) || (!silentsession))
+	{
+		gmdFreeCheckpoints ();
+		return;
+	}
+	*silentsession=*cpifaceSession;
+	silentsession->mcpSet=gmdNullSet;
+	silentsession->mcpGet=gmdNullGet;
+	silentgspeed=256*2*speed/5;
+
+	gmdSaveState (checkpointwalk);
+	checkpointticks=0;
+}
+
+/* Continues the silent walk until pat has a checkpoint, or the module loops. Only used by mpSetPosition(), which
+ * empties the queue afterwards.
+ */
+static void gmdWalkCheckpoints (int pat)
+{
+	size_t size = sizeof (struct gmdcheckpoint) + sizeof (tdata[0]) * channels;
+	int oldpchan[GMD_MAXPCHAN];
+	int oldlockpattern = lockpattern;
+	int oldlooped = looped;
+
+	gmdSaveState (checkpointlive);
+	memcpy (oldpchan, pchan, sizeof (pchan));
+	gmdLoadState (checkpointwalk); /* the walk has no voices of its own, they do not change the state */
+	lockpattern=-1;
+	looped=0;
+	querpos=0;
+	quewpos=0;
+
+	while ((!checkpoints[pat]) && (checkpointticks<GMD_CHECKPOINT_MAXTICKS) && (!looped))
+	{
+		int nextrow = (currenttick+1)>=tempo;
+		int ord = currentpattern;
+
+		if (nextrow)
+		{
+			gmdSaveState (checkpointscratch);
+		}
+		PlayTick (silentsession);
+		/* the first order reached is recorded as well, it is not order 0 if the module starts with "+++" */
+		if (nextrow && ((currentpattern!=ord) || (!checkpointticks)) && (!looped) && (!checkpoints[currentpattern]))
+		{
+			if (!(checkpoints[currentpattern]=malloc (size)))
+			{
+				looped=1; /* stop here, the orders not reached yet use the old jump */
+				break;
+			}
+			memcpy (checkpoints[currentpattern], checkpointscratch, size);
+			checkpoints[currentpattern]->row=currentrow;
+		}
+		checkpointticks++;
+	}
+	if (looped || (checkpointticks>=GMD_CHECKPOINT_MAXTICKS))
+	{
+		checkpointticks=-1;
+	}
+
+	gmdSaveState (checkpointwalk);
+	gmdLoadState (checkpointlive);
+	memcpy (tdata, checkpointlive->tdata, sizeof (tdata[0]) * channels); /* keeps phys and mute */
+	memcpy (pchan, oldpchan, sizeof (pchan));
+	lockpattern=oldlockpattern;
+	looped=oldlooped;
+}
+
+/* restores the checkpoint of pat, and plays silently until row is reached. Returns non-zero on failure */
+static int gmdSeekCheckpoint (int pat, int row)
+{
+	const struct gmdcheckpoint *c;
+	int oldlockpattern = lockpattern;
+	int oldlooped = looped;
+	int retval = -1;
+	int ticks;
+
+	if (!checkpoints)
+	{
+		return -1;
+	}
+	if ((!checkpoints[pat]) && (checkpointticks>=0))
+	{
+		gmdWalkCheckpoints (pat);
+	}
+	c=checkpoints[pat];
+	if ((!c) || (row<c->row))
+	{
+		return -1;
+	}
+	lockpattern=-1;
+	gmdLoadState (c);
+
+	for (ticks=0; ticks<GMD_CHECKPOINT_MAXTICKS; ticks++)
+	{
+		int nextrow = (currenttick+1)>=tempo;
+
+		if (nextrow)
+		{
+			gmdSaveState (checkpointscratch);
+		}
+		PlayTick (silentsession);
+		if (currentpattern!=pat)
+		{ /* jumped away before row was reached */
+			break;
+		}
+		if (nextrow && (currentrow==row))
+		{
+			gmdLoadState (checkpointscratch);
+			retval=0;
+			break;
+		}
+	}
+
+	lockpattern=oldlockpattern;
+	looped=oldlooped;
+	return retval;
+}
+
 OCP_INTERNAL int mpPlayModule (const struct gmdmodule *m, struct ocpfilehandle_t *file, struct cpifaceSessionAPI_t *cpifaceSession)
 {
 	int i;
@@ -1587,10 +1841,13 @@ OCP_INTERNAL int mpPlayModule (const struct gmdmodule *m, struct ocpfilehandle_t
 	for (i=129; i<256; i++)
 		sintab[i]=-sintab[256-i];
 
-	if (m->orders[0]==0xFFFF)
-	{
+	for (i=0; (i<m->ordnum)&&(m->orders[i]==0xFFFF); i++)
+		;
+	if (i==m->ordnum)
+	{ /* nothing but "+++" */
 		return errFormStruc;
 	}
+	startpat=i;
 
 	sampleinfos=m->samples;
 	modsampnum=m->modsampnum;
@@ -1608,8 +1865,10 @@ OCP_INTERNAL int mpPlayModule (const struct gmdmodule *m, struct ocpfilehandle_t
 	tdataend=tdata+channels;
 	tracks=m->tracks;
 	looppat=(m->loopord<m->ordnum)?m->loopord:0;
-	while (m->orders[looppat]==0xFFFF)
+	while (looppat&&(m->orders[looppat]==0xFFFF))
 		looppat--;
+	while (m->orders[looppat]==0xFFFF) /* the module starts with "+++" */
+		looppat++;
 
 	endpat=m->endord;
 	samiextrawurscht=!!(m->options&MOD_S3M);
@@ -1649,8 +1908,11 @@ OCP_INTERNAL int mpPlayModule (const struct gmdmodule *m, struct ocpfilehandle_t
 	querpos=0;
 	quewpos=0;
 
+	gmdInitCheckpoints (cpifaceSession);
+
 	if (!cpifaceSession->mcpDevAPI->OpenPlayer (channels, PlayTick, file, cpifaceSession))
 	{
+		gmdFreeCheckpoints ();
 		return errPlay;
 	}
 
@@ -1666,6 +1928,7 @@ OCP_INTERNAL void mpStopModule (struct cpifaceSessionAPI_t *cpifaceSession)
 	cpifaceSession->mcpDevAPI->ClosePlayer (cpifaceSession);
 	free(que);
 	que=0;
+	gmdFreeCheckpoints ();
 }
 
 OCP_INTERNAL void mpGetChanInfo (uint8_t ch, struct chaninfo *ci)
@@ -1738,6 +2001,8 @@ OCP_INTERNAL int mpGetRealPos (struct cpifaceSessionAPI_t *cpifaceSession)
 
 OCP_INTERNAL void mpSetPosition (struct cpifaceSessionAPI_t *cpifaceSession, int16_t pat, int16_t row)
 {
+	int oldpattern=currentpattern;
+	int failed;
 	unsigned int i;
 	if (row<0)
 		pat--;
@@ -1753,9 +2018,12 @@ OCP_INTERNAL void mpSetPosition (struct cpifaceSessionAPI_t *cpifaceSession, int
 	}
 	if (row<0)
 	{
-		while (orders[pat]==0xFFFF)
+		while (pat&&(orders[pat]==0xFFFF))
 			pat--;
-		row+=patterns[orders[pat]].patlen;
+		if (orders[pat]==0xFFFF) /* only "+++" in front of it, start at the first pattern */
+			row=0;
+		else
+			row+=patterns[orders[pat]].patlen;
 		if (row<0)
 			row=0;
 	}
@@ -1773,7 +2041,9 @@ OCP_INTERNAL void mpSetPosition (struct cpifaceSessionAPI_t *cpifaceSession, int
 		if (pat>=patternnum)
 			pat=looppat;
 	}
-	if (pat!=currentpattern)
+	/* a jump inside the current order keeps the notes that are playing, checkpoints can not restore them */
+	failed=(pat!=oldpattern)?gmdSeekCheckpoint (pat, row):-1; /* this might walk to pat, and add its checkpoint */
+	if (pat!=oldpattern)
 	{
 		if (lockpattern!=-1)
 			lockpattern=pat;
@@ -1784,6 +2054,14 @@ OCP_INTERNAL void mpSetPosition (struct cpifaceSessionAPI_t *cpifaceSession, int
 		}
 		for (i=0; i<channels; i++)
 			tdata[i].phys=-1;
+		querpos=0;
+		quewpos=0;
+		realpos=(row<<8)|(pat<<16);
+	}
+	if (!failed)
+	{
+		cpifaceSession->mcpSet (cpifaceSession, -1, mcpGSpeed, silentgspeed);
+		return;
 	}
 	donotshutup=0;
 	patdelay=0;
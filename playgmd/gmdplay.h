@@ -89,8 +89,9 @@ struct chaninfo
 	uint8_t fx;
 };
 
+struct cpifaceSessionAPI_t;
 OCP_INTERNAL void mpReset (struct gmdmodule *m);
-OCP_INTERNAL void mpFree (struct gmdmodule *m);
+OCP_INTERNAL void mpFree (struct cpifaceSessionAPI_t *cpifaceSession, struct gmdmodule *m);
 OCP_INTERNAL int mpAllocInstruments (struct gmdmodule *m, int n);
 OCP_INTERNAL int mpAllocSamples (struct gmdmodule *m, int n);
 OCP_INTERNAL int mpAllocModSamples (struct gmdmodule *m, int n);
@@ -110,6 +111,8 @@ OCP_INTERNAL void mpStopModule (struct cpifaceSessionAPI_t *cpifaceSession);
 OCP_INTERNAL void mpSetPosition (struct cpifaceSessionAPI_t *cpifaceSession, int16_t pat, int16_t row);
 OCP_INTERNAL void mpGetPosition (uint16_t *pat, uint8_t *row);
 OCP_INTERNAL int mpGetRealPos (struct cpifaceSessionAPI_t *cpifaceSession);
+OCP_INTERNAL int gmdPrecalcTime (const struct gmdmodule *m, int ignore1, int (*calc)[2], int n, int ite);
+OCP_INTERNAL void gmdTimeStart (struct cpifaceSessionAPI_t *cpifaceSession, const struct gmdmodule *m); /* calculates song-time table in the background */
 OCP_INTERNAL void mpGetChanInfo (uint8_t ch, struct chaninfo *ci);
 OCP_INTERNAL uint16_t mpGetRealNote (struct cpifaceSessionAPI_t *cpifaceSession, uint8_t ch);
 OCP_INTERNAL void mpGetGlobInfo (struct globinfo *gi);
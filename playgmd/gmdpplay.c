@@ -96,6 +96,12 @@ static void gmdDrawGStrings (struct cpifaceSessionAPI_t *cpifaceSession)
 	);
 }
 
+static void gmdSongTimeSeek (struct cpifaceSessionAPI_t *cpifaceSession)
+{ /* let the timer follow the seek, realpos already holds the new position */
+	int p = mpGetRealPos (cpifaceSession);
+	cpifaceSession->SongTimeSeek (cpifaceSession, p>>16, (p>>8)&0xFF);
+}
+
 static int gmdProcessKey (struct cpifaceSessionAPI_t *cpifaceSession, uint16_t key)
 {
 	uint16_t pat;
@@ -130,19 +136,23 @@ static int gmdProcessKey (struct cpifaceSessionAPI_t *cpifaceSession, uint16_t k
 		case KEY_CTRL_LEFT:
 			mpGetPosition(&pat, &row);
 			mpSetPosition (cpifaceSession, pat-1, 0);
+			gmdSongTimeSeek (cpifaceSession);
 			break;
 		case '>':
 		case KEY_CTRL_RIGHT:
 			mpGetPosition(&pat, &row);
 			mpSetPosition (cpifaceSession, pat+1, 0);
+			gmdSongTimeSeek (cpifaceSession);
 			break;
 		case KEY_CTRL_UP:
 			mpGetPosition(&pat, &row);
 			mpSetPosition (cpifaceSession, pat, row-8);
+			gmdSongTimeSeek (cpifaceSession);
 			break;
 		case KEY_CTRL_DOWN:
 			mpGetPosition(&pat, &row);
 			mpSetPosition (cpifaceSession, pat, row+8);
+			gmdSongTimeSeek (cpifaceSession);
 			break;
 		case KEY_ALT_L:
 			patlock=!patlock;
@@ -158,7 +168,7 @@ static void gmdCloseFile (struct cpifaceSessionAPI_t *cpifaceSession)
 {
 	gmdActive=0;
 	mpStopModule (cpifaceSession);
-	mpFree(&mod);
+	mpFree (cpifaceSession, &mod);
 }
 
 static int gmdLooped (struct cpifaceSessionAPI_t *cpifaceSession, int LoopMod)
@@ -190,7 +200,7 @@ static int gmdOpenFile (struct cpifaceSessionAPI_t *cpifaceSession, struct modul
 	memset (info->composer, 0, sizeof (info->composer));
 	if ((retval = loader (cpifaceSession, &mod, file)))
 	{
-		mpFree(&mod);
+		mpFree (cpifaceSession, &mod);
 		return retval;
 	}
 
@@ -203,12 +213,12 @@ static int gmdOpenFile (struct cpifaceSessionAPI_t *cpifaceSession, struct modul
 	}
 	if (!mpReduceSamples(&mod))
 	{
-		mpFree(&mod);
+		mpFree (cpifaceSession, &mod);
 		return errAllocMem;
 	}
 	if (!mpLoadSamples (cpifaceSession, &mod))
 	{
-		mpFree(&mod);
+		mpFree (cpifaceSession, &mod);
 		return errAllocSamp;
 	}
 	mpReduceMessage(&mod);
@@ -217,7 +227,7 @@ static int gmdOpenFile (struct cpifaceSessionAPI_t *cpifaceSession, struct modul
 
 	if ((retval = mpPlayModule(&mod, file, cpifaceSession)))
 	{
-		mpFree(&mod);
+		mpFree (cpifaceSession, &mod);
 		return retval;
 	}
 
@@ -248,6 +258,7 @@ static int gmdOpenFile (struct cpifaceSessionAPI_t *cpifaceSession, struct modul
 					0, gmdMarkInsSamp);
 	gmdChanSetup (cpifaceSession, &mod);
 	gmdTrkSetup (cpifaceSession, &mod);
+	gmdTimeStart (cpifaceSession, &mod);
 
 	cpifaceSession->GetPChanSample = cpifaceSession->mcpGetChanSample;
 
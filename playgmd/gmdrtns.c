@@ -29,6 +29,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "types.h"
+#include "cpiface/cpiface.h"
 #include "dev/mcp.h"
 #include "gmdplay.h"
 
@@ -214,7 +215,7 @@ OCP_INTERNAL void mpReset (struct gmdmodule *m)
 	*m->name=0;
 }
 
-OCP_INTERNAL void mpFree (struct gmdmodule *m)
+OCP_INTERNAL void mpFree (struct cpifaceSessionAPI_t *cpifaceSession, struct gmdmodule *m)
 {
 	unsigned int i;
 
@@ -227,8 +228,7 @@ OCP_INTERNAL void mpFree (struct gmdmodule *m)
 	if (m->message)
 		free(*m->message);
 	if (m->samples)
-		for (i=0; i<m->sampnum; i++)
-			free(m->samples[i].ptr);
+		cpifaceSession->mcpAPI->FreeSamples (m->samples, m->sampnum);
 
 	free(m->tracks);
 	free(m->patterns);
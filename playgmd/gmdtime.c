@@ -28,9 +28,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include "types.h"
+#include "cpiface/cpiface.h"
 #include "gmdplay.h"
 
-#if 0
 static int timerval;
 static int timerfrac;
 static int gspeed;
@@ -42,6 +42,7 @@ static uint16_t currentpattern;
 static uint16_t patternnum;
 static uint16_t looppat;
 static uint16_t endpat;
+static uint16_t startpat; /* the first order that is not "+++" */
 static struct gmdtrack gtrack;
 static const struct gmdpattern *patterns;
 static const struct gmdtrack *tracks;
@@ -58,6 +59,11 @@ static int (*calctimer)[2];
 static int calcn;
 static int sync;
 
+static struct cpifaceSessionAPI_t *timesession; /* set while the song-time table is calculated in the background */
+static int timeloopedpending; /* a jump command that loops the song has been seen, it takes effect on the next jump */
+static int timelooped;
+static uint32_t timelength;
+
 static void trackmoveto(struct gmdtrack *t, uint8_t row)
 {
 	while (1)
@@ -146,6 +152,8 @@ static void PlayGCommand(const uint8_t *cmd, uint8_t len)
 static int FindTick(void)
 {
 	int i, p;
+	int jumped=0;
+	int jumplooped=0;
 
 	currenttick++;
 	if (currenttick>=tempo)
@@ -175,6 +183,7 @@ static int FindTick(void)
 		}
 		if (brkpat!=-1)
 		{
+			jumped=1;
 			if (currentpattern!=brkpat)
 			{
 				memset(patloopcount, 0, sizeof(patloopcount));
@@ -191,9 +200,8 @@ static int FindTick(void)
 				currentpattern=looppat;
 				looped=1;
 			}
-			if (!currentpattern&&!currentrow&&!patdelay)
+			if ((currentpattern==startpat)&&!currentrow&&!patdelay)
 			{
-				currentpattern=0;
 				currentrow=0;
 				tempo=6;
 				speed=125;
@@ -202,6 +210,8 @@ static int FindTick(void)
 			LoadPattern(currentpattern, currentrow);
 		}
 
+		jumplooped=looped;
+
 		while (1)
 		{
 			if (gtrack.ptr>=gtrack.end)
@@ -236,6 +246,19 @@ static int FindTick(void)
 				if (!++calctimer[i][1])
 					calctimer[i][1]=timerval;
 
+	if (timesession&&!currenttick)
+	{
+		if (jumped&&(jumplooped||timeloopedpending))
+		{
+			timelooped=1;
+			timelength=timerval;
+		} else {
+			timesession->SongTimeRow (timesession, currentpattern, currentrow, timerval);
+			if (looped)
+				timeloopedpending=1;
+		}
+	}
+
 	looped=0;
 
 	timerfrac+=1638400*1024/gspeed;
@@ -249,12 +272,20 @@ static int FindTick(void)
 	return 1;
 }
 
-int gmdPrecalcTime(struct gmdmodule *m, int ignore1, int (*calc)[2], int n, int ite)
+static int gmdTimeReset (const struct gmdmodule *m, int (*calc)[2], int n)
 {
 	int i;
 
-	if (m->orders[0]==0xFFFF)
+	for (i=0; (i<m->ordnum)&&(m->orders[i]==0xFFFF); i++)
+		;
+	if (i==m->ordnum)
 		return 0;
+	startpat=i;
+
+	timesession=0;
+	timeloopedpending=0;
+	timelooped=0;
+	timelength=0;
 
 	sync=-1;
 	calcn=n;
@@ -264,8 +295,10 @@ int gmdPrecalcTime(struct gmdmodule *m, int ignore1, int (*calc)[2], int n, int
 	patternnum=m->ordnum;
 	tracks=m->tracks;
 	looppat=(m->loopord<m->ordnum)?m->loopord:0;
-	while (m->orders[looppat]==0xFFFF)
+	while (looppat&&(m->orders[looppat]==0xFFFF))
 		looppat--;
+	while (m->orders[looppat]==0xFFFF) /* the module starts with "+++" */
+		looppat++;
 
 	endpat=m->endord;
 
@@ -283,10 +316,56 @@ int gmdPrecalcTime(struct gmdmodule *m, int ignore1, int (*calc)[2], int n, int
 	timerval=0;
 	timerfrac=0;
 
+	return 1;
+}
+
+OCP_INTERNAL int gmdPrecalcTime (const struct gmdmodule *m, int ignore1, int (*calc)[2], int n, int ite)
+{
+	int i;
+
+	if (!gmdTimeReset (m, calc, n))
+		return 0;
+
 	for (i=0; i<ite; i++)
 		if (FindTick())
 			return 1;
 
 	return 0;
 }
-#endif
+
+static int gmdTimeStep (struct cpifaceSessionAPI_t *cpifaceSession, int ticks, uint32_t *length)
+{
+	while (ticks--)
+	{
+		FindTick();
+		if (timelooped)
+		{
+			*length=timelength;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+OCP_INTERNAL void gmdTimeStart (struct cpifaceSessionAPI_t *cpifaceSession, const struct gmdmodule *m)
+{
+	uint32_t hash=0;
+	unsigned int i;
+
+	if (!gmdTimeReset (m, 0, 0))
+		return;
+
+	hash=cpifaceSession->SongTimeHash (hash, &m->endord, sizeof (m->endord));
+	hash=cpifaceSession->SongTimeHash (hash, &m->loopord, sizeof (m->loopord));
+	hash=cpifaceSession->SongTimeHash (hash, m->orders, sizeof (m->orders[0]) * m->ordnum);
+	for (i=0; i<m->patnum; i++)
+	{
+		const struct gmdtrack *t=&m->tracks[m->patterns[i].gtrack];
+		hash=cpifaceSession->SongTimeHash (hash, &m->patterns[i].patlen, sizeof (m->patterns[i].patlen));
+		hash=cpifaceSession->SongTimeHash (hash, t->ptr, t->end - t->ptr);
+	}
+
+	timesession=cpifaceSession;
+
+	cpifaceSession->SongTimeRegister (cpifaceSession, "GMDTime", hash, m->ordnum, gmdTimeStep);
+}
@@ -257,7 +257,14 @@ static const char *HVL_description[] =
 
 };
 
-static struct mdbreadinforegstruct hvlReadInfoReg = {"HVL/AHX", hvlReadInfo MDBREADINFOREGSTRUCT_TAIL};
+static const struct mdbReadInfoSignature hvlSignatures[] =
+{
+	{0, 3, "THX"},
+	{0, 3, "HVL"},
+	{0, 0, 0}
+};
+
+static struct mdbreadinforegstruct hvlReadInfoReg = {"HVL/AHX", hvlReadInfo, hvlSignatures, 0 MDBREADINFOREGSTRUCT_TAIL};
 
 OCP_INTERNAL int hvl_type_init (struct PluginInitAPI_t *API)
 {
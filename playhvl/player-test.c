@@ -0,0 +1,238 @@
+/* OpenCP Module Player
+ * copyright (c) 2026 Stian Skjelstad <stian.skjelstad@gmail.com>
+ *
+ * Test and micro-benchmark for hvl_mixchunk(). Random voices are rendered
+ * by both hvl_mixchunk() and the original sample-by-sample mixer, and the
+ * output must be bit-exact.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "player.c"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* the way hvl_mixchunk() worked before it rendered one voice at the time */
+static void reference_mixchunk (struct hvl_tune *ht, int16_t *buf, size_t samples)
+{
+	const int8_t *src[MAX_CHANNELS];
+	const int8_t *rsrc[MAX_CHANNELS];
+	uint32_t  delta[MAX_CHANNELS];
+	uint32_t  rdelta[MAX_CHANNELS];
+	int32_t   vol[MAX_CHANNELS];
+	uint32_t  pos[MAX_CHANNELS];
+	uint32_t  rpos[MAX_CHANNELS];
+	uint32_t  cnt;
+	int32_t   panl[MAX_CHANNELS];
+	int32_t   panr[MAX_CHANNELS];
+	int32_t   j;
+	uint32_t  i, chans, loops;
+
+	chans = ht->ht_Channels;
+	for ( i=0; i<chans; i++ )
+	{
+		delta[i] = ht->ht_Voices[i].vc_Delta;
+		vol[i]   = ht->ht_Voices[i].vc_VoiceVolume;
+		pos[i]   = ht->ht_Voices[i].vc_SamplePos;
+		src[i]   = ht->ht_Voices[i].vc_MixSource;
+		panl[i]  = ht->ht_Voices[i].vc_PanMultLeft;
+		panr[i]  = ht->ht_Voices[i].vc_PanMultRight;
+		rdelta[i]= ht->ht_Voices[i].vc_RingDelta;
+		rpos[i]  = ht->ht_Voices[i].vc_RingSamplePos;
+		rsrc[i]  = ht->ht_Voices[i].vc_RingMixSource;
+	}
+
+	do
+	{
+		loops = samples;
+		for ( i=0; i<chans; i++ )
+		{
+			if ( pos[i] >= (0x280 << 16))
+			{
+				pos[i] -= 0x280<<16;
+			}
+			cnt = ((0x280<<16) - pos[i] - 1) / delta[i] + 1;
+			if ( cnt < loops )
+			{
+				loops = cnt;
+			}
+			if ( rsrc[i] )
+			{
+				if ( rpos[i] >= (0x280<<16))
+				{
+					rpos[i] -= 0x280<<16;
+				}
+				cnt = ((0x280<<16) - rpos[i] - 1) / rdelta[i] + 1;
+				if ( cnt < loops )
+				{
+					loops = cnt;
+				}
+			}
+		}
+
+		samples -= loops;
+
+		do
+		{
+			for ( i=0; i<chans; i++ )
+			{
+				if ( rsrc[i] )
+				{
+					j = ((src[i][pos[i]>>16]*rsrc[i][rpos[i]>>16])>>7)*vol[i];
+					rpos[i] += rdelta[i];
+				} else {
+					j = src[i][pos[i]>>16]*vol[i];
+				}
+				*(buf++) = (j * panl[i]) >> 7;
+				*(buf++) = (j * panr[i]) >> 7;
+				pos[i] += delta[i];
+			}
+			for ( ; i < MAX_CHANNELS; i++)
+			{
+				*(buf++) = 0;
+				*(buf++) = 0;
+			}
+			loops--;
+		} while ( loops > 0 );
+	} while ( samples > 0 );
+
+	for ( i=0; i<chans; i++ )
+	{
+		ht->ht_Voices[i].vc_SamplePos = pos[i];
+		ht->ht_Voices[i].vc_RingSamplePos = rpos[i];
+	}
+}
+
+static int8_t sources[4][0x280];
+
+static void randomize_tune (struct hvl_tune *ht)
+{
+	int i;
+
+	memset (ht, 0, sizeof (*ht));
+	ht->ht_Channels = 1 + rand () % MAX_CHANNELS;
+	for (i = 0; i < ht->ht_Channels; i++)
+	{
+		struct hvl_voice *voice = &ht->ht_Voices[i];
+		int pan = rand () & 255;
+
+		voice->vc_MixSource = sources[rand () & 3];
+		voice->vc_Delta = 1 + rand () % 0x40000;
+		voice->vc_SamplePos = rand () % (0x280 << 16);
+		voice->vc_VoiceVolume = (rand () & 1) ? 0x40 : rand () & 255;
+		voice->vc_PanMultLeft = panning_left[pan];
+		voice->vc_PanMultRight = panning_right[pan];
+		if (rand () & 1)
+		{
+			voice->vc_RingMixSource = sources[rand () & 3];
+			voice->vc_RingDelta = 1 + rand () % 0x40000;
+			voice->vc_RingSamplePos = rand () % (0x280 << 16);
+		}
+	}
+}
+
+static double now (void)
+{
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+int main (int argc, char *argv[])
+{
+	static int16_t a[4096 * 2 * MAX_CHANNELS];
+	static int16_t b[4096 * 2 * MAX_CHANNELS];
+	struct hvl_tune *ta = malloc (sizeof (*ta));
+	struct hvl_tune *tb = malloc (sizeof (*tb));
+	const int iterations = 20000;
+	double t0, t1, t2;
+	int errors = 0;
+	int i, j;
+
+	hvl_InitReplayer ();
+
+	srand (1);
+	for (i = 0; i < sizeof (sources); i++)
+	{
+		((int8_t *)sources)[i] = rand ();
+	}
+	sources[0][0] = -128; /* the extremes of the multiplications */
+	sources[1][0] = -128;
+
+	for (i = 0; i < iterations; i++)
+	{
+		size_t samples = 1 + rand () % 4096;
+
+		randomize_tune (ta);
+		*tb = *ta;
+		memset (a, 0x55, sizeof (a));
+		memset (b, 0x55, sizeof (b));
+
+		hvl_mixchunk (ta, a, samples);
+		reference_mixchunk (tb, b, samples);
+
+		if (memcmp (a, b, sizeof (a)))
+		{
+			fprintf (stderr, "iteration %d, %d channels, %d samples: output differs\n", i, (int)ta->ht_Channels, (int)samples);
+			errors++;
+			break;
+		}
+		for (j = 0; j < ta->ht_Channels; j++)
+		{
+			if ((ta->ht_Voices[j].vc_SamplePos != tb->ht_Voices[j].vc_SamplePos) ||
+			    (ta->ht_Voices[j].vc_RingSamplePos != tb->ht_Voices[j].vc_RingSamplePos))
+			{
+				fprintf (stderr, "iteration %d, channel %d: positions differ\n", i, j);
+				errors++;
+				break;
+			}
+		}
+		if (errors)
+		{
+			break;
+		}
+	}
+	fprintf (stderr, "%d random chunks: %s\n", i, errors ? "FAILED" : "ok");
+
+	/* benchmark, a typical 4 channel AHX tune, half of the voices with ring modulation */
+	srand (2);
+	do
+	{
+		randomize_tune (ta);
+	} while (ta->ht_Channels < 4);
+	ta->ht_Channels = 4;
+	*tb = *ta;
+
+	t0 = now ();
+	for (i = 0; i < iterations; i++)
+	{
+		hvl_mixchunk (ta, a, 1024);
+	}
+	t1 = now ();
+	for (i = 0; i < iterations; i++)
+	{
+		reference_mixchunk (tb, b, 1024);
+	}
+	t2 = now ();
+	fprintf (stderr, "4 channels x 1024 samples: %.1f ns (reference %.1f ns)\n", (t1 - t0) * 1e9 / iterations, (t2 - t1) * 1e9 / iterations);
+
+	fprintf (stderr, "Final result: %d errors\n", errors);
+
+	free (ta);
+	free (tb);
+
+	return !!errors;
+}
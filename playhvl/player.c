@@ -21,6 +21,9 @@
 #include "config.h"
 #include <math.h>
 #include <string.h>
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
 #include "types.h"
 #include "player.h"
 
@@ -1520,6 +1523,101 @@ static void hvl_play_irq ( struct hvl_tune *ht )
 	}
 }
 
+/* Renders one voice for a block of samples where neither the waveform nor the ring-modulation source wraps.
+ * Output is interleaved stereo with a stride of MAX_CHANNELS voices.
+ */
+static void
+hvl_mixvoice (int16_t *buf, uint32_t loops,
+              const int8_t *src, uint32_t *_pos, uint32_t delta,
+              const int8_t *rsrc, uint32_t *_rpos, uint32_t rdelta,
+              int32_t vol, int32_t panl, int32_t panr)
+{
+	uint32_t pos = *_pos;
+	uint32_t rpos = *_rpos;
+	int32_t j;
+
+#ifdef __SSE2__
+	/* |sample * vol| <= 128 * 255 fits in 16 bits, and so does |(sample * ringsample) >> 7| * vol. The final
+	 * (j * pan) >> 7 is truncated to 16 bits, which are bits 7-22 of the 32 bit product: (lo >> 7) | (hi << 9) */
+	const __m128i v = _mm_set1_epi16 (vol);
+	const __m128i pl = _mm_set1_epi16 (panl);
+	const __m128i pr = _mm_set1_epi16 (panr);
+
+	while (loops >= 8)
+	{
+		__m128i s = _mm_setzero_si128 ();
+		__m128i l, r, lr;
+
+		s = _mm_insert_epi16 (s, src[pos>>16], 0); pos += delta;
+		s = _mm_insert_epi16 (s, src[pos>>16], 1); pos += delta;
+		s = _mm_insert_epi16 (s, src[pos>>16], 2); pos += delta;
+		s = _mm_insert_epi16 (s, src[pos>>16], 3); pos += delta;
+		s = _mm_insert_epi16 (s, src[pos>>16], 4); pos += delta;
+		s = _mm_insert_epi16 (s, src[pos>>16], 5); pos += delta;
+		s = _mm_insert_epi16 (s, src[pos>>16], 6); pos += delta;
+		s = _mm_insert_epi16 (s, src[pos>>16], 7); pos += delta;
+		if (rsrc)
+		{
+			__m128i rs = _mm_setzero_si128 ();
+
+			rs = _mm_insert_epi16 (rs, rsrc[rpos>>16], 0); rpos += rdelta;
+			rs = _mm_insert_epi16 (rs, rsrc[rpos>>16], 1); rpos += rdelta;
+			rs = _mm_insert_epi16 (rs, rsrc[rpos>>16], 2); rpos += rdelta;
+			rs = _mm_insert_epi16 (rs, rsrc[rpos>>16], 3); rpos += rdelta;
+			rs = _mm_insert_epi16 (rs, rsrc[rpos>>16], 4); rpos += rdelta;
+			rs = _mm_insert_epi16 (rs, rsrc[rpos>>16], 5); rpos += rdelta;
+			rs = _mm_insert_epi16 (rs, rsrc[rpos>>16], 6); rpos += rdelta;
+			rs = _mm_insert_epi16 (rs, rsrc[rpos>>16], 7); rpos += rdelta;
+			s = _mm_srai_epi16 (_mm_mullo_epi16 (s, rs), 7);
+		}
+		s = _mm_mullo_epi16 (s, v);
+
+		l = _mm_or_si128 (_mm_srli_epi16 (_mm_mullo_epi16 (s, pl), 7), _mm_slli_epi16 (_mm_mulhi_epi16 (s, pl), 9));
+		r = _mm_or_si128 (_mm_srli_epi16 (_mm_mullo_epi16 (s, pr), 7), _mm_slli_epi16 (_mm_mulhi_epi16 (s, pr), 9));
+
+		lr = _mm_unpacklo_epi16 (l, r);
+		*(int32_t *)(buf + 0 * 2 * MAX_CHANNELS) = _mm_cvtsi128_si32 (lr);
+		*(int32_t *)(buf + 1 * 2 * MAX_CHANNELS) = _mm_cvtsi128_si32 (_mm_srli_si128 (lr, 4));
+		*(int32_t *)(buf + 2 * 2 * MAX_CHANNELS) = _mm_cvtsi128_si32 (_mm_srli_si128 (lr, 8));
+		*(int32_t *)(buf + 3 * 2 * MAX_CHANNELS) = _mm_cvtsi128_si32 (_mm_srli_si128 (lr, 12));
+		lr = _mm_unpackhi_epi16 (l, r);
+		*(int32_t *)(buf + 4 * 2 * MAX_CHANNELS) = _mm_cvtsi128_si32 (lr);
+		*(int32_t *)(buf + 5 * 2 * MAX_CHANNELS) = _mm_cvtsi128_si32 (_mm_srli_si128 (lr, 4));
+		*(int32_t *)(buf + 6 * 2 * MAX_CHANNELS) = _mm_cvtsi128_si32 (_mm_srli_si128 (lr, 8));
+		*(int32_t *)(buf + 7 * 2 * MAX_CHANNELS) = _mm_cvtsi128_si32 (_mm_srli_si128 (lr, 12));
+
+		buf += 8 * 2 * MAX_CHANNELS;
+		loops -= 8;
+	}
+#endif
+
+	if (rsrc)
+	{
+		for (; loops; loops--)
+		{
+			/* Ring Modulation */
+			j = ((src[pos>>16]*rsrc[rpos>>16])>>7)*vol;
+			rpos += rdelta;
+			buf[0] = (j * panl) >> 7;
+			buf[1] = (j * panr) >> 7;
+			buf += 2 * MAX_CHANNELS;
+			pos += delta;
+		}
+	} else {
+		for (; loops; loops--)
+		{
+			j = src[pos>>16]*vol;
+			buf[0] = (j * panl) >> 7;
+			buf[1] = (j * panr) >> 7;
+			buf += 2 * MAX_CHANNELS;
+			pos += delta;
+		}
+	}
+
+	*_pos = pos;
+	*_rpos = rpos;
+}
+
 static void
 hvl_mixchunk (struct hvl_tune *ht, int16_t *buf, size_t samples)
 {
@@ -1533,9 +1631,7 @@ hvl_mixchunk (struct hvl_tune *ht, int16_t *buf, size_t samples)
 	uint32_t  cnt;
 	int32_t   panl[MAX_CHANNELS];
 	int32_t   panr[MAX_CHANNELS];
-//	uint32_t  vu[MAX_CHANNELS];
-	int32_t   j;
-	uint32_t  i, chans, loops;
+	uint32_t  i, n, chans, loops;
 
 	chans = ht->ht_Channels;
 	for ( i=0; i<chans; i++ )
@@ -1551,8 +1647,6 @@ hvl_mixchunk (struct hvl_tune *ht, int16_t *buf, size_t samples)
 		rdelta[i]= ht->ht_Voices[i].vc_RingDelta;
 		rpos[i]  = ht->ht_Voices[i].vc_RingSamplePos;
 		rsrc[i]  = ht->ht_Voices[i].vc_RingMixSource;
-
-//		vu[i] = 0;
 	}
 
 	do
@@ -1586,51 +1680,28 @@ hvl_mixchunk (struct hvl_tune *ht, int16_t *buf, size_t samples)
 
 		samples -= loops;
 
-		// Inner loop
-		do
+		/* Voice parameters are constant until the next wrap, so render one voice at the time for the whole block */
+		for ( i=0; i<chans; i++ )
 		{
-			for ( i=0; i<chans; i++ )
-			{
-				if ( rsrc[i] )
-				{
-					/* Ring Modulation */
-					j = ((src[i][pos[i]>>16]*rsrc[i][rpos[i]>>16])>>7)*vol[i];
-					rpos[i] += rdelta[i];
-				} else {
-					j = src[i][pos[i]>>16]*vol[i];
-				}
-				/*
-				if ( abs( j ) > vu[i] )
-				{
-					vu[i] = abs( j );
-				}
-				*/
+			hvl_mixvoice (buf + 2 * i, loops, src[i], pos + i, delta[i], rsrc[i], rpos + i, rdelta[i], vol[i], panl[i], panr[i]);
+		}
 
-				*(buf++) = (j * panl[i]) >> 7;
-				*(buf++) = (j * panr[i]) >> 7;
-				pos[i] += delta[i];
-			}
-#if 1
-			/* clear non-used channels, just to be nice to the caller */
-			for ( ; i < MAX_CHANNELS; i++)
+		/* clear non-used channels, just to be nice to the caller */
+		if (chans < MAX_CHANNELS)
+		{
+			for ( n=0; n<loops; n++ )
 			{
-				*(buf++) = 0;
-				*(buf++) = 0;
+				memset (buf + n * 2 * MAX_CHANNELS + 2 * chans, 0, (MAX_CHANNELS - chans) * 2 * sizeof (int16_t));
 			}
-#else
-/* Possible micro-optimalization */
-			buf += 2 * (MAX_CHANNELS - chans);
-#endif
+		}
 
-			loops--;
-		} while ( loops > 0 );
+		buf += loops * 2 * MAX_CHANNELS;
 	} while ( samples > 0 );
 
 	for ( i=0; i<chans; i++ )
 	{
 		ht->ht_Voices[i].vc_SamplePos = pos[i];
 		ht->ht_Voices[i].vc_RingSamplePos = rpos[i];
-//		ht->ht_Voices[i].vc_VUMeter = vu[i];
 	}
 }
 
@@ -831,15 +831,13 @@ OCP_INTERNAL int it_load (struct cpifaceSessionAPI_t *cpifaceSession, struct it_
 	return 0;
 }
 
-OCP_INTERNAL void it_free (struct it_module *this)
+OCP_INTERNAL void it_free (struct cpifaceSessionAPI_t *cpifaceSession, struct it_module *this)
 {
 	int i;
 
 	if (this->sampleinfos)
 	{
-		for (i=0; i<this->nsampi; i++)
-			if (this->sampleinfos[i].ptr)
-				free(this->sampleinfos[i].ptr);
+		cpifaceSession->mcpAPI->FreeSamples (this->sampleinfos, this->nsampi);
 		free(this->sampleinfos);
 	}
 	if (this->samples)
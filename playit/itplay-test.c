@@ -0,0 +1,395 @@
+/* OpenCP Module Player
+ * copyright (c) 2026 Stian Skjelstad <stian.skjelstad@gmail.com>
+ *
+ * Test for the order checkpoints used when seeking. After setpos() the
+ * player must be in the same state as it was when the same row was reached
+ * by playing from the start, and stay so for the ticks that follow. Notes
+ * that still sound are not part of the checkpoints, so physical channels are
+ * not compared, and the patterns never depend on them (no portamento to note,
+ * and no instrument without a note). A seek inside the current order must not
+ * use the checkpoints, but keep the notes that are playing. Every other
+ * module starts with a "+++"
+ * skip marker in order 0. The seeks are done in random order, so the silent
+ * walk that makes the checkpoints is resumed from where it stopped.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "itplay.c"
+
+#define NCHAN 4
+#define NPCHAN 16
+#define NPAT 4
+#define NORD 8
+#define PATLEN 32
+#define MAXTICKS 20000
+#define COMPARETICKS 96
+
+static struct itplayer player;
+static void (*player_tick)(struct cpifaceSessionAPI_t *cpifaceSession);
+
+static void test_mcpSet (struct cpifaceSessionAPI_t *cpifaceSession, int ch, int opt, int val)
+{
+}
+
+static int test_mcpGet (struct cpifaceSessionAPI_t *cpifaceSession, int ch, int opt)
+{
+	return opt == mcpCStatus; /* the same as itNullGet(), voices never end by themselves */
+}
+
+static int test_GetFreq6848 (int note)
+{
+	return 6848 + note;
+}
+
+static int test_GetNote (unsigned int freq)
+{
+	return freq / 7;
+}
+
+static int test_OpenPlayer (int chan, void (*p)(struct cpifaceSessionAPI_t *cpifaceSession), struct ocpfilehandle_t *source_file, struct cpifaceSessionAPI_t *cpifaceSession)
+{
+	player_tick = p;
+	cpifaceSession->PhysicalChannelCount = chan;
+	return 1;
+}
+
+static void test_ClosePlayer (struct cpifaceSessionAPI_t *cpifaceSession)
+{
+}
+
+static void test_Normalize (struct cpifaceSessionAPI_t *cpifaceSession, enum mcpNormalizeType Type)
+{
+}
+
+static uint32_t state_hash;
+
+static void hash_add (const void *data, size_t len)
+{
+	const uint8_t *d = data;
+	size_t j;
+	for (j = 0; j < len; j++)
+	{
+		state_hash = (state_hash ^ d[j]) * 16777619;
+	}
+}
+
+#define HASH(x) hash_add (&(x), sizeof (x))
+
+/* everything a checkpoint restores, except what belongs to the physical channels or is only updated through the queue */
+static uint32_t hash_state (void)
+{
+	int i;
+
+	state_hash = 2166136261u;
+	HASH (player.randseed);
+	HASH (player.gotoord);
+	HASH (player.gotorow);
+	HASH (player.manualgoto);
+	HASH (player.patdelayrow);
+	HASH (player.patdelaytick);
+	HASH (player.patptr);
+	HASH (player.speed);
+	HASH (player.tempo);
+	HASH (player.gvol);
+	HASH (player.gvolslide);
+	HASH (player.curtick);
+	HASH (player.currow);
+	HASH (player.curord);
+	for (i = 0; i < NCHAN; i++)
+	{
+		struct it_logchan c = player.channels[i];
+		c.pch = 0;
+		memset (&c.newchan, 0, sizeof (c.newchan));
+		c.realsync = c.realsynctime = 0;
+		c.evpos0 = c.evmodtype = c.evmod = c.evmodpos = c.evpos = c.evtime = 0;
+		HASH (c);
+	}
+	return state_hash;
+}
+
+static uint32_t random_state;
+
+static int random_int (int n)
+{ /* not rand(), so the module does not depend on the C library */
+	random_state = random_state * 1103515245 + 12345;
+	return (random_state >> 16) % n;
+}
+
+/* patterns full of effects that keep state between rows: slides with effect memory, vibrato, tempo and global volume */
+static void random_module (struct it_module *m, int skipfirst, uint8_t (*patdata)[PATLEN * (NCHAN * 6 + 1)], uint16_t *patlens, uint8_t **patterns, uint16_t *orders, struct it_sample *samples, struct it_instrument *instruments, struct it_sampleinfo *sampleinfos)
+{
+	static const uint8_t commands[] =
+	{
+		cmdPortaU, cmdPortaD, cmdVibrato, cmdFineVib, cmdVolSlide, cmdTremolo, cmdTremor, cmdArpeggio,
+		cmdVibVol, cmdChanVol, cmdChanVolSlide, cmdOffset, cmdPanSlide, cmdRetrigger, cmdPanbrello,
+		cmdGVolume, cmdGVolSlide, cmdSpeed, cmdTempo, cmdSpecial, cmdBreak
+	};
+	static const uint8_t specials[] =
+	{
+		cmdSVibType, cmdSTremType, cmdSPanbrType, cmdSPatDelayTick, cmdSNoteCut, cmdSNoteDelay, cmdSPatDelayRow
+	};
+	int i, j, k;
+
+	memset (m, 0, sizeof (*m));
+	m->nchan = NCHAN;
+	m->ninst = 2;
+	m->nsamp = 2;
+	m->nsampi = 2;
+	m->npat = NPAT;
+	m->nord = NORD;
+	m->endord = NORD;
+	m->linear = 1;
+	m->instmode = 1;
+	m->inispeed = 6;
+	m->initempo = 125;
+	m->inigvol = 128;
+	m->chsep = 128;
+	m->samples = samples;
+	m->instruments = instruments;
+	m->sampleinfos = sampleinfos;
+	m->patlens = patlens;
+	m->patterns = patterns;
+	m->orders = orders;
+
+	memset (samples, 0, sizeof (samples[0]) * 2);
+	memset (instruments, 0, sizeof (instruments[0]) * 2);
+	memset (sampleinfos, 0, sizeof (sampleinfos[0]) * 2);
+	for (i = 0; i < 2; i++)
+	{
+		samples[i].handle = i;
+		samples[i].gvl = 64;
+		samples[i].vol = 32 + i * 32;
+		samples[i].dfp = 32;
+		sampleinfos[i].length = 0x10000;
+		sampleinfos[i].samprate = 44100;
+		instruments[i].fadeout = 0x100;
+		instruments[i].gbv = 128;
+		instruments[i].dfp = 128;
+		instruments[i].nna = i * 2; /* cut, and note off that keeps the voice in the background */
+		for (j = 0; j < IT_KEYTABS; j++)
+		{
+			instruments[i].keytab[j][0] = j;
+			instruments[i].keytab[j][1] = 1 + i;
+		}
+	}
+	for (i = 0; i < NCHAN; i++)
+	{
+		m->inipan[i] = (i & 1) ? 48 : 16;
+		m->inivol[i] = 64;
+	}
+
+	for (i = 0; i < NPAT; i++)
+	{
+		uint8_t *p = patdata[i];
+
+		patlens[i] = PATLEN;
+		patterns[i] = p;
+		for (j = 0; j < PATLEN; j++)
+		{
+			for (k = 0; k < NCHAN; k++)
+			{
+				if (random_int (3))
+				{
+					continue;
+				}
+				p[0] = k + 1;
+				p[1] = random_int (4) ? 0 : (random_int (8) ? cmdNNote + 24 + random_int (72) : cmdNNoteCut + random_int (2));
+				p[2] = p[1] ? 1 + random_int (2) : 0; /* never an instrument without a note */
+				p[3] = random_int (3) ? 0 : (random_int (2) ? cmdVVolume + random_int (65) : cmdVVolSlU + random_int (20));
+				p[4] = commands[random_int (sizeof (commands))];
+				p[5] = random_int (3) ? 0 : random_int (256);
+				switch (p[4])
+				{
+					case cmdSpeed:
+						p[5] = 1 + random_int (6);
+						break;
+					case cmdTempo:
+						p[5] = random_int (2) ? random_int (0x20) : 0x40 + random_int (0xc0);
+						break;
+					case cmdSpecial:
+						p[5] = (specials[random_int (sizeof (specials))] << 4) | random_int (4);
+						break;
+					case cmdBreak:
+						if (random_int (8))
+						{
+							p[4] = cmdArpeggio;
+						}
+						p[5] = random_int (PATLEN);
+						break;
+				}
+				p += 6;
+			}
+			*p++ = 0;
+		}
+	}
+	for (i = 0; i < NORD; i++)
+	{
+		orders[i] = random_int (NPAT);
+	}
+	if (skipfirst)
+	{
+		orders[0] = 0xFFFF;
+	}
+}
+
+struct position_t
+{
+	int ord, row;
+	int tick; /* the first tick of the row when played from the start */
+};
+
+int main (int argc, char *argv[])
+{
+	static uint8_t patdata[NPAT][PATLEN * (NCHAN * 6 + 1)];
+	static uint32_t linear[MAXTICKS];
+	static struct position_t rows[MAXTICKS];
+	uint16_t patlens[NPAT];
+	uint8_t *patterns[NPAT];
+	uint16_t orders[NORD];
+	struct it_sample samples[2];
+	struct it_instrument instruments[2];
+	struct it_sampleinfo sampleinfos[2];
+	struct it_module m;
+	struct mcpAPI_t api;
+	struct mcpDevAPI_t devapi;
+	struct cpifaceSessionAPI_t session;
+	int seeds = 20;
+	int errors = 0;
+	int seed;
+
+	memset (&api, 0, sizeof (api));
+	api.GetFreq6848 = test_GetFreq6848;
+	api.GetNote6848 = test_GetNote;
+	api.GetNote8363 = test_GetNote;
+	memset (&devapi, 0, sizeof (devapi));
+	devapi.OpenPlayer = test_OpenPlayer;
+	devapi.ClosePlayer = test_ClosePlayer;
+	memset (&session, 0, sizeof (session));
+	session.mcpAPI = &api;
+	session.mcpDevAPI = &devapi;
+	session.mcpSet = test_mcpSet;
+	session.mcpGet = test_mcpGet;
+	session.Normalize = test_Normalize;
+
+	for (seed = 0; seed < seeds; seed++)
+	{
+		int nrows = 0;
+		int ticks, i, j;
+		int seekerrors = 0;
+
+		random_state = seed;
+		random_module (&m, seed & 1, patdata, patlens, patterns, orders, samples, instruments, sampleinfos);
+
+		memset (&player, 0, sizeof (player));
+		if (itplay (&player, &m, NPCHAN, 0, &session))
+		{
+			fprintf (stderr, "seed %d: itplay() failed\n", seed);
+			errors++;
+			continue;
+		}
+		if (player.checkpointticks)
+		{
+			fprintf (stderr, "seed %d: itplay() walked the module, that is only done when seeking\n", seed);
+			errors++;
+		}
+		for (ticks = 0; ticks < MAXTICKS; ticks++)
+		{
+			int nextrow = ((player.curtick+1)==(player.speed+player.patdelaytick)) && (!player.patdelayrow);
+
+			linear[ticks] = hash_state ();
+			player_tick (&session);
+			if (nextrow && !player.looped)
+			{ /* only the first time through the song, checkpoints are not made after it loops */
+				for (i = 0; i < nrows; i++)
+				{
+					if ((rows[i].ord == player.curord) && (rows[i].row == player.currow))
+					{
+						break;
+					}
+				}
+				if (i == nrows)
+				{
+					rows[nrows].ord = player.curord;
+					rows[nrows].row = player.currow;
+					rows[nrows].tick = ticks;
+					nrows++;
+				}
+			}
+		}
+
+		for (i = nrows - 1; i > 0; i--)
+		{
+			struct position_t temp = rows[i];
+			j = random_int (i + 1);
+			rows[i] = rows[j];
+			rows[j] = temp;
+		}
+		for (i = 0; i < nrows; i++)
+		{
+			if (player.curord == rows[i].ord)
+			{
+				int notecut[NPCHAN];
+				for (j = 0; j < NPCHAN; j++)
+				{
+					notecut[j] = player.pchannels[j].notecut;
+				}
+				setpos (&player, rows[i].ord, rows[i].row);
+				for (j = 0; j < NPCHAN; j++)
+				{
+					if (player.pchannels[j].notecut != notecut[j])
+					{
+						if (!seekerrors)
+						{
+							fprintf (stderr, "seed %d: seek to row %d inside order %d cut the notes\n", seed, rows[i].row, rows[i].ord);
+						}
+						seekerrors++;
+						break;
+					}
+				}
+				/* the checkpoint is only restored when coming from another order */
+				for (j = 0; (j < nrows) && (rows[j].ord == rows[i].ord); j++)
+				{
+				}
+				if (j == nrows)
+				{
+					continue;
+				}
+				setpos (&player, rows[j].ord, rows[j].row);
+			}
+			setpos (&player, rows[i].ord, rows[i].row);
+			for (j = 0; (j < COMPARETICKS) && ((rows[i].tick + j) < MAXTICKS); j++)
+			{
+				if (hash_state () != linear[rows[i].tick + j])
+				{
+					if (!seekerrors)
+					{
+						fprintf (stderr, "seed %d: seek to order %d row %d differs at tick %d\n", seed, rows[i].ord, rows[i].row, j);
+					}
+					seekerrors++;
+					break;
+				}
+				player_tick (&session);
+			}
+		}
+		fprintf (stderr, "seed %d: %d rows%s, %s\n", seed, nrows, (orders[0] == 0xFFFF) ? " (starts with +++)" : "", seekerrors ? "FAILED" : "ok");
+		errors += seekerrors;
+
+		itstop (&session, &player);
+	}
+
+	fprintf (stderr, "Final result: %d errors\n", errors);
+	return !!errors;
+}
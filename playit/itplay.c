@@ -96,6 +96,32 @@ static int it_random(struct itplayer *this)
 
 static struct itplayer *staticthis=NULL;
 
+/* Player state just before the tick that starts an order. They are recorded by playing the module silently from the
+ * start, so that a seek gets the effect memory, tempo and volumes it would have had when played from the start. The
+ * silent walk is only done as far as a seek needs it, and continues from where it stopped on the next seek.
+ * Physical channels are not part of it, notes that still sound at that point are not restored.
+ */
+struct itcheckpoint
+{
+	int row; /* the row the order was entered at */
+	int randseed;
+	int gotoord;
+	int gotorow;
+	int manualgoto;
+	int patdelayrow;
+	int patdelaytick;
+	uint8_t *patptr;
+	int speed;
+	int tempo;
+	int gvol;
+	int gvolslide;
+	int curtick;
+	int currow;
+	int curord;
+	struct it_logchan channels[]; /* nchan entries */
+};
+#define IT_CHECKPOINT_MAXTICKS 0x100000
+
 static int8_t sintab[256] =
 {
 	  0,   2,   3,   5,   6,   8,   9,  11,  12,  14,  16,  17,  19,  20,
@@ -1826,6 +1852,241 @@ static void playtick (struct cpifaceSessionAPI_t *cpifaceSession, struct itplaye
 	putque(this, quePos, -1, (this->curtick&0xFF)|(this->currow<<8)|(this->curord<<16));
 }
 
+static void itNullSet (struct cpifaceSessionAPI_t *cpifaceSession, int ch, int opt, int val)
+{
+}
+
+static int itNullGet (struct cpifaceSessionAPI_t *cpifaceSession, int ch, int opt)
+{
+	return opt==mcpCStatus; /* voices never end by themselves */
+}
+
+static void itSaveState (struct itplayer *this, struct itcheckpoint *c)
+{
+	c->randseed=this->randseed;
+	c->gotoord=this->gotoord;
+	c->gotorow=this->gotorow;
+	c->manualgoto=this->manualgoto;
+	c->patdelayrow=this->patdelayrow;
+	c->patdelaytick=this->patdelaytick;
+	c->patptr=this->patptr;
+	c->speed=this->speed;
+	c->tempo=this->tempo;
+	c->gvol=this->gvol;
+	c->gvolslide=this->gvolslide;
+	c->curtick=this->curtick;
+	c->currow=this->currow;
+	c->curord=this->curord;
+	memcpy (c->channels, this->channels, sizeof (struct it_logchan) * this->nchan);
+}
+
+static void itLoadState (struct itplayer *this, const struct itcheckpoint *c)
+{
+	int i;
+
+	this->randseed=c->randseed;
+	this->gotoord=c->gotoord;
+	this->gotorow=c->gotorow;
+	this->manualgoto=c->manualgoto;
+	this->patdelayrow=c->patdelayrow;
+	this->patdelaytick=c->patdelaytick;
+	this->patptr=c->patptr;
+	this->speed=c->speed;
+	this->tempo=c->tempo;
+	this->gvol=c->gvol;
+	this->gvolslide=c->gvolslide;
+	this->curtick=c->curtick;
+	this->currow=c->currow;
+	this->curord=c->curord;
+	for (i=0; i<this->nchan; i++)
+	{
+		int mute=this->channels[i].mute; /* set by the user, not by the module */
+		this->channels[i]=c->channels[i];
+		this->channels[i].mute=mute;
+		this->channels[i].pch=0;
+	}
+}
+
+/* like itLoadState(), but the logical channels are taken as they are, including mute and the physical channels */
+static void itRestoreState (struct itplayer *this, const struct itcheckpoint *c)
+{
+	itLoadState (this, c);
+	memcpy (this->channels, c->channels, sizeof (struct it_logchan) * this->nchan);
+}
+
+static void itResetSilentChannels (struct it_physchan *pchannels, int ch)
+{
+	int i;
+
+	memset (pchannels, 0, sizeof (struct it_physchan) * ch);
+	for (i=0; i<ch; i++)
+	{
+		pchannels[i].no=i;
+		pchannels[i].lch=-1;
+	}
+}
+
+static void itFreeCheckpoints (struct itplayer *this)
+{
+	int i;
+
+	if (this->checkpoints)
+	{
+		for (i=0; i<this->nord; i++)
+		{
+			free (this->checkpoints[i]);
+		}
+		free (this->checkpoints);
+		this->checkpoints=NULL;
+	}
+	free (this->checkpointscratch);
+	this->checkpointscratch=NULL;
+	free (this->checkpointwalk);
+	this->checkpointwalk=NULL;
+	free (this->checkpointlive);
+	this->checkpointlive=NULL;
+	free (this->silentpchannels);
+	this->silentpchannels=NULL;
+	free (this->walkpchannels);
+	this->walkpchannels=NULL;
+	free (this->silentsession);
+	this->silentsession=NULL;
+}
+
+/* the silent walk starts from the state the module is loaded with. Without memory, seeks use the old jump */
+static void itInitCheckpoints (struct cpifaceSessionAPI_t *cpifaceSession, struct itplayer *this, int ch)
+{
+	size_t size = sizeof (struct itcheckpoint) + sizeof (struct it_logchan) * this->nchan;
+
+	this->checkpoints=calloc (this->nord, sizeof (this->checkpoints[0]));
+	this->checkpointscratch=malloc (size);
+	this->checkpointwalk=malloc (size);
+	this->checkpointlive=malloc (size);
+	this->silentpchannels=malloc (sizeof (struct it_physchan) * ch);
+	this->walkpchannels=malloc (sizeof (struct it_physchan) * ch);
+	this->silentsession=malloc (sizeof (*this->silentsession));
+	if ((!this->checkpoints) || (!this->checkpointscratch) || (!this->checkpointwalk) || (!this->checkpointlive) ||
+	    (!this->silentpchannels) || (!this->walkpchannels) || (!this->silentsession))
+	{
+		itFreeCheckpoints (this);
+		return;
+	}
+	*this->silentsession=*cpifaceSession;
+	this->silentsession->mcpSet=itNullSet;
+	this->silentsession->mcpGet=itNullGet;
+
+	itResetSilentChannels (this->walkpchannels, ch);
+	itSaveState (this, this->checkpointwalk);
+	this->checkpointticks=0;
+}
+
+/* Continues the silent walk until ord has a checkpoint, or the module loops. Only used by setpos(), which empties the
+ * queue afterwards.
+ */
+static void itWalkCheckpoints (struct itplayer *this, int ord)
+{
+	size_t size = sizeof (struct itcheckpoint) + sizeof (struct it_logchan) * this->nchan;
+	struct it_physchan *pchannels=this->pchannels;
+	int noloop=this->noloop;
+	int looped=this->looped;
+
+	itSaveState (this, this->checkpointlive);
+	itRestoreState (this, this->checkpointwalk);
+	this->pchannels=this->walkpchannels;
+	this->noloop=0;
+	this->looped=0;
+	this->querpos=this->quewpos=0;
+
+	while ((!this->checkpoints[ord]) && (this->checkpointticks<IT_CHECKPOINT_MAXTICKS) && (!this->looped))
+	{
+		int nextrow = ((this->curtick+1)==(this->speed+this->patdelaytick)) && (!this->patdelayrow);
+		int o = this->curord;
+
+		if (nextrow)
+		{
+			itSaveState (this, this->checkpointscratch);
+		}
+		playtick (this->silentsession, this);
+		/* the first order reached is recorded as well, even if the module does not start with order 0 */
+		if (nextrow && ((this->curord!=o) || (!this->checkpointticks)) && (!this->looped) && (!this->checkpoints[this->curord]))
+		{
+			if (!(this->checkpoints[this->curord]=malloc (size)))
+			{
+				this->looped=1; /* stop here, the orders not reached yet use the old jump */
+				break;
+			}
+			memcpy (this->checkpoints[this->curord], this->checkpointscratch, size);
+			this->checkpoints[this->curord]->row=this->currow;
+		}
+		this->checkpointticks++;
+	}
+	if (this->looped || (this->checkpointticks>=IT_CHECKPOINT_MAXTICKS))
+	{
+		this->checkpointticks=-1;
+	}
+
+	itSaveState (this, this->checkpointwalk);
+	itRestoreState (this, this->checkpointlive);
+	this->pchannels=pchannels;
+	this->noloop=noloop;
+	this->looped=looped;
+}
+
+/* restores the checkpoint of ord, and plays silently until row is reached. Returns non-zero on failure */
+static int itSeekCheckpoint (struct itplayer *this, int ord, int row)
+{
+	const struct itcheckpoint *c;
+	struct it_physchan *pchannels=this->pchannels;
+	int noloop=this->noloop;
+	int looped=this->looped;
+	int retval=-1;
+	int ticks;
+
+	if (!this->checkpoints)
+	{
+		return -1;
+	}
+	if ((!this->checkpoints[ord]) && (this->checkpointticks>=0))
+	{
+		itWalkCheckpoints (this, ord);
+	}
+	c=this->checkpoints[ord];
+	if ((!c) || (row<c->row))
+	{
+		return -1;
+	}
+	itResetSilentChannels (this->silentpchannels, this->npchan);
+	this->pchannels=this->silentpchannels;
+	this->noloop=0;
+	itLoadState (this, c);
+
+	for (ticks=0; ticks<IT_CHECKPOINT_MAXTICKS; ticks++)
+	{
+		int nextrow = ((this->curtick+1)==(this->speed+this->patdelaytick)) && (!this->patdelayrow);
+
+		if (nextrow)
+		{
+			itSaveState (this, this->checkpointscratch);
+		}
+		playtick (this->silentsession, this);
+		if (this->curord!=ord)
+		{ /* jumped away before row was reached */
+			break;
+		}
+		if (nextrow && (this->currow==row))
+		{
+			itLoadState (this, this->checkpointscratch);
+			retval=0;
+			break;
+		}
+	}
+
+	this->pchannels=pchannels;
+	this->noloop=noloop;
+	this->looped=looped;
+	return retval;
+}
+
 OCP_INTERNAL int loadsamples (struct cpifaceSessionAPI_t *cpifaceSession, struct it_module *m)
 {
 	return cpifaceSession->mcpDevAPI->LoadSamples (cpifaceSession, m->sampleinfos, m->nsampi);
@@ -1886,6 +2147,7 @@ OCP_INTERNAL int itplay (struct itplayer *this, const struct it_module *m, int c
 	{
 		return errFormStruc;
 	}
+	this->gotoord=this->curord; /* not 0, going back to a "+++" in front of it would count as a loop */
 
 	this->channels=malloc(sizeof(struct it_logchan)*this->nchan);
 	this->pchannels=malloc(sizeof(struct it_physchan)*ch);
@@ -1930,8 +2192,14 @@ OCP_INTERNAL int itplay (struct itplayer *this, const struct it_module *m, int c
 		c->tremoroffcounter=0;
 	}
 
+	itInitCheckpoints (cpifaceSession, this, ch);
+	this->realtempo=this->tempo;
+	this->realspeed=this->speed;
+	this->realgvol=this->gvol;
+
 	if (!cpifaceSession->mcpDevAPI->OpenPlayer(ch, playtickstatic, file, cpifaceSession))
 	{
+		itFreeCheckpoints (this);
 		return errPlay;
 	}
 
@@ -1945,6 +2213,7 @@ OCP_INTERNAL int itplay (struct itplayer *this, const struct it_module *m, int c
 OCP_INTERNAL void itstop (struct cpifaceSessionAPI_t *cpifaceSession, struct itplayer *this)
 {
 	cpifaceSession->mcpDevAPI->ClosePlayer (cpifaceSession);
+	itFreeCheckpoints (this);
 	if (this->channels)
 	{
 		free(this->channels);
@@ -2004,23 +2273,31 @@ OCP_INTERNAL void itplayer_getrealvol (struct cpifaceSessionAPI_t *cpifaceSessio
 
 OCP_INTERNAL void setpos (struct itplayer *this, int ord, int row)
 {
+	int oldord=this->curord;
+	int failed;
 	int i;
-	if (this->curord!=ord)
-		for (i=0; i<this->npchan; i++)
-			this->pchannels[i].notecut=1;
-	this->curtick=this->speed-1;
-	this->patdelaytick=0;
-	this->patdelayrow=0;
 	if ((ord==this->curord)&&(row>this->patlens[this->orders[this->curord]]))
 	{
 		row=0;
 		ord++;
 	}
-	this->gotorow=(row>0xFF)?0xFF:(row<0)?0:row;
-	this->gotoord=((ord>=this->nord)||(ord<0))?0:ord;
-	this->manualgoto=1;
+	row=(row>0xFF)?0xFF:(row<0)?0:row;
+	ord=((ord>=this->nord)||(ord<0))?0:ord;
+	/* a jump inside the current order keeps the notes that are playing, checkpoints can not restore them */
+	failed=(oldord!=ord)?itSeekCheckpoint (this, ord, row):-1; /* this might walk to ord, and add its checkpoint */
 	this->querpos=this->quewpos=0;
-	this->realpos=(this->gotorow<<8)|(this->gotoord<<16);
+	this->realpos=(row<<8)|(ord<<16);
+	if (oldord!=ord)
+		for (i=0; i<this->npchan; i++)
+			this->pchannels[i].notecut=1;
+	if (!failed)
+		return;
+	this->curtick=this->speed-1;
+	this->patdelaytick=0;
+	this->patdelayrow=0;
+	this->gotorow=row;
+	this->gotoord=ord;
+	this->manualgoto=1;
 }
 
 OCP_INTERNAL int getdotsdata (struct cpifaceSessionAPI_t *cpifaceSession, struct itplayer *this, int ch, int pch, int *smp, int *note, int *voll, int *volr, int *sus)
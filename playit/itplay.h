@@ -110,9 +110,10 @@ struct it_module
 struct cpifaceSessionAPI_t;
 struct ocpfilehandle_t;
 OCP_INTERNAL int  it_load (struct cpifaceSessionAPI_t *cpifaceSession, struct it_module *, struct ocpfilehandle_t *); /* done */
-OCP_INTERNAL void it_free (struct it_module *); /* done */
+OCP_INTERNAL void it_free (struct cpifaceSessionAPI_t *cpifaceSession, struct it_module *); /* done */
 OCP_INTERNAL void it_optimizepatlens (struct it_module *); /* done */
 OCP_INTERNAL int  it_precalctime (struct it_module *, int startpos, int (*calctimer)[2], int calcn, int ite); /* done */
+OCP_INTERNAL void it_timestart (struct cpifaceSessionAPI_t *cpifaceSession, struct it_module *); /* calculates song-time table in the background */
 
 OCP_INTERNAL int decompress8 (struct cpifaceSessionAPI_t *cpifaceSession, struct ocpfilehandle_t *, void *dst, int len, char it215); /* done */
 OCP_INTERNAL int decompress16(struct cpifaceSessionAPI_t *cpifaceSession, struct ocpfilehandle_t *, void *dst, int len, char it215); /* done */
@@ -358,6 +359,15 @@ struct itplayer
 	int realspeed;
 	int realgvol;
 
+	struct itcheckpoint **checkpoints; /* one per order, NULL if the order is not reached (yet) */
+	struct itcheckpoint *checkpointscratch;
+	struct itcheckpoint *checkpointwalk; /* where the silent walk stopped */
+	struct itcheckpoint *checkpointlive; /* the state of the playback, while walking */
+	int checkpointticks; /* ticks walked so far, -1 when the module has looped */
+	struct it_physchan *silentpchannels; /* used instead of pchannels while seeking silently */
+	struct it_physchan *walkpchannels; /* used instead of pchannels while walking, kept between the walks */
+	struct cpifaceSessionAPI_t *silentsession; /* copy of the session with a mixer that does nothing */
+
 	enum
 	{
 		quePos, queSync, queTempo, queSpeed, queGVol
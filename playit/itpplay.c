@@ -57,6 +57,12 @@ static struct it_module mod;
 static struct it_instrument *insts;
 static struct it_sample *samps;
 
+static void itpSongTimeSeek (struct cpifaceSessionAPI_t *cpifaceSession)
+{ /* let the timer follow the seek, realpos already holds the new position */
+	int p = getrealpos (cpifaceSession, &itplayer);
+	cpifaceSession->SongTimeSeek (cpifaceSession, p>>16, (p>>8)&0xFF);
+}
+
 static int itpProcessKey(struct cpifaceSessionAPI_t *cpifaceSession, uint16_t key)
 {
 	int row;
@@ -92,24 +98,28 @@ static int itpProcessKey(struct cpifaceSessionAPI_t *cpifaceSession, uint16_t ke
 			p=getpos(&itplayer);
 			pat=p>>16;
 			setpos(&itplayer, pat-1, 0);
+			itpSongTimeSeek (cpifaceSession);
 			break;
 		case '>':
 		case KEY_CTRL_RIGHT:
 			p=getpos(&itplayer);
 			pat=p>>16;
 			setpos(&itplayer, pat+1, 0);
+			itpSongTimeSeek (cpifaceSession);
 			break;
 		case KEY_CTRL_UP:
 			p=getpos(&itplayer);
 			pat=p>>16;
 			row=(p>>8)&0xFF;
 			setpos(&itplayer, pat, row-8);
+			itpSongTimeSeek (cpifaceSession);
 			break;
 		case KEY_CTRL_DOWN:
 			p=getpos(&itplayer);
 			pat=p>>16;
 			row=(p>>8)&0xFF;
 			setpos(&itplayer, pat, row+8);
+			itpSongTimeSeek (cpifaceSession);
 			break;
 		default:
 			return 0;
@@ -162,7 +172,7 @@ static void itpDrawGStrings (struct cpifaceSessionAPI_t *cpifaceSession)
 static void itpCloseFile (struct cpifaceSessionAPI_t *cpifaceSession)
 {
 	itstop (cpifaceSession, &itplayer);
-	it_free(&mod);
+	it_free (cpifaceSession, &mod);
 }
 
 /**********************************************************************/
@@ -253,7 +263,7 @@ static int itpOpenFile (struct cpifaceSessionAPI_t *cpifaceSession, struct modul
 
 	if (retval)
 	{
-		it_free(&mod);
+		it_free (cpifaceSession, &mod);
 		return retval;
 	}
 
@@ -262,7 +272,7 @@ static int itpOpenFile (struct cpifaceSessionAPI_t *cpifaceSession, struct modul
 	nch = cpifaceSession->configAPI->GetProfileInt2 (cpifaceSession->configAPI->SoundSec, "sound", "itchan", 64, 10);
 	if ((retval = itplay(&itplayer, &mod, nch, file, cpifaceSession)))
 	{
-		it_free(&mod);
+		it_free (cpifaceSession, &mod);
 		return retval;
 	}
 
@@ -278,6 +288,7 @@ static int itpOpenFile (struct cpifaceSessionAPI_t *cpifaceSession, struct modul
 	itChanSetup (cpifaceSession, insts, samps);
 	itpInstSetup (cpifaceSession, mod.instruments, mod.ninst, mod.samples, mod.nsamp, mod.sampleinfos, /*mod.nsampi,*/ 0, itpMarkInsSamp);
 	itTrkSetup (cpifaceSession, &mod);
+	it_timestart (cpifaceSession, &mod);
 	if (mod.message)
 	{
 		cpifaceSession->UseMessage(mod.message);
@@ -31,215 +31,316 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include "types.h"
+#include "cpiface/cpiface.h"
 #include "itplay.h"
 
-OCP_INTERNAL int it_precalctime (struct it_module *this, int startpos, int (*calctimer)[2], int calcn, int ite)
+static struct it_module *this;
+static uint8_t *patptr;
+
+static int patdelaytick;
+static int patdelayrow;
+static int cursync;
+static int looped;
+static int gotorow;
+static int gotoord;
+static int curord;
+static int currow;
+
+static int curspeed;
+static int curtick;
+
+static int tempo;
+static int timerval;
+static int timerfrac;
+
+static uint8_t tempos[64];
+static uint8_t cmds[64];
+static uint8_t specials[64];
+static uint8_t patloopcount[64];
+static uint8_t patloopstart[64];
+
+static int (*calctimer)[2];
+static int calcn;
+
+static struct cpifaceSessionAPI_t *timesession; /* set while the song-time table is calculated in the background */
+static int timelooped;
+static uint32_t timelength;
+
+static void it_timereset (struct it_module *m, int startpos, int (*calc)[2], int n)
 {
-	uint8_t *patptr=0;
-
-	int patdelaytick=0;
-	int patdelayrow=0;
-	int sync=-1;
-	int looped=0;
-	int gotorow=(startpos>>8)&0xFF;
-	int gotoord=startpos&0xFF;
-	int curord=-1;
-	int currow=-1;
-
-	int curspeed=this->inispeed;
-	int curtick=this->inispeed-1;
-
-	/* int loopord=0;   unused */
-	int tempo=this->initempo;
-	int timerval=0;
-	int timerfrac=0;
-
-	uint8_t tempos[64];
-	uint8_t cmds[64];
-	uint8_t specials[64];
-	uint8_t patloopcount[64];
-	uint8_t patloopstart[64];
+	this=m;
+	patptr=0;
 
-	int it;
+	patdelaytick=0;
+	patdelayrow=0;
+	cursync=-1;
+	looped=0;
+	gotorow=(startpos>>8)&0xFF;
+	gotoord=startpos&0xFF;
+	curord=-1;
+	currow=-1;
+
+	curspeed=this->inispeed;
+	curtick=this->inispeed-1;
+
+	tempo=this->initempo;
+	timerval=0;
+	timerfrac=0;
+
+	calctimer=calc;
+	calcn=n;
+
+	timesession=0;
+	timelooped=0;
+	timelength=0;
 
 	memset(tempos, 0, this->nchan);
 	memset(specials, 0, this->nchan);
 	memset(cmds, 0, this->nchan);
+	memset(patloopcount, 0, this->nchan);
+	memset(patloopstart, 0, this->nchan);
+}
 
+/* returns 1 when all entries in calctimer has been resolved */
+static int it_findtick (void)
+{
+	int i;
+	int p;
 
-	for (it=0; it<ite; it++)
+	curtick++;
+	if ((curtick==(curspeed+patdelaytick))&&patdelayrow)
 	{
-		int i;
-		int p;
-
-		curtick++;
-		if ((curtick==(curspeed+patdelaytick))&&patdelayrow)
+		curtick=0;
+		patdelayrow--;
+	}
+	if (curtick==(curspeed+patdelaytick))
+	{
+		patdelaytick=0;
+		curtick=0;
+		currow++;
+		if ((gotoord==-1)&&(currow==this->patlens[this->orders[curord]]))
 		{
-			curtick=0;
-			patdelayrow--;
+			gotoord=curord+1;
+			gotorow=0;
 		}
-		if (curtick==(curspeed+patdelaytick))
+		if (gotoord!=-1)
 		{
-			patdelaytick=0;
-			curtick=0;
-			currow++;
-			if ((gotoord==-1)&&(currow==this->patlens[this->orders[curord]]))
+			if (gotoord!=curord)
 			{
-				gotoord=curord+1;
-				gotorow=0;
+				memset(patloopcount, 0, this->nchan);
+				memset(patloopstart, 0, this->nchan);
 			}
-			if (gotoord!=-1)
-			{
-				if (gotoord!=curord)
-				{
-					memset(patloopcount, 0, this->nchan);
-					memset(patloopstart, 0, this->nchan);
-				}
 
-				if (gotoord>=this->endord)
-					gotoord=0;
+			if (gotoord>=this->endord)
+				gotoord=0;
+			while (this->orders[gotoord]==0xFFFF)
+				gotoord++;
+			if (gotoord==this->endord)
+				gotoord=0;
+			if (gotorow>=this->patlens[this->orders[gotoord]])
+			{
+				gotoord++;
+				gotorow=0;
 				while (this->orders[gotoord]==0xFFFF)
 					gotoord++;
 				if (gotoord==this->endord)
 					gotoord=0;
-				if (gotorow>=this->patlens[this->orders[gotoord]])
-				{
-					gotoord++;
-					gotorow=0;
-					while (this->orders[gotoord]==0xFFFF)
-						gotoord++;
-					if (gotoord==this->endord)
-						gotoord=0;
-				}
-				if (gotoord<curord)
-					looped=1;
-				curord=gotoord;
-				patptr=this->patterns[this->orders[curord]];
-				for (currow=0; currow<gotorow; currow++)
-				{
-					while (*patptr)
-						patptr+=6;
-					patptr++;
-				}
-				gotoord=-1;
 			}
-
-			for (i=0; i<this->nchan; i++)
-				cmds[i]=0;
-			if (!patptr)
+			if (gotoord<curord)
+				looped=1;
+			curord=gotoord;
+			patptr=this->patterns[this->orders[curord]];
+			for (currow=0; currow<gotorow; currow++)
 			{
-				fprintf(stderr, "playit: ittime.c: patptr not set\n");
-				abort();
+				while (*patptr)
+					patptr+=6;
+				patptr++;
 			}
-			while (*patptr)
+			gotoord=-1;
+		}
+
+		for (i=0; i<this->nchan; i++)
+			cmds[i]=0;
+		if (!patptr)
+		{
+			fprintf(stderr, "playit: ittime.c: patptr not set\n");
+			abort();
+		}
+		while (*patptr)
+		{
+			int ch=*patptr++-1;
+
+			int data=patptr[4];
+
+			cmds[ch]=patptr[3];
+			switch (cmds[ch])
 			{
-				int ch=*patptr++-1;
-
-				int data=patptr[4];
-
-				cmds[ch]=patptr[3];
-				switch (cmds[ch])
-				{
-					case cmdSpeed:
-						if (data)
-							curspeed=data;
-						break;
-					case cmdJump:
-						gotorow=0;
-						gotoord=data;
-						break;
-					case cmdBreak:
-						if (gotoord==-1)
-							gotoord=curord+1;
-						gotorow=data;
-						break;
-					case cmdSpecial:
-						if (data)
-							specials[ch]=data;
-						switch (specials[ch]>>4)
-						{
-							case cmdSPatDelayTick:
-								patdelaytick=specials[ch]&0xF;
-								break;
-							case cmdSPatLoop:
-								if (!(specials[ch]&0xF))
-									patloopstart[ch]=currow;
-								else {
-									patloopcount[ch]++;
-									if (patloopcount[ch]<=(specials[ch]&0xF))
-									{
-										gotorow=patloopstart[ch];
-										gotoord=curord;
-									} else {
-										patloopcount[ch]=0;
-										patloopstart[ch]=currow+1;
-									}
+				case cmdSpeed:
+					if (data)
+						curspeed=data;
+					break;
+				case cmdJump:
+					gotorow=0;
+					gotoord=data;
+					break;
+				case cmdBreak:
+					if (gotoord==-1)
+						gotoord=curord+1;
+					gotorow=data;
+					break;
+				case cmdSpecial:
+					if (data)
+						specials[ch]=data;
+					switch (specials[ch]>>4)
+					{
+						case cmdSPatDelayTick:
+							patdelaytick=specials[ch]&0xF;
+							break;
+						case cmdSPatLoop:
+							if (!(specials[ch]&0xF))
+								patloopstart[ch]=currow;
+							else {
+								patloopcount[ch]++;
+								if (patloopcount[ch]<=(specials[ch]&0xF))
+								{
+									gotorow=patloopstart[ch];
+									gotoord=curord;
+								} else {
+									patloopcount[ch]=0;
+									patloopstart[ch]=currow+1;
 								}
-								break;
-							case cmdSPatDelayRow:
-								patdelayrow=specials[ch]&0xF;
-								break;
-						}
-						break;
-					case cmdTempo:
-						if (data)
-							tempos[ch]=data;
-						if (tempos[ch]>=0x20)
-							tempo=tempos[ch];
-						break;
+							}
+							break;
+						case cmdSPatDelayRow:
+							patdelayrow=specials[ch]&0xF;
+							break;
+					}
+					break;
+				case cmdTempo:
+					if (data)
+						tempos[ch]=data;
+					if (tempos[ch]>=0x20)
+						tempo=tempos[ch];
+					break;
 #if 0
-					TODO this upcode is invalid
-					case cmdSync:
-						sync=data;
-						break;
+				TODO this upcode is invalid
+				case cmdSync:
+					cursync=data;
+					break;
 #endif
-				}
-				patptr+=5;
 			}
-			patptr++;
-		} else
-			for (i=0; i<this->nchan; i++)
-				if ((cmds[i]==cmdTempo)&&(tempos[i]<0x20))
-				{
-					tempo+=(tempos[i]<0x10)?-tempos[i]:(tempos[i]&0xF);
-					tempo=(tempo<0x20)?0x20:(tempo>0xFF)?0xFF:tempo;
-				}
+			patptr+=5;
+		}
+		patptr++;
+	} else
+		for (i=0; i<this->nchan; i++)
+			if ((cmds[i]==cmdTempo)&&(tempos[i]<0x20))
+			{
+				tempo+=(tempos[i]<0x10)?-tempos[i]:(tempos[i]&0xF);
+				tempo=(tempo<0x20)?0x20:(tempo>0xFF)?0xFF:tempo;
+			}
+
 
 
+	p=(curord<<16)|(currow<<8)|curtick;
+	for (i=0; i<calcn; i++)
+		if ((p==calctimer[i][0])&&(calctimer[i][1]<0))
+			if (!++calctimer[i][1])
+				calctimer[i][1]=timerval;
 
-		p=(curord<<16)|(currow<<8)|curtick;
+	if (cursync!=-1)
 		for (i=0; i<calcn; i++)
-			if ((p==calctimer[i][0])&&(calctimer[i][1]<0))
+			if ((calctimer[i][0]==(-256-cursync))&&(calctimer[i][1]<0))
 				if (!++calctimer[i][1])
 					calctimer[i][1]=timerval;
 
-		if (sync!=-1)
-			for (i=0; i<calcn; i++)
-				if ((calctimer[i][0]==(-256-sync))&&(calctimer[i][1]<0))
-					if (!++calctimer[i][1])
-						calctimer[i][1]=timerval;
+	cursync=-1;
 
-		sync=-1;
+	if (looped)
+		for (i=0; i<calcn; i++)
+			if ((calctimer[i][0]==-1)&&(calctimer[i][1]<0))
+				if (!++calctimer[i][1])
+					calctimer[i][1]=timerval;
 
+	if (timesession&&!curtick)
+	{
 		if (looped)
-			for (i=0; i<calcn; i++)
-				if ((calctimer[i][0]==-1)&&(calctimer[i][1]<0))
-					if (!++calctimer[i][1])
-						calctimer[i][1]=timerval;
+		{
+			timelooped=1;
+			timelength=timerval;
+		} else
+			timesession->SongTimeRow (timesession, curord, currow, timerval);
+	}
 
-		looped=0;
+	looped=0;
 
-		timerfrac+=4096*163840/tempo;
-		timerval+=timerfrac>>12;
-		timerfrac&=4095;
+	timerfrac+=4096*163840/tempo;
+	timerval+=timerfrac>>12;
+	timerfrac&=4095;
 
-		for (i=0; i<calcn; i++)
-			if (calctimer[i][1]<0)
-				break;
+	for (i=0; i<calcn; i++)
+		if (calctimer[i][1]<0)
+			return 0;
 
-		if (i==calcn)
+	return 1;
+}
+
+OCP_INTERNAL int it_precalctime (struct it_module *m, int startpos, int (*calc)[2], int n, int ite)
+{
+	int it;
+
+	it_timereset (m, startpos, calc, n);
+
+	for (it=0; it<ite; it++)
+		if (it_findtick())
 			break;
-	}
 
 	return 1;
 }
+
+static int it_timestep (struct cpifaceSessionAPI_t *cpifaceSession, int ticks, uint32_t *length)
+{
+	while (ticks--)
+	{
+		it_findtick();
+		if (timelooped)
+		{
+			*length=timelength;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+OCP_INTERNAL void it_timestart (struct cpifaceSessionAPI_t *cpifaceSession, struct it_module *m)
+{
+	uint32_t hash=0;
+	int i;
+
+	hash=cpifaceSession->SongTimeHash (hash, &m->nchan, sizeof (m->nchan));
+	hash=cpifaceSession->SongTimeHash (hash, &m->endord, sizeof (m->endord));
+	hash=cpifaceSession->SongTimeHash (hash, &m->inispeed, sizeof (m->inispeed));
+	hash=cpifaceSession->SongTimeHash (hash, &m->initempo, sizeof (m->initempo));
+	hash=cpifaceSession->SongTimeHash (hash, m->orders, sizeof (m->orders[0]) * m->nord);
+	hash=cpifaceSession->SongTimeHash (hash, m->patlens, sizeof (m->patlens[0]) * m->npat);
+	for (i=0; i<m->npat; i++)
+	{
+		uint8_t *p=m->patterns[i];
+		int row;
+
+		if (!p)
+			continue;
+		for (row=0; row<m->patlens[i]; row++)
+		{
+			while (*p)
+				p+=6;
+			p++;
+		}
+		hash=cpifaceSession->SongTimeHash (hash, m->patterns[i], p - m->patterns[i]);
+	}
+
+	it_timereset (m, 0, 0, 0);
+	timesession=cpifaceSession;
+
+	cpifaceSession->SongTimeRegister (cpifaceSession, "ITTime", hash, m->nord, it_timestep);
+}
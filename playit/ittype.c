@@ -356,7 +356,13 @@ static const char *IT_description[] =
 	NULL
 };
 
-static struct mdbreadinforegstruct itpReadInfoReg = {"IT", itpReadInfo MDBREADINFOREGSTRUCT_TAIL};
+static const struct mdbReadInfoSignature itpSignatures[] =
+{
+	{0, 4, "IMPM"},
+	{0, 0, 0}
+};
+
+static struct mdbreadinforegstruct itpReadInfoReg = {"IT", itpReadInfo, itpSignatures, 0 MDBREADINFOREGSTRUCT_TAIL};
 
 OCP_INTERNAL int it_type_init (struct PluginInitAPI_t *API)
 {
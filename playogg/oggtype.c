@@ -142,7 +142,13 @@ static const char *OGG_description[] =
 	NULL
 };
 
-static struct mdbreadinforegstruct oggReadInfoReg = {"OGG", oggReadInfo MDBREADINFOREGSTRUCT_TAIL};
+static const struct mdbReadInfoSignature oggSignatures[] =
+{
+	{0, 4, "OggS"},
+	{0, 0, 0}
+};
+
+static struct mdbreadinforegstruct oggReadInfoReg = {"OGG", oggReadInfo, oggSignatures, 0 MDBREADINFOREGSTRUCT_TAIL};
 
 OCP_INTERNAL int ogg_type_init (struct PluginInitAPI_t *API)
 {
@@ -146,6 +146,7 @@ Cocpemu::Cocpemu(Copl *realopl, int rate, int isRetroWave) : realopl(realopl), i
 	steprate[15] = 0x400000; /* instant */
 
 	currType = realopl->gettype();
+	blockbuf = 0;
 	init();
 }
 
@@ -154,99 +155,107 @@ Cocpemu::~Cocpemu()
 	delete realopl;
 }
 
-static int update_op_sub (uint32_t *pos, uint32_t target, uint32_t steprate, unsigned int *samples)
+void Cocpemu::update(short *buf, int samples, uint32_t ratescale)
 {
-	uint32_t max = *samples * steprate;
-	if (steprate >= 0x400000)
-	{
-		max = 0x400000;
-	}
-	if (!steprate)
-	{
-		*samples = 0;
-		return 0;
-	}
-	if (*pos == target)
+	blockstart (buf, samples, ratescale);
+	blockadvance (samples);
+	blockrender ();
+}
+
+void Cocpemu::blockstart(short *buf, int samples, uint32_t ratescale)
+{
+	assert (!blockbuf);
+
+	if (isRetroWave)
 	{
-		return 1;
+		((oplRetroWave *)realopl)->ratescale = ratescale;
 	}
-	if (*pos < target)
+	blockbuf = buf;
+	blocksamples = samples;
+	blockoffset = 0;
+	blockdone = 0;
+	blockqueuehead = 0;
+	blockqueuefill = 0;
+}
+
+void Cocpemu::blockadvance(int samples)
+{
+	int ch, o;
+
+	assert (blockbuf);
+	assert ((blockoffset + samples) <= blocksamples);
+
+	oplEnvelopeAdvance (&env, samples);
+	for (ch=0; ch < 18; ch++)
 	{
-		uint32_t diff = target - *pos;
-		if (max >= diff)
-		{
-			*pos = target;
-			*samples -= diff / steprate;
-			return 1;
-		} else {
-			*pos += max;
-			*samples = 0;
-			return 0;
-		}
-	} else {
-		uint32_t diff = *pos - target;
-		if (max >= diff)
+		for (o=0; o < 2; o++)
 		{
-			*pos = target;
-			*samples -= diff / steprate;
-			return 1;
-		} else {
-			*pos -= max;
-			*samples = 0;
-			return 0;
+			s.channel[ch].op[o].EnvelopeState = env.state[ch*2 + o];
+			s.channel[ch].op[o].EnvelopePosition = env.position[ch*2 + o];
 		}
 	}
+	blockoffset += samples;
 }
 
-void Cocpemu::update_op (const int ch, const int o, unsigned int samples)
+/* render up to upto, and apply the queued writes that are due on the way */
+void Cocpemu::blockflush(int upto)
 {
-	while (samples)
+	int chip = realopl->getchip();
+
+	while (1)
 	{
-		switch (s.channel[ch].op[o].EnvelopeState)
+		int next = upto;
+
+		while ((blockqueuehead < blockqueuefill) && (blockqueue[blockqueuehead].offset <= blockdone))
 		{
-			case 0: return;
-			case 1: if (update_op_sub(&s.channel[ch].op[o].EnvelopePosition, 0x400000, steprate[s.channel[ch].op[o].attack_rate], &samples))
-				{
-					s.channel[ch].op[o].EnvelopeState++;
-				}
-				break;
-			case 2: if (update_op_sub(&s.channel[ch].op[o].EnvelopePosition, s.channel[ch].op[o].sustain_level << 17, steprate[s.channel[ch].op[o].decay_rate], &samples))
-				{
-					s.channel[ch].op[o].EnvelopeState++;
-				}
-				break;
-			case 3:	if (s.channel[ch].op[o].sustain_enabled)
-				{
-					return;
-				}
-				s.channel[ch].op[o].EnvelopeState++;
-				/* pass-through */
-			case 4: if (update_op_sub(&s.channel[ch].op[o].EnvelopePosition, 0, steprate[s.channel[ch].op[o].release_rate], &samples))
-				{
-					s.channel[ch].op[o].EnvelopeState = 0;
-				}
-				return;
+			realopl->setchip (blockqueue[blockqueuehead].chip);
+			realopl->write (blockqueue[blockqueuehead].reg, blockqueue[blockqueuehead].val);
+			blockqueuehead++;
 		}
+		if (blockdone >= upto)
+		{
+			break;
+		}
+		if ((blockqueuehead < blockqueuefill) && (blockqueue[blockqueuehead].offset < next))
+		{
+			next = blockqueue[blockqueuehead].offset;
+		}
+		realopl->update (blockbuf + (blockdone << 1) /* stereo */, next - blockdone);
+		blockdone = next;
 	}
+	if (blockqueuehead == blockqueuefill)
+	{
+		blockqueuehead = 0;
+		blockqueuefill = 0;
+	}
+	realopl->setchip (chip);
+}
 
+void Cocpemu::blockrender()
+{
+	assert (blockbuf);
+
+	blockflush (blocksamples);
+	blockbuf = 0;
 }
 
-void Cocpemu::update(short *buf, int samples, uint32_t ratescale)
+/* all writes to the real chip go through here, so they can be queued while a block is open */
+void Cocpemu::realwrite(int reg, int val)
 {
-	int ch, o;
-	for (ch=0; ch < 18; ch++)
+	if (!blockbuf)
 	{
-		for (o=0; o < 2; o++)
-		{
-			update_op (ch, o, samples);
-		}
+		realopl->write (reg, val);
+		return;
 	}
-
-	if (isRetroWave)
-	{
-		((oplRetroWave *)realopl)->ratescale = ratescale;
+	if (blockqueuefill >= (int)(sizeof (blockqueue) / sizeof (blockqueue[0])))
+	{ /* queue is full, render what we have so far */
+		blockflush (blockoffset);
 	}
-	realopl->update(buf, samples);
+	blockqueue[blockqueuefill].offset = blockoffset;
+	blockqueue[blockqueuefill].reg = reg;
+	blockqueue[blockqueuefill].val = val;
+	blockqueue[blockqueuefill].chip = realopl->getchip();
+	blockqueuefill++;
 }
 
 void Cocpemu::setchip(int n)
@@ -260,15 +269,15 @@ void Cocpemu::register_channel_2_op_drum (const int chan, const int chip)
 	const int userchannel = chan + (chip?9:0);
 
 	/* channel is already in percussion mode */
-	s.channel[userchannel].op[0].EnvelopeState = STATE_ATTACK;
-	s.channel[userchannel].op[1].EnvelopeState = STATE_ATTACK;
+	env.state[userchannel*2 + 0] = STATE_ATTACK;
+	env.state[userchannel*2 + 1] = STATE_ATTACK;
 }
 
 void Cocpemu::unregister_channel_2_op_drum (const int chan, const int chip)
 {
 	const int userchannel = chan + (chip?9:0);
 
-	s.channel[userchannel].op[1].EnvelopeState = STATE_RELEASE;
+	env.state[userchannel*2 + 1] = STATE_RELEASE;
 }
 
 void Cocpemu::register_channel_1_op_drum (const int chan, const int op, const int chip)
@@ -276,7 +285,7 @@ void Cocpemu::register_channel_1_op_drum (const int chan, const int op, const in
 	const int userchannel = chan + (chip?9:0);
 
 	/* channel is already in percussion mode */
-	s.channel[userchannel].op[op].EnvelopeState = STATE_ATTACK;
+	env.state[userchannel*2 + op] = STATE_ATTACK;
 }
 
 void Cocpemu::unregister_channel_1_op_drum (const int chan, const int op, const int chip)
@@ -284,7 +293,7 @@ void Cocpemu::unregister_channel_1_op_drum (const int chan, const int op, const
 	const int userchannel = chan + (chip?9:0);
 
 	/* channel is already in percussion mode */
-	s.channel[userchannel].op[op].EnvelopeState = STATE_RELEASE;
+	env.state[userchannel*2 + op] = STATE_RELEASE;
 }
 
 void Cocpemu::register_channel_4_op (const int chan, const int chip)
@@ -309,20 +318,20 @@ void Cocpemu::register_channel_4_op (const int chan, const int chip)
 	}
 	s.channel[userchannel+3].CM = CM_disabled;
 
-	s.channel[userchannel  ].op[0].EnvelopeState = STATE_ATTACK;
-	s.channel[userchannel  ].op[1].EnvelopeState = STATE_ATTACK;
-	s.channel[userchannel+3].op[0].EnvelopeState = STATE_ATTACK;
-	s.channel[userchannel+3].op[1].EnvelopeState = STATE_ATTACK;
+	env.state[userchannel*2 + 0] = STATE_ATTACK;
+	env.state[userchannel*2 + 1] = STATE_ATTACK;
+	env.state[(userchannel+3)*2 + 0] = STATE_ATTACK;
+	env.state[(userchannel+3)*2 + 1] = STATE_ATTACK;
 }
 
 void Cocpemu::unregister_channel_4_op (const int chan, const int chip)
 {
 	const int userchannel = chan + (chip?9:0);
 
-	s.channel[userchannel  ].op[0].EnvelopeState = STATE_RELEASE;
-	s.channel[userchannel  ].op[1].EnvelopeState = STATE_RELEASE;
-	s.channel[userchannel+3].op[0].EnvelopeState = STATE_RELEASE;
-	s.channel[userchannel+3].op[1].EnvelopeState = STATE_RELEASE;
+	env.state[userchannel*2 + 0] = STATE_RELEASE;
+	env.state[userchannel*2 + 1] = STATE_RELEASE;
+	env.state[(userchannel+3)*2 + 0] = STATE_RELEASE;
+	env.state[(userchannel+3)*2 + 1] = STATE_RELEASE;
 }
 
 void Cocpemu::register_channel_2_op (const int chan, const int chip)
@@ -336,16 +345,16 @@ void Cocpemu::register_channel_2_op (const int chan, const int chip)
 		s.channel[userchannel].CM = CM_2OP_FM;
 	}
 
-	s.channel[userchannel].op[0].EnvelopeState = STATE_ATTACK;
-	s.channel[userchannel].op[1].EnvelopeState = STATE_ATTACK;
+	env.state[userchannel*2 + 0] = STATE_ATTACK;
+	env.state[userchannel*2 + 1] = STATE_ATTACK;
 }
 
 void Cocpemu::unregister_channel_2_op (const int chan, const int chip)
 {
 	const int userchannel = chan + (chip?9:0);
 
-	s.channel[userchannel].op[0].EnvelopeState = STATE_RELEASE;
-	s.channel[userchannel].op[1].EnvelopeState = STATE_RELEASE;
+	env.state[userchannel*2 + 0] = STATE_RELEASE;
+	env.state[userchannel*2 + 1] = STATE_RELEASE;
 }
 
 void Cocpemu::write(int reg, int val)
@@ -527,6 +536,7 @@ complete:
 			s.channel[ch + (currChip?9:0)].op[op & 0x1].tremolo_enabled = !!(val & 0x80);
 			s.channel[ch + (currChip?9:0)].op[op & 0x1].vibrato_enabled = !!(val & 0x40);
 			s.channel[ch + (currChip?9:0)].op[op & 0x1].sustain_enabled = !!(val & 0x20);
+			env.hold[(ch + (currChip?9:0))*2 + (op & 0x1)] = !!(val & 0x20);
 			s.channel[ch + (currChip?9:0)].op[op & 0x1].ksr_enabled = !!(val & 0x10);
 			s.channel[ch + (currChip?9:0)].op[op & 0x1].frequency_multiplication_factor = !!(val & 0x0f);
 		}
@@ -547,6 +557,8 @@ complete:
 			int ch = op2_to_channel[op];
 			s.channel[ch + (currChip?9:0)].op[op & 0x1].attack_rate = val >> 4;
 			s.channel[ch + (currChip?9:0)].op[op & 0x1].decay_rate = val & 0x0f;
+			env.attack[(ch + (currChip?9:0))*2 + (op & 0x1)] = steprate[val >> 4];
+			env.decay[(ch + (currChip?9:0))*2 + (op & 0x1)] = steprate[val & 0x0f];
 		}
 	} else if ((reg >= 0x80) && (reg <= 0x95))
 	{
@@ -556,6 +568,8 @@ complete:
 			int ch = op2_to_channel[op];
 			s.channel[ch + (currChip?9:0)].op[op & 0x1].sustain_level = val >> 4;
 			s.channel[ch + (currChip?9:0)].op[op & 0x1].release_rate = val & 0x0f;
+			env.sustain[(ch + (currChip?9:0))*2 + (op & 0x1)] = (val >> 4) << 17;
+			env.release[(ch + (currChip?9:0))*2 + (op & 0x1)] = steprate[val & 0x0f];
 		}
 	} else if ((reg >= 0xa0) && (reg <= 0xa8))
 	{
@@ -618,7 +632,7 @@ complete:
 			}
 		}
 	}
-	realopl->write (reg, val);
+	realwrite (reg, val);
 
 	/* re-evaluate mute if needed - going in/out of OPL3 mode and 4op channel mode */
 	if (OPL3_enabled)
@@ -657,6 +671,7 @@ void Cocpemu::init()
 {
 	memset (regcache, 0, sizeof (regcache));
 	memset (&s, 0, sizeof (s));
+	memset (&env, 0, sizeof (env));
 
 	realopl->init();
 	for (int i=0; i < 18; i++)
@@ -695,10 +710,10 @@ void Cocpemu::setmute(int chan, int val)
 				uint8_t reg2 = operator_to_offset[channel_to_two_operator[(chan + 3 )% 9][0]] | 0x40;
 				uint8_t reg3 = operator_to_offset[channel_to_two_operator[(chan + 3 )% 9][1]] | 0x40;
 
-				realopl->write (reg0, regcache[chan / 9][reg0] | mask);
-				realopl->write (reg1, regcache[chan / 9][reg1] | mask);
-				realopl->write (reg2, regcache[chan / 9][reg2] | mask);
-				realopl->write (reg3, regcache[chan / 9][reg3] | mask);
+				realwrite (reg0, regcache[chan / 9][reg0] | mask);
+				realwrite (reg1, regcache[chan / 9][reg1] | mask);
+				realwrite (reg2, regcache[chan / 9][reg2] | mask);
+				realwrite (reg3, regcache[chan / 9][reg3] | mask);
 				return;
 			}
 			if ((((chan    ) == (i + 3)) && (regcache[1][0x04] & (1<<i))) ||
@@ -709,6 +724,6 @@ void Cocpemu::setmute(int chan, int val)
 		}
 	}
 
-	realopl->write (reg0, regcache[chan / 9][reg0] | mask);
-	realopl->write (reg1, regcache[chan / 9][reg1] | mask);
+	realwrite (reg0, regcache[chan / 9][reg0] | mask);
+	realwrite (reg1, regcache[chan / 9][reg1] | mask);
 }
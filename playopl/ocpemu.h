@@ -30,6 +30,10 @@
 #include "adplug-git/src/opl.h"
 #include <stdio.h>
 #include <stdint.h>
+extern "C"
+{
+#include "oplenvelope.h"
+}
 
 struct op_status
 {
@@ -109,6 +113,17 @@ public:
 	virtual void update(short *buf, int samples, uint32_t ratescale);   // fill buffer
 	void setchip(int n);
 
+	/* block rendering: blockstart() opens a block of samples at buf. Until
+	 * blockrender(), register writes are queued together with the offset in
+	 * the block they take effect at, and blockadvance() moves that offset
+	 * forward (and steps the channel viewer state). blockrender() then
+	 * renders the whole block, only splitting it where queued writes have to
+	 * be applied.
+	 */
+	void blockstart(short *buf, int samples, uint32_t ratescale);
+	void blockadvance(int samples);
+	void blockrender();
+
 	// template methods
 	void write(int reg, int val);
 	void init();
@@ -122,7 +137,24 @@ private:
 	unsigned char regcache[2][256];
 	uint32_t steprate[16]; // 16:16 fixed point
 
-	void update_op (const int ch, const int o, unsigned int samples); // used by update() to update the volume envelope of each op
+	struct oplEnvelopeLanes_t env; // stepped by blockadvance(), and copied into s.channel[].op[].Envelope*
+
+	struct blockwrite_t
+	{
+		int offset;
+		int reg;
+		uint8_t val;
+		uint8_t chip;
+	} blockqueue[2048];
+	int blockqueuehead;
+	int blockqueuefill;
+	short *blockbuf;     // NULL when no block is open
+	int blocksamples;
+	int blockoffset;     // where queued writes take effect
+	int blockdone;       // samples rendered so far
+
+	void realwrite (int reg, int val);
+	void blockflush (int upto);
 
 	void register_channel_2_op_drum (const int chan, const int chip);
 	void register_channel_1_op_drum (const int chan, const int op, const int chip);
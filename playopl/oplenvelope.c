@@ -0,0 +1,299 @@
+/* OpenCP Module Player
+ * copyright (c) 2026 Stian Skjelstad <stian.skjelstad@gmail.com>
+ *
+ * Approximated OPL operator envelopes for the channel viewer, all operators stepped as one block
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "config.h"
+#include <stdint.h>
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+#include "types.h"
+#include "oplenvelope.h"
+
+static int oplEnvelopeStep (uint32_t *pos, uint32_t target, uint32_t steprate, unsigned int *samples)
+{
+	uint32_t max = *samples * steprate;
+	if (steprate >= 0x400000)
+	{
+		max = 0x400000;
+	}
+	if (!steprate)
+	{
+		*samples = 0;
+		return 0;
+	}
+	if (*pos == target)
+	{
+		return 1;
+	}
+	if (*pos < target)
+	{
+		uint32_t diff = target - *pos;
+		if (max >= diff)
+		{
+			*pos = target;
+			*samples -= diff / steprate;
+			return 1;
+		} else {
+			*pos += max;
+			*samples = 0;
+			return 0;
+		}
+	} else {
+		uint32_t diff = *pos - target;
+		if (max >= diff)
+		{
+			*pos = target;
+			*samples -= diff / steprate;
+			return 1;
+		} else {
+			*pos -= max;
+			*samples = 0;
+			return 0;
+		}
+	}
+}
+
+/* the exact model, one lane at the time */
+static void oplEnvelopeLane (struct oplEnvelopeLanes_t *l, const int i, unsigned int samples)
+{
+	while (samples)
+	{
+		switch (l->state[i])
+		{
+			case 0: return;
+			case 1: if (oplEnvelopeStep (&l->position[i], 0x400000, l->attack[i], &samples))
+				{
+					l->state[i]++;
+				}
+				break;
+			case 2: if (oplEnvelopeStep (&l->position[i], l->sustain[i], l->decay[i], &samples))
+				{
+					l->state[i]++;
+				}
+				break;
+			case 3:	if (l->hold[i])
+				{
+					return;
+				}
+				l->state[i]++;
+				/* pass-through */
+			case 4: if (oplEnvelopeStep (&l->position[i], 0, l->release[i], &samples))
+				{
+					l->state[i] = 0;
+				}
+				return;
+		}
+	}
+}
+
+void oplEnvelopeAdvance (struct oplEnvelopeLanes_t *l, unsigned int samples)
+{
+	int i;
+#ifdef __SSE2__
+	/* Most lanes are either idle or move towards their target without reaching it, and that can be done four lanes at the time.
+	 * Lanes that change state are handed over to oplEnvelopeLane() untouched */
+	const __m128i zero = _mm_setzero_si128 ();
+	const __m128i bias = _mm_set1_epi32 (0x80000000); /* SSE2 only has signed compares */
+	const __m128i n = _mm_set1_epi32 (samples);
+	const __m128i full = _mm_set1_epi32 (0x400000);
+	const __m128i instant = _mm_set1_epi32 (0x3fffff ^ 0x80000000);
+
+	if (!samples)
+	{
+		return;
+	}
+
+	for (i = 0; i < OPLENVELOPE_LANES; i += 4)
+	{
+		__m128i state = _mm_loadu_si128 ((__m128i *)(l->state + i));
+		__m128i pos = _mm_loadu_si128 ((__m128i *)(l->position + i));
+		__m128i isattack = _mm_cmpeq_epi32 (state, _mm_set1_epi32 (1));
+		__m128i isdecay = _mm_cmpeq_epi32 (state, _mm_set1_epi32 (2));
+		__m128i issustain = _mm_cmpeq_epi32 (state, _mm_set1_epi32 (3));
+		__m128i isrelease = _mm_cmpeq_epi32 (state, _mm_set1_epi32 (4));
+		__m128i rate, target, max, even, odd, up, diff, moving, slow, fast;
+		int mask, j;
+
+		rate = _mm_or_si128 (_mm_or_si128 (
+			_mm_and_si128 (isattack,  _mm_loadu_si128 ((__m128i *)(l->attack + i))),
+			_mm_and_si128 (isdecay,   _mm_loadu_si128 ((__m128i *)(l->decay + i)))),
+			_mm_and_si128 (isrelease, _mm_loadu_si128 ((__m128i *)(l->release + i))));
+		target = _mm_or_si128 (
+			_mm_and_si128 (isattack, full),
+			_mm_and_si128 (isdecay,  _mm_loadu_si128 ((__m128i *)(l->sustain + i))));
+
+		/* max = samples * rate, truncated to 32 bit like oplEnvelopeStep() does */
+		even = _mm_mul_epu32 (rate, n);
+		odd = _mm_mul_epu32 (_mm_srli_epi64 (rate, 32), n);
+		max = _mm_unpacklo_epi32 (_mm_shuffle_epi32 (even, _MM_SHUFFLE (3, 1, 2, 0)), _mm_shuffle_epi32 (odd, _MM_SHUFFLE (3, 1, 2, 0)));
+
+		up = _mm_cmpgt_epi32 (_mm_xor_si128 (target, bias), _mm_xor_si128 (pos, bias)); /* pos < target */
+		diff = _mm_or_si128 (
+			_mm_and_si128    (up, _mm_sub_epi32 (target, pos)),
+			_mm_andnot_si128 (up, _mm_sub_epi32 (pos, target)));
+
+		moving = _mm_andnot_si128 (_mm_cmpeq_epi32 (rate, zero), _mm_or_si128 (_mm_or_si128 (isattack, isdecay), isrelease));
+
+		/* state changes: target is reached (max >= diff), instant rates, and sustain without hold that moves into release */
+		slow = _mm_or_si128 (
+			_mm_and_si128 (issustain, _mm_cmpeq_epi32 (_mm_loadu_si128 ((__m128i *)(l->hold + i)), zero)),
+			_mm_and_si128 (moving, _mm_or_si128 (
+				_mm_cmpeq_epi32 (_mm_cmpgt_epi32 (_mm_xor_si128 (diff, bias), _mm_xor_si128 (max, bias)), zero),
+				_mm_cmpgt_epi32 (_mm_xor_si128 (rate, bias), instant))));
+		fast = _mm_andnot_si128 (slow, moving);
+
+		pos = _mm_or_si128 (
+			_mm_andnot_si128 (fast, pos),
+			_mm_and_si128 (fast, _mm_or_si128 (
+				_mm_and_si128    (up, _mm_add_epi32 (pos, max)),
+				_mm_andnot_si128 (up, _mm_sub_epi32 (pos, max)))));
+		_mm_storeu_si128 ((__m128i *)(l->position + i), pos);
+
+		mask = _mm_movemask_ps (_mm_castsi128_ps (slow));
+		for (j = 0; mask; j++, mask >>= 1)
+		{
+			if (mask & 1)
+			{
+				oplEnvelopeLane (l, i + j, samples);
+			}
+		}
+	}
+#else
+	for (i = 0; i < OPLENVELOPE_LANES; i++)
+	{
+		oplEnvelopeLane (l, i, samples);
+	}
+#endif
+}
+
+#ifdef UNIT_TEST
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t steprate[16];
+
+static void fill_steprate (int rate)
+{ /* same table as Cocpemu uses */
+	static const int divisor[15] = {0, 1132, 567, 284, 135, 70, 32, 17, 13, 9, 5, 4, 3, 2, 1};
+	int i;
+	steprate[0] = 0;
+	for (i = 1; i < 15; i++)
+	{
+		steprate[i] = (((uint_fast32_t)65536) * 64000) / (rate * divisor[i]) + 1;
+	}
+	steprate[15] = 0x400000;
+}
+
+static void randomize_lane (struct oplEnvelopeLanes_t *l, int i)
+{
+	l->sustain[i] = (rand () & 15) << 17;
+	l->hold[i] = rand () & 1;
+	l->attack[i] = steprate[rand () & 15];
+	l->decay[i] = steprate[rand () & 15];
+	l->release[i] = steprate[rand () & 15];
+}
+
+static int compare (const struct oplEnvelopeLanes_t *a, const struct oplEnvelopeLanes_t *b, int iteration, unsigned int samples)
+{
+	int i;
+	int errors = 0;
+	for (i = 0; i < OPLENVELOPE_LANES; i++)
+	{
+		if ((a->state[i] != b->state[i]) || (a->position[i] != b->position[i]))
+		{
+			fprintf (stderr, "iteration %d, samples %u, lane %d: state %u position 0x%06x, expected state %u position 0x%06x\n", iteration, samples, i, a->state[i], a->position[i], b->state[i], b->position[i]);
+			errors++;
+		}
+	}
+	return errors;
+}
+
+int main (int argc, char *argv[])
+{
+	static const int rates[] = {8000, 22050, 44100, 48000, 96000};
+	struct oplEnvelopeLanes_t a, b;
+	int errors = 0;
+	int r, iteration, i;
+
+	srand (1);
+
+	for (r = 0; r < (sizeof (rates) / sizeof (rates[0])); r++)
+	{
+		fill_steprate (rates[r]);
+		memset (&a, 0, sizeof (a));
+		for (i = 0; i < OPLENVELOPE_LANES; i++)
+		{
+			randomize_lane (&a, i);
+			a.state[i] = rand () % 5;
+			a.position[i] = (rand () & 1) ? a.sustain[i] : rand () % 0x400001;
+		}
+		b = a;
+
+		for (iteration = 0; iteration < 200000; iteration++)
+		{
+			unsigned int samples;
+
+			switch (rand () & 7)
+			{
+				case 0:  samples = 0; break;
+				case 1:  samples = 1; break;
+				case 2:  samples = rand () % 0x100000; break; /* large enough for samples * rate to overflow */
+				default: samples = rand () % 2048; break;
+			}
+
+			/* key-on / key-off and register changes, like Cocpemu::write() does */
+			for (i = 0; i < 4; i++)
+			{
+				int lane = rand () % OPLENVELOPE_LANES;
+				switch (rand () & 3)
+				{
+					case 0: a.state[lane] = b.state[lane] = 1; break;
+					case 1: a.state[lane] = b.state[lane] = 4; break;
+					case 2: randomize_lane (&a, lane);
+						b.sustain[lane] = a.sustain[lane];
+						b.hold[lane] = a.hold[lane];
+						b.attack[lane] = a.attack[lane];
+						b.decay[lane] = a.decay[lane];
+						b.release[lane] = a.release[lane];
+						break;
+					default: break;
+				}
+			}
+
+			oplEnvelopeAdvance (&a, samples);
+			for (i = 0; i < OPLENVELOPE_LANES; i++)
+			{
+				oplEnvelopeLane (&b, i, samples);
+			}
+
+			if (compare (&a, &b, iteration, samples))
+			{
+				errors++;
+				break;
+			}
+		}
+		fprintf (stderr, "rate %d: %s\n", rates[r], (iteration == 200000) ? "ok" : "FAILED");
+	}
+
+	fprintf (stderr, "Final result: %d errors\n", errors);
+	return !!errors;
+}
+#endif
@@ -0,0 +1,25 @@
+#ifndef _OPLENVELOPE_H
+#define _OPLENVELOPE_H 1
+
+/* Approximated operator envelopes, used by Cocpemu to feed the channel viewer.
+ *
+ * All 36 operators are stored as structure-of-arrays, lane = channel * 2 + operator,
+ * so that oplEnvelopeAdvance() can step several lanes at once.
+ */
+
+#define OPLENVELOPE_LANES 36
+
+struct oplEnvelopeLanes_t
+{
+	uint32_t state[OPLENVELOPE_LANES];    /* 0=off, 1=attack, 2=delay, 3=sustain, 4=release */
+	uint32_t position[OPLENVELOPE_LANES]; /* 0 - 0x400000 */
+	uint32_t sustain[OPLENVELOPE_LANES];  /* sustain_level << 17 */
+	uint32_t hold[OPLENVELOPE_LANES];     /* non-zero if sustain_enabled */
+	uint32_t attack[OPLENVELOPE_LANES];   /* steprates, 16:16 fixed point */
+	uint32_t decay[OPLENVELOPE_LANES];
+	uint32_t release[OPLENVELOPE_LANES];
+};
+
+void oplEnvelopeAdvance (struct oplEnvelopeLanes_t *l, unsigned int samples);
+
+#endif
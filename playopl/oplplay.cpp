@@ -52,12 +52,10 @@ extern "C"
 
 struct oplStatusBuffer_t
 {
-	const struct plrDevAPI_t *plrDevAPI;
-	int in_use;
 	struct oplStatus data;
 	int pos;
 };
-static struct oplStatusBuffer_t oplStatusBuffers[ROW_BUFFERS] = {{0}};
+static struct ringbuffer_snapshots_t *oplStatusBuffers; /* timestamps are in oplbufpos samples */
 
 struct oplStatus oplLastStatus; /* current register status */
 int oplLastPos;
@@ -128,6 +126,9 @@ OCP_INTERNAL void oplClosePlayer (struct cpifaceSessionAPI_t *cpifaceSession)
 		cpifaceSession->ringbufferAPI->free (oplbufpos);
 		oplbufpos = 0;
 
+		cpifaceSession->ringbufferAPI->snapshots_free (oplStatusBuffers);
+		oplStatusBuffers = 0;
+
 		cpifaceSession->plrDevAPI->Stop (cpifaceSession);
 
 		delete(p);
@@ -317,7 +318,6 @@ OCP_INTERNAL int oplOpenPlayer (const char *filename /* needed for detection */,
 		return errPlay;
 	}
 
-	memset (oplStatusBuffers, 0, sizeof (oplStatusBuffers));
 	memset (&oplLastStatus, 0, sizeof (oplLastStatus));
 	oplLastPos = 0;
 
@@ -383,6 +383,12 @@ OCP_INTERNAL int oplOpenPlayer (const char *filename /* needed for detection */,
 		retval = errAllocMem;
 		goto error_out;
 	}
+	oplStatusBuffers = cpifaceSession->ringbufferAPI->snapshots_new (ROW_BUFFERS, ROW_BUFFERS * sizeof (struct oplStatusBuffer_t));
+	if (!oplStatusBuffers)
+	{
+		retval = errAllocMem;
+		goto error_out;
+	}
 	opltowrite=0;
 
 	cpifaceSession->mcpSet = oplSet;
@@ -402,6 +408,11 @@ error_out:
 		cpifaceSession->ringbufferAPI->free (oplbufpos);
 		oplbufpos = 0;
 	}
+	if (oplStatusBuffers)
+	{
+		cpifaceSession->ringbufferAPI->snapshots_free (oplStatusBuffers);
+		oplStatusBuffers = 0;
+	}
 	delete(p);
 	delete(opl);
 	free (content);
@@ -435,20 +446,21 @@ static void oplSetVolume(void)
 		volr = (volr * (64 - bal)) >> 6;
 }
 
-static void delay_callback_from_devp (void *arg, int samples_ago)
+/* find the status that matches what the devp is playing right now */
+static void oplUpdateLastStatus (struct cpifaceSessionAPI_t *cpifaceSession)
 {
-	oplStatusBuffer_t *state = (oplStatusBuffer_t *)arg;
-	oplLastStatus = state->data;
-	oplLastPos = state->pos;
-	state->plrDevAPI = 0;
-	state->in_use = 0;
-}
+	struct oplStatusBuffer_t state;
+	uint64_t tail, committed, processed, delay;
 
-static void oplStatBuffers_callback_from_oplbuf (void *arg, int samples_ago)
-{
-	oplStatusBuffer_t *state = (oplStatusBuffer_t *)arg;
-	int samples_until = samples_ago * oplbufrate / 65536;
-	state->plrDevAPI->OnBufferCallback (-samples_until, delay_callback_from_devp, arg);
+	cpifaceSession->ringbufferAPI->get_stats (oplbufpos, 0, &tail);
+	cpifaceSession->plrDevAPI->GetStats (&committed, &processed);
+	delay = (committed - processed) * oplbufrate / 65536; /* samples still buffered by devp, converted into oplbufpos samples */
+
+	if (cpifaceSession->ringbufferAPI->snapshots_get (oplStatusBuffers, (tail > delay) ? (tail - delay) : 0, &state, sizeof (state), 0) == sizeof (state))
+	{
+		oplLastStatus = state.data;
+		oplLastPos = state.pos;
+	}
 }
 
 static void oplIdler (struct cpifaceSessionAPI_t *cpifaceSession)
@@ -465,33 +477,40 @@ static void oplIdler (struct cpifaceSessionAPI_t *cpifaceSession)
 
 	while (length1)
 	{
-		if (!opltowrite)
-		{
-			p->update(); /* TODO, rewind... */
-			opltowrite = (int)((float)(oplRate)*256.0 / (p->getrefresh()*((float)_speed)));
-		}
-		if (length1>opltowrite)
-		{
-			length1=opltowrite;
-		}
-		opl->update(oplbuf+(pos1<<1) /* stereo */, length1, oplbufrate); /* given in samples */
+		uint64_t head;
+		int offset = 0;
 
-		opltowrite-=length1;
+		cpifaceSession->ringbufferAPI->get_stats (oplbufpos, &head, 0);
 
-		for (int i=0; i < ROW_BUFFERS; i++)
+		/* the player ticks only queue their register writes, the whole fragment is rendered in one go below */
+		opl->blockstart (oplbuf+(pos1<<1) /* stereo */, length1, oplbufrate); /* given in samples */
+		while (offset < length1)
 		{
-			if (oplStatusBuffers[i].in_use)
+			struct oplStatusBuffer_t *state;
+			int length;
+
+			if (!opltowrite)
 			{
-				continue;
+				p->update(); /* TODO, rewind... */
+				opltowrite = (int)((float)(oplRate)*256.0 / (p->getrefresh()*((float)_speed)));
 			}
+			length = length1 - offset;
+			if (length>opltowrite)
+			{
+				length=opltowrite;
+			}
+			opl->blockadvance (length);
 
-			oplStatusBuffers[i].plrDevAPI = cpifaceSession->plrDevAPI;
-			oplStatusBuffers[i].in_use = 1;
-			oplStatusBuffers[i].data = opl->s;
-			oplStatusBuffers[i].pos = p->getorder() << 8 | p->getrow();
-			cpifaceSession->ringbufferAPI->add_tail_callback_samples (oplbufpos, 0, oplStatBuffers_callback_from_oplbuf, oplStatusBuffers + i);
-			break;
+			opltowrite-=length;
+
+			state = (struct oplStatusBuffer_t *)cpifaceSession->ringbufferAPI->snapshots_write (oplStatusBuffers, head + offset, sizeof (*state));
+			state->data = opl->s;
+			state->pos = p->getorder() << 8 | p->getrow();
+			cpifaceSession->ringbufferAPI->snapshots_commit (oplStatusBuffers);
+
+			offset += length;
 		}
+		opl->blockrender ();
 
 		cpifaceSession->ringbufferAPI->head_add_samples (oplbufpos, length1);
 		cpifaceSession->ringbufferAPI->get_head_samples (oplbufpos, &pos1, &length1, &pos2, &length2);
@@ -685,6 +704,8 @@ OCP_INTERNAL void oplIdle (struct cpifaceSessionAPI_t *cpifaceSession)
 
 	cpifaceSession->plrDevAPI->Idle();
 
+	oplUpdateLastStatus (cpifaceSession);
+
 	clipbusy--;
 }
 
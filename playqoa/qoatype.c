@@ -86,7 +86,13 @@ static const char *QOA_description[] =
 	NULL
 };
 
-static struct mdbreadinforegstruct qoaReadInfoReg = {"QOA", qoaReadInfo MDBREADINFOREGSTRUCT_TAIL};
+static const struct mdbReadInfoSignature qoaSignatures[] =
+{
+	{0, 4, "qoaf"},
+	{0, 0, 0}
+};
+
+static struct mdbreadinforegstruct qoaReadInfoReg = {"QOA", qoaReadInfo, qoaSignatures, 0 MDBREADINFOREGSTRUCT_TAIL};
 
 OCP_INTERNAL int qoa_type_init (struct PluginInitAPI_t *API)
 {
@@ -47,6 +47,7 @@ extern "C"
 #include "../config.h"
 
 #include <assert.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -84,6 +85,29 @@ typedef struct
 
 static SidStatBuffer_t last; /* current register values, 3 SID chips */
 
+/* The C64 and all the SID chips are clocked by a worker thread that renders a few rows ahead, so the UI thread only copies finished rows into sid_buf_pos. Multi-SID tunes no longer stall the UI */
+#define RENDER_ROWS 8
+
+typedef struct
+{
+	int16_t *stereo; /* stereo interleaved */
+	int16_t *raw[3]; /* 4-chan interleaved, 3 SID chips */
+	int fill;        /* in samples */
+	uint8_t registers[3][0x20];
+	uint8_t volumes[3][3];
+} SidRenderRow_t;
+
+static SidRenderRow_t SidRenderRows[RENDER_ROWS];
+static int16_t *SidRenderRowsData;
+static unsigned int SidRenderHead; /* rows rendered,  protected by SidRenderMutex */
+static unsigned int SidRenderTail; /* rows consumed,  protected by SidRenderMutex */
+static int SidRenderQuit;          /*                 protected by SidRenderMutex */
+static int SidRenderRunning;
+static pthread_t SidRenderThread;
+static pthread_mutex_t SidRenderMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t SidRenderCond = PTHREAD_COND_INITIALIZER;
+static pthread_mutex_t SidPlayerMutex = PTHREAD_MUTEX_INITIALIZER; /* held while mySidPlayer is used by the worker, lock before SidRenderMutex if both are needed */
+
 static SidStatBuffer_t SidStatBuffers[MAX_ROW_BUFFERS] = {{0}}; // half a second
 static int SidStatBuffers_available = 0;
 static int SidStatBuffers_target = 0;
@@ -155,6 +179,61 @@ static void SidStatBuffers_callback_from_sidbuf (void *arg, int samples_ago)
 	SidStatBuffers_available++;
 }
 
+static void *SidRenderThreadMain (void *context)
+{
+#ifdef __linux
+	pthread_setname_np (SidRenderThread, "SID render");
+#endif
+
+	pthread_mutex_lock (&SidRenderMutex);
+	while (!SidRenderQuit)
+	{
+		SidRenderRow_t *row;
+		int j;
+
+		if ((SidRenderHead - SidRenderTail) >= RENDER_ROWS)
+		{
+			pthread_cond_wait (&SidRenderCond, &SidRenderMutex);
+			continue;
+		}
+		pthread_mutex_unlock (&SidRenderMutex);
+
+		pthread_mutex_lock (&SidPlayerMutex);
+
+		/* the slot is ours until SidRenderHead is increased, and SidRenderTail can not pass it */
+		row = SidRenderRows + (SidRenderHead % RENDER_ROWS);
+		{
+			std::vector<int16_t *> raw {row->raw[0], row->raw[1], row->raw[2]};
+			row->fill = mySidPlayer->iterateaudio (row->stereo, sid_samples_per_row, sid_clocks_per_row, &raw) >> 1;
+		}
+		for (j=0; j < SidCount; j++)
+		{
+			mySidPlayer->getSidStatus (j,
+			                           row->registers[j],
+			                           row->volumes[j][0],
+			                           row->volumes[j][1],
+			                           row->volumes[j][2]);
+		}
+
+		pthread_mutex_lock (&SidRenderMutex);
+		SidRenderHead++;
+		pthread_cond_broadcast (&SidRenderCond);
+		pthread_mutex_unlock (&SidPlayerMutex);
+	}
+	pthread_mutex_unlock (&SidRenderMutex);
+
+	return 0;
+}
+
+/* caller must hold SidPlayerMutex, rows that was rendered before a track change, mute or filter change should not be played, else the change is heard up to RENDER_ROWS rows late */
+static void SidRenderDiscard (void)
+{
+	pthread_mutex_lock (&SidRenderMutex);
+	SidRenderTail = SidRenderHead;
+	pthread_cond_broadcast (&SidRenderCond);
+	pthread_mutex_unlock (&SidRenderMutex);
+}
+
 OCP_INTERNAL void sidIdler (struct cpifaceSessionAPI_t *cpifaceSession)
 {
 	while (SidStatBuffers_available > 0) /* we only prepare more data if SidStatBuffers_available is non-zero. This gives about 0.5 seconds worth of sample-data */
@@ -163,7 +242,8 @@ OCP_INTERNAL void sidIdler (struct cpifaceSessionAPI_t *cpifaceSession)
 
 		int pos1, pos2;
 		int length1, length2;
-		int fill1 = 0, fill2 = 0;
+		int fill1, fill2;
+		SidRenderRow_t *row;
 
 		for (i=0; i < MAX_ROW_BUFFERS; i++)
 		{
@@ -184,31 +264,50 @@ OCP_INTERNAL void sidIdler (struct cpifaceSessionAPI_t *cpifaceSession)
 			break; /* can only happen if speed is over 800% ... */
 		}
 
-		std::vector<int16_t *> raw1 {sid_buf_4x3[0] + (pos1<<2),
-		                             sid_buf_4x3[1] + (pos1<<2),
-		                             sid_buf_4x3[2] + (pos1<<2)};
+		pthread_mutex_lock (&SidRenderMutex);
+		while (SidRenderHead == SidRenderTail)
+		{
+			if (SidStatBuffers_available != SidStatBuffers_target)
+			{ /* devp still has data buffered, do not stall the UI */
+				break;
+			}
+			pthread_cond_wait (&SidRenderCond, &SidRenderMutex);
+		}
+		if (SidRenderHead == SidRenderTail)
+		{
+			pthread_mutex_unlock (&SidRenderMutex);
+			break;
+		}
+		row = SidRenderRows + (SidRenderTail % RENDER_ROWS);
+		pthread_mutex_unlock (&SidRenderMutex);
 
-		/* ringbuffer can physically fit one sid_samples_per_row overflow, so we can manually wrap it back when iterateaudio() writes more data than length1 could fit */
-		fill1 = mySidPlayer->iterateaudio (sid_buf_stereo + (pos1 << 1), sid_samples_per_row, sid_clocks_per_row, &raw1) >> 1;
+		fill1 = row->fill;
+		fill2 = 0;
 		if (fill1 > length1)
 		{
 			fill2 = fill1 - length1;
 			fill1 = length1;
-			memcpy (sid_buf_stereo + (pos2 << 1), sid_buf_stereo + ((pos1 + fill1) << 1), fill2 * 2 * sizeof (int16_t));
-			memcpy (sid_buf_4x3[0] + (pos2 << 2), sid_buf_4x3[0] + ((pos1 + fill1) << 2), fill2 * 4 * sizeof (int16_t));
-			memcpy (sid_buf_4x3[1] + (pos2 << 2), sid_buf_4x3[1] + ((pos1 + fill1) << 2), fill2 * 4 * sizeof (int16_t));
-			memcpy (sid_buf_4x3[2] + (pos2 << 2), sid_buf_4x3[2] + ((pos1 + fill1) << 2), fill2 * 4 * sizeof (int16_t));
 		}
-		for (j=0; j < SidCount; j++)
+		memcpy (sid_buf_stereo + (pos1 << 1), row->stereo, fill1 * 2 * sizeof (int16_t));
+		for (j=0; j < 3; j++)
 		{
-			uint8_t registers[32];
-			mySidPlayer->getSidStatus (j,
-			                           registers,
-			                           SidStatBuffers[i].volumes[j][0],
-			                           SidStatBuffers[i].volumes[j][1],
-			                           SidStatBuffers[i].volumes[j][2]);
-			memcpy (SidStatBuffers[i].registers[j], registers, 0x20);
+			memcpy (sid_buf_4x3[j] + (pos1 << 2), row->raw[j], fill1 * 4 * sizeof (int16_t));
+		}
+		if (fill2)
+		{
+			memcpy (sid_buf_stereo + (pos2 << 1), row->stereo + (fill1 << 1), fill2 * 2 * sizeof (int16_t));
+			for (j=0; j < 3; j++)
+			{
+				memcpy (sid_buf_4x3[j] + (pos2 << 2), row->raw[j] + (fill1 << 2), fill2 * 4 * sizeof (int16_t));
+			}
 		}
+		memcpy (SidStatBuffers[i].registers, row->registers, sizeof (SidStatBuffers[i].registers));
+		memcpy (SidStatBuffers[i].volumes, row->volumes, sizeof (SidStatBuffers[i].volumes));
+
+		pthread_mutex_lock (&SidRenderMutex);
+		SidRenderTail++;
+		pthread_cond_broadcast (&SidRenderCond);
+		pthread_mutex_unlock (&SidRenderMutex);
 
 		SidStatBuffers[i].in_use = 1;
 		cpifaceSession->ringbufferAPI->add_tail_callback_samples (sid_buf_pos, 0, SidStatBuffers_callback_from_sidbuf, SidStatBuffers + i);
@@ -584,7 +683,10 @@ OCP_INTERNAL void sidStartSong (uint8_t sng)
 	if (sng>mySidTuneInfo->songs())
 		sng=mySidTuneInfo->songs();
 	clipbusy++;
+	pthread_mutex_lock (&SidPlayerMutex);
 	mySidPlayer->selecttrack (sng);
+	SidRenderDiscard ();
+	pthread_mutex_unlock (&SidPlayerMutex);
 	clipbusy--;
 }
 
@@ -629,7 +731,12 @@ OCP_INTERNAL void sidMute (struct cpifaceSessionAPI_t *cpifaceSession, int i, in
 {
 	cpifaceSession->MuteChannel[i] = m;
 	sidMuted[i] = m;
+	clipbusy++;
+	pthread_mutex_lock (&SidPlayerMutex);
 	mySidPlayer->mute(i, m);
+	SidRenderDiscard ();
+	pthread_mutex_unlock (&SidPlayerMutex);
+	clipbusy--;
 }
 
 /*extern ubyte filterType;*/
@@ -855,7 +962,12 @@ OCP_INTERNAL void sidSetFilter(bool enable)
 	{
 		return;
 	}
+	clipbusy++;
+	pthread_mutex_lock (&SidPlayerMutex);
 	mySidPlayer->SetFilter (enable);
+	SidRenderDiscard ();
+	pthread_mutex_unlock (&SidPlayerMutex);
+	clipbusy--;
 }
 
 OCP_INTERNAL void sidSetFilterCurve6581 (double v)
@@ -864,7 +976,12 @@ OCP_INTERNAL void sidSetFilterCurve6581 (double v)
 	{
 		return;
 	}
+	clipbusy++;
+	pthread_mutex_lock (&SidPlayerMutex);
 	mySidPlayer->SetFilterCurve6581 (v);
+	SidRenderDiscard ();
+	pthread_mutex_unlock (&SidPlayerMutex);
+	clipbusy--;
 }
 
 OCP_INTERNAL void sidSetFilterRange6581 (double v)
@@ -873,7 +990,12 @@ OCP_INTERNAL void sidSetFilterRange6581 (double v)
 	{
 		return;
 	}
+	clipbusy++;
+	pthread_mutex_lock (&SidPlayerMutex);
 	mySidPlayer->SetFilterRange6581 (v);
+	SidRenderDiscard ();
+	pthread_mutex_unlock (&SidPlayerMutex);
+	clipbusy--;
 }
 
 OCP_INTERNAL void sidSetFilterCurve8580 (double v)
@@ -882,7 +1004,12 @@ OCP_INTERNAL void sidSetFilterCurve8580 (double v)
 	{
 		return;
 	}
+	clipbusy++;
+	pthread_mutex_lock (&SidPlayerMutex);
 	mySidPlayer->SetFilterCurve8580 (v);
+	SidRenderDiscard ();
+	pthread_mutex_unlock (&SidPlayerMutex);
+	clipbusy--;
 }
 
 OCP_INTERNAL void sidSetCombinedWaveformsStrength (int CWF)
@@ -891,7 +1018,12 @@ OCP_INTERNAL void sidSetCombinedWaveformsStrength (int CWF)
 	{
 		return;
 	}
+	clipbusy++;
+	pthread_mutex_lock (&SidPlayerMutex);
 	mySidPlayer->SetCombinedWaveformsStrength (CWF);
+	SidRenderDiscard ();
+	pthread_mutex_unlock (&SidPlayerMutex);
+	clipbusy--;
 }
 
 OCP_INTERNAL int sidOpenPlayer (struct ocpfilehandle_t *file, struct cpifaceSessionAPI_t *cpifaceSession)
@@ -971,11 +1103,12 @@ OCP_INTERNAL int sidOpenPlayer (struct ocpfilehandle_t *file, struct cpifaceSess
 	fprintf (stderr, "sid_samples_per_row=%u\n", (unsigned int)sid_samples_per_row);
 #endif
 
-	sid_buf_stereo = new int16_t [(MAX_ROW_BUFFERS + 1 /* the +1, is due to iterateaudio always mixes a full buffer page per iteration, so we memmove on wrap by hand */) * 2 * sid_samples_per_row](); /* 2 for stereo, ()=initialize the array to zero, ensure valgrind is happy */
-	sid_buf_4x3[0] = new int16_t [(MAX_ROW_BUFFERS + 1 /* the +1, is due to iterateaudio always mixes a full buffer page per iteration, so we memmove on wrap by hand */) * 4 * sid_samples_per_row](); /* 4 for 1 output and 3 internal channels, First SID IC */
-	sid_buf_4x3[1] = new int16_t [(MAX_ROW_BUFFERS + 1 /* the +1, is due to iterateaudio always mixes a full buffer page per iteration, so we memmove on wrap by hand */) * 4 * sid_samples_per_row](); /*                                         Second SID IC */
-	sid_buf_4x3[2] = new int16_t [(MAX_ROW_BUFFERS + 1 /* the +1, is due to iterateaudio always mixes a full buffer page per iteration, so we memmove on wrap by hand */) * 4 * sid_samples_per_row](); /*                                         Third SID IC */
-	if ((!sid_buf_4x3[0]) || (!sid_buf_4x3[1]) || (!sid_buf_4x3[2]))
+	sid_buf_stereo = new int16_t [MAX_ROW_BUFFERS * 2 * sid_samples_per_row](); /* 2 for stereo, ()=initialize the array to zero, ensure valgrind is happy */
+	sid_buf_4x3[0] = new int16_t [MAX_ROW_BUFFERS * 4 * sid_samples_per_row](); /* 4 for 1 output and 3 internal channels, First SID IC */
+	sid_buf_4x3[1] = new int16_t [MAX_ROW_BUFFERS * 4 * sid_samples_per_row](); /*                                         Second SID IC */
+	sid_buf_4x3[2] = new int16_t [MAX_ROW_BUFFERS * 4 * sid_samples_per_row](); /*                                         Third SID IC */
+	SidRenderRowsData = new int16_t [RENDER_ROWS * (2 + 4 * 3) * sid_samples_per_row]();
+	if ((!sid_buf_stereo) || (!sid_buf_4x3[0]) || (!sid_buf_4x3[1]) || (!sid_buf_4x3[2]) || (!SidRenderRowsData))
 	{
 		retval = errAllocMem;
 		goto error_out_sid_buffers;
@@ -992,6 +1125,25 @@ OCP_INTERNAL int sidOpenPlayer (struct ocpfilehandle_t *file, struct cpifaceSess
 	SidStatBuffers_target = TARGET_ROW_BUFFERS;
 	SidStatBuffers_available = SidStatBuffers_target;
 
+	memset (SidRenderRows, 0, sizeof (SidRenderRows));
+	for (int i=0; i < RENDER_ROWS; i++)
+	{
+		SidRenderRows[i].stereo = SidRenderRowsData + i * (2 + 4 * 3) * sid_samples_per_row;
+		SidRenderRows[i].raw[0] = SidRenderRows[i].stereo + 2 * sid_samples_per_row;
+		SidRenderRows[i].raw[1] = SidRenderRows[i].raw[0] + 4 * sid_samples_per_row;
+		SidRenderRows[i].raw[2] = SidRenderRows[i].raw[1] + 4 * sid_samples_per_row;
+	}
+	SidRenderHead = 0;
+	SidRenderTail = 0;
+	SidRenderQuit = 0;
+	if (pthread_create (&SidRenderThread, 0, SidRenderThreadMain, 0))
+	{
+		cpifaceSession->cpiDebug (cpifaceSession, "[SID] pthread_create() failed\n");
+		retval = errGen;
+		goto error_out_sid_buf_pos;
+	}
+	SidRenderRunning = 1;
+
 	sidbuffpos = 0x00000000;
 	sidbufrate = 0x00010000;
 
@@ -1018,12 +1170,14 @@ OCP_INTERNAL int sidOpenPlayer (struct ocpfilehandle_t *file, struct cpifaceSess
 
 	return errOk;
 
-	//cpifaceSession->ringbufferAPI->free (sid_buf_pos); sid_buf_pos = 0;
+error_out_sid_buf_pos:
+	cpifaceSession->ringbufferAPI->free (sid_buf_pos); sid_buf_pos = 0;
 error_out_sid_buffers:
 	delete[] sid_buf_stereo; sid_buf_stereo = NULL;
 	delete[] sid_buf_4x3[0]; sid_buf_4x3[0] = NULL;
 	delete[] sid_buf_4x3[1]; sid_buf_4x3[1] = NULL;
 	delete[] sid_buf_4x3[2]; sid_buf_4x3[2] = NULL;
+	delete[] SidRenderRowsData; SidRenderRowsData = NULL;
 error_out_mySidPlay:
 	cpifaceSession->plrDevAPI->Stop (cpifaceSession);
 	delete mySidPlayer; mySidPlayer = NULL;
@@ -1039,6 +1193,16 @@ OCP_INTERNAL void sidClosePlayer (struct cpifaceSessionAPI_t *cpifaceSession)
 		cpifaceSession->plrDevAPI->Stop (cpifaceSession);
 	}
 
+	if (SidRenderRunning)
+	{
+		pthread_mutex_lock (&SidRenderMutex);
+		SidRenderQuit = 1;
+		pthread_cond_broadcast (&SidRenderCond);
+		pthread_mutex_unlock (&SidRenderMutex);
+		pthread_join (SidRenderThread, 0);
+		SidRenderRunning = 0;
+	}
+
 	if (sid_buf_pos)
 	{
 		cpifaceSession->ringbufferAPI->free (sid_buf_pos);
@@ -1051,4 +1215,5 @@ OCP_INTERNAL void sidClosePlayer (struct cpifaceSessionAPI_t *cpifaceSession)
 	delete[] sid_buf_4x3[0]; sid_buf_4x3[0] = NULL;
 	delete[] sid_buf_4x3[1]; sid_buf_4x3[1] = NULL;
 	delete[] sid_buf_4x3[2]; sid_buf_4x3[2] = NULL;
+	delete[] SidRenderRowsData; SidRenderRowsData = NULL;
 }
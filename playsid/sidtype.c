@@ -168,7 +168,18 @@ static int sidReadInfo(struct moduleinfostruct *m, struct ocpfilehandle_t *fp, c
 	return 0;
 }
 
-static struct mdbreadinforegstruct sidReadInfoReg = {"SID", sidReadInfo MDBREADINFOREGSTRUCT_TAIL};
+static const struct mdbReadInfoSignature sidSignatures[] =
+{
+	{0, 4, "PSID"},
+	{0, 4, "RSID"},
+	{0, 16, "SIDPLAY INFOFILE"},
+	{2, 1, "\x4c"}, /* raw C64 dump, see the checks in sidReadInfo() */
+	{0, 0, 0}
+};
+
+static const char * const sidExtensions[] = {"MUS", "SID", 0};
+
+static struct mdbreadinforegstruct sidReadInfoReg = {"SID", sidReadInfo, sidSignatures, sidExtensions MDBREADINFOREGSTRUCT_TAIL};
 
 static const char *SID_description[] =
 {
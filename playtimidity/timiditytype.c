@@ -246,7 +246,14 @@ static const char *MIDI_description[] =
 	NULL
 };
 
-static struct mdbreadinforegstruct timidityReadInfoReg = {"MIDI", timidityReadInfo MDBREADINFOREGSTRUCT_TAIL};
+static const struct mdbReadInfoSignature timiditySignatures[] =
+{
+	{0, 4, "MThd"},
+	{8, 4, "RMID"}, /* MIDI inside a RIFF container */
+	{0, 0, 0}
+};
+
+static struct mdbreadinforegstruct timidityReadInfoReg = {"MIDI", timidityReadInfo, timiditySignatures, 0 MDBREADINFOREGSTRUCT_TAIL};
 
 OCP_INTERNAL int timidity_type_init (struct PluginInitAPI_t *API)
 {
@@ -197,7 +197,13 @@ static const char *WAV_description[] =
 	NULL
 };
 
-static struct mdbreadinforegstruct wavReadInfoReg = {"WAVE", wavReadInfo MDBREADINFOREGSTRUCT_TAIL};
+static const struct mdbReadInfoSignature wavSignatures[] =
+{
+	{8, 4, "WAVE"},
+	{0, 0, 0}
+};
+
+static struct mdbreadinforegstruct wavReadInfoReg = {"WAVE", wavReadInfo, wavSignatures, 0 MDBREADINFOREGSTRUCT_TAIL};
 
 OCP_INTERNAL int wav_type_init (struct PluginInitAPI_t *API)
 {
@@ -0,0 +1,294 @@
+/* OpenCP Module Player
+ * copyright (c) 2026 Stian Skjelstad <stian.skjelstad@gmail.com>
+ *
+ * Test for the order checkpoints used when seeking. After xmpSetPos() the
+ * player must send the same channel updates as it did when the same row was
+ * reached by playing from the start. The seeks are done in random order, so
+ * the silent walk that makes the checkpoints is resumed from where it stopped.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "xmplay.c"
+
+#define NCHAN 4
+#define NPAT 4
+#define NORD 8
+#define PATLEN 32
+#define MAXTICKS 20000
+#define COMPARETICKS 96
+
+static uint32_t tick_hash;
+static int speed;
+static void (*player_tick)(struct cpifaceSessionAPI_t *cpifaceSession);
+
+static void hash_add (uint32_t v)
+{
+	int j;
+	for (j = 0; j < 4; j++)
+	{
+		tick_hash = (tick_hash ^ ((v >> (j * 8)) & 0xff)) * 16777619;
+	}
+}
+
+static void test_mcpSet (struct cpifaceSessionAPI_t *cpifaceSession, int ch, int opt, int val)
+{
+	if (opt == mcpGSpeed)
+	{ /* a seek sends the current speed again, so only the value is compared */
+		speed = val;
+		return;
+	}
+	hash_add (ch);
+	hash_add (opt);
+	hash_add (val);
+}
+
+static int test_mcpGet (struct cpifaceSessionAPI_t *cpifaceSession, int ch, int opt)
+{
+	return 0;
+}
+
+static int test_GetFreq6848 (int note)
+{
+	return 6848 + note;
+}
+
+static int test_GetNote (unsigned int freq)
+{
+	return freq / 7;
+}
+
+static int test_OpenPlayer (int chan, void (*p)(struct cpifaceSessionAPI_t *cpifaceSession), struct ocpfilehandle_t *source_file, struct cpifaceSessionAPI_t *cpifaceSession)
+{
+	player_tick = p;
+	cpifaceSession->PhysicalChannelCount = chan;
+	return 1;
+}
+
+static void test_ClosePlayer (struct cpifaceSessionAPI_t *cpifaceSession)
+{
+}
+
+static void test_Normalize (struct cpifaceSessionAPI_t *cpifaceSession, enum mcpNormalizeType Type)
+{
+}
+
+static uint32_t random_state;
+
+static int random_int (int n)
+{ /* not rand(), so the module does not depend on the C library */
+	random_state = random_state * 1103515245 + 12345;
+	return (random_state >> 16) % n;
+}
+
+/* patterns full of effects that keep state between rows: slides with effect memory, vibrato, tempo and global volume */
+static void random_module (struct xmodule *m, uint8_t (*patdata)[PATLEN * NCHAN][5], uint16_t *patlens, uint8_t (**patterns)[5], uint16_t *orders, struct xmpsample *samples, struct xmpinstrument *instruments)
+{
+	static const uint8_t commands[] =
+	{
+		xmpCmdPortaU, xmpCmdPortaD, xmpCmdPortaNote, xmpCmdVibrato, xmpCmdVolSlide, xmpCmdTremolo,
+		xmpCmdArpeggio, xmpCmdGVolSlide, xmpCmdSpeed, xmpCmdPanSlide, xmpCmdPatDelay, xmpCmdBreak
+	};
+	int i, j;
+
+	memset (m, 0, sizeof (*m));
+	m->nchan = NCHAN;
+	m->ninst = 2;
+	m->nsamp = 2;
+	m->npat = NPAT;
+	m->nord = NORD;
+	m->linearfreq = 1;
+	m->initempo = 6;
+	m->inibpm = 125;
+	m->samples = samples;
+	m->instruments = instruments;
+	m->patlens = patlens;
+	m->patterns = patterns;
+	m->orders = orders;
+
+	memset (samples, 0, sizeof (samples[0]) * 2);
+	memset (instruments, 0, sizeof (instruments[0]) * 2);
+	for (i = 0; i < 2; i++)
+	{
+		samples[i].handle = i;
+		samples[i].stdvol = 0xc0 + i * 0x40;
+		samples[i].stdpan = 0x40 + i * 0x80;
+		samples[i].volenv = samples[i].panenv = samples[i].pchenv = 0xffff;
+		samples[i].volfade = 0xffff;
+		for (j = 0; j < 128; j++)
+		{
+			instruments[i].samples[j] = i;
+		}
+	}
+	for (i = 0; i < NCHAN; i++)
+	{
+		m->panpos[i] = (i & 1) ? 0xc0 : 0x40;
+	}
+
+	for (i = 0; i < NPAT; i++)
+	{
+		patlens[i] = PATLEN;
+		patterns[i] = patdata[i];
+		for (j = 0; j < PATLEN * NCHAN; j++)
+		{
+			uint8_t *c = patdata[i][j];
+			c[0] = random_int (4) ? 0 : 1 + random_int (96);
+			c[1] = c[0] ? 1 + random_int (2) : 0;
+			c[2] = random_int (3) ? 0 : 0x10 + random_int (0x41);
+			c[3] = commands[random_int (sizeof (commands))];
+			c[4] = random_int (3) ? 0 : random_int (256);
+			switch (c[3])
+			{
+				case xmpCmdSpeed:
+					c[4] = random_int (2) ? 2 + random_int (6) : 0x40 + random_int (0xc0); /* never 0, that restarts the song */
+					break;
+				case xmpCmdPatDelay:
+					c[4] = random_int (8) ? 0 : random_int (3);
+					break;
+				case xmpCmdBreak:
+					if (random_int (8))
+					{
+						c[3] = xmpCmdArpeggio;
+					}
+					c[4] = random_int (PATLEN);
+					c[4] = ((c[4] / 10) << 4) | (c[4] % 10); /* BCD */
+					break;
+			}
+		}
+	}
+	for (i = 0; i < NORD; i++)
+	{
+		orders[i] = random_int (NPAT);
+	}
+}
+
+struct position_t
+{
+	int ord, row;
+	int tick; /* the first tick of the row when played from the start */
+};
+
+int main (int argc, char *argv[])
+{
+	static uint8_t patdata[NPAT][PATLEN * NCHAN][5];
+	static uint32_t linear[MAXTICKS];
+	static int linearspeed[MAXTICKS];
+	static struct position_t rows[MAXTICKS];
+	uint16_t patlens[NPAT];
+	uint8_t (*patterns[NPAT])[5];
+	uint16_t orders[NORD];
+	struct xmpsample samples[2];
+	struct xmpinstrument instruments[2];
+	struct xmodule m;
+	struct mcpAPI_t api;
+	struct mcpDevAPI_t devapi;
+	struct cpifaceSessionAPI_t session;
+	int seeds = 20;
+	int errors = 0;
+	int seed;
+
+	memset (&api, 0, sizeof (api));
+	api.GetFreq6848 = test_GetFreq6848;
+	api.GetNote6848 = test_GetNote;
+	api.GetNote8363 = test_GetNote;
+	memset (&devapi, 0, sizeof (devapi));
+	devapi.OpenPlayer = test_OpenPlayer;
+	devapi.ClosePlayer = test_ClosePlayer;
+	memset (&session, 0, sizeof (session));
+	session.mcpAPI = &api;
+	session.mcpDevAPI = &devapi;
+	session.mcpSet = test_mcpSet;
+	session.mcpGet = test_mcpGet;
+	session.Normalize = test_Normalize;
+
+	for (seed = 0; seed < seeds; seed++)
+	{
+		int nrows = 0;
+		int ticks, i, j;
+		int seekerrors = 0;
+
+		random_state = seed;
+		random_module (&m, patdata, patlens, patterns, orders, samples, instruments);
+
+		if (xmpPlayModule (&m, 0, &session))
+		{
+			fprintf (stderr, "seed %d: xmpPlayModule() failed\n", seed);
+			errors++;
+			continue;
+		}
+		if (checkpointticks)
+		{
+			fprintf (stderr, "seed %d: xmpPlayModule() walked the module, that is only done when seeking\n", seed);
+			errors++;
+		}
+		for (ticks = 0; ticks < MAXTICKS; ticks++)
+		{
+			tick_hash = 2166136261u;
+			player_tick (&session);
+			linear[ticks] = tick_hash;
+			linearspeed[ticks] = speed;
+			if (tick0 && !patdelay && !looped)
+			{ /* only the first time through the song, checkpoints are not made after it loops */
+				for (i = 0; i < nrows; i++)
+				{
+					if ((rows[i].ord == curord) && (rows[i].row == currow))
+					{
+						break;
+					}
+				}
+				if (i == nrows)
+				{
+					rows[nrows].ord = curord;
+					rows[nrows].row = currow;
+					rows[nrows].tick = ticks;
+					nrows++;
+				}
+			}
+		}
+
+		for (i = nrows - 1; i > 0; i--)
+		{
+			struct position_t temp = rows[i];
+			j = random_int (i + 1);
+			rows[i] = rows[j];
+			rows[j] = temp;
+		}
+		for (i = 0; i < nrows; i++)
+		{
+			xmpSetPos (&session, rows[i].ord, rows[i].row);
+			for (j = 0; (j < COMPARETICKS) && ((rows[i].tick + j) < MAXTICKS); j++)
+			{
+				tick_hash = 2166136261u;
+				player_tick (&session);
+				if ((tick_hash != linear[rows[i].tick + j]) || (speed != linearspeed[rows[i].tick + j]))
+				{
+					if (!seekerrors)
+					{
+						fprintf (stderr, "seed %d: seek to order %d row %d differs at tick %d\n", seed, rows[i].ord, rows[i].row, j);
+					}
+					seekerrors++;
+					break;
+				}
+			}
+		}
+		fprintf (stderr, "seed %d: %d rows, %s\n", seed, nrows, seekerrors ? "FAILED" : "ok");
+		errors += seekerrors;
+
+		xmpStopModule (&session);
+	}
+
+	fprintf (stderr, "Final result: %d errors\n", errors);
+	return !!errors;
+}
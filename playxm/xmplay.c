@@ -211,6 +211,37 @@ static int realtempo;
 static int realspeed;
 static int realgvol;
 
+/* Player state just before the tick that starts an order. They are recorded by playing the module silently from the
+ * start, so that a seek gets the effect memory, envelopes, tempo and volumes it would have had when played from the
+ * start. The silent walk is only done as far as a seek needs it, and continues from where it stopped on the next seek.
+ */
+struct xmpcheckpoint
+{
+	int row; /* the row the order was entered at */
+	uint8_t globalvol;
+	uint8_t globalfx;
+	uint8_t curtick;
+	uint8_t curtempo;
+	uint8_t tick0;
+	uint8_t (*patptr)[5];
+	int currow;
+	int patlen;
+	int curord;
+	int jumptoord;
+	int jumptorow;
+	int nextpatternrow;
+	int patdelay;
+	int curbpm;
+	struct channel channels[]; /* nchan entries */
+};
+#define XMP_CHECKPOINT_MAXTICKS 0x100000
+static struct xmpcheckpoint **checkpoints; /* one per order, NULL if the order is not reached (yet) */
+static struct xmpcheckpoint *checkpointscratch;
+static struct xmpcheckpoint *checkpointwalk; /* where the silent walk stopped */
+static struct xmpcheckpoint *checkpointlive; /* the state of the playback, while walking */
+static int checkpointticks; /* ticks walked so far, -1 when the module has looped */
+static struct cpifaceSessionAPI_t *silentsession; /* copy of the session with a mixer that does nothing */
+
 
 enum
 {
@@ -1438,6 +1469,204 @@ OCP_INTERNAL void xmpGetRealVolume (struct cpifaceSessionAPI_t *cpifaceSession,
 	cpifaceSession->mcpGetRealVolume (ch, voll, volr);
 }
 
+static void xmpNullSet (struct cpifaceSessionAPI_t *cpifaceSession, int ch, int opt, int val)
+{
+}
+
+static int xmpNullGet (struct cpifaceSessionAPI_t *cpifaceSession, int ch, int opt)
+{
+	return 0;
+}
+
+static void xmpSaveState (struct xmpcheckpoint *c)
+{
+	c->globalvol=globalvol;
+	c->globalfx=globalfx;
+	c->curtick=curtick;
+	c->curtempo=curtempo;
+	c->tick0=tick0;
+	c->patptr=patptr;
+	c->currow=currow;
+	c->patlen=patlen;
+	c->curord=curord;
+	c->jumptoord=jumptoord;
+	c->jumptorow=jumptorow;
+	c->nextpatternrow=nextpatternrow;
+	c->patdelay=patdelay;
+	c->curbpm=curbpm;
+	memcpy (c->channels, channels, sizeof (channels[0]) * nchan);
+}
+
+static void xmpLoadState (const struct xmpcheckpoint *c)
+{
+	globalvol=c->globalvol;
+	globalfx=c->globalfx;
+	curtick=c->curtick;
+	curtempo=c->curtempo;
+	tick0=c->tick0;
+	patptr=c->patptr;
+	currow=c->currow;
+	patlen=c->patlen;
+	curord=c->curord;
+	jumptoord=c->jumptoord;
+	jumptorow=c->jumptorow;
+	nextpatternrow=c->nextpatternrow;
+	patdelay=c->patdelay;
+	curbpm=c->curbpm;
+	memcpy (channels, c->channels, sizeof (channels[0]) * nchan);
+	firstspeed=256*2*curbpm/5;
+}
+
+static void xmpFreeCheckpoints (void)
+{
+	int i;
+
+	if (checkpoints)
+	{
+		for (i=0; i<nord; i++)
+		{
+			free (checkpoints[i]);
+		}
+		free (checkpoints);
+		checkpoints=0;
+	}
+	free (checkpointscratch);
+	checkpointscratch=0;
+	free (checkpointwalk);
+	checkpointwalk=0;
+	free (checkpointlive);
+	checkpointlive=0;
+	free (silentsession);
+	silentsession=0;
+}
+
+/* the silent walk starts from the state the module is loaded with. Without memory, seeks use the old jump */
+static void xmpInitCheckpoints (struct cpifaceSessionAPI_t *cpifaceSession)
+{
+	size_t size = sizeof (struct xmpcheckpoint) + sizeof (channels[0]) * nchan;
+
+	checkpoints=calloc (nord, sizeof (checkpoints[0]));
+	checkpointscratch=malloc (size);
+	checkpointwalk=malloc (size);
+	checkpointlive=malloc (size);
+	silentsession=malloc (sizeof (*silentsession));
+	if ((!checkpoints) || (!checkpointscratch) || (!checkpointwalk) || (!checkpointlive) || (!silentsession))
+	{
+		xmpFreeCheckpoints ();
+		return;
+	}
+	*silentsession=*cpifaceSession;
+	silentsession->mcpSet=xmpNullSet;
+	silentsession->mcpGet=xmpNullGet;
+
+	xmpSaveState (checkpointwalk);
+	checkpointticks=0;
+}
+
+/* Continues the silent walk until ord has a checkpoint, or the module loops. Only used by xmpSetPos(), which empties
+ * the queue afterwards.
+ */
+static void xmpWalkCheckpoints (int ord)
+{
+	size_t size = sizeof (struct xmpcheckpoint) + sizeof (channels[0]) * nchan;
+	int oldlooping=looping, oldlooped=looped, oldusersetpos=usersetpos, oldfirstspeed=firstspeed;
+	int oldrealtempo=realtempo, oldrealspeed=realspeed, oldrealgvol=realgvol, oldrealsync=realsync, oldrealsynctime=realsynctime;
+
+	xmpSaveState (checkpointlive);
+	xmpLoadState (checkpointwalk);
+	looping=1;
+	looped=0;
+	usersetpos=0;
+	firstspeed=0;
+	querpos=0;
+	quewpos=0;
+
+	while ((!checkpoints[ord]) && (checkpointticks<XMP_CHECKPOINT_MAXTICKS) && (!looped))
+	{
+		int nextrow = (curtick+1)>=curtempo;
+		int o = curord;
+
+		if (nextrow)
+		{
+			xmpSaveState (checkpointscratch);
+		}
+		xmpPlayTick (silentsession);
+		if (nextrow && ((curord!=o) || (!checkpointticks)) && (!looped) && (!checkpoints[curord]))
+		{
+			if (!(checkpoints[curord]=malloc (size)))
+			{
+				looped=1; /* stop here, the orders not reached yet use the old jump */
+				break;
+			}
+			memcpy (checkpoints[curord], checkpointscratch, size);
+			checkpoints[curord]->row=currow;
+		}
+		checkpointticks++;
+	}
+	if (looped || (checkpointticks>=XMP_CHECKPOINT_MAXTICKS))
+	{
+		checkpointticks=-1;
+	}
+
+	xmpSaveState (checkpointwalk);
+	xmpLoadState (checkpointlive);
+	looping=oldlooping;
+	looped=oldlooped;
+	usersetpos=oldusersetpos;
+	firstspeed=oldfirstspeed;
+	realtempo=oldrealtempo;
+	realspeed=oldrealspeed;
+	realgvol=oldrealgvol;
+	realsync=oldrealsync;
+	realsynctime=oldrealsynctime;
+}
+
+/* restores the checkpoint of ord, and plays silently until row is reached. Returns non-zero on failure */
+static int xmpSeekCheckpoint (int ord, int row)
+{
+	const struct xmpcheckpoint *c;
+	int oldlooped = looped;
+	int ticks;
+
+	if (!checkpoints)
+	{
+		return -1;
+	}
+	if ((!checkpoints[ord]) && (checkpointticks>=0))
+	{
+		xmpWalkCheckpoints (ord);
+	}
+	c=checkpoints[ord];
+	if ((!c) || (row<c->row))
+	{
+		return -1;
+	}
+	xmpLoadState (c);
+
+	for (ticks=0; ticks<XMP_CHECKPOINT_MAXTICKS; ticks++)
+	{
+		int nextrow = (curtick+1)>=curtempo;
+
+		if (nextrow)
+		{
+			xmpSaveState (checkpointscratch);
+		}
+		xmpPlayTick (silentsession);
+		if (curord!=ord)
+		{ /* jumped away before row was reached */
+			break;
+		}
+		if (nextrow && (currow==row))
+		{
+			xmpLoadState (checkpointscratch);
+			looped=oldlooped;
+			return 0;
+		}
+	}
+	looped=oldlooped;
+	return -1;
+}
+
 OCP_INTERNAL uint16_t xmpGetPos (void)
 {
 	return (curord<<8)|currow;
@@ -1471,15 +1700,18 @@ OCP_INTERNAL void xmpSetPos (struct cpifaceSessionAPI_t *cpifaceSession, int ord
 	}
 	for (i=0; i<nchan; i++)
 		cpifaceSession->mcpSet (cpifaceSession, i, mcpCReset, 0);
-	jumptoord=ord;
-	jumptorow=row;
-	curtick=curtempo;
-	curord=ord;
-	currow=row;
+	if (xmpSeekCheckpoint (ord, row))
+	{
+		jumptoord=ord;
+		jumptorow=row;
+		curtick=curtempo;
+		curord=ord;
+		currow=row;
+	}
 	usersetpos=1;
 	querpos=0;
 	quewpos=0;
-	realpos=(curord<<16)|(currow<<8);
+	realpos=(ord<<16)|(row<<8);
 }
 
 OCP_INTERNAL void xmpMute (struct cpifaceSessionAPI_t *cpifaceSession, int i, int m)
@@ -1554,11 +1786,14 @@ OCP_INTERNAL int xmpPlayModule (struct xmodule *m, struct ocpfilehandle_t *file,
 	quewpos=0;
 
 	curbpm=m->inibpm;
+	firstspeed=256*2*curbpm/5;
+	xmpInitCheckpoints (cpifaceSession);
 	realtempo=m->inibpm;
 	realspeed=m->initempo;
-	firstspeed=256*2*curbpm/5;
+	realgvol=0x40;
 	if (!cpifaceSession->mcpDevAPI->OpenPlayer(nchan, xmpPlayTick, file, cpifaceSession))
 	{
+		xmpFreeCheckpoints ();
 		return errPlay;
 	}
 
@@ -1567,6 +1802,7 @@ OCP_INTERNAL int xmpPlayModule (struct xmodule *m, struct ocpfilehandle_t *file,
 	if (nchan != cpifaceSession->PhysicalChannelCount)
 	{
 		cpifaceSession->mcpDevAPI->ClosePlayer (cpifaceSession);
+		xmpFreeCheckpoints ();
 		return errFormStruc;
 	}
 
@@ -1578,6 +1814,7 @@ OCP_INTERNAL void xmpStopModule (struct cpifaceSessionAPI_t *cpifaceSession)
 	cpifaceSession->mcpDevAPI->ClosePlayer (cpifaceSession);
 	free(que);
 	que=0;
+	xmpFreeCheckpoints ();
 }
 
 OCP_INTERNAL void xmpGetGlobInfo (int *tmp, int *bpm, int *gvol)
@@ -119,7 +119,7 @@ OCP_INTERNAL int xmpLoadM15  (struct cpifaceSessionAPI_t *cpifaceSession, struct
 OCP_INTERNAL int xmpLoadM15t (struct cpifaceSessionAPI_t *cpifaceSession, struct xmodule *m, struct ocpfilehandle_t *f);
 OCP_INTERNAL int xmpLoadWOW  (struct cpifaceSessionAPI_t *cpifaceSession, struct xmodule *m, struct ocpfilehandle_t *f);
 OCP_INTERNAL int xmpLoadMXM  (struct cpifaceSessionAPI_t *cpifaceSession, struct xmodule *m, struct ocpfilehandle_t *f);
-OCP_INTERNAL void xmpFreeModule (struct xmodule *m);
+OCP_INTERNAL void xmpFreeModule (struct cpifaceSessionAPI_t *cpifaceSession, struct xmodule *m);
 
 OCP_INTERNAL int xmpPlayModule (struct xmodule *m, struct ocpfilehandle_t *file, struct cpifaceSessionAPI_t *cpifaceSession);
 OCP_INTERNAL void xmpStopModule (struct cpifaceSessionAPI_t *cpifaceSession);
@@ -131,6 +131,7 @@ OCP_INTERNAL uint16_t xmpGetPos (void);
 OCP_INTERNAL int xmpGetRealPos (struct cpifaceSessionAPI_t *cpifaceSession);
 OCP_INTERNAL int xmpGetDotsData (struct cpifaceSessionAPI_t *cpifaceSession, int ch, int *smp, int *frq, int *l, int *r, int *sus);
 OCP_INTERNAL int xmpPrecalcTime (struct xmodule *m, int startpos, int (*calc)[2], int n, int ite);
+OCP_INTERNAL void xmpTimeStart (struct cpifaceSessionAPI_t *cpifaceSession, struct xmodule *m); /* calculates song-time table in the background */
 OCP_INTERNAL int xmpLoop (void);
 OCP_INTERNAL void xmpSetLoop (int);
 OCP_INTERNAL int xmpGetChanIns (int);
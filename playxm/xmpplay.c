@@ -60,6 +60,12 @@ OCP_INTERNAL struct xmodule mod;
 static struct xmpinstrument *insts;
 static struct xmpsample *samps;
 
+static void xmpSongTimeSeek (struct cpifaceSessionAPI_t *cpifaceSession)
+{ /* let the timer follow the seek, realpos already holds the new position */
+	int p = xmpGetRealPos (cpifaceSession);
+	cpifaceSession->SongTimeSeek (cpifaceSession, p>>16, (p>>8)&0xFF);
+}
+
 static int xmpProcessKey(struct cpifaceSessionAPI_t *cpifaceSession, uint16_t key)
 {
 	int row;
@@ -95,24 +101,28 @@ static int xmpProcessKey(struct cpifaceSessionAPI_t *cpifaceSession, uint16_t ke
 			p=xmpGetPos();
 			pat=p>>8;
 			xmpSetPos (cpifaceSession, pat-1, 0);
+			xmpSongTimeSeek (cpifaceSession);
 			break;
 		case '>':
 		case KEY_CTRL_RIGHT:
 			p=xmpGetPos();
 			pat=p>>8;
 			xmpSetPos (cpifaceSession, pat+1, 0);
+			xmpSongTimeSeek (cpifaceSession);
 			break;
 		case KEY_CTRL_UP:
 			p=xmpGetPos();
 			pat=p>>8;
 			row=p&0xFF;
 			xmpSetPos (cpifaceSession, pat, row-8);
+			xmpSongTimeSeek (cpifaceSession);
 			break;
 		case KEY_CTRL_DOWN:
 			p=xmpGetPos();
 			pat=p>>8;
 			row=p&0xFF;
 			xmpSetPos (cpifaceSession, pat, row+8);
+			xmpSongTimeSeek (cpifaceSession);
 			break;
 		default:
 			return 0;
@@ -158,7 +168,7 @@ static void xmpDrawGStrings (struct cpifaceSessionAPI_t *cpifaceSession)
 static void xmpCloseFile (struct cpifaceSessionAPI_t *cpifaceSession)
 {
 	xmpStopModule (cpifaceSession);
-	xmpFreeModule(&mod);
+	xmpFreeModule (cpifaceSession, &mod);
 }
 
 /***********************************************************************/
@@ -242,12 +252,12 @@ static int xmpOpenFile (struct cpifaceSessionAPI_t *cpifaceSession, struct modul
 
 	if ((retval = loader (cpifaceSession, &mod, file)))
 	{
-		xmpFreeModule(&mod);
+		xmpFreeModule (cpifaceSession, &mod);
 		return retval;
 	}
 	if (!xmpLoadSamples (cpifaceSession, &mod))
 	{
-		xmpFreeModule(&mod);
+		xmpFreeModule (cpifaceSession, &mod);
 		return errAllocSamp;
 	}
 
@@ -255,7 +265,7 @@ static int xmpOpenFile (struct cpifaceSessionAPI_t *cpifaceSession, struct modul
 
 	if ((retval = xmpPlayModule (&mod, file, cpifaceSession)))
 	{
-		xmpFreeModule(&mod);
+		xmpFreeModule (cpifaceSession, &mod);
 		return retval;
 	}
 
@@ -278,6 +288,8 @@ static int xmpOpenFile (struct cpifaceSessionAPI_t *cpifaceSession, struct modul
 	xmpInstSetup (cpifaceSession, mod.instruments, mod.ninst, mod.samples, mod.nsamp, mod.sampleinfos, mod.nsampi, 0, xmpMarkInsSamp);
 	xmTrkSetup (cpifaceSession, &mod);
 
+	xmpTimeStart (cpifaceSession, &mod);
+
 	cpifaceSession->InPause = 0;
 	cpifaceSession->mcpSet (cpifaceSession, -1, mcpMasterPause, 0);
 
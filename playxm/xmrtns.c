@@ -29,16 +29,16 @@
 #include <stdlib.h>
 #include <string.h>
 #include "types.h"
+#include "cpiface/cpiface.h"
 #include "dev/mcp.h"
 #include "xmplay.h"
 #include "stuff/err.h"
 
-OCP_INTERNAL void xmpFreeModule (struct xmodule *m)
+OCP_INTERNAL void xmpFreeModule (struct cpifaceSessionAPI_t *cpifaceSession, struct xmodule *m)
 {
 	unsigned int i;
 	if (m->sampleinfos)
-		for (i=0; i<m->nsampi; i++)
-			free(m->sampleinfos[i].ptr);
+		cpifaceSession->mcpAPI->FreeSamples (m->sampleinfos, m->nsampi);
 	free(m->sampleinfos);
 	free(m->samples);
 	if (m->envelopes)
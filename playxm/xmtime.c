@@ -27,6 +27,7 @@
 
 #include "config.h"
 #include "types.h"
+#include "cpiface/cpiface.h"
 #include "xmplay.h"
 
 static uint8_t chPatLoopCount[256];
@@ -60,6 +61,10 @@ static int (*calctimer)[2];
 static int calcn;
 static int sync;
 
+static struct cpifaceSessionAPI_t *timesession; /* set while the song-time table is calculated in the background */
+static int timelooped;
+static uint32_t timelength;
+
 static int xmpFindTick(void)
 {
 	int i;
@@ -195,6 +200,16 @@ static int xmpFindTick(void)
 				if (!++calctimer[i][1])
 					calctimer[i][1]=timerval;
 
+	if (timesession&&!curtick)
+	{
+		if (looped)
+		{
+			timelooped=1;
+			timelength=timerval;
+		} else
+			timesession->SongTimeRow (timesession, curord, currow, timerval);
+	}
+
 	looped=0;
 
 	timerfrac+=4096*163840/speed;
@@ -208,9 +223,11 @@ static int xmpFindTick(void)
 	return 1;
 }
 
-OCP_INTERNAL int xmpPrecalcTime (struct xmodule *m, int startpos, int (*calc)[2], int n, int ite)
+static void xmpTimeReset (struct xmodule *m, int startpos, int (*calc)[2], int n)
 {
-	int i;
+	timesession=0;
+	timelooped=0;
+	timelength=0;
 
 	patdelay=0;
 	sync=-1;
@@ -234,6 +251,13 @@ OCP_INTERNAL int xmpPrecalcTime (struct xmodule *m, int startpos, int (*calc)[2]
 	speed=m->inibpm;
 	timerval=0;
 	timerfrac=0;
+}
+
+OCP_INTERNAL int xmpPrecalcTime (struct xmodule *m, int startpos, int (*calc)[2], int n, int ite)
+{
+	int i;
+
+	xmpTimeReset (m, startpos, calc, n);
 
 	for (i=0; i<ite; i++)
 		if (xmpFindTick())
@@ -241,3 +265,38 @@ OCP_INTERNAL int xmpPrecalcTime (struct xmodule *m, int startpos, int (*calc)[2]
 
 	return 1;
 }
+
+static int xmpTimeStep (struct cpifaceSessionAPI_t *cpifaceSession, int ticks, uint32_t *length)
+{
+	while (ticks--)
+	{
+		xmpFindTick();
+		if (timelooped)
+		{
+			*length=timelength;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+OCP_INTERNAL void xmpTimeStart (struct cpifaceSessionAPI_t *cpifaceSession, struct xmodule *m)
+{
+	uint32_t hash=0;
+	unsigned int i;
+
+	hash=cpifaceSession->SongTimeHash (hash, &m->nchan, sizeof (m->nchan));
+	hash=cpifaceSession->SongTimeHash (hash, &m->loopord, sizeof (m->loopord));
+	hash=cpifaceSession->SongTimeHash (hash, &m->initempo, sizeof (m->initempo));
+	hash=cpifaceSession->SongTimeHash (hash, &m->inibpm, sizeof (m->inibpm));
+	hash=cpifaceSession->SongTimeHash (hash, m->orders, sizeof (m->orders[0]) * m->nord);
+	hash=cpifaceSession->SongTimeHash (hash, m->patlens, sizeof (m->patlens[0]) * m->npat);
+	for (i=0; i<m->npat; i++)
+		if (m->patterns[i])
+			hash=cpifaceSession->SongTimeHash (hash, m->patterns[i], m->patlens[i] * m->nchan * sizeof (m->patterns[i][0]));
+
+	xmpTimeReset (m, 0, 0, 0);
+	timesession=cpifaceSession;
+
+	cpifaceSession->SongTimeRegister (cpifaceSession, "XMTime", hash, m->nord, xmpTimeStep);
+}
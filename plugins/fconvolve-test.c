@@ -0,0 +1,222 @@
+/* OpenCP Module Player
+ * copyright (c) 2026 Stian Skjelstad <stian.skjelstad@gmail.com>
+ *
+ * Test for fconvolve.c. The partitioned FFT convolution must give the same
+ * output as a direct convolution in the time domain, one partition late.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "fconvolve.c"
+
+#define SAMPLES 20000
+#define MAXCHUNK 1500
+
+static int test_mcpGet (struct cpifaceSessionAPI_t *cpifaceSession, int ch, int opt)
+{
+	return (opt == mcpMasterReverb) ? 32 : 0;
+}
+
+static uint32_t random_state;
+
+static int random_int (int n)
+{ /* not rand(), so the test does not depend on the C library */
+	random_state = random_state * 1103515245 + 12345;
+	return (random_state >> 16) % n;
+}
+
+static float random_float (void)
+{
+	return (random_int (65536) - 32768) / 32768.0f;
+}
+
+static void put_u16 (uint8_t *p, uint32_t v)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+}
+
+static void put_u32 (uint8_t *p, uint32_t v)
+{
+	put_u16 (p, v);
+	put_u16 (p + 2, v >> 16);
+}
+
+/* a 16 bit stereo WAVE file with an extra chunk in front of the data */
+static uint8_t *make_wave (const int16_t *samples, int length, int rate, uint32_t *size)
+{
+	uint8_t *w;
+	int i;
+
+	*size = 12 + 24 + 10 + 8 + length * 4;
+	w = calloc (*size, 1);
+	memcpy (w, "RIFF", 4);
+	put_u32 (w + 4, *size - 8);
+	memcpy (w + 8, "WAVE", 4);
+	memcpy (w + 12, "fmt ", 4);
+	put_u32 (w + 16, 16);
+	put_u16 (w + 20, 1);
+	put_u16 (w + 22, 2);
+	put_u32 (w + 24, rate);
+	put_u32 (w + 28, rate * 4);
+	put_u16 (w + 32, 4);
+	put_u16 (w + 34, 16);
+	memcpy (w + 36, "LIST", 4);
+	put_u32 (w + 40, 1); /* odd length, padded */
+	memcpy (w + 46, "data", 4);
+	put_u32 (w + 50, length * 4);
+	for (i = 0; i < length * 2; i++)
+	{
+		put_u16 (w + 54 + i * 2, samples[i]);
+	}
+	return w;
+}
+
+static int test_wave (void)
+{
+	int16_t samples[2000];
+	uint32_t size;
+	uint8_t *w;
+	float *left, *right;
+	int length, rate;
+	int errors = 0;
+	int i;
+
+	random_state = 1;
+	for (i = 0; i < 2000; i++)
+	{
+		samples[i] = random_int (65536) - 32768;
+	}
+	w = make_wave (samples, 1000, 22050, &size);
+
+	if (conv_parse_wave (w, size, &left, &right, &length, &rate))
+	{
+		fprintf (stderr, "WAVE file: conv_parse_wave() failed\n");
+		free (w);
+		return 1;
+	}
+	if ((length != 1000) || (rate != 22050))
+	{
+		fprintf (stderr, "WAVE file: got %d samples at %d Hz, expected 1000 samples at 22050 Hz\n", length, rate);
+		errors++;
+	}
+	for (i = 0; (i < length) && (i < 1000); i++)
+	{
+		if ((left[i] != samples[i * 2] / 32768.0f) || (right[i] != samples[i * 2 + 1] / 32768.0f))
+		{
+			fprintf (stderr, "WAVE file: sample %d differs\n", i);
+			errors++;
+			break;
+		}
+	}
+	free (left);
+	free (right);
+
+	memcpy (w + 8, "AVI ", 4);
+	if (!conv_parse_wave (w, size, &left, &right, &length, &rate))
+	{
+		fprintf (stderr, "WAVE file: a file that is not WAVE was accepted\n");
+		free (left);
+		free (right);
+		errors++;
+	}
+	free (w);
+
+	fprintf (stderr, "WAVE file: %s\n", errors ? "FAILED" : "ok");
+	return errors;
+}
+
+/* the impulse response is decaying noise, different on left and right */
+static int test_convolution (int irlength)
+{
+	struct cpifaceSessionAPI_t session;
+	float *hl = malloc (sizeof (float) * irlength);
+	float *hr = malloc (sizeof (float) * irlength);
+	float *input = malloc (sizeof (float) * 2 * SAMPLES);
+	float *output = malloc (sizeof (float) * 2 * SAMPLES);
+	const float gain = test_mcpGet (0, 0, mcpMasterReverb) / 64.0;
+	double maxerror = 0, peak = 0;
+	int i, chunk;
+
+	memset (&session, 0, sizeof (session));
+	session.mcpGet = test_mcpGet;
+
+	random_state = irlength;
+	for (i = 0; i < irlength; i++)
+	{
+		hl[i] = random_float () * exp (-4.0 * i / irlength);
+		hr[i] = random_float () * exp (-4.0 * i / irlength);
+	}
+	for (i = 0; i < SAMPLES * 2; i++)
+	{
+		input[i] = ((i / 4000) % 3 != 2) ? random_float () : 0;
+	}
+	memcpy (output, input, sizeof (float) * 2 * SAMPLES);
+
+	fConvolve_init (44100);
+	conv_set_impulse (hl, hr, irlength);
+	for (i = 0; i < SAMPLES; i += chunk)
+	{ /* the mixer hands over blocks of varying length */
+		chunk = 1 + random_int (MAXCHUNK);
+		if (chunk > SAMPLES - i) chunk = SAMPLES - i;
+		fConvolve_process (&session, output + i * 2, chunk, 44100);
+	}
+	fConvolve_close ();
+
+	for (i = 0; i < SAMPLES; i++)
+	{
+		double l = input[i * 2], r = input[i * 2 + 1];
+		int j;
+
+		for (j = 0; j < irlength; j++)
+		{
+			const int k = i - CONV_PARTITION - j;
+			if (k < 0)
+			{
+				break;
+			}
+			l += gain * hl[j] * input[k * 2];
+			r += gain * hr[j] * input[k * 2 + 1];
+		}
+		if (fabs (l) > peak) peak = fabs (l);
+		if (fabs (r) > peak) peak = fabs (r);
+		if (fabs (output[i * 2] - l) > maxerror) maxerror = fabs (output[i * 2] - l);
+		if (fabs (output[i * 2 + 1] - r) > maxerror) maxerror = fabs (output[i * 2 + 1] - r);
+	}
+
+	free (hl);
+	free (hr);
+	free (input);
+	free (output);
+
+	fprintf (stderr, "impulse response of %5d samples: max error %g of peak %g, %s\n", irlength, maxerror, peak, (maxerror > peak * 1e-5) ? "FAILED" : "ok");
+	return maxerror > peak * 1e-5;
+}
+
+int main (int argc, char *argv[])
+{
+	static const int irlengths[] = {1, 100, CONV_PARTITION, CONV_PARTITION + 1, 3000, 12345};
+	int errors = 0;
+	int i;
+
+	errors += test_wave ();
+	for (i = 0; i < (sizeof (irlengths) / sizeof (irlengths[0])); i++)
+	{
+		errors += test_convolution (irlengths[i]);
+	}
+
+	fprintf (stderr, "Final result: %d errors\n", errors);
+	return !!errors;
+}
@@ -0,0 +1,734 @@
+/* OpenCP Module Player
+ * copyright (c) 2026 Stian Skjelstad <stian.skjelstad@gmail.com>
+ *
+ * Floating point convolution reverb, using impulse responses from WAV files in the configuration directory
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/* The impulse response is cut into partitions of CONV_PARTITION samples, and every partition is stored as the
+ * spectrum of itself padded with zeroes to CONV_FFTSIZE. The input is handled with overlap-save: every time a new
+ * partition of input is complete, the spectrum of the last CONV_FFTSIZE input samples is added to a frequency domain
+ * delay line. Multiplying the delay line with the impulse response spectra and summing gives the spectrum of the
+ * output, and the last CONV_PARTITION samples of its inverse is the next block of output.
+ *
+ * Every block costs one forward and one inverse FFT, independent of the impulse response length, and the output is
+ * delayed by one partition. Left and right are real signals, so both channels share one complex FFT.
+ */
+
+#include "config.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "types.h"
+#include "boot/plinkman.h"
+#include "boot/psetting.h"
+#include "cpiface/cpiface.h"
+#include "cpiface/vol.h"
+#include "dev/mcp.h"
+#include "dev/postproc.h"
+#include "filesel/dirdb.h"
+#include "filesel/filesystem.h"
+#include "stuff/err.h"
+
+#define CONV_PARTITION   256                    /* latency, and the length of each impulse response partition */
+#define CONV_FFTSIZE     (CONV_PARTITION * 2)
+#define CONV_BINS        (CONV_PARTITION + 1)   /* the upper half of the spectrum of a real signal is mirrored */
+#define CONV_MAXSECONDS  10
+#define CONV_MAXFILESIZE (64 * 1024 * 1024)
+#define CONV_MAXFILES    16
+
+static const struct configAPI_t *convconfigAPI;
+static const struct dirdbAPI_t *convdirdbAPI;
+
+static struct ocpfile_t *irfiles[CONV_MAXFILES];
+static int               irfilecount;
+static char              irnames[256];         /* the option list shown for the volume register, cpiface/volctrl.c copies it into a 256 byte buffer */
+
+static struct ocpvolstruct convvol[] =
+{
+	{1, 0, -1, 1, 0, irnames}, /* max is set to -(irfilecount + 1) */
+};
+
+static int running;
+static int samplerate;
+
+static float fft_wr[CONV_FFTSIZE / 2];
+static float fft_wi[CONV_FFTSIZE / 2];
+static uint16_t fft_bitrev[CONV_FFTSIZE];
+
+static int    partitions;                 /* 0 if no impulse response is loaded */
+static float *irspectrum;                 /* partitions * 4 * CONV_BINS: left real, left imaginary, right real, right imaginary */
+static float *fdl;                        /* frequency domain delay line, same layout as irspectrum */
+static int    fdlpos;                     /* the newest entry in fdl */
+
+static float inbuf[2][CONV_FFTSIZE];      /* the last CONV_FFTSIZE samples of input, the second half is being filled */
+static float outbuf[2][CONV_PARTITION];   /* output for the block that is being filled */
+static int   fill;
+
+static void fft_init (void)
+{
+	int i, j, bits;
+
+	for (i = 0; i < CONV_FFTSIZE / 2; i++)
+	{
+		fft_wr[i] = cos (2.0 * M_PI * i / CONV_FFTSIZE);
+		fft_wi[i] = -sin (2.0 * M_PI * i / CONV_FFTSIZE);
+	}
+	for (bits = 0; (1 << bits) < CONV_FFTSIZE; bits++)
+	{
+	}
+	for (i = 0; i < CONV_FFTSIZE; i++)
+	{
+		int r = 0;
+		for (j = 0; j < bits; j++)
+		{
+			if (i & (1 << j))
+			{
+				r |= 1 << (bits - 1 - j);
+			}
+		}
+		fft_bitrev[i] = r;
+	}
+}
+
+/* In-place unscaled forward FFT. Swapping re and im gives the inverse transform */
+static void fft (float *re, float *im)
+{
+	int i, size;
+
+	for (i = 0; i < CONV_FFTSIZE; i++)
+	{
+		int j = fft_bitrev[i];
+		if (j > i)
+		{
+			float t;
+			t = re[i]; re[i] = re[j]; re[j] = t;
+			t = im[i]; im[i] = im[j]; im[j] = t;
+		}
+	}
+
+	for (size = 2; size <= CONV_FFTSIZE; size <<= 1)
+	{
+		const int half = size >> 1;
+		const int step = CONV_FFTSIZE / size;
+		int start, k;
+
+		for (start = 0; start < CONV_FFTSIZE; start += size)
+		{
+			float *ar = re + start, *ai = im + start;
+			float *br = ar + half, *bi = ai + half;
+
+			for (k = 0; k < half; k++)
+			{
+				const float wr = fft_wr[k * step];
+				const float wi = fft_wi[k * step];
+				const float tr = br[k] * wr - bi[k] * wi;
+				const float ti = br[k] * wi + bi[k] * wr;
+				br[k] = ar[k] - tr;
+				bi[k] = ai[k] - ti;
+				ar[k] += tr;
+				ai[k] += ti;
+			}
+		}
+	}
+}
+
+/* Transforms left + i*right and splits the result into the two spectra, bin 0 to CONV_PARTITION. The spectra are
+ * scaled by 2, since the split leaves out the division.
+ */
+static void fft_stereo (float *dst, const float *left, const float *right)
+{
+	float re[CONV_FFTSIZE], im[CONV_FFTSIZE];
+	int k;
+
+	memcpy (re, left, sizeof (re));
+	memcpy (im, right, sizeof (im));
+	fft (re, im);
+
+	for (k = 0; k < CONV_BINS; k++)
+	{
+		const int nk = (CONV_FFTSIZE - k) & (CONV_FFTSIZE - 1);
+		dst[0 * CONV_BINS + k] = re[k] + re[nk];
+		dst[1 * CONV_BINS + k] = im[k] - im[nk];
+		dst[2 * CONV_BINS + k] = im[k] + im[nk];
+		dst[3 * CONV_BINS + k] = re[nk] - re[k];
+	}
+}
+
+static void conv_reset (void)
+{
+	memset (inbuf, 0, sizeof (inbuf));
+	memset (outbuf, 0, sizeof (outbuf));
+	fill = 0;
+	fdlpos = 0;
+	if (fdl)
+	{
+		memset (fdl, 0, sizeof (fdl[0]) * partitions * 4 * CONV_BINS);
+	}
+}
+
+static void conv_clear (void)
+{
+	free (irspectrum);
+	irspectrum = 0;
+	free (fdl);
+	fdl = 0;
+	partitions = 0;
+	conv_reset ();
+}
+
+/* Precomputes the spectra of the impulse response, which must already be at the mixing rate */
+static int conv_set_impulse (const float *left, const float *right, int length)
+{
+	float *spectrum, *delayline;
+	int count = (length + CONV_PARTITION - 1) / CONV_PARTITION;
+	int p;
+
+	conv_clear ();
+	if (count <= 0)
+	{
+		return 0;
+	}
+
+	spectrum = malloc (sizeof (spectrum[0]) * count * 4 * CONV_BINS);
+	delayline = calloc (count * 4 * CONV_BINS, sizeof (delayline[0]));
+	if ((!spectrum) || (!delayline))
+	{
+		free (spectrum);
+		free (delayline);
+		return -1;
+	}
+
+	for (p = 0; p < count; p++)
+	{
+		float l[CONV_FFTSIZE], r[CONV_FFTSIZE];
+		float *s = spectrum + p * 4 * CONV_BINS;
+		int n = length - p * CONV_PARTITION;
+		int k;
+
+		if (n > CONV_PARTITION)
+		{
+			n = CONV_PARTITION;
+		}
+		memset (l, 0, sizeof (l));
+		memset (r, 0, sizeof (r));
+		memcpy (l, left + p * CONV_PARTITION, sizeof (l[0]) * n);
+		memcpy (r, right + p * CONV_PARTITION, sizeof (r[0]) * n);
+		fft_stereo (s, l, r);
+
+		/* the input spectra are scaled by 2 and the inverse FFT by CONV_FFTSIZE, so the division is done here once */
+		for (k = 0; k < 4 * CONV_BINS; k++)
+		{
+			s[k] *= 0.5f / (2 * CONV_FFTSIZE);
+		}
+	}
+
+	irspectrum = spectrum;
+	fdl = delayline;
+	partitions = count;
+	conv_reset ();
+
+	return 0;
+}
+
+/* The second half of inbuf is complete, make the next block of output */
+static void conv_block (void)
+{
+	float yl[2][CONV_BINS], yr[2][CONV_BINS];
+	float re[CONV_FFTSIZE], im[CONV_FFTSIZE];
+	int p, k, slot;
+
+	fdlpos = fdlpos ? fdlpos - 1 : partitions - 1;
+	fft_stereo (fdl + fdlpos * 4 * CONV_BINS, inbuf[0], inbuf[1]);
+
+	memset (yl, 0, sizeof (yl));
+	memset (yr, 0, sizeof (yr));
+	for (p = 0, slot = fdlpos; p < partitions; p++)
+	{
+		const float *h = irspectrum + p * 4 * CONV_BINS;
+		const float *x = fdl + slot * 4 * CONV_BINS;
+
+		for (k = 0; k < CONV_BINS; k++)
+		{
+			yl[0][k] += x[0 * CONV_BINS + k] * h[0 * CONV_BINS + k] - x[1 * CONV_BINS + k] * h[1 * CONV_BINS + k];
+			yl[1][k] += x[0 * CONV_BINS + k] * h[1 * CONV_BINS + k] + x[1 * CONV_BINS + k] * h[0 * CONV_BINS + k];
+			yr[0][k] += x[2 * CONV_BINS + k] * h[2 * CONV_BINS + k] - x[3 * CONV_BINS + k] * h[3 * CONV_BINS + k];
+			yr[1][k] += x[2 * CONV_BINS + k] * h[3 * CONV_BINS + k] + x[3 * CONV_BINS + k] * h[2 * CONV_BINS + k];
+		}
+
+		if (++slot >= partitions)
+		{
+			slot = 0;
+		}
+	}
+
+	/* join the two output spectra as left + i*right, the upper half mirrored */
+	for (k = 0; k < CONV_BINS; k++)
+	{
+		re[k] = yl[0][k] - yr[1][k];
+		im[k] = yl[1][k] + yr[0][k];
+	}
+	for (k = CONV_BINS; k < CONV_FFTSIZE; k++)
+	{
+		const int m = CONV_FFTSIZE - k;
+		re[k] = yl[0][m] + yr[1][m];
+		im[k] = yr[0][m] - yl[1][m];
+	}
+	fft (im, re);
+
+	memcpy (outbuf[0], re + CONV_PARTITION, sizeof (outbuf[0]));
+	memcpy (outbuf[1], im + CONV_PARTITION, sizeof (outbuf[1]));
+
+	memcpy (inbuf[0], inbuf[0] + CONV_PARTITION, sizeof (inbuf[0][0]) * CONV_PARTITION);
+	memcpy (inbuf[1], inbuf[1] + CONV_PARTITION, sizeof (inbuf[1][0]) * CONV_PARTITION);
+}
+
+static uint32_t wave_u16 (const uint8_t *p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+static uint32_t wave_u32 (const uint8_t *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* Parses a RIFF WAVE file with 8, 16, 24 or 32 bit PCM, or 32 bit float samples. Mono files gives the same data in
+ * left and right, and channels after the first two are ignored.
+ */
+static int conv_parse_wave (const uint8_t *data, uint32_t len, float **left, float **right, int *length, int *rate)
+{
+	const uint8_t *fmt = 0, *samples = 0;
+	uint32_t fmtlen = 0, sampleslen = 0;
+	uint32_t pos = 12;
+	int format, channels, bits, blockalign;
+	int i, n;
+
+	*left = *right = 0;
+
+	if ((len < 12) || memcmp (data, "RIFF", 4) || memcmp (data + 8, "WAVE", 4))
+	{
+		return -1;
+	}
+
+	while ((pos + 8) <= len)
+	{
+		uint32_t chunklen = wave_u32 (data + pos + 4);
+		if (chunklen > (len - pos - 8))
+		{
+			chunklen = len - pos - 8; /* truncated file */
+		}
+		if (!memcmp (data + pos, "fmt ", 4))
+		{
+			fmt = data + pos + 8;
+			fmtlen = chunklen;
+		} else if (!memcmp (data + pos, "data", 4))
+		{
+			samples = data + pos + 8;
+			sampleslen = chunklen;
+		}
+		pos += 8 + chunklen + (chunklen & 1);
+	}
+
+	if ((!fmt) || (fmtlen < 16) || (!samples))
+	{
+		return -1;
+	}
+	format = wave_u16 (fmt);
+	channels = wave_u16 (fmt + 2);
+	*rate = wave_u32 (fmt + 4);
+	blockalign = wave_u16 (fmt + 12);
+	bits = wave_u16 (fmt + 14);
+	if ((format == 0xfffe) && (fmtlen >= 26))
+	{ /* WAVE_FORMAT_EXTENSIBLE, the format is the start of the sub-format GUID */
+		format = wave_u16 (fmt + 24);
+	}
+	if ((channels < 1) || (*rate < 1000) || (*rate > 768000) ||
+	    (!(((format == 1) && ((bits == 8) || (bits == 16) || (bits == 24) || (bits == 32))) ||
+	       ((format == 3) && (bits == 32)))) ||
+	    (blockalign < (channels * bits / 8)))
+	{
+		return -1;
+	}
+
+	n = sampleslen / blockalign;
+	if (n > (CONV_MAXSECONDS * *rate))
+	{
+		n = CONV_MAXSECONDS * *rate;
+	}
+	if (!n)
+	{
+		return -1;
+	}
+	*left = malloc (sizeof (float) * n);
+	*right = malloc (sizeof (float) * n);
+	if ((!*left) || (!*right))
+	{
+		free (*left);
+		free (*right);
+		*left = *right = 0;
+		return -1;
+	}
+
+	for (i = 0; i < n; i++)
+	{
+		int c;
+		for (c = 0; c < 2; c++)
+		{
+			const uint8_t *s = samples + i * blockalign + ((c < channels) ? c : 0) * (bits / 8);
+			float v;
+
+			switch (bits)
+			{
+				case 8:  v = (s[0] - 128) / 128.0f; break;
+				case 16: v = (int16_t)wave_u16 (s) / 32768.0f; break;
+				case 24: v = (int32_t)((s[0] << 8) | (s[1] << 16) | ((uint32_t)s[2] << 24)) / 2147483648.0f; break;
+				default:
+					if (format == 3)
+					{
+						uint32_t u = wave_u32 (s);
+						memcpy (&v, &u, sizeof (v));
+						if (!isfinite (v))
+						{
+							v = 0;
+						}
+					} else {
+						v = (int32_t)wave_u32 (s) / 2147483648.0f;
+					}
+					break;
+			}
+			(c ? *right : *left)[i] = v;
+		}
+	}
+	*length = n;
+
+	return 0;
+}
+
+/* Converts the impulse response to the mixing rate with linear interpolation, and scales it to unity energy so the
+ * reverb level does not depend on how the file was recorded.
+ */
+static int conv_prepare (float **left, float **right, int *length, int rate)
+{
+	double energy = 0;
+	float scale;
+	int i, c;
+
+	if (rate != samplerate)
+	{
+		const double step = (double)rate / samplerate;
+		int n = (double)*length * samplerate / rate;
+		float *l, *r;
+
+		if (n < 1)
+		{
+			n = 1;
+		}
+		l = malloc (sizeof (float) * n);
+		r = malloc (sizeof (float) * n);
+		if ((!l) || (!r))
+		{
+			free (l);
+			free (r);
+			return -1;
+		}
+		for (i = 0; i < n; i++)
+		{
+			const double x = i * step;
+			const int j = x;
+			const float f = x - j;
+			const int j2 = (j + 1 < *length) ? j + 1 : j;
+			l[i] = (*left)[j]  + f * ((*left)[j2]  - (*left)[j]);
+			r[i] = (*right)[j] + f * ((*right)[j2] - (*right)[j]);
+		}
+		free (*left);
+		free (*right);
+		*left = l;
+		*right = r;
+		*length = n;
+	}
+
+	for (c = 0; c < 2; c++)
+	{
+		const float *s = c ? *right : *left;
+		for (i = 0; i < *length; i++)
+		{
+			energy += s[i] * s[i];
+		}
+	}
+	if (energy <= 0)
+	{
+		return -1;
+	}
+	scale = 1.0 / sqrt (energy / 2);
+	for (i = 0; i < *length; i++)
+	{
+		(*left)[i] *= scale;
+		(*right)[i] *= scale;
+	}
+
+	return 0;
+}
+
+static void conv_load (int n)
+{
+	struct ocpfilehandle_t *fh;
+	const char *name = 0;
+	uint8_t *data;
+	uint64_t size;
+	float *left, *right;
+	int length, rate;
+
+	conv_clear ();
+	if ((n < 0) || (n >= irfilecount))
+	{
+		return;
+	}
+	convdirdbAPI->GetName_internalstr (irfiles[n]->dirdb_ref, &name);
+
+	if (!(fh = irfiles[n]->open (irfiles[n])))
+	{
+		fprintf (stderr, "fConvolve: failed to open %s\n", name);
+		return;
+	}
+	size = fh->filesize (fh);
+	if ((size < 12) || (size > CONV_MAXFILESIZE))
+	{
+		fprintf (stderr, "fConvolve: %s has an invalid size\n", name);
+		fh->unref (fh);
+		return;
+	}
+	if (!(data = malloc (size)))
+	{
+		fh->unref (fh);
+		return;
+	}
+	if (fh->read (fh, data, size) != size)
+	{
+		fprintf (stderr, "fConvolve: failed to read %s\n", name);
+		free (data);
+		fh->unref (fh);
+		return;
+	}
+	fh->unref (fh);
+
+	if (conv_parse_wave (data, size, &left, &right, &length, &rate))
+	{
+		fprintf (stderr, "fConvolve: %s is not a supported WAVE file\n", name);
+		free (data);
+		return;
+	}
+	free (data);
+
+	if (conv_prepare (&left, &right, &length, rate) || conv_set_impulse (left, right, length))
+	{
+		fprintf (stderr, "fConvolve: failed to prepare %s\n", name);
+	}
+	free (left);
+	free (right);
+}
+
+static void conv_scan_file (void *token, struct ocpfile_t *file)
+{
+	const char *name = 0;
+	int len;
+
+	convdirdbAPI->GetName_internalstr (file->dirdb_ref, &name);
+	len = strlen (name);
+	if ((len < 5) || strcasecmp (name + len - 4, ".wav"))
+	{
+		return;
+	}
+	if ((irfilecount >= CONV_MAXFILES) || ((strlen (irnames) + 1 + len) >= sizeof (irnames)))
+	{
+		fprintf (stderr, "fConvolve: too many impulse responses, ignoring %s\n", name);
+		return;
+	}
+	strcat (irnames, "\t");
+	strcat (irnames, name);
+	irfiles[irfilecount++] = file;
+	file->ref (file);
+}
+
+static void conv_scan_dir (void *token, struct ocpdir_t *dir)
+{
+}
+
+static void conv_scan (void)
+{
+	ocpdirhandle_pt d;
+
+	snprintf (irnames, sizeof (irnames), "impulse response\tnone");
+	if ((!convconfigAPI) || (!convconfigAPI->ConfigHomeDir))
+	{
+		return;
+	}
+	if ((d = convconfigAPI->ConfigHomeDir->readdir_start (convconfigAPI->ConfigHomeDir, conv_scan_file, conv_scan_dir, 0)))
+	{
+		while (convconfigAPI->ConfigHomeDir->readdir_iterate (d));
+		convconfigAPI->ConfigHomeDir->readdir_cancel (d);
+	}
+}
+
+static void fConvolve_close (void)
+{
+	int i;
+
+	running = 0;
+	conv_clear ();
+	for (i = 0; i < irfilecount; i++)
+	{
+		irfiles[i]->unref (irfiles[i]);
+	}
+	irfilecount = 0;
+}
+
+static void fConvolve_init (int rate)
+{
+	samplerate = rate;
+	fft_init ();
+	conv_scan ();
+
+	convvol[0].max = -(irfilecount + 1);
+	if (convvol[0].val > irfilecount)
+	{
+		convvol[0].val = irfilecount ? 1 : 0;
+	}
+	conv_load (convvol[0].val - 1);
+
+	running = 1;
+}
+
+static void fConvolve_process (struct cpifaceSessionAPI_t *cpifaceSession, float *buf, int len, int rate)
+{
+	float gain;
+	int i;
+
+	if (!partitions)
+	{
+		return;
+	}
+
+	if (!cpifaceSession->mcpGet)
+	{
+		gain = 0;
+	} else {
+		gain = cpifaceSession->mcpGet (cpifaceSession, 0, mcpMasterReverb) / 64.0;
+	}
+	if (gain <= 0)
+	{
+		return;
+	}
+
+	for (i = 0; i < len;)
+	{
+		int n = CONV_PARTITION - fill;
+		int k;
+
+		if (n > len - i)
+		{
+			n = len - i;
+		}
+		for (k = 0; k < n; k++)
+		{
+			inbuf[0][CONV_PARTITION + fill + k] = buf[(i + k) * 2];
+			inbuf[1][CONV_PARTITION + fill + k] = buf[(i + k) * 2 + 1];
+			buf[(i + k) * 2]     += outbuf[0][fill + k] * gain;
+			buf[(i + k) * 2 + 1] += outbuf[1][fill + k] * gain;
+		}
+		fill += n;
+		i += n;
+
+		if (fill == CONV_PARTITION)
+		{
+			conv_block ();
+			fill = 0;
+		}
+	}
+}
+
+static int fConvolve_processkey (uint16_t key)
+{
+	return 0;
+}
+
+static int fConvolve_GetNumVolume (void)
+{
+	return sizeof (convvol) / sizeof (convvol[0]);
+}
+
+static int fConvolve_GetVolume (struct ocpvolstruct *v, int n)
+{
+	if (running && (n < (sizeof (convvol) / sizeof (convvol[0]))))
+	{
+		*v = convvol[n];
+		return !0;
+	}
+	return 0;
+}
+
+static int fConvolve_SetVolume (struct ocpvolstruct *v, int n)
+{
+	if (n == 0)
+	{
+		if (convvol[0].val != v->val)
+		{
+			convvol[0].val = v->val;
+			if (running)
+			{
+				conv_load (convvol[0].val - 1);
+			}
+		}
+		return !0;
+	}
+	return 0;
+}
+
+static const struct ocpvolregstruct volconv =
+{
+	fConvolve_GetNumVolume,
+	fConvolve_GetVolume,
+	fConvolve_SetVolume
+};
+
+static struct PostProcFPRegStruct fConvolve =
+{
+	"fConvolve",
+	fConvolve_process,
+	fConvolve_init,
+	fConvolve_close,
+	&volconv,
+	fConvolve_processkey
+};
+
+static int fConvolvePluginInit (struct PluginInitAPI_t *API)
+{
+	convconfigAPI = API->configAPI;
+	convdirdbAPI = API->dirdb;
+	API->mcpRegisterPostProcFP (&fConvolve);
+
+	return errOk;
+}
+
+static void fConvolvePluginClose (struct PluginCloseAPI_t *API)
+{
+	API->mcpUnregisterPostProcFP (&fConvolve);
+}
+
+DLLEXTINFO_DRIVER_PREFIX struct linkinfostruct dllextinfo = {.name = "fconvolve", .desc = "OpenCP floating point convolution reverb (c) 2026 Stian Skjelstad", .ver = DLLVERSION, .sortindex = 99, .PluginInit = fConvolvePluginInit, .PluginClose = fConvolvePluginClose};
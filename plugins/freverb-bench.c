@@ -0,0 +1,186 @@
+/* OpenCP Module Player
+ * copyright (c) 2026 Stian Skjelstad <stian.skjelstad@gmail.com>
+ *
+ * Micro-benchmark for the block based reverb in freverb.c
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "freverb.c"
+#include <string.h>
+#include <time.h>
+
+#define SECONDS 20
+#define MAXCHUNK 2048
+
+static int mcpGet (struct cpifaceSessionAPI_t *cpifaceSession, int ch, int opt)
+{
+	return (opt == mcpMasterReverb) ? 64 : 0;
+}
+
+/* the reverb the way fReverb_process() did it before, one sample at the time */
+static float reference_doreverb (float inp, int32_t *pos, float *lines[], float lpf[])
+{
+	float asum = 0;
+	float y1, y2, z;
+	int i;
+
+	inp *= 0.25;
+
+	for (i=0; i<4; i++)
+	{
+		                   lpf[i] += lpfval * (inp + gainsf[i] * lines[i][pos[i]] - lpf[i]);
+		lines[i][pos[i]] = lpf[i];
+		asum            += lpf[i];
+	}
+
+	y1 = lines[4][pos[4]];
+	z = gainsf[4] * y1 + asum;
+	lines[4][pos[4]] = z;
+
+	y2 = lines[5][pos[5]];
+	z = gainsf[5] * y2 + y1 - gainsf[4] * z;
+	lines[5][pos[5]] = z;
+
+	asum = y2 - gainsf[5] * z;
+
+	return asum;
+}
+
+static void reference_process (float *buf, int len)
+{
+	const float outgainr = 1.0;
+	int i;
+
+	for (i=0; i<len; i++)
+	{
+		int j;
+		float v1, v2;
+
+		for (j=0; j<6; j++)
+		{
+			if (++lpos[j]>=llen[j]) lpos[j]=0;
+			if (++rpos[j]>=rlen[j]) rpos[j]=0;
+		}
+
+		v1 = buf[i*2  ];
+		v2 = buf[i*2+1];
+		lpl += lpconst*(v1-lpl);
+		lpr += lpconst*(v2-lpr);
+
+		buf[i*2  ]+=reference_doreverb(v2-lpr, rpos, rightl, rlpf) * outgainr;
+		buf[i*2+1]+=reference_doreverb(v1-lpl, lpos,  leftl, llpf) * outgainr;
+	}
+}
+
+static double now (void)
+{
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+static uint32_t random_state;
+
+static int random_int (int n)
+{
+	random_state = random_state * 1103515245 + 12345;
+	return (random_state >> 16) % n;
+}
+
+/* bursts of noise with silence in between, so the reverb tail is exercised too */
+static void fill_input (float *buf, int samples, int rate)
+{
+	int i;
+	random_state = 1;
+	for (i = 0; i < samples; i++)
+	{
+		int burst = ((i / (rate / 4)) % 3) != 2;
+		buf[i*2  ] = burst ? (random_int (65536) - 32768) : 0;
+		buf[i*2+1] = burst ? (random_int (65536) - 32768) : 0;
+	}
+}
+
+int main (int argc, char *argv[])
+{
+	static const int rates[] = {44100, 48000, 96000};
+	struct cpifaceSessionAPI_t session;
+	int errors = 0;
+	int r;
+
+	memset (&session, 0, sizeof (session));
+	session.mcpGet = mcpGet;
+
+	for (r = 0; r < (sizeof (rates) / sizeof (rates[0])); r++)
+	{
+		const int rate = rates[r];
+		const int samples = rate * SECONDS;
+		float *input = malloc (sizeof (float) * 2 * samples);
+		float *a = malloc (sizeof (float) * 2 * samples);
+		float *b = malloc (sizeof (float) * 2 * samples);
+		float peak = 0, maxdiff = 0;
+		double t0, t1, t2;
+		int i, chunk;
+
+		fill_input (input, samples, rate);
+		memcpy (a, input, sizeof (float) * 2 * samples);
+		memcpy (b, input, sizeof (float) * 2 * samples);
+
+		/* the mixer hands over blocks of varying length */
+		fReverb_init (rate);
+		random_state = 2;
+		t0 = now ();
+		for (i = 0; i < samples; i += chunk)
+		{
+			chunk = 1 + random_int (MAXCHUNK);
+			if (chunk > samples - i) chunk = samples - i;
+			fReverb_process (&session, a + i * 2, chunk, rate);
+		}
+		t1 = now ();
+		fReverb_close ();
+
+		fReverb_init (rate);
+		random_state = 2;
+		for (i = 0; i < samples; i += chunk)
+		{
+			chunk = 1 + random_int (MAXCHUNK);
+			if (chunk > samples - i) chunk = samples - i;
+			reference_process (b + i * 2, chunk);
+		}
+		t2 = now ();
+		fReverb_close ();
+
+		for (i = 0; i < samples * 2; i++)
+		{
+			float diff = (a[i] == b[i]) ? 0 : fabsf (a[i] - b[i]);
+			if (diff != diff) diff = INFINITY; /* NaN */
+			if (fabsf (b[i]) > peak) peak = fabsf (b[i]);
+			if (diff > maxdiff) maxdiff = diff;
+		}
+		if (maxdiff > peak * 1e-6f)
+		{
+			errors++;
+		}
+
+		printf ("rate %d: %.1f Msamples/s (reference %.1f Msamples/s), speed-up %.2fx, max error %g of peak %g%s\n",
+			rate, samples / (t1 - t0) / 1e6, samples / (t2 - t1) / 1e6, (t2 - t1) / (t1 - t0), maxdiff, peak, (maxdiff > peak * 1e-6f) ? " FAILED" : "");
+
+		free (input);
+		free (a);
+		free (b);
+	}
+
+	return !!errors;
+}
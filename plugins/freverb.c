@@ -24,6 +24,9 @@
 #include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
 #include "types.h"
 #include "boot/plinkman.h"
 #include "cpiface/cpiface.h"
@@ -221,32 +224,87 @@ fail:
 	fReverb_close ();
 }
 
-static float doreverb(float inp, int32_t *pos, float *lines[], float lpf[])
-{
-	float asum = 0;
-	float y1, y2, z;
-	int i;
+#define REVERB_BLOCK 128
 
-	inp *= 0.25;
+/* Runs n samples through the 4 comb filters and the 2 allpass filters. start[] is where each delay line is read and
+ * written for the first sample, and the caller makes sure that no delay line wraps within the block. Every slot is
+ * read before it is written, so the block can be done one filter at the time.
+ */
+static void doreverb (const float *inp, float *out, int n, const int32_t *start, float *lines[], float lpf[])
+{
+	float asum[REVERB_BLOCK];
+	float *a = lines[4] + start[4];
+	float *b = lines[5] + start[5];
+	int k;
+
+#ifdef __SSE2__
+	{ /* the comb filters as four lanes */
+		float *l0 = lines[0] + start[0];
+		float *l1 = lines[1] + start[1];
+		float *l2 = lines[2] + start[2];
+		float *l3 = lines[3] + start[3];
+		const __m128 gain = _mm_loadu_ps (gainsf);
+		const __m128 f = _mm_set1_ps (lpfval);
+		__m128 v = _mm_loadu_ps (lpf);
+		__m128 lanes[REVERB_BLOCK];
+
+		for (k=0; k<n; k++)
+		{
+			__m128 d = _mm_setr_ps (l0[k], l1[k], l2[k], l3[k]);
+			v = _mm_add_ps (v, _mm_mul_ps (f, _mm_sub_ps (_mm_add_ps (_mm_set1_ps (inp[k]), _mm_mul_ps (gain, d)), v)));
+			lanes[k] = v;
+		}
+		_mm_storeu_ps (lpf, v);
 
-	for (i=0; i<4; i++)
+		for (k=0; k<n; k++)
+		{
+			float t[4];
+			_mm_storeu_ps (t, lanes[k]);
+			l0[k] = t[0];
+			l1[k] = t[1];
+			l2[k] = t[2];
+			l3[k] = t[3];
+			asum[k] = t[0] + t[1] + t[2] + t[3];
+		}
+	}
+#else
 	{
-		                   lpf[i] += lpfval * (inp + gainsf[i] * lines[i][pos[i]] - lpf[i]);
-		lines[i][pos[i]] = lpf[i];
-		asum            += lpf[i];
+		int i;
+
+		for (k=0; k<n; k++)
+		{
+			asum[k] = 0;
+		}
+		for (i=0; i<4; i++)
+		{
+			float *l = lines[i] + start[i];
+			float v = lpf[i];
+
+			for (k=0; k<n; k++)
+			{
+				v += lpfval * (inp[k] + gainsf[i] * l[k] - v);
+				l[k] = v;
+				asum[k] += v;
+			}
+			lpf[i] = v;
+		}
 	}
+#endif
 
-	y1 = lines[4][pos[4]];
-	z = gainsf[4] * y1 + asum;
-	lines[4][pos[4]] = z;
+	for (k=0; k<n; k++)
+	{
+		float y1, y2, z;
 
-	y2 = lines[5][pos[5]];
-	z = gainsf[5] * y2 + y1 - gainsf[4] * z;
-	lines[5][pos[5]] = z;
+		y1 = a[k];
+		z = gainsf[4] * y1 + asum[k];
+		a[k] = z;
 
-	asum = y2 - gainsf[5] * z;
+		y2 = b[k];
+		z = gainsf[5] * y2 + y1 - gainsf[4] * z;
+		b[k] = z;
 
-	return asum;
+		out[k] = y2 - gainsf[5] * z;
+	}
 }
 
 static void fReverb_process (struct cpifaceSessionAPI_t *cpifaceSession, float *buf, int len, int rate)
@@ -372,26 +430,49 @@ static void fReverb_process (struct cpifaceSessionAPI_t *cpifaceSession, float *
 
 	if (outgainr > 0)
 	{
-		int i;
-		for (i=0; i<len; i++)
+		int i, n;
+		for (i=0; i<len; i+=n)
 		{
-			int j;
-			float v1, v2;
-
+			float lin[REVERB_BLOCK], rin[REVERB_BLOCK];
+			float lout[REVERB_BLOCK], rout[REVERB_BLOCK];
+			int32_t lstart[6], rstart[6];
+			int j, k;
+
+			// the block ends when the first delay line wraps
+			n = len - i;
+			if (n > REVERB_BLOCK) n = REVERB_BLOCK;
 			for (j=0; j<6; j++)
 			{
-				if (++lpos[j]>=llen[j]) lpos[j]=0;
-				if (++rpos[j]>=rlen[j]) rpos[j]=0;
+				lstart[j] = (lpos[j]+1>=llen[j]) ? 0 : lpos[j]+1;
+				rstart[j] = (rpos[j]+1>=rlen[j]) ? 0 : rpos[j]+1;
+				if (n > llen[j]-lstart[j]) n = llen[j]-lstart[j];
+				if (n > rlen[j]-rstart[j]) n = rlen[j]-rstart[j];
 			}
 
-			v1 = buf[i*2  ];
-			v2 = buf[i*2+1];
-			lpl += lpconst*(v1-lpl);
-			lpr += lpconst*(v2-lpr);
+			for (k=0; k<n; k++)
+			{
+				float v1 = buf[(i+k)*2  ];
+				float v2 = buf[(i+k)*2+1];
+				lpl += lpconst*(v1-lpl);
+				lpr += lpconst*(v2-lpr);
+				lin[k] = (v1-lpl) * 0.25f;
+				rin[k] = (v2-lpr) * 0.25f;
+			}
 
 			// apply reverb
-			buf[i*2  ]+=doreverb(v2-lpr, rpos, rightl, rlpf) * outgainr;
-			buf[i*2+1]+=doreverb(v1-lpl, lpos,  leftl, llpf) * outgainr;
+			doreverb (rin, rout, n, rstart, rightl, rlpf);
+			doreverb (lin, lout, n, lstart,  leftl, llpf);
+			for (k=0; k<n; k++)
+			{
+				buf[(i+k)*2  ]+=rout[k] * outgainr;
+				buf[(i+k)*2+1]+=lout[k] * outgainr;
+			}
+
+			for (j=0; j<6; j++)
+			{
+				lpos[j] = lstart[j]+n-1;
+				rpos[j] = rstart[j]+n-1;
+			}
 		}
 	}
 }
@@ -25,6 +25,9 @@
 #include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
 #include "types.h"
 #include "boot/plinkman.h"
 #include "cpiface/cpiface.h"
@@ -228,32 +231,101 @@ fail:
 	iReverb_close ();
 }
 
-static int doreverb (int32_t inp, int32_t *pos, int32_t *lines[], int32_t lpf[])
+#define REVERB_BLOCK 128
+
+#ifdef __SSE2__
+/* imulshr16() / imulshr24() on four lanes. SSE2 can only multiply unsigned, so the signed product is made by
+ * subtracting a<<32 when b is negative and b<<32 when a is negative from the unsigned product.
+ */
+static inline __m128i mulshr_epi32 (__m128i a, __m128i b, const int shift)
 {
-	int32_t asum=0,
-	        y1, y2, z;
-	int i;
+	const __m128i count = _mm_cvtsi32_si128 (shift);
+	__m128i even = _mm_srl_epi64 (_mm_mul_epu32 (a, b), count);
+	__m128i odd = _mm_srl_epi64 (_mm_mul_epu32 (_mm_srli_epi64 (a, 32), _mm_srli_epi64 (b, 32)), count);
+	__m128i r = _mm_unpacklo_epi32 (_mm_shuffle_epi32 (even, _MM_SHUFFLE (3, 1, 2, 0)), _mm_shuffle_epi32 (odd, _MM_SHUFFLE (3, 1, 2, 0)));
+	__m128i corr = _mm_add_epi32 (_mm_and_si128 (_mm_srai_epi32 (a, 31), b), _mm_and_si128 (_mm_srai_epi32 (b, 31), a));
+	return _mm_sub_epi32 (r, _mm_sll_epi32 (corr, _mm_cvtsi32_si128 (32 - shift)));
+}
+#endif
 
-	inp >>= 2;
+/* Same as doreverb() in freverb.c: n samples through the 4 comb filters and the 2 allpass filters, starting at
+ * start[] in each delay line, and no delay line wraps within the block.
+ */
+static void doreverb (const int32_t *inp, int32_t *out, int n, const int32_t *start, int32_t *lines[], int32_t lpf[])
+{
+	int32_t asum[REVERB_BLOCK];
+	int32_t *a = lines[4] + start[4];
+	int32_t *b = lines[5] + start[5];
+	int k;
+
+#ifdef __SSE2__
+	{ /* the comb filters as four lanes */
+		int32_t *l0 = lines[0] + start[0];
+		int32_t *l1 = lines[1] + start[1];
+		int32_t *l2 = lines[2] + start[2];
+		int32_t *l3 = lines[3] + start[3];
+		const __m128i gain = _mm_loadu_si128 ((__m128i *)gainsf);
+		const __m128i f = _mm_set1_epi32 (lpfval);
+		__m128i v = _mm_loadu_si128 ((__m128i *)lpf);
+		__m128i lanes[REVERB_BLOCK];
+
+		for (k=0; k<n; k++)
+		{
+			__m128i d = _mm_setr_epi32 (l0[k], l1[k], l2[k], l3[k]);
+			v = _mm_add_epi32 (v, mulshr_epi32 (f, _mm_sub_epi32 (_mm_add_epi32 (_mm_set1_epi32 (inp[k]), mulshr_epi32 (gain, d, 16)), v), 24));
+			lanes[k] = v;
+		}
+		_mm_storeu_si128 ((__m128i *)lpf, v);
 
-	for (i=0; i<4; i++)
+		for (k=0; k<n; k++)
+		{
+			int32_t t[4];
+			_mm_storeu_si128 ((__m128i *)t, lanes[k]);
+			l0[k] = t[0];
+			l1[k] = t[1];
+			l2[k] = t[2];
+			l3[k] = t[3];
+			asum[k] = t[0] + t[1] + t[2] + t[3];
+		}
+	}
+#else
 	{
-		                   lpf[i] += imulshr24(lpfval, (inp + imulshr16 (gainsf[i], lines[i][pos[i]]) - lpf[i]));
-		lines[i][pos[i]] = lpf[i];
-		asum            += lpf[i];
+		int i;
+
+		for (k=0; k<n; k++)
+		{
+			asum[k] = 0;
+		}
+		for (i=0; i<4; i++)
+		{
+			int32_t *l = lines[i] + start[i];
+			int32_t v = lpf[i];
+
+			for (k=0; k<n; k++)
+			{
+				v += imulshr24(lpfval, (inp[k] + imulshr16 (gainsf[i], l[k]) - v));
+				l[k] = v;
+				asum[k] += v;
+			}
+			lpf[i] = v;
+		}
 	}
+#endif
 
-	y1 = lines[4][pos[4]];
-	z  = imulshr16(gainsf[4], y1) + asum;
-	lines[4][pos[4]] = z;
+	for (k=0; k<n; k++)
+	{
+		int32_t y1, y2, z;
 
-	y2 = lines[5][pos[5]];
-	z = imulshr16(gainsf[5], y2) + y1 - imulshr16(gainsf[4], z);
-	lines[5][pos[5]] = z;
+		y1 = a[k];
+		z  = imulshr16(gainsf[4], y1) + asum[k];
+		a[k] = z;
 
-	asum = y2 - imulshr16(gainsf[5], z);
+		y2 = b[k];
+		z = imulshr16(gainsf[5], y2) + y1 - imulshr16(gainsf[4], z);
+		b[k] = z;
 
-	return asum;
+		out[k] = y2 - imulshr16(gainsf[5], z);
+	}
 }
 
 static void iReverb_process (struct cpifaceSessionAPI_t *cpifaceSession, int32_t *buf, int len, int rate)
@@ -339,27 +411,51 @@ static void iReverb_process (struct cpifaceSessionAPI_t *cpifaceSession, int32_t
 	}
 	if (outgainreverb > 0)
 	{
-		int i;
-		for (i=0; i<len; i++)
+		int i, n;
+		for (i=0; i<len; i+=n)
 		{
-			int j;
-			int32_t v1, v2;
+			int32_t lin[REVERB_BLOCK], rin[REVERB_BLOCK];
+			int32_t lout[REVERB_BLOCK], rout[REVERB_BLOCK];
+			int32_t lstart[6], rstart[6];
+			int j, k;
+
+			// the block ends when the first delay line wraps
+			n = len - i;
+			if (n > REVERB_BLOCK) n = REVERB_BLOCK;
 			for (j=0; j<6; j++)
 			{
-				if (++lpos[j] >= llen[j]) lpos[j]=0;
-				if (++rpos[j] >= rlen[j]) rpos[j]=0;
+				lstart[j] = (lpos[j]+1 >= llen[j]) ? 0 : lpos[j]+1;
+				rstart[j] = (rpos[j]+1 >= rlen[j]) ? 0 : rpos[j]+1;
+				if (n > llen[j]-lstart[j]) n = llen[j]-lstart[j];
+				if (n > rlen[j]-rstart[j]) n = rlen[j]-rstart[j];
 			}
 
-			v1 = buf[i*2  ];
-			v2 = buf[i*2+1];
-			lpl += imulshr24 (lpconst, (v1 - (lpl>>8)));
-			lpr += imulshr24 (lpconst, (v2 - (lpr>>8)));
-
-			// lpl and lpr is a small "infection" of sound from left to right and back again
+			for (k=0; k<n; k++)
+			{
+				int32_t v1 = buf[(i+k)*2  ];
+				int32_t v2 = buf[(i+k)*2+1];
+				lpl += imulshr24 (lpconst, (v1 - (lpl>>8)));
+				lpr += imulshr24 (lpconst, (v2 - (lpr>>8)));
+
+				// lpl and lpr is a small "infection" of sound from left to right and back again
+				lin[k] = (v1 - (lpl>>8)) >> 2;
+				rin[k] = (v2 - (lpr>>8)) >> 2;
+			}
 
 			// apply reverb
-			buf[i*2  ] += imulshr16 (doreverb (v2 - (lpr>>8), rpos, rightl, rlpf), outgainreverb);
-			buf[i*2+1] += imulshr16 (doreverb (v1 - (lpl>>8), lpos,  leftl, llpf), outgainreverb);
+			doreverb (rin, rout, n, rstart, rightl, rlpf);
+			doreverb (lin, lout, n, lstart,  leftl, llpf);
+			for (k=0; k<n; k++)
+			{
+				buf[(i+k)*2  ] += imulshr16 (rout[k], outgainreverb);
+				buf[(i+k)*2+1] += imulshr16 (lout[k], outgainreverb);
+			}
+
+			for (j=0; j<6; j++)
+			{
+				lpos[j] = lstart[j]+n-1;
+				rpos[j] = rstart[j]+n-1;
+			}
 		}
 	}
 }
@@ -44,6 +44,7 @@
 #include "types.h"
 #include "imsrtns.h"
 #include "poll.h"
+#include "profile.h"
 
 static void (*tmTimerRoutineSlaveAudio)()=NULL;
 static void (*tmTimerRoutineSlaveVideo)()=NULL;
@@ -56,8 +57,15 @@ void tmTimerHandler(enum pollType type)
 			tmTimerRoutineSlaveAudio();
 
 	if (type == pollTypeVideo)
+	{
 		if (tmTimerRoutineSlaveVideo)
+		{
+			uint64_t start = profile_now ();
 			tmTimerRoutineSlaveVideo();
+			profile_add (profileStagePresent, start);
+		}
+		profile_next_frame ();
+	}
 
 }
 
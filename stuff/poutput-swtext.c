@@ -908,12 +908,30 @@ void swtext_displaystr_utf8(uint16_t y, uint16_t x, uint8_t attr, const char *st
 
 int swtext_measurestr_utf8 (const char *src, int srclen)
 {
+	static uint8_t asciiwidth[128]; /* cells + 1, zero if not looked up yet */
 	int retval = 0;
 	while (srclen > 0)
 	{
 		int cp, inc;
 		int fontwidth;
 
+		inc = utf8_ascii_span (src, srclen);
+		if (inc)
+		{
+			srclen -= inc;
+			while (inc--)
+			{
+				uint8_t c = *(src++);
+				if (!asciiwidth[c])
+				{
+					fontengine_8x16 (c, &fontwidth);
+					asciiwidth[c] = 1 + ((fontwidth == 16) ? 2 : (fontwidth == 8) ? 1 : 0);
+				}
+				retval += asciiwidth[c] - 1;
+			}
+			continue;
+		}
+
 		cp = utf8_decode (src, srclen, &inc);
 		src += inc;
 		srclen -= inc;
@@ -0,0 +1,161 @@
+/* OpenCP Module Player
+ * copyright (c) 2026 Stian Skjelstad <stian.skjelstad@gmail.com>
+ *
+ * Scoped timers for the audio and video hot paths
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "config.h"
+#include <string.h>
+#include <time.h>
+#include "types.h"
+#include "profile.h"
+
+/* Each frame has one slot per stage, plus one slot for the buffer fill (in ms) */
+#define PROFILE_SLOTS (profileStageCount + 1)
+#define PROFILE_SLOT_BUFFER profileStageCount
+
+static uint32_t profile_frames[PROFILE_FRAMES][PROFILE_SLOTS];
+static unsigned int profile_current; /* frame currently being accumulated */
+static unsigned int profile_completed; /* number of completed frames in the ring, saturates at PROFILE_FRAMES - 1 */
+static uint32_t profile_buffer_ms;
+static uint32_t profile_xruns; /* counted from the audio callback thread */
+
+static const char *profile_stage_names[profileStageCount] =
+{
+	"player idle",
+	"devw mix",
+	"devw postproc",
+	"devw clip",
+	"devp idle",
+	"devp write",
+	"cpiface draw",
+	"console present"
+};
+
+uint64_t profile_now (void)
+{
+	struct timespec ts;
+
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void profile_add (enum profileStage stage, uint64_t start)
+{
+	uint64_t delta = profile_now () - start;
+
+	if (delta > 0xffffffff)
+	{
+		delta = 0xffffffff;
+	}
+	profile_frames[profile_current][stage] += delta;
+}
+
+void profile_buffer_fill (unsigned int samples, unsigned int rate)
+{
+	if (!rate)
+	{
+		return;
+	}
+	profile_buffer_ms = (uint64_t)samples * 1000 / rate;
+}
+
+void profile_xrun (void)
+{
+	__atomic_fetch_add (&profile_xruns, 1, __ATOMIC_RELAXED);
+}
+
+void profile_next_frame (void)
+{
+	profile_frames[profile_current][PROFILE_SLOT_BUFFER] = profile_buffer_ms;
+
+	profile_current = (profile_current + 1) & (PROFILE_FRAMES - 1);
+	memset (profile_frames[profile_current], 0, sizeof (profile_frames[profile_current]));
+
+	if (profile_completed < (PROFILE_FRAMES - 1))
+	{
+		profile_completed++;
+	}
+}
+
+void profile_reset (void)
+{
+	memset (profile_frames, 0, sizeof (profile_frames));
+	profile_current = 0;
+	profile_completed = 0;
+	profile_buffer_ms = 0;
+	__atomic_store_n (&profile_xruns, 0, __ATOMIC_RELAXED);
+}
+
+static void profile_get_slot (unsigned int slot, struct profileStats_t *stats)
+{
+	uint64_t sum = 0;
+	unsigned int i;
+
+	memset (stats, 0, sizeof (*stats));
+
+	if (!profile_completed)
+	{
+		return;
+	}
+
+	stats->last = profile_frames[(profile_current - 1) & (PROFILE_FRAMES - 1)][slot];
+	stats->min = 0xffffffff;
+	for (i = 1; i <= profile_completed; i++)
+	{
+		uint32_t value = profile_frames[(profile_current - i) & (PROFILE_FRAMES - 1)][slot];
+		sum += value;
+		if (value < stats->min)
+		{
+			stats->min = value;
+		}
+		if (value > stats->max)
+		{
+			stats->max = value;
+		}
+	}
+	stats->avg = sum / profile_completed;
+}
+
+void profile_get_stats (enum profileStage stage, struct profileStats_t *stats)
+{
+	profile_get_slot (stage, stats);
+}
+
+void profile_get_buffer (struct profileStats_t *stats)
+{
+	profile_get_slot (PROFILE_SLOT_BUFFER, stats);
+}
+
+uint32_t profile_get_xruns (void)
+{
+	return __atomic_load_n (&profile_xruns, __ATOMIC_RELAXED);
+}
+
+const char *profile_stage_name (enum profileStage stage)
+{
+	return profile_stage_names[stage];
+}
+
+const struct profileAPI_t profileAPI =
+{
+	profile_now,
+	profile_add,
+	profile_buffer_fill,
+	profile_xrun
+};
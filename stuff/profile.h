@@ -0,0 +1,55 @@
+#ifndef _STUFF_PROFILE_H
+#define _STUFF_PROFILE_H 1
+
+/* Light-weight timing of the hot paths. All timestamps are monotonic and given
+ * in micro-seconds. Measurements are accumulated per video-frame, and the last
+ * PROFILE_FRAMES frames are kept in a ring for the viewer (cpiface/cpiprof.c)
+ */
+
+enum profileStage
+{
+	profileStagePlayerIdle = 0, /* cpiface: playback plugin IsEnd() (includes mixing and device idle when driven from there) */
+	profileStageMix,            /* devw: mixing of channels */
+	profileStagePostProc,       /* devw: post-processing chain */
+	profileStageClip,           /* devw: amplify and clip into the device buffer */
+	profileStageDeviceIdle,     /* devp: plrDevAPI->Idle() */
+	profileStageDeviceWrite,    /* devp: pushing data into kernel/hardware */
+	profileStageDraw,           /* cpiface: Draw() of the active mode */
+	profileStagePresent,        /* console: refresh of the video output */
+	profileStageCount
+};
+
+#define PROFILE_FRAMES 64 /* must be power of two */
+
+struct profileStats_t
+{
+	uint32_t last; /* last completed frame */
+	uint32_t avg;  /* average over the frame ring */
+	uint32_t min;  /* lowest value in the frame ring */
+	uint32_t max;  /* peak value in the frame ring */
+};
+
+uint64_t profile_now (void);
+void profile_add (enum profileStage stage, uint64_t start); /* adds profile_now() - start to the current frame */
+void profile_buffer_fill (unsigned int samples, unsigned int rate); /* samples in the device buffer */
+void profile_xrun (void);
+
+void profile_next_frame (void); /* called once per video frame */
+void profile_reset (void); /* called when a new file starts to play */
+
+void profile_get_stats (enum profileStage stage, struct profileStats_t *stats);
+void profile_get_buffer (struct profileStats_t *stats); /* given in ms */
+uint32_t profile_get_xruns (void);
+const char *profile_stage_name (enum profileStage stage);
+
+struct profileAPI_t
+{
+	uint64_t (*now) (void);
+	void (*add) (enum profileStage stage, uint64_t start);
+	void (*buffer_fill) (unsigned int samples, unsigned int rate);
+	void (*xrun) (void);
+};
+
+extern const struct profileAPI_t profileAPI;
+
+#endif
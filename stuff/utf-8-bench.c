@@ -0,0 +1,223 @@
+/* OpenCP Module Player
+ * copyright (c) 2026 Stian Skjelstad <stian.skjelstad@gmail.com>
+ *
+ * Micro-benchmark for the ASCII fast paths in utf-8.c
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#include "config.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "types.h"
+
+#include "stuff/poutput.h"
+#include "utf-8.h"
+
+#include "utf-8.c"
+
+void framelock(void)
+{
+}
+
+void cpiKeyHelp(uint16_t key, const char *shorthelp)
+{
+}
+
+int cpiKeyHelpDisplay(void)
+{
+	return 0;
+}
+
+void cpiKeyHelpClear(void)
+{
+}
+
+struct console_t Console;
+
+static volatile size_t sink; /* keeps the compiler from optimizing the loops away */
+
+/* the way utf8_casefold() worked before the ASCII fast path, one codepoint at the time */
+static char *reference_casefold (const char *src)
+{
+	int remaining = strlen (src);
+	char *retval = malloc (remaining * 3 + 1);
+	char *dst = retval;
+
+	while (remaining)
+	{
+		int i, inc;
+		uint32_t codepoint = utf8_decode (src, remaining, &inc);
+
+		{ /* binary search */
+			int start = 0;
+			int length = (sizeof (Table_Single) / sizeof (Table_Single[0]));
+			while (length)
+			{
+				int half = length / 2;
+				int diff = (int)Table_Single[start + half].Src - (int)codepoint;
+				if (diff == 0)
+				{
+					dst += utf8_encode (dst, Table_Single[start + half].Dst1);
+					goto next;
+				}
+				if (!half)
+				{
+					break;
+				}
+				if (diff > 0)
+				{
+					length -= half;
+				} else {
+					start += half + 1;
+					length -= half + 1;
+				}
+			}
+		}
+		for (i = 0; i < (sizeof (Table_Double) / sizeof (Table_Double[0])); i++)
+		{
+			if (Table_Double[i].Src == codepoint)
+			{
+				dst += utf8_encode (dst, Table_Double[i].Dst1);
+				dst += utf8_encode (dst, Table_Double[i].Dst2);
+				goto next;
+			}
+		}
+		for (i = 0; i < (sizeof (Table_Triple) / sizeof (Table_Triple[0])); i++)
+		{
+			if (Table_Triple[i].Src == codepoint)
+			{
+				dst += utf8_encode (dst, Table_Triple[i].Dst1);
+				dst += utf8_encode (dst, Table_Triple[i].Dst2);
+				dst += utf8_encode (dst, Table_Triple[i].Dst3);
+				goto next;
+			}
+		}
+		memcpy (dst, src, inc);
+		dst += inc;
+next:
+		remaining -= inc;
+		src += inc;
+	}
+	*dst = 0;
+	return retval;
+}
+
+static double now (void)
+{
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+static const char *samples[] =
+{
+	"01 - Some Artist - A Fairly Typical Module Name (Remix).mod",
+	"the_last_ninja_2_-_central_park_loader.sid",
+	"Jean-Michel Jarre - Équinoxe Part 4.xm",
+	"Ærlig talt, så er ø og å også bokstaver.s3m",
+	"ﬃ ß STRASSE Straße ΣΊΣΥΦΟΣ.it",
+	"",
+};
+
+int main (int argc, char *argv[])
+{
+	const int iterations = 200000;
+	int errors = 0;
+	int i, j;
+
+	for (j = 0; j < (sizeof (samples) / sizeof (samples[0])); j++)
+	{
+		char *a = utf8_casefold (samples[j]);
+		char *b = reference_casefold (samples[j]);
+		double t0, t1, t2;
+		size_t sum = 0;
+
+		if (strcmp (a, b))
+		{
+			printf ("MISMATCH \"%s\": \"%s\" != \"%s\"\n", samples[j], a, b);
+			errors++;
+		}
+		free (a);
+		free (b);
+
+		t0 = now ();
+		for (i = 0; i < iterations; i++)
+		{
+			a = utf8_casefold (samples[j]);
+			sum += a[0];
+			free (a);
+		}
+		t1 = now ();
+		for (i = 0; i < iterations; i++)
+		{
+			a = reference_casefold (samples[j]);
+			sum += a[0];
+			free (a);
+		}
+		t2 = now ();
+
+		printf ("casefold \"%s\": %.1f ns (reference %.1f ns)\n", samples[j], (t1 - t0) * 1e9 / iterations, (t2 - t1) * 1e9 / iterations);
+		sink += sum;
+	}
+
+	for (j = 0; j < (sizeof (samples) / sizeof (samples[0])); j++)
+	{
+		int len = strlen (samples[j]);
+		double t0, t1, t2;
+		size_t sum = 0;
+
+		t0 = now ();
+		for (i = 0; i < iterations; i++)
+		{
+			const char *iter = samples[j];
+			int remaining = len;
+			while (remaining)
+			{
+				int inc = utf8_ascii_span (iter, remaining);
+				if (inc)
+				{
+					sum += inc;
+				} else {
+					sum += utf8_decode (iter, remaining, &inc);
+				}
+				iter += inc;
+				remaining -= inc;
+			}
+		}
+		t1 = now ();
+		for (i = 0; i < iterations; i++)
+		{
+			const char *iter = samples[j];
+			int remaining = len;
+			while (remaining)
+			{
+				int inc;
+				sum += utf8_decode (iter, remaining, &inc);
+				iter += inc;
+				remaining -= inc;
+			}
+		}
+		t2 = now ();
+
+		printf ("scan \"%s\": %.1f ns (utf8_decode loop %.1f ns)\n", samples[j], (t1 - t0) * 1e9 / iterations, (t2 - t1) * 1e9 / iterations);
+		sink += sum;
+	}
+
+	return !!errors;
+}
@@ -25,6 +25,43 @@
 #include "poutput.h"
 #include "utf-8.h"
 
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+
+size_t utf8_ascii_span (const char *src, size_t srclen)
+{
+	size_t i = 0;
+#ifdef __SSE2__
+	for (; (i + 16) <= srclen; i += 16)
+	{
+		int mask = _mm_movemask_epi8 (_mm_loadu_si128 ((const __m128i *)(src + i)));
+		if (mask)
+		{
+			return i + __builtin_ctz (mask);
+		}
+	}
+#else
+	for (; (i + 8) <= srclen; i += 8)
+	{
+		uint64_t word;
+		memcpy (&word, src + i, 8);
+		if (word & 0x8080808080808080ULL)
+		{
+			break;
+		}
+	}
+#endif
+	for (; i < srclen; i++)
+	{
+		if (src[i] & 0x80)
+		{
+			break;
+		}
+	}
+	return i;
+}
+
 //#define UNKNOWN_UNICODE 0xFFFD
 uint32_t utf8_decode (const char *_src, size_t srclen, int *inc)
 {
@@ -746,6 +783,52 @@ static const struct Table_Triple_t Table_Triple[] = {
 #include "CaseFoldingTable-3.c"
 };
 
+/* Case folding of 7-bit ASCII is only A-Z => a-z, so runs of ASCII bytes can skip the tables */
+static int utf8_ascii_hasupper (const char *src, size_t len)
+{
+	size_t i = 0;
+#ifdef __SSE2__
+	const __m128i A = _mm_set1_epi8 ('A' - 1);
+	const __m128i Z = _mm_set1_epi8 ('Z' + 1);
+	for (; (i + 16) <= len; i += 16)
+	{
+		__m128i x = _mm_loadu_si128 ((const __m128i *)(src + i));
+		if (_mm_movemask_epi8 (_mm_and_si128 (_mm_cmpgt_epi8 (x, A), _mm_cmplt_epi8 (x, Z))))
+		{
+			return 1;
+		}
+	}
+#endif
+	for (; i < len; i++)
+	{
+		if ((src[i] >= 'A') && (src[i] <= 'Z'))
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static void utf8_ascii_tolower (char *dst, const char *src, size_t len)
+{
+	size_t i = 0;
+#ifdef __SSE2__
+	const __m128i A = _mm_set1_epi8 ('A' - 1);
+	const __m128i Z = _mm_set1_epi8 ('Z' + 1);
+	const __m128i bit = _mm_set1_epi8 (0x20);
+	for (; (i + 16) <= len; i += 16)
+	{
+		__m128i x = _mm_loadu_si128 ((const __m128i *)(src + i));
+		__m128i upper = _mm_and_si128 (_mm_cmpgt_epi8 (x, A), _mm_cmplt_epi8 (x, Z));
+		_mm_storeu_si128 ((__m128i *)(dst + i), _mm_or_si128 (x, _mm_and_si128 (upper, bit)));
+	}
+#endif
+	for (; i < len; i++)
+	{
+		dst[i] = ((src[i] >= 'A') && (src[i] <= 'Z')) ? (src[i] | 0x20) : src[i];
+	}
+}
+
 char *utf8_casefold (const char *src)
 {
 	int len = strlen (src);
@@ -763,7 +846,20 @@ char *utf8_casefold (const char *src)
 	{
 		int i;
 		int inc;
-		uint32_t codepoint = utf8_decode(iter, remaining, &inc);
+		uint32_t codepoint;
+
+		inc = utf8_ascii_span (iter, remaining);
+		if (inc)
+		{
+			if ((!hit) && utf8_ascii_hasupper (iter, inc))
+			{
+				hit = 1;
+			}
+			newlen += inc;
+			goto prescan_next;
+		}
+
+		codepoint = utf8_decode(iter, remaining, &inc);
 
 #if 0
 		for (i = 0; i < (sizeof (Table_Single) / sizeof (Table_Single[0])); i++)
@@ -848,7 +944,17 @@ prescan_next:
 	{
 		int i;
 		int inc;
-		uint32_t codepoint = utf8_decode(iter, remaining, &inc);
+		uint32_t codepoint;
+
+		inc = utf8_ascii_span (iter, remaining);
+		if (inc)
+		{
+			utf8_ascii_tolower (retvalnext, iter, inc);
+			retvalnext += inc;
+			goto rebuild_next;
+		}
+
+		codepoint = utf8_decode(iter, remaining, &inc);
 
 #if 0
 		for (i = 0; i < (sizeof (Table_Single) / sizeof (Table_Single[0])); i++)
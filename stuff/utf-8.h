@@ -6,6 +6,9 @@
 /* returns non-zero if stream is broken... *length tells how many bytes was consumed, even if stream is broken */
 uint32_t utf8_decode (const char *_src, size_t srclen, int *inc);
 
+/* returns the number of leading bytes that are 7-bit ASCII, these can be used as codepoints directly */
+size_t utf8_ascii_span (const char *src, size_t srclen);
+
 /* returns number of characters needed, excluding zero-termination */
 int utf8_encoded_length (uint32_t codepoint);
 